@@ -0,0 +1,58 @@
+#pragma once
+#include "const.h"
+#include <hiredis/hiredis.h>
+#include <hiredis/async.h>
+#include <boost/asio.hpp>
+#include <functional>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+#include <atomic>
+
+// redis 回复的拷贝，回调返回后 hiredis 会释放原始的 redisReply
+struct RedisValue {
+	int type = REDIS_REPLY_NIL;
+	long long integer = 0;
+	std::string str;
+	std::vector<RedisValue> elements;
+
+	bool IsNil() const { return type == REDIS_REPLY_NIL; }
+	bool IsError() const { return type == REDIS_REPLY_ERROR; }
+	bool IsInteger() const { return type == REDIS_REPLY_INTEGER; }
+	bool IsString() const { return type == REDIS_REPLY_STRING; }
+	bool IsStatus() const { return type == REDIS_REPLY_STATUS; }
+	bool IsArray() const { return type == REDIS_REPLY_ARRAY; }
+
+	static RedisValue FromReply(const redisReply* reply);
+	// 连接不可用、断线等本地错误，和redis返回的错误同样用 ERROR 类型表示
+	static RedisValue Error(const std::string& message);
+};
+
+class AsyncRedisConn;
+
+// 基于 redisAsyncContext 的异步客户端
+// 持有少量长连接，每条连接绑定 AsioIOServicePool 中的一个 io_context，由该线程与会话一起驱动；
+// 并发的命令在同一条连接上直接追加，
+// hiredis 会把同一轮事件循环中积累的命令一次写出，回复按发送顺序依次回调，天然形成流水线
+class AsyncRedis
+{
+public:
+	using Callback = std::function<void(const RedisValue& reply)>;
+	using BatchCallback = std::function<void(std::vector<RedisValue>& replies)>;
+	AsyncRedis(const std::string& host, int port, const std::string& pwd, size_t conns);
+	~AsyncRedis();
+	// 回调在连接所属的io线程中执行，这个线程同时处理会话的读写：不要在回调里、也不要在会话的io线程中
+	// 同步等待redis命令的结果，命令若恰好分到同一个 io_context 会互相等待
+	void Command(std::vector<std::string> args, Callback callback);
+	std::future<RedisValue> Command(std::vector<std::string> args);
+	// 一批命令发往同一条连接并在同一次写操作中发出，全部回复到齐后按加入顺序回调
+	void Batch(std::vector<std::vector<std::string>> commands, BatchCallback callback);
+	std::future<std::vector<RedisValue>> Batch(std::vector<std::vector<std::string>> commands);
+	// 必须在 io 线程池停止之前调用
+	void Close();
+private:
+	std::vector<std::shared_ptr<AsyncRedisConn>> _conns;
+	std::atomic<size_t> _next;
+	std::atomic<bool> _b_stop;
+};
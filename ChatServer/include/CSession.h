@@ -31,6 +31,9 @@ public:
 	std::string& GetSessionId();
 	void SetUserId(int uid);
 	int GetUserId();
+	// ¼ʱõ u_<uid> Ȩ汾
+	void SetFence(long long fence);
+	long long GetFence();
 	void Start();
 	void Send(char* msg,  short max_length, short msgid);
 	void Send(std::string msg, short msgid);
@@ -65,6 +68,7 @@ private:
 	//յͷṹ
 	std::shared_ptr<MsgNode> _recv_head_node;
 	int _user_uid;
+	std::atomic<long long> _fence;
 	//¼ϴνݵʱ
 	std::atomic<time_t> _last_heartbeat;
 	//session 
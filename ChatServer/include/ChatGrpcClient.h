@@ -5,13 +5,15 @@
 #include <grpcpp/grpcpp.h> 
 #include "message.grpc.pb.h"
 #include "message.pb.h"
-#include <queue>
 #include "const.h"
 #include "data.h"
+#include "ChatStream.h"
+#include "AsyncRpc.h"
 #include <json/json.h>
 #include <json/value.h>
 #include <json/reader.h>
 #include <condition_variable>
+#include <mutex>
 
 using grpc::Channel;
 using grpc::Status;
@@ -36,68 +38,6 @@ using message::KickUserReq;
 using message::KickUserRsp;
 
 
-class ChatConPool {
-public:
-	ChatConPool(size_t poolSize, std::string host, std::string port)
-		: poolSize_(poolSize), host_(host), port_(port), b_stop_(false) {
-		for (size_t i = 0; i < poolSize_; ++i) {
-
-			std::shared_ptr<Channel> channel = grpc::CreateChannel(host + ":" + port,
-				grpc::InsecureChannelCredentials());
-
-			connections_.push(ChatService::NewStub(channel));
-		}
-	}
-
-	~ChatConPool() {
-		std::lock_guard<std::mutex> lock(mutex_);
-		Close();
-		while (!connections_.empty()) {
-			connections_.pop();
-		}
-	}
-
-	std::unique_ptr<ChatService::Stub> getConnection() {
-		std::unique_lock<std::mutex> lock(mutex_);
-		cond_.wait(lock, [this] {
-			if (b_stop_) {
-				return true;
-			}
-			return !connections_.empty();
-			});
-		//���ֹͣ��ֱ�ӷ��ؿ�ָ��
-		if (b_stop_) {
-			return  nullptr;
-		}
-		auto context = std::move(connections_.front());
-		connections_.pop();
-		return context;
-	}
-
-	void returnConnection(std::unique_ptr<ChatService::Stub> context) {
-		std::lock_guard<std::mutex> lock(mutex_);
-		if (b_stop_) {
-			return;
-		}
-		connections_.push(std::move(context));
-		cond_.notify_one();
-	}
-
-	void Close() {
-		b_stop_ = true;
-		cond_.notify_all();
-	}
-
-private:
-	atomic<bool> b_stop_;
-	size_t poolSize_;
-	std::string host_;
-	std::string port_;
-	std::queue<std::unique_ptr<ChatService::Stub> > connections_;
-	std::mutex mutex_;
-	std::condition_variable cond_;
-};
-
 class ChatGrpcClient :public Singleton<ChatGrpcClient>
 {
 	friend class Singleton<ChatGrpcClient>;
@@ -106,14 +46,32 @@ public:
 
 	}
 
-	AddFriendRsp NotifyAddFriend(std::string server_ip, const AddFriendReq& req);
-	AuthFriendRsp NotifyAuthFriend(std::string server_ip, const AuthFriendReq& req);
+	// ֪ͨ첽ãfuturerpcɻʱ÷ᱻԶ
+	std::future<AddFriendRsp> NotifyAddFriend(std::string server_ip, const AddFriendReq& req);
+	std::future<AuthFriendRsp> NotifyAuthFriend(std::string server_ip, const AuthFriendReq& req);
 	bool GetBaseInfo(std::string base_key, int uid, std::shared_ptr<UserInfo>& userinfo);
-	TextChatMsgRsp NotifyTextChatMsg(std::string server_ip, const TextChatMsgReq& req, const Json::Value& rtvalue);
-	KickUserRsp NotifyKickUser(std::string server_ip, const KickUserReq& req);
+	std::future<TextChatMsgRsp> NotifyTextChatMsg(std::string server_ip, const TextChatMsgReq& req, const Json::Value& rtvalue);
+	std::future<KickUserRsp> NotifyKickUser(std::string server_ip, const KickUserReq& req);
+	// Զ˼ַ仯ʱstubϢѴҵַͬ
+	void AddPeer(const std::string& name, const std::string& host, const std::string& port);
+	// Զ뿪ʱرϢƳstubδȷϵϢȾһԪò
+	void RemovePeer(const std::string& name);
+	void Close();
 private:
 	ChatGrpcClient();
-	unordered_map<std::string, std::unique_ptr<ChatConPool>> _pools;	
+	// һԪãϢʱ
+	std::future<TextChatMsgRsp> notifyTextChatMsgUnary(const std::string& server_ip, const TextChatMsgReq& req);
+	std::shared_ptr<ChatService::Stub> getStub(const std::string& server_ip);
+	std::shared_ptr<ChatStream> getStream(const std::string& server_ip);
+	// ԶעĶ̬_stubs_streams_addrs  _peer_mtx 
+	std::mutex _peer_mtx;
+	// ÿԶһstub첽ͬһchannel϶·
+	unordered_map<std::string, std::shared_ptr<ChatService::Stub>> _stubs;
+	// ÿԶһıϢ˫
+	unordered_map<std::string, std::shared_ptr<ChatStream>> _streams;
+	// ÿԶ˵ǰӵĵַ host:port
+	unordered_map<std::string, std::string> _addrs;
+	AsyncRpcQueue _rpc_queue;
 };
 
 
@@ -6,6 +6,7 @@
 #include "data.h"
 #include "CServer.h"
 #include <memory>
+#include <boost/asio/thread_pool.hpp>
 
 using grpc::Server;
 using grpc::ServerBuilder;
@@ -25,27 +26,39 @@ using message::KickUserReq;
 using message::KickUserRsp;
 
 
-class ChatServiceImpl final: public ChatService::Service
+class ChatServiceImpl final: public ChatService::CallbackService
 {
 public:
 	ChatServiceImpl();
-	Status NotifyAddFriend(ServerContext* context, const AddFriendReq* request,
-		AddFriendRsp* reply) override;
+	~ChatServiceImpl();
+	// ¶ǻصʽӿڣgRPCĻص߳бã
+	// Ҫredis/mysqlĴͶݵ _workers ̳߳أ Finish
+	grpc::ServerUnaryReactor* NotifyAddFriend(grpc::CallbackServerContext* context,
+		const AddFriendReq* request, AddFriendRsp* reply) override;
 
-	Status NotifyAuthFriend(ServerContext* context, 
+	grpc::ServerUnaryReactor* NotifyAuthFriend(grpc::CallbackServerContext* context,
 		const AuthFriendReq* request, AuthFriendRsp* response) override;
 
-	Status NotifyTextChatMsg(::grpc::ServerContext* context, 
+	grpc::ServerUnaryReactor* NotifyTextChatMsg(grpc::CallbackServerContext* context,
 		const TextChatMsgReq* request, TextChatMsgRsp* response) override;
 
+	// ԶChatServerıϢÿһ˳һȷ
+	grpc::ServerBidiReactor<TextChatMsgReq, TextChatMsgRsp>* TextChatMsgStream(
+		grpc::CallbackServerContext* context) override;
+
 	bool GetBaseInfo(std::string base_key, int uid, std::shared_ptr<UserInfo>& userinfo);
 
 	//rpc
-	Status NotifyKickUser(::grpc::ServerContext* context,
+	grpc::ServerUnaryReactor* NotifyKickUser(grpc::CallbackServerContext* context,
 		const KickUserReq* request, KickUserRsp* response) override;
 
 	void RegisterServer(std::shared_ptr<CServer> pServer);
+	// ֹ̣ͣ߳gRPCر֮
+	void Shutdown();
+
+	// ıϢͶݸϵûһԪú
+	void DeliverTextChatMsg(const TextChatMsgReq& request, TextChatMsgRsp* reply);
 private:
 	std::shared_ptr<CServer> _p_server;
+	std::unique_ptr<boost::asio::thread_pool> _workers;
 };
-
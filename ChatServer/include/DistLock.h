@@ -1,17 +1,38 @@
 #pragma once
-#include <hiredis/hiredis.h>
 #include <string>
+#include <mutex>
+#include <condition_variable>
+#include <unordered_map>
+#include <cstdint>
+#include <chrono>
 class DistLock
 {
 public:
 	static DistLock& Inst();
 	~DistLock() = default;
-	std::string acquireLock(redisContext* context, const std::string& lockName,
+	// 每次尝试加锁都是一条独立的 EVAL，等待期间不占用连接
+	std::string acquireLock(const std::string& lockName,
 		int lockTimeout, int acquireTimeout);
+	std::string acquireLock(const std::string& lockName,
+		int lockTimeout, std::chrono::milliseconds acquireTimeout);
 
-	bool releaseLock(redisContext* context, const std::string& lockName,
+	bool releaseLock(const std::string& lockName,
 		const std::string& identifier);
 private:
 	DistLock() = default;
+	// 尝试一次加锁，失败时通过 pttl 返回锁的剩余存活毫秒数
+	bool tryAcquire(const std::string& lockKey,
+		const std::string& identifier, int lockTimeout, long long& pttl);
+	// 收到锁释放通知
+	void onRelease(const std::string& lockKey);
+
+	struct Waiter {
+		uint64_t seq = 0;     // 释放通知的序号，变化即说明锁被释放过
+		int count = 0;        // 正在等待该锁的线程数
+	};
+	std::once_flag _sub_flag;
+	std::mutex _mutex;
+	std::condition_variable _cond;
+	std::unordered_map<std::string, Waiter> _waiters;
 };
 
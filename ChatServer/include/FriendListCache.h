@@ -0,0 +1,73 @@
+#pragma once
+#include "const.h"
+#include "Singleton.h"
+#include "data.h"
+#include <list>
+#include <unordered_map>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <vector>
+
+// 进程内的好友列表缓存(L1)，位于 Redis u_<uid> 的 friends 字段之前
+// 每个用户缓存的只是按uid升序排列的好友uid和备注，不带资料，都未命中时只查好友关系表，
+// 好友的资料由调用方经 UserInfoCache 批量补全；
+// 加好友时由 MysqlMgr::AddFriend 就地更新本机的条目，并通过 FRIEND_LIST_INVALIDATE 频道通知其他服务器删除；
+// Redis 中的列表以联系人版本号校验，加好友后版本号自增，旧列表随之作废
+class FriendListCache : public Singleton<FriendListCache>
+{
+	friend class Singleton<FriendListCache>;
+public:
+	using FriendList = std::vector<FriendEntry>;
+
+	~FriendListCache();
+	// 依次查询本地缓存、Redis、MySQL，返回的列表不可修改，按uid升序
+	bool GetFriends(int uid, std::shared_ptr<const FriendList>& friends);
+	// 好友关系写入数据库后调用
+	void OnFriendAdded(int self_id, int friend_id, const std::string& back);
+	// 输出命中率等统计信息，由定时器周期性调用
+	void LogStats();
+
+	// Redis 中的紧凑编码，按 protobuf 线格式手工编解码，等价于
+	// message FriendList { repeated uint32 uid_delta = 1 [packed = true]; repeated string back = 2; }
+	// uid 升序后逐个与前一个相减，差值多为一两个字节；备注与 uid 一一对应，空备注也要写入
+	static std::string Serialize(const FriendList& friends);
+	static bool Parse(const std::string& data, FriendList& friends);
+private:
+	FriendListCache();
+	bool getLocal(int uid, std::shared_ptr<const FriendList>& friends);
+	uint64_t versionOf(int uid);
+	// 分片的版本号仍是 version 时才写入，期间有过失效或本机加好友则放弃，避免写回过期的列表
+	void put(int uid, std::shared_ptr<const FriendList> friends, uint64_t version);
+	void erase(int uid);
+
+	struct Entry {
+		std::shared_ptr<const FriendList> friends;
+		std::chrono::steady_clock::time_point expire;
+	};
+	using LruList = std::list<std::pair<int, Entry>>;
+	struct Shard {
+		std::mutex mutex;
+		LruList lru;       // 头部是最近使用的条目
+		std::unordered_map<int, LruList::iterator> index;
+		// 分片内任一条目失效或被本机修改时加一
+		uint64_t version = 0;
+	};
+	static const int SHARD_COUNT = 16;
+
+	Shard& shardOf(int uid) {
+		return _shards[static_cast<unsigned int>(uid) % SHARD_COUNT];
+	}
+
+	Shard _shards[SHARD_COUNT];
+	size_t _shard_capacity;
+	// 本服务器的名字，忽略自己发出的失效通知
+	std::string _self_name;
+
+	std::atomic<uint64_t> _hits;
+	std::atomic<uint64_t> _misses;
+	std::atomic<uint64_t> _evictions;
+	std::atomic<uint64_t> _invalidations;
+};
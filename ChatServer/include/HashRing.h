@@ -0,0 +1,20 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+// 一致性哈希环
+// 每个节点按名字在环上放置若干虚拟节点，key 落在顺时针方向的第一个虚拟节点上；
+// 增删节点时只有相邻区间的 key 需要迁移，其余 key 的归属不变
+class HashRing {
+public:
+	// nodes 为节点的稳定标识，Locate 返回的是节点在 nodes 中的下标
+	HashRing(const std::vector<std::string>& nodes, int virtual_nodes);
+	size_t Locate(const std::string& key) const;
+	// 跨进程、跨平台结果一致的64位哈希，不能用 std::hash
+	static uint64_t Hash(const std::string& data);
+private:
+	// { 虚拟节点的哈希值, 节点下标 }，按哈希值升序
+	std::vector<std::pair<uint64_t, size_t>> _ring;
+};
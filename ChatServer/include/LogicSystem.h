@@ -6,6 +6,9 @@
 #include <queue>
 #include <map>
 #include <functional>
+#include <future>
+#include <memory>
+#include <boost/asio/thread_pool.hpp>
 #include "const.h"
 #include <json/json.h>
 #include <json/value.h>
@@ -22,6 +25,8 @@ public:
 	~LogicSystem();
 	void PostMsgToQue(shared_ptr < LogicNode> msg);
 	void SetServer(std::shared_ptr<CServer> pserver);
+	// 用户基础信息修改后调用：丢弃各服务器的缓存，并让所有把 uid 加为好友的用户的联系人版本号加一
+	void OnProfileChanged(int uid);
 private:
 	LogicSystem();
 	void DealMsg();
@@ -32,12 +37,18 @@ private:
 	void AuthFriendApply(std::shared_ptr<CSession> session, const short& msg_id, const string& msg_data);
 	void DealChatTextMsg(std::shared_ptr<CSession> session, const short& msg_id, const string& msg_data);
 	void HeartBeatHandler(std::shared_ptr<CSession> session, const short& msg_id, const string& msg_data);
+	void GetApplyListHandler(std::shared_ptr<CSession> session, const short& msg_id, const string& msg_data);
+	void GetFriendListHandler(std::shared_ptr<CSession> session, const short& msg_id, const string& msg_data);
 	bool isPureDigit(const std::string& str);
 	void GetUserByUid(std::string uid_str, Json::Value& rtvalue);
 	void GetUserByName(std::string name, Json::Value& rtvalue);
 	bool GetBaseInfo(std::string base_key, int uid, std::shared_ptr<UserInfo> &userinfo);
-	bool GetFriendApplyInfo(int to_uid, std::vector<std::shared_ptr<ApplyInfo>>& list);
-	bool GetFriendList(int self_id, std::vector<std::shared_ptr<UserInfo>> & user_list);
+	bool GetFriendApplyInfo(int to_uid, int after_uid, int limit, std::vector<std::shared_ptr<ApplyInfo>>& list);
+	bool GetFriendList(int self_id, int after_uid, int limit, std::vector<std::shared_ptr<UserInfo>> & user_list);
+	bool GetFriendApplyInfo(int to_uid, const std::vector<int>& from_uids, std::vector<std::shared_ptr<ApplyInfo>>& list);
+	bool GetFriendList(int self_id, const std::vector<int>& friend_ids, std::vector<std::shared_ptr<UserInfo>>& user_list);
+	// 在加载线程池中执行 job，登录时并发读取好友申请列表和好友列表
+	std::future<bool> postLoad(std::function<bool()> job);
 	std::thread _worker_thread;
 	std::queue<shared_ptr<LogicNode>> _msg_que;
 	std::mutex _mutex;
@@ -45,5 +56,7 @@ private:
 	bool _b_stop;
 	std::map<short, FunCallBack> _fun_callbacks;
 	std::shared_ptr<CServer> _p_server;
+	// 固定大小的加载线程池，不为每次登录新建线程
+	std::unique_ptr<boost::asio::thread_pool> _loaders;
 };
 
@@ -1,147 +1,15 @@
 #pragma once
 #include "const.h"
-#include <thread>
-#include <mysqlx/xdevapi.h>
-#include <queue>
-#include <mutex>
-#include <condition_variable>
-#include <memory>
+#include "MySqlPool.h"
 #include <atomic>
 #include <chrono>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
 #include <iostream>
 #include "data.h"
 
-// 使用 X DevAPI 的 Session
-class SqlConnection {
-public:
-	SqlConnection(std::shared_ptr<mysqlx::Session> session, int64_t lasttime) :
-		_session(session),
-		_last_oper_time(lasttime)
-	{
-	}
-
-	std::shared_ptr<mysqlx::Session> _session;
-	int64_t _last_oper_time;
-};
-
-// 使用 X DevAPI 的连接池
-class MySqlPool {
-public:
-	MySqlPool(const std::string& host, int port, const std::string& user, 
-			  const std::string& pass, const std::string& schema, int poolSize)
-		: host_(host), port_(port), user_(user), pass_(pass), 
-		  schema_(schema), poolSize_(poolSize), b_stop_(false) {
-		try {
-			for (int i = 0; i < poolSize_; ++i) {
-				mysqlx::SessionSettings settings(
-					host_, port_,
-					user_, pass_,
-					schema_
-				);
-				auto session = std::make_shared<mysqlx::Session>(settings);
-				auto currentTime = std::chrono::system_clock::now().time_since_epoch();
-				long long timestamp = std::chrono::duration_cast<std::chrono::seconds>(currentTime).count();
-				pool_.push(std::make_unique<SqlConnection>(session, timestamp));
-			}
-
-			_check_thread = std::thread([this]() {
-				while (!b_stop_) {
-					checkConnection();
-					std::this_thread::sleep_for(std::chrono::seconds(60));
-				}
-			});
-
-			_check_thread.detach();
-		}
-		catch (const mysqlx::Error& e) {
-			spdlog::error("Mysql 连接池初始化失败: {}", e.what());
-		}
-	}
-
-	void checkConnection() {
-		std::lock_guard<std::mutex> guard(mutex_);
-		int poolsize = pool_.size();
-		auto currentTime = std::chrono::system_clock::now().time_since_epoch();
-		long long timestamp = std::chrono::duration_cast<std::chrono::seconds>(currentTime).count();
-		
-		for (int i = 0; i < poolsize; i++) {
-			auto con = std::move(pool_.front());
-			pool_.pop();
-			Defer defer([this, &con]() {
-				pool_.push(std::move(con));
-			});
-
-			if (timestamp - con->_last_oper_time < 5) {
-				continue;
-			}
-
-			try {
-				con->_session->sql("SELECT 1").execute();
-				con->_last_oper_time = timestamp;
-			}
-			catch (const mysqlx::Error& e) {
-				spdlog::error("Mysql 连接池保持连接失败: {}", e.what());
-				mysqlx::SessionSettings settings(
-					host_, port_,
-					user_, pass_,
-					schema_
-				);
-				con->_session = std::make_shared<mysqlx::Session>(settings);
-				con->_last_oper_time = timestamp;
-			}
-		}
-	}
-
-	std::unique_ptr<SqlConnection> getConnection() {
-		std::unique_lock<std::mutex> lock(mutex_);
-		cond_.wait(lock, [this] { 
-			if (b_stop_) {
-				return true;
-			}       
-			return !pool_.empty(); });
-		if (b_stop_) {
-			return nullptr;
-		}
-		std::unique_ptr<SqlConnection> con(std::move(pool_.front()));
-		pool_.pop();
-		return con;
-	}
-
-	void returnConnection(std::unique_ptr<SqlConnection> con) {
-		std::unique_lock<std::mutex> lock(mutex_);
-		if (b_stop_) {
-			return;
-		}
-		pool_.push(std::move(con));
-		cond_.notify_one();
-	}
-
-	void Close() {
-		b_stop_ = true;
-		cond_.notify_all();
-	}
-
-	~MySqlPool() {
-		std::unique_lock<std::mutex> lock(mutex_);
-		while (!pool_.empty()) {
-			pool_.pop();
-		}
-	}
-
-private:
-	std::string host_;
-	int port_;
-	std::string user_;
-	std::string pass_;
-	std::string schema_;
-	int poolSize_;
-	std::queue<std::unique_ptr<SqlConnection>> pool_;
-	std::mutex mutex_;
-	std::condition_variable cond_;
-	std::atomic<bool> b_stop_;
-	std::thread _check_thread;
-};
-
 class MysqlDao
 {
 public:
@@ -154,12 +22,40 @@ public:
 	bool AddFriendApply(const int& from, const int& to);
 	bool AuthFriendApply(const int& from, const int& to);
 	bool AddFriend(const int& from, const int& to, std::string back_name);
-	std::shared_ptr<UserInfo> GetUser(int uid);
-	std::shared_ptr<UserInfo> GetUser(std::string name);
-	bool GetApplyList(int touid, std::vector<std::shared_ptr<ApplyInfo>>& applyList, int offset, int limit);
-	bool GetFriendList(int self_id, std::vector<std::shared_ptr<UserInfo>>& user_info);
+	// 查到时写入 user；连接池超时或出错返回 LOOKUP_ERROR，调用方不能当作不存在；用于回填缓存，走主库
+	LookupResult GetUser(int uid, std::shared_ptr<UserInfo>& user);
+	LookupResult GetUser(std::string name, std::shared_ptr<UserInfo>& user);
+	// 按 from_uid 升序取 after_uid 之后的最多 limit 条待处理的好友申请
+	bool GetApplyList(int touid, int after_uid, int limit, std::vector<std::shared_ptr<ApplyInfo>>& applyList);
+	// 增量同步用：按uid取指定的几条好友申请(不论是否已处理)，已不存在的不在结果中
+	bool GetApplyList(int touid, const std::vector<int>& from_uids, std::vector<std::shared_ptr<ApplyInfo>>& applyList);
+	// 按好友uid升序取全部好友的uid和备注，不带资料，用于回填缓存，走主库
+	bool GetFriendIds(int self_id, std::vector<FriendEntry>& friends);
+	// 一条语句批量查询基础信息，不存在的uid不在结果中；用于回填缓存，走主库
+	bool GetUsers(const std::vector<int>& uids, std::vector<std::shared_ptr<UserInfo>>& users);
+	// 把 friend_id 加为好友的所有用户
+	bool GetFriendOwners(int friend_id, std::vector<int>& owners);
+	bool ScanUsers(int after_uid, int limit, std::vector<std::pair<int, std::string>>& users);
 private:
+	// 读请求用的连接池：key 在粘滞窗口内写过时走主库，否则在可用的副本间轮询
+	MySqlPool& readPool(const std::string& key);
+	// 回填 Redis 缓存的读请求一律走主库：结果会按当前的联系人版本号或长 TTL 缓存，
+	// 别的服务器刚写入、本机不在粘滞窗口内时，副本的延迟会被固化到缓存里
+	MySqlPool& fillPool() { return *pool_; }
+	// 写之前调用，此后 sticky_ms_ 内涉及 key 的读请求都走主库
+	void markWrite(const std::string& key);
+	static std::string uidKey(int uid);
+	static std::string nameKey(const std::string& name);
+
+	// 主库，所有写请求都在这里执行
 	std::unique_ptr<MySqlPool> pool_;
+	std::vector<std::unique_ptr<MySqlPool>> replicas_;
+	std::atomic<size_t> next_replica_;
+	int sticky_ms_;
+	std::mutex sticky_mutex_;
+	std::unordered_map<std::string, std::chrono::steady_clock::time_point> sticky_;
+	// sticky_ 达到这个大小时清理一次过期的条目
+	size_t sticky_sweep_at_;
 };
 
 
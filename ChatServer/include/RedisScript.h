@@ -0,0 +1,15 @@
+#pragma once
+#include <string>
+
+// Lua 脚本及其 sha1
+// sha1 在本地计算，与 SCRIPT LOAD 返回的一致；平时只用 EVALSHA 发送40字节的摘要，
+// 服务器没有缓存该脚本(重启、SCRIPT FLUSH、新分片)时由 RedisMgr 改用 EVAL 发送一次源码，redis 随之缓存
+class RedisScript {
+public:
+	explicit RedisScript(std::string source);
+	const std::string& Source() const { return _source; }
+	const std::string& Sha() const { return _sha; }
+private:
+	std::string _source;
+	std::string _sha;
+};
@@ -0,0 +1,62 @@
+#pragma once
+#include "const.h"
+#include "Singleton.h"
+#include <functional>
+#include <map>
+#include <vector>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+
+// 注册中心里的一个ChatServer节点
+struct ChatNode {
+	std::string name;
+	std::string host;
+	std::string port;      // 客户端长连接端口
+	std::string rpc_port;  // 服务器之间的rpc端口
+
+	bool operator==(const ChatNode& other) const {
+		return name == other.name && host == other.host && port == other.port && rpc_port == other.rpc_port;
+	}
+	bool operator!=(const ChatNode& other) const {
+		return !(*this == other);
+	}
+};
+
+// 基于Redis的ChatServer注册中心
+// 后台线程按心跳间隔续约本节点并清理过期节点，成员变化通过 MEMBERSHIP_CHANNEL 广播；
+// 收到广播或到达心跳周期时拉取全量成员，与本地视图比较后把增减通知给监听者
+class ServiceRegistry : public Singleton<ServiceRegistry>
+{
+	friend class Singleton<ServiceRegistry>;
+public:
+	// joined 为false表示节点离开，地址变化时先回调离开再回调加入
+	// 回调在注册中心线程中执行，不包含本节点
+	using Listener = std::function<void(const ChatNode& node, bool joined)>;
+	~ServiceRegistry();
+	// 需要在 Start 之前注册
+	void Watch(Listener listener);
+	// 注册本节点，开始心跳和成员监听
+	void Start();
+	// 停止心跳并注销本节点，其他节点会立即收到离开通知
+	void Close();
+private:
+	ServiceRegistry();
+	void run();
+	void sync();
+	static bool parseNode(const std::string& name, const std::string& info, ChatNode& node);
+
+	std::string _self_name;
+	std::string _self_info;
+	std::mutex _mutex;
+	std::condition_variable _cond;
+	// 收到成员变更通知，需要立即同步
+	bool _b_dirty;
+	// 其他节点的本地视图，只在注册中心线程中读写
+	std::map<std::string, ChatNode> _members;
+	std::vector<Listener> _listeners;
+	std::atomic<bool> _b_stop;
+	std::thread _thread;
+};
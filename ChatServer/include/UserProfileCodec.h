@@ -0,0 +1,15 @@
+#pragma once
+#include "data.h"
+#include <string>
+
+// 用户基础信息在 Redis 中的紧凑编码，按 protobuf 线格式手工编解码，等价于
+// message UserProfile {
+//     int32 uid = 1; string name = 2; string pwd = 3; string email = 4;
+//     string nick = 5; string desc = 6; int32 sex = 7; string icon = 8;
+// }
+// 与 proto3 一样省略默认值字段；解析时跳过不认识的字段，以后新增字段不影响旧版本读取
+class UserProfileCodec {
+public:
+	static std::string Serialize(const UserInfo& userinfo);
+	static bool Parse(const std::string& data, UserInfo& userinfo);
+};
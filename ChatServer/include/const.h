@@ -15,6 +15,7 @@ enum ErrorCodes {
 	PasswdInvalid = 1009,   //密码更新失败
 	TokenInvalid = 1010,   //Token失效
 	UidInvalid = 1011,  //uid无效
+	DbBusy = 1012,  //数据库繁忙或查询失败
 };
 
 
@@ -61,17 +62,71 @@ enum MSG_IDS {
 	ID_NOTIFY_OFF_LINE_REQ = 1021, //通知用户下线
 	ID_HEART_BEAT_REQ = 1023,      //心跳请求
 	ID_HEARTBEAT_RSP = 1024,       //心跳回复
+	ID_GET_APPLY_LIST_REQ = 1025,  //分页拉取好友申请列表请求
+	ID_GET_APPLY_LIST_RSP = 1026,  //分页拉取好友申请列表回复
+	ID_GET_FRIEND_LIST_REQ = 1027, //分页拉取好友列表请求
+	ID_GET_FRIEND_LIST_RSP = 1028, //分页拉取好友列表回复
 };
 
+//登录回包中联系人的同步方式
+enum ContactSync {
+	CONTACT_SYNC_FULL = 0,          //全量，回包带第一页，其余分页拉取
+	CONTACT_SYNC_DELTA = 1,         //只带客户端版本之后有变化的条目
+	CONTACT_SYNC_NOT_MODIFIED = 2,  //没有变化，沿用客户端本地的列表
+};
+
+//按键查询单条记录的结果，区分确认不存在与查询失败(连接池超时、数据库出错)
+enum LookupResult {
+	LOOKUP_FOUND = 0,
+	LOOKUP_NOT_FOUND = 1,
+	LOOKUP_ERROR = 2,
+};
+
+//用户数据hash，一个uid一个key，字段:
+//v 结构版本，server/sid/fence 会话所有权，profile 基础信息(protobuf线格式)，
+//cver 联系人版本号，好友列表、好友申请或好友资料每变化一次加一
+//friends/fver 好友uid和备注的缓存及其写入时的 cver，fver 与 cver 不一致时作废
+#define USER_HASH_PREFIX "u_"
+//联系人变更记录，一个uid一个有序集合，成员 a<uid>/f<uid> 表示该申请/好友有变化，分数为变化时的 cver；
+//成员 floor 的分数之前的记录已被裁掉，客户端版本低于它时只能全量同步
+#define CONTACT_LOG_PREFIX "uc_"
+//用户名 -> uid 索引，值为uid
+#define USER_NAME_INDEX "un_"
+//用户数据hash的结构版本，与 v 字段不一致的 profile 视为未命中；
+//3: 从MySQL回源的 profile 补齐了昵称、签名、性别和头像，之前只有账号字段
+#define USER_LAYOUT_VERSION "3"
+//以下为旧的每用户key，只有迁移工具还会读取
 #define USERIPPREFIX  "uip_"
 #define USERTOKENPREFIX  "utoken_"
-#define IPCOUNTPREFIX  "ipcount_"
 #define USER_BASE_INFO "ubaseinfo_"
-#define LOGIN_COUNT  "logincount"
 #define NAME_INFO  "nameinfo_"
-#define LOCK_PREFIX "lock_"
 #define USER_SESSION_PREFIX "usession_"
+#define IPCOUNTPREFIX  "ipcount_"
+#define LOGIN_COUNT  "logincount"
+#define LOCK_PREFIX "lock_"
 #define LOCK_COUNT "lockcount"
+//锁释放通知频道，等待者订阅后被唤醒，不再轮询
+#define LOCK_RELEASE_CHANNEL "lock_release"
+//用户基础信息失效通知频道，消息内容为uid
+#define USER_INFO_INVALIDATE "ubaseinfo_invalidate"
+//好友列表失效通知频道，消息内容为 uid,发出通知的服务器名
+#define FRIEND_LIST_INVALIDATE "friendlist_invalidate"
+//新用户注册通知频道，由 GateServer 在注册成功后发布，消息内容为 "uid,name"
+#define USER_REGISTERED_CHANNEL "user_registered"
+//uid路由变更通知频道，消息内容为 "uid,server"，server为空表示下线
+#define ROUTE_CHANNEL "uip_route"
+//ChatServer注册中心，zset 成员为服务器名，分值为心跳过期时刻(毫秒)
+#define CHAT_REGISTRY "chatserver_nodes"
+//注册中心的节点地址，hash 字段为服务器名，值为 "host,port,rpc_port"
+#define CHAT_REGISTRY_INFO "chatserver_info"
+//ChatServer成员变更通知频道，消息内容为 "join,name" 或 "leave,name"
+#define MEMBERSHIP_CHANNEL "chatserver_membership"
+//ChatServer负载上报频道，消息内容为 "name,连接数,容量"
+#define LOAD_CHANNEL "chatserver_load"
+//登录token黑名单，zset 成员为token id，分值为token过期时刻(unix秒)
+#define TOKEN_DENY_LIST "token_deny"
+//token吊销通知频道，消息内容为 "id,expire"
+#define TOKEN_DENY_CHANNEL "token_deny"
 
 //分布式锁的超时时间
 #define LOCK_TIME_OUT 10
@@ -0,0 +1,395 @@
+#include "AsyncRedis.h"
+#include "AsioIOServicePool.h"
+
+RedisValue RedisValue::FromReply(const redisReply* reply) {
+	RedisValue value;
+	if (reply == nullptr) {
+		return value;
+	}
+	value.type = reply->type;
+	switch (reply->type) {
+	case REDIS_REPLY_INTEGER:
+		value.integer = reply->integer;
+		break;
+	case REDIS_REPLY_STRING:
+	case REDIS_REPLY_STATUS:
+	case REDIS_REPLY_ERROR:
+		value.str.assign(reply->str, reply->len);
+		break;
+	case REDIS_REPLY_ARRAY:
+		value.elements.reserve(reply->elements);
+		for (size_t i = 0; i < reply->elements; ++i) {
+			value.elements.push_back(FromReply(reply->element[i]));
+		}
+		break;
+	default:
+		break;
+	}
+	return value;
+}
+
+RedisValue RedisValue::Error(const std::string& message) {
+	RedisValue value;
+	value.type = REDIS_REPLY_ERROR;
+	value.str = message;
+	return value;
+}
+
+// 一条异步连接，绑定 AsioIOServicePool 中的一个 io_context，与会话共用该 io_context 的线程，
+// redisAsyncContext 的全部操作都在这个线程中执行；线程池每个 io_context 只有一个线程，无需 strand
+// hiredis 通过 ev 钩子请求关注可读/可写事件，这里用 stream_descriptor 的 async_wait 实现；
+// 投递出去的处理函数都持有 shared_ptr，关闭后仍在队列中的处理函数执行完才释放连接
+class AsyncRedisConn : public std::enable_shared_from_this<AsyncRedisConn>
+{
+public:
+	AsyncRedisConn(std::shared_ptr<AsioIOServicePool> pool, const std::string& host, int port, const std::string& pwd)
+		: _host(host), _port(port), _pwd(pwd), _pool(pool), _ioc(pool->GetIOService()),
+		_socket(_ioc), _retry_timer(_ioc), _ac(nullptr), _reading(false), _writing(false),
+		_read_waiting(false), _write_waiting(false), _b_stop(false) {
+	}
+
+	void Start() {
+		boost::asio::post(_ioc, [self = shared_from_this()]() {
+			self->connect();
+			});
+	}
+
+	// 可在任意线程调用，命令投递到连接线程后追加到发送缓冲区
+	void Send(std::vector<std::string> args, AsyncRedis::Callback callback) {
+		boost::asio::post(_ioc, [self = shared_from_this(), args = std::move(args), callback = std::move(callback)]() mutable {
+			self->send(args, std::move(callback));
+			});
+	}
+
+	void SendBatch(std::vector<std::vector<std::string>> commands, AsyncRedis::BatchCallback callback) {
+		boost::asio::post(_ioc, [self = shared_from_this(), commands = std::move(commands), callback = std::move(callback)]() mutable {
+			self->sendBatch(commands, std::move(callback));
+			});
+	}
+
+	// 等已发出的命令全部回复后断开；io 线程池停止之前、在 io 线程之外调用
+	// 之后投递的命令由 send 检查 _b_stop 以错误回调结束，io_context 照常运行，不会留在队列中
+	void Close() {
+		auto closed = std::make_shared<std::promise<void>>();
+		auto future = closed->get_future();
+		boost::asio::post(_ioc, [self = shared_from_this(), closed]() {
+			self->_b_stop = true;
+			self->_retry_timer.cancel();
+			if (self->_ac == nullptr) {
+				closed->set_value();
+				return;
+			}
+			// 断开完成后由 lost 通知
+			self->_closed = closed;
+			redisAsyncDisconnect(self->_ac);
+			});
+		if (future.wait_for(std::chrono::seconds(CLOSE_TIMEOUT_SEC)) != std::future_status::ready) {
+			spdlog::warn("Redis 异步连接 {} 秒内未断开，不再等待", CLOSE_TIMEOUT_SEC);
+		}
+	}
+
+private:
+	struct PendingReply {
+		AsyncRedis::Callback callback;
+	};
+	// 关闭时等待已发出命令回复的上限(秒)
+	static const int CLOSE_TIMEOUT_SEC = 5;
+
+	void connect() {
+		_ac = redisAsyncConnect(_host.c_str(), _port);
+		if (_ac == nullptr || _ac->err != 0) {
+			spdlog::error("Redis 异步连接失败: {}", _ac ? _ac->errstr : "null");
+			if (_ac != nullptr) {
+				redisAsyncFree(_ac);
+				_ac = nullptr;
+			}
+			scheduleReconnect();
+			return;
+		}
+
+		boost::system::error_code ec;
+		_socket.assign(_ac->c.fd, ec);
+		if (ec) {
+			spdlog::error("Redis 异步连接绑定失败: {}", ec.message());
+			redisAsyncFree(_ac);
+			_ac = nullptr;
+			scheduleReconnect();
+			return;
+		}
+
+		_ac->data = this;
+		_ac->ev.data = this;
+		_ac->ev.addRead = &AsyncRedisConn::addRead;
+		_ac->ev.delRead = &AsyncRedisConn::delRead;
+		_ac->ev.addWrite = &AsyncRedisConn::addWrite;
+		_ac->ev.delWrite = &AsyncRedisConn::delWrite;
+		_ac->ev.cleanup = &AsyncRedisConn::cleanup;
+		// 设置连接回调时 hiredis 会关注可写事件，用来得知非阻塞connect完成，所以要在挂上钩子之后
+		redisAsyncSetConnectCallback(_ac, &AsyncRedisConn::onConnect);
+		redisAsyncSetDisconnectCallback(_ac, &AsyncRedisConn::onDisconnect);
+		// 在连接建立前就可以追加命令，AUTH 排在最前面发出
+		redisAsyncCommand(_ac, &AsyncRedisConn::onAuth, this, "AUTH %s", _pwd.c_str());
+	}
+
+	void scheduleReconnect() {
+		if (_b_stop) {
+			return;
+		}
+		_retry_timer.expires_after(std::chrono::seconds(1));
+		_retry_timer.async_wait([self = shared_from_this()](const boost::system::error_code& ec) {
+			if (ec || self->_b_stop) {
+				return;
+			}
+			self->connect();
+			});
+	}
+
+	void send(const std::vector<std::string>& args, AsyncRedis::Callback callback) {
+		// 断线重连期间直接失败，不在本地堆积命令
+		if (_ac == nullptr || _b_stop) {
+			callback(RedisValue::Error("redis 连接不可用"));
+			return;
+		}
+
+		// 参数按长度传递，二进制安全；指针数组在连接线程内复用，hiredis 会立即把命令编码进发送缓冲区
+		_argv.clear();
+		_argvlen.clear();
+		for (auto& arg : args) {
+			_argv.push_back(arg.data());
+			_argvlen.push_back(arg.size());
+		}
+
+		auto* pending = new PendingReply{ std::move(callback) };
+		if (redisAsyncCommandArgv(_ac, &AsyncRedisConn::onReply, pending,
+			(int)args.size(), _argv.data(), _argvlen.data()) != REDIS_OK) {
+			std::unique_ptr<PendingReply> guard(pending);
+			guard->callback(RedisValue::Error("redis 命令发送失败"));
+		}
+	}
+
+	// 在同一个任务里把整批命令追加到发送缓冲区，hiredis 在下一次可写时一次写出
+	// 回复只在连接线程中写入，不需要加锁
+	void sendBatch(const std::vector<std::vector<std::string>>& commands, AsyncRedis::BatchCallback callback) {
+		struct BatchState {
+			std::vector<RedisValue> replies;
+			size_t remaining = 0;
+			AsyncRedis::BatchCallback callback;
+		};
+		auto state = std::make_shared<BatchState>();
+		state->replies.resize(commands.size());
+		state->remaining = commands.size();
+		state->callback = std::move(callback);
+		if (commands.empty()) {
+			state->callback(state->replies);
+			return;
+		}
+
+		for (size_t i = 0; i < commands.size(); ++i) {
+			send(commands[i], [state, i](const RedisValue& reply) {
+				state->replies[i] = reply;
+				if (--state->remaining == 0) {
+					state->callback(state->replies);
+				}
+				});
+		}
+	}
+
+	void startRead() {
+		if (_read_waiting || !_reading) {
+			return;
+		}
+		_read_waiting = true;
+		_socket.async_wait(boost::asio::posix::stream_descriptor::wait_read, [self = shared_from_this()](const boost::system::error_code& ec) {
+			self->_read_waiting = false;
+			if (ec || !self->_reading || self->_ac == nullptr) {
+				return;
+			}
+			// 回调里可能断开并释放连接，之后由 _reading 和 _ac 决定是否继续等待
+			redisAsyncHandleRead(self->_ac);
+			self->startRead();
+			});
+	}
+
+	void startWrite() {
+		if (_write_waiting || !_writing) {
+			return;
+		}
+		_write_waiting = true;
+		_socket.async_wait(boost::asio::posix::stream_descriptor::wait_write, [self = shared_from_this()](const boost::system::error_code& ec) {
+			self->_write_waiting = false;
+			if (ec || !self->_writing || self->_ac == nullptr) {
+				return;
+			}
+			redisAsyncHandleWrite(self->_ac);
+			self->startWrite();
+			});
+	}
+
+	// 连接断开后 hiredis 会以空回复调用所有未完成命令的回调，再释放连接
+	void lost() {
+		_ac = nullptr;
+		if (_closed != nullptr) {
+			_closed->set_value();
+			_closed.reset();
+			return;
+		}
+		scheduleReconnect();
+	}
+
+	static void addRead(void* data) {
+		auto* self = static_cast<AsyncRedisConn*>(data);
+		self->_reading = true;
+		self->startRead();
+	}
+
+	static void delRead(void* data) {
+		static_cast<AsyncRedisConn*>(data)->_reading = false;
+	}
+
+	static void addWrite(void* data) {
+		auto* self = static_cast<AsyncRedisConn*>(data);
+		self->_writing = true;
+		self->startWrite();
+	}
+
+	static void delWrite(void* data) {
+		static_cast<AsyncRedisConn*>(data)->_writing = false;
+	}
+
+	// 描述符由 hiredis 负责关闭，这里只解除绑定，同时取消还在等待的事件
+	static void cleanup(void* data) {
+		auto* self = static_cast<AsyncRedisConn*>(data);
+		self->_reading = false;
+		self->_writing = false;
+		if (self->_socket.is_open()) {
+			self->_socket.release();
+		}
+	}
+
+	static void onConnect(const redisAsyncContext* ac, int status) {
+		auto* self = static_cast<AsyncRedisConn*>(ac->data);
+		if (status != REDIS_OK) {
+			// 连接失败时 hiredis 随后会释放上下文，不再回调 onDisconnect
+			spdlog::error("Redis 异步连接失败: {}", ac->errstr ? ac->errstr : "");
+			self->lost();
+			return;
+		}
+		redisEnableKeepAlive(const_cast<redisContext*>(&ac->c));
+		spdlog::info("Redis 异步连接成功");
+	}
+
+	static void onDisconnect(const redisAsyncContext* ac, int status) {
+		auto* self = static_cast<AsyncRedisConn*>(ac->data);
+		if (status != REDIS_OK) {
+			spdlog::error("Redis 异步连接断开: {}", ac->errstr ? ac->errstr : "");
+		}
+		self->lost();
+	}
+
+	static void onAuth(redisAsyncContext* ac, void* r, void* privdata) {
+		auto* reply = static_cast<redisReply*>(r);
+		if (reply == nullptr) {
+			return;
+		}
+		if (reply->type == REDIS_REPLY_ERROR) {
+			// 未认证的连接上所有命令都会失败，断开后由 onDisconnect 安排重连，重新认证
+			spdlog::error("Redis 认证失败: {}", std::string(reply->str, reply->len));
+			redisAsyncDisconnect(ac);
+			return;
+		}
+		spdlog::info("Redis 认证成功");
+	}
+
+	static void onReply(redisAsyncContext* ac, void* r, void* privdata) {
+		std::unique_ptr<PendingReply> pending(static_cast<PendingReply*>(privdata));
+		auto* reply = static_cast<redisReply*>(r);
+		if (reply == nullptr) {
+			pending->callback(RedisValue::Error(ac->errstr ? ac->errstr : "redis 连接已断开"));
+			return;
+		}
+		pending->callback(RedisValue::FromReply(reply));
+	}
+
+	std::string _host;
+	int _port;
+	std::string _pwd;
+	// 持有线程池，保证 io_context 比绑定在上面的 socket 和定时器活得久
+	std::shared_ptr<AsioIOServicePool> _pool;
+	boost::asio::io_context& _ioc;
+	boost::asio::posix::stream_descriptor _socket;
+	boost::asio::steady_timer _retry_timer;
+	// 以下成员只在连接线程中访问
+	redisAsyncContext* _ac;
+	// hiredis 当前是否需要读写事件，以及是否已有 async_wait 在等待
+	bool _reading;
+	bool _writing;
+	bool _read_waiting;
+	bool _write_waiting;
+	bool _b_stop;
+	std::vector<const char*> _argv;
+	std::vector<size_t> _argvlen;
+	// Close 等待断开完成
+	std::shared_ptr<std::promise<void>> _closed;
+};
+
+AsyncRedis::AsyncRedis(const std::string& host, int port, const std::string& pwd, size_t conns)
+	: _next(0), _b_stop(false) {
+	conns = std::max<size_t>(1, conns);
+	// 各条连接轮流绑定到 io 线程池中的 io_context，不再各自创建线程
+	auto pool = AsioIOServicePool::GetInstance();
+	for (size_t i = 0; i < conns; ++i) {
+		_conns.push_back(std::make_shared<AsyncRedisConn>(pool, host, port, pwd));
+		_conns.back()->Start();
+	}
+}
+
+AsyncRedis::~AsyncRedis() {
+	Close();
+}
+
+void AsyncRedis::Command(std::vector<std::string> args, Callback callback) {
+	if (_b_stop) {
+		callback(RedisValue::Error("redis 客户端已关闭"));
+		return;
+	}
+	// 轮流分摊到各条连接，同一调用方的前后命令不保证在同一条连接上执行
+	auto& conn = _conns[_next++ % _conns.size()];
+	conn->Send(std::move(args), std::move(callback));
+}
+
+std::future<RedisValue> AsyncRedis::Command(std::vector<std::string> args) {
+	auto promise = std::make_shared<std::promise<RedisValue>>();
+	auto future = promise->get_future();
+	Command(std::move(args), [promise](const RedisValue& reply) {
+		promise->set_value(reply);
+		});
+	return future;
+}
+
+void AsyncRedis::Batch(std::vector<std::vector<std::string>> commands, BatchCallback callback) {
+	if (_b_stop) {
+		std::vector<RedisValue> replies(commands.size(), RedisValue::Error("redis 客户端已关闭"));
+		callback(replies);
+		return;
+	}
+	auto& conn = _conns[_next++ % _conns.size()];
+	conn->SendBatch(std::move(commands), std::move(callback));
+}
+
+std::future<std::vector<RedisValue>> AsyncRedis::Batch(std::vector<std::vector<std::string>> commands) {
+	auto promise = std::make_shared<std::promise<std::vector<RedisValue>>>();
+	auto future = promise->get_future();
+	Batch(std::move(commands), [promise](std::vector<RedisValue>& replies) {
+		promise->set_value(std::move(replies));
+		});
+	return future;
+}
+
+void AsyncRedis::Close() {
+	if (_b_stop.exchange(true)) {
+		return;
+	}
+	for (auto& conn : _conns) {
+		conn->Close();
+	}
+}
@@ -0,0 +1,64 @@
+#include "BloomFilter.h"
+#include <algorithm>
+#include <cmath>
+#include <functional>
+
+// splitmix64 的混合步骤，std::hash 对整数和短字符串的分布不够均匀
+static uint64_t mix(uint64_t x) {
+	x += 0x9e3779b97f4a7c15ULL;
+	x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+	return x ^ (x >> 31);
+}
+
+BloomFilter::BloomFilter(size_t expected, double fp_rate) : _expected(std::max<size_t>(1, expected)),
+	_bits(0), _hashes(1), _added(0) {
+	fp_rate = std::min(0.5, std::max(1e-6, fp_rate));
+	// m = -n*ln(p)/(ln2)^2，k = m/n*ln2
+	double ln2 = std::log(2.0);
+	double bits = -(double)_expected * std::log(fp_rate) / (ln2 * ln2);
+	_bits = std::max<size_t>(64, (size_t)std::ceil(bits / 64) * 64);
+	_hashes = std::max(1, std::min(16, (int)std::lround((double)_bits / _expected * ln2)));
+
+	size_t words = _bits / 64;
+	_words.reset(new std::atomic<uint64_t>[words]);
+	for (size_t i = 0; i < words; ++i) {
+		_words[i].store(0, std::memory_order_relaxed);
+	}
+}
+
+void BloomFilter::hash(const std::string& key, uint64_t& h1, uint64_t& h2) {
+	uint64_t h = std::hash<std::string>()(key);
+	h1 = mix(h);
+	// 第二个哈希必须是奇数，否则步长与位数组大小有公因子时会在少数位置上打转
+	h2 = mix(h1) | 1;
+}
+
+bool BloomFilter::Add(const std::string& key) {
+	uint64_t h1 = 0, h2 = 0;
+	hash(key, h1, h2);
+	bool changed = false;
+	for (int i = 0; i < _hashes; ++i) {
+		uint64_t bit = (h1 + i * h2) % _bits;
+		uint64_t mask = 1ULL << (bit % 64);
+		if ((_words[bit / 64].fetch_or(mask, std::memory_order_relaxed) & mask) == 0) {
+			changed = true;
+		}
+	}
+	if (changed) {
+		_added++;
+	}
+	return changed;
+}
+
+bool BloomFilter::MayContain(const std::string& key) const {
+	uint64_t h1 = 0, h2 = 0;
+	hash(key, h1, h2);
+	for (int i = 0; i < _hashes; ++i) {
+		uint64_t bit = (h1 + i * h2) % _bits;
+		if ((_words[bit / 64].load(std::memory_order_relaxed) & (1ULL << (bit % 64))) == 0) {
+			return false;
+		}
+	}
+	return true;
+}
@@ -5,201 +5,243 @@
 #include "const.h"
 #include "CSession.h"
 #include "MysqlMgr.h"
+#include "UserInfoCache.h"
 
 ChatGrpcClient::ChatGrpcClient()
 {
-	auto& cfg = ConfigMgr::Inst();
-	auto server_list = cfg["PeerServer"]["Servers"];
-
-	std::vector<std::string> words;
-
-	std::stringstream ss(server_list);
-	std::string word;
-
-	while (std::getline(ss, word, ',')) {
-		words.push_back(word);
+	// 配置中的对端作为初始成员，之后随注册中心的通知增减
+	auto cfg = ConfigMgr::Inst().Snapshot();
+	for (auto& peer : cfg->peers) {
+		AddPeer(peer.name, peer.host, peer.port);
 	}
 
-	for (auto& word : words) {
-		if (cfg[word]["Name"].empty()) {
-			continue;
+}
+
+void ChatGrpcClient::AddPeer(const std::string& name, const std::string& host, const std::string& port)
+{
+	auto addr = host + ":" + port;
+	{
+		std::lock_guard<std::mutex> lock(_peer_mtx);
+		auto iter = _addrs.find(name);
+		if (iter != _addrs.end() && iter->second == addr) {
+			return;
 		}
-		_pools[cfg[word]["Name"]] = std::make_unique<ChatConPool>(5, cfg[word]["Host"], cfg[word]["Port"]);
 	}
 
+	// 地址变化说明对端换了位置重启，先拆掉旧的连接
+	RemovePeer(name);
+
+	auto channel = grpc::CreateChannel(addr, grpc::InsecureChannelCredentials());
+	std::shared_ptr<ChatService::Stub> stub = ChatService::NewStub(channel);
+	auto stream = std::make_shared<ChatStream>(name, host, port,
+		[this, name](const TextChatMsgReq& req) {
+			notifyTextChatMsgUnary(name, req);
+		});
+
+	std::lock_guard<std::mutex> lock(_peer_mtx);
+	_stubs[name] = stub;
+	_streams[name] = stream;
+	_addrs[name] = addr;
+	spdlog::info("添加对端 {} 地址 {}", name, addr);
 }
 
-AddFriendRsp ChatGrpcClient::NotifyAddFriend(std::string server_ip, const AddFriendReq& req)
+void ChatGrpcClient::RemovePeer(const std::string& name)
 {
-	AddFriendRsp rsp;
-	Defer defer([&rsp, &req]() {
-		rsp.set_error(ErrorCodes::Success);
-		rsp.set_applyuid(req.applyuid());
-		rsp.set_touid(req.touid());
-		});
+	std::shared_ptr<ChatStream> stream;
+	{
+		std::lock_guard<std::mutex> lock(_peer_mtx);
+		auto iter = _streams.find(name);
+		if (iter != _streams.end()) {
+			stream = iter->second;
+			_streams.erase(iter);
+		}
+	}
 
-	auto find_iter = _pools.find(server_ip);
-	if (find_iter == _pools.end()) {
-		return rsp;
+	// 关流时未确认的消息要经一元调用补发，所以在锁外关闭，并且关完再移除stub
+	if (stream) {
+		stream->Close();
 	}
-	
-	auto &pool = find_iter->second;
-	ClientContext context;
-	auto stub = pool->getConnection();
-	Status status = stub->NotifyAddFriend(&context, req, &rsp);
-	Defer defercon([&stub, this, &pool]() {
-		pool->returnConnection(std::move(stub));
-		});
 
-	if (!status.ok()) {
-		rsp.set_error(ErrorCodes::RPCFailed);
-		return rsp;
+	std::lock_guard<std::mutex> lock(_peer_mtx);
+	if (_stubs.erase(name) > 0) {
+		spdlog::info("移除对端 {} 地址 {}", name, _addrs[name]);
+	}
+	_addrs.erase(name);
+}
+
+void ChatGrpcClient::Close()
+{
+	// 先停消息流，断流时未确认的消息还要经一元调用补发
+	std::vector<std::shared_ptr<ChatStream>> streams;
+	{
+		std::lock_guard<std::mutex> lock(_peer_mtx);
+		for (auto& stream : _streams) {
+			streams.push_back(stream.second);
+		}
+		_streams.clear();
+	}
+	for (auto& stream : streams) {
+		stream->Close();
 	}
 
-	return rsp;
+	_rpc_queue.Close();
 }
 
+std::shared_ptr<ChatService::Stub> ChatGrpcClient::getStub(const std::string& server_ip)
+{
+	std::lock_guard<std::mutex> lock(_peer_mtx);
+	auto find_iter = _stubs.find(server_ip);
+	if (find_iter == _stubs.end()) {
+		return nullptr;
+	}
+	return find_iter->second;
+}
 
-bool ChatGrpcClient::GetBaseInfo(std::string base_key, int uid, std::shared_ptr<UserInfo>& userinfo)
+std::shared_ptr<ChatStream> ChatGrpcClient::getStream(const std::string& server_ip)
 {
-	// 优先从redis中查询用户信息
-	std::string info_str = "";
-	bool b_base = RedisMgr::GetInstance()->Get(base_key, info_str);
-	if (b_base) {
-		Json::Reader reader;
-		Json::Value root;
-		reader.parse(info_str, root);
-		userinfo->uid = root["uid"].asInt();
-		userinfo->name = root["name"].asString();
-		userinfo->pwd = root["pwd"].asString();
-		userinfo->email = root["email"].asString();
-		userinfo->nick = root["nick"].asString();
-		userinfo->desc = root["desc"].asString();
-		userinfo->sex = root["sex"].asInt();
-		userinfo->icon = root["icon"].asString();
-		
-		spdlog::info("从Redis中查询到用户信息 uid: {} name: {} pwd: {} email: {} nick: {} desc: {} sex: {} icon: {}",
-			userinfo->uid, userinfo->name, userinfo->pwd, userinfo->email, userinfo->nick, userinfo->desc, userinfo->sex, userinfo->icon);
+	std::lock_guard<std::mutex> lock(_peer_mtx);
+	auto find_iter = _streams.find(server_ip);
+	if (find_iter == _streams.end()) {
+		return nullptr;
 	}
-	else {
-		// redis没有则查询mysql
-		// 查询数据库
-		std::shared_ptr<UserInfo> user_info = nullptr;
-		user_info = MysqlMgr::GetInstance()->GetUser(uid);
-		if (user_info == nullptr) {
-			return false;
-		}
+	return find_iter->second;
+}
 
-		userinfo = user_info;
-
-		// 将数据库结果写入redis缓存
-		Json::Value redis_root;
-		redis_root["uid"] = uid;
-		redis_root["pwd"] = userinfo->pwd;
-		redis_root["name"] = userinfo->name;
-		redis_root["email"] = userinfo->email;
-		redis_root["nick"] = userinfo->nick;
-		redis_root["desc"] = userinfo->desc;
-		redis_root["sex"] = userinfo->sex;
-		redis_root["icon"] = userinfo->icon;
-		RedisMgr::GetInstance()->Set(base_key, redis_root.toStyledString());
+std::future<AddFriendRsp> ChatGrpcClient::NotifyAddFriend(std::string server_ip, const AddFriendReq& req)
+{
+	auto fill = [req](AddFriendRsp& rsp) {
+		rsp.set_applyuid(req.applyuid());
+		rsp.set_touid(req.touid());
+	};
+
+	auto stub = getStub(server_ip);
+	if (stub == nullptr) {
+		AddFriendRsp rsp;
+		rsp.set_error(ErrorCodes::Success);
+		fill(rsp);
+		return MakeReadyFuture(std::move(rsp));
 	}
-	
+
+	auto cfg = ConfigMgr::Inst().Snapshot();
+	return _rpc_queue.Call<AddFriendRsp>(req, cfg->rpc_timeout_ms,
+		[stub](ClientContext* context, const AddFriendReq& request, grpc::CompletionQueue* cq) {
+			return stub->PrepareAsyncNotifyAddFriend(context, request, cq);
+		},
+		[fill, server_ip](const Status& status, AddFriendRsp& rsp) {
+			fill(rsp);
+			if (!status.ok()) {
+				spdlog::error("通知 {} 添加好友失败, code: {}, msg: {}", server_ip, (int)status.error_code(), status.error_message());
+				rsp.set_error(ErrorCodes::RPCFailed);
+			}
+		});
 }
 
-AuthFriendRsp ChatGrpcClient::NotifyAuthFriend(std::string server_ip, const AuthFriendReq& req) {
-	AuthFriendRsp rsp;
-	rsp.set_error(ErrorCodes::Success);
 
-	Defer defer([&rsp, &req]() {
+bool ChatGrpcClient::GetBaseInfo(std::string base_key, int uid, std::shared_ptr<UserInfo>& userinfo)
+{
+	// 与LogicSystem共用同一份本地缓存，未命中再查redis和mysql
+	return UserInfoCache::GetInstance()->GetBaseInfo(uid, userinfo);
+}
+
+std::future<AuthFriendRsp> ChatGrpcClient::NotifyAuthFriend(std::string server_ip, const AuthFriendReq& req) {
+	auto fill = [req](AuthFriendRsp& rsp) {
 		rsp.set_fromuid(req.fromuid());
 		rsp.set_touid(req.touid());
-		});
+	};
 
-	auto find_iter = _pools.find(server_ip);
-	if (find_iter == _pools.end()) {
-		return rsp;
+	auto stub = getStub(server_ip);
+	if (stub == nullptr) {
+		AuthFriendRsp rsp;
+		rsp.set_error(ErrorCodes::Success);
+		fill(rsp);
+		return MakeReadyFuture(std::move(rsp));
 	}
 
-	auto& pool = find_iter->second;
-	ClientContext context;
-	auto stub = pool->getConnection();
-	Status status = stub->NotifyAuthFriend(&context, req, &rsp);
-	Defer defercon([&stub, this, &pool]() {
-		pool->returnConnection(std::move(stub));
+	auto cfg = ConfigMgr::Inst().Snapshot();
+	return _rpc_queue.Call<AuthFriendRsp>(req, cfg->rpc_timeout_ms,
+		[stub](ClientContext* context, const AuthFriendReq& request, grpc::CompletionQueue* cq) {
+			return stub->PrepareAsyncNotifyAuthFriend(context, request, cq);
+		},
+		[fill, server_ip](const Status& status, AuthFriendRsp& rsp) {
+			fill(rsp);
+			if (!status.ok()) {
+				spdlog::error("通知 {} 好友认证失败, code: {}, msg: {}", server_ip, (int)status.error_code(), status.error_message());
+				rsp.set_error(ErrorCodes::RPCFailed);
+			}
 		});
+}
 
-	if (!status.ok()) {
-		rsp.set_error(ErrorCodes::RPCFailed);
-		return rsp;
+std::future<TextChatMsgRsp> ChatGrpcClient::NotifyTextChatMsg(std::string server_ip,
+	const TextChatMsgReq& req, const Json::Value& rtvalue) {
+
+	// 优先走长连接双向流，由写线程攒批发送，调用方不必等对端处理完
+	auto stream = getStream(server_ip);
+	if (stream != nullptr && stream->Send(req)) {
+		TextChatMsgRsp rsp;
+		rsp.set_error(ErrorCodes::Success);
+		rsp.set_fromuid(req.fromuid());
+		rsp.set_touid(req.touid());
+		return MakeReadyFuture(std::move(rsp));
 	}
 
-	return rsp;
+	return notifyTextChatMsgUnary(server_ip, req);
 }
 
-TextChatMsgRsp ChatGrpcClient::NotifyTextChatMsg(std::string server_ip, 
-	const TextChatMsgReq& req, const Json::Value& rtvalue) {
-	
-	TextChatMsgRsp rsp;
-	rsp.set_error(ErrorCodes::Success);
-
-	Defer defer([&rsp, &req]() {
+std::future<TextChatMsgRsp> ChatGrpcClient::notifyTextChatMsgUnary(const std::string& server_ip, const TextChatMsgReq& req) {
+	auto fill = [req](TextChatMsgRsp& rsp) {
 		rsp.set_fromuid(req.fromuid());
 		rsp.set_touid(req.touid());
+		rsp.clear_textmsgs();
 		for (const auto& text_data : req.textmsgs()) {
 			TextChatData* new_msg = rsp.add_textmsgs();
 			new_msg->set_msgid(text_data.msgid());
 			new_msg->set_msgcontent(text_data.msgcontent());
 		}
-		
-		});
+	};
 
-	auto find_iter = _pools.find(server_ip);
-	if (find_iter == _pools.end()) {
-		return rsp;
+	auto stub = getStub(server_ip);
+	if (stub == nullptr) {
+		TextChatMsgRsp rsp;
+		rsp.set_error(ErrorCodes::Success);
+		fill(rsp);
+		return MakeReadyFuture(std::move(rsp));
 	}
 
-	auto& pool = find_iter->second;
-	ClientContext context;
-	auto stub = pool->getConnection();
-	Status status = stub->NotifyTextChatMsg(&context, req, &rsp);
-	Defer defercon([&stub, this, &pool]() {
-		pool->returnConnection(std::move(stub));
+	auto cfg = ConfigMgr::Inst().Snapshot();
+	return _rpc_queue.Call<TextChatMsgRsp>(req, cfg->rpc_timeout_ms,
+		[stub](ClientContext* context, const TextChatMsgReq& request, grpc::CompletionQueue* cq) {
+			return stub->PrepareAsyncNotifyTextChatMsg(context, request, cq);
+		},
+		[fill, server_ip](const Status& status, TextChatMsgRsp& rsp) {
+			fill(rsp);
+			if (!status.ok()) {
+				spdlog::error("转发文本消息到 {} 失败, code: {}, msg: {}", server_ip, (int)status.error_code(), status.error_message());
+				rsp.set_error(ErrorCodes::RPCFailed);
+			}
 		});
-
-	if (!status.ok()) {
-		rsp.set_error(ErrorCodes::RPCFailed);
-		return rsp;
-	}
-
-	return rsp;
 }
 
-KickUserRsp ChatGrpcClient::NotifyKickUser(std::string server_ip, const KickUserReq& req)
+std::future<KickUserRsp> ChatGrpcClient::NotifyKickUser(std::string server_ip, const KickUserReq& req)
 {
-	KickUserRsp rsp;
-	Defer defer([&rsp, &req]() {
+	auto stub = getStub(server_ip);
+	if (stub == nullptr) {
+		KickUserRsp rsp;
 		rsp.set_error(ErrorCodes::Success);
 		rsp.set_uid(req.uid());
-		});
-
-	auto find_iter = _pools.find(server_ip);
-	if (find_iter == _pools.end()) {
-		return rsp;
+		return MakeReadyFuture(std::move(rsp));
 	}
 
-	auto& pool = find_iter->second;
-	ClientContext context;
-	auto stub = pool->getConnection();
-	Defer defercon([&stub, this, &pool]() {
-		pool->returnConnection(std::move(stub));
+	auto cfg = ConfigMgr::Inst().Snapshot();
+	auto uid = req.uid();
+	return _rpc_queue.Call<KickUserRsp>(req, cfg->rpc_timeout_ms,
+		[stub](ClientContext* context, const KickUserReq& request, grpc::CompletionQueue* cq) {
+			return stub->PrepareAsyncNotifyKickUser(context, request, cq);
+		},
+		[uid, server_ip](const Status& status, KickUserRsp& rsp) {
+			rsp.set_uid(uid);
+			if (!status.ok()) {
+				spdlog::error("通知 {} 踢掉用户 {} 失败, code: {}, msg: {}", server_ip, uid, (int)status.error_code(), status.error_message());
+				rsp.set_error(ErrorCodes::RPCFailed);
+			}
 		});
-	Status status = stub->NotifyKickUser(&context, req, &rsp);
-
-	if (!status.ok()) {
-		rsp.set_error(ErrorCodes::RPCFailed);
-		return rsp;
-	}
-
-	return rsp;
 }
@@ -6,27 +6,122 @@
 #include <json/reader.h>
 #include "RedisMgr.h"
 #include "MysqlMgr.h"
+#include "UserInfoCache.h"
+#include "RpcMetrics.h"
+#include "ConfigMgr.h"
+#include <boost/asio/post.hpp>
+#include <deque>
+
+// 对端消息流的服务端reactor：每读到一条就投递给本服用户并排队确认，
+// 同一时刻最多一个写在进行，读写回调可能在不同线程，共享状态用锁保护
+class TextChatStreamReactor : public grpc::ServerBidiReactor<TextChatMsgReq, TextChatMsgRsp>
+{
+public:
+	explicit TextChatStreamReactor(ChatServiceImpl* service)
+		: _service(service), _writing(false), _read_done(false), _finished(false) {
+		StartRead(&_request);
+	}
+
+	void OnReadDone(bool ok) override {
+		if (!ok) {
+			// 对端结束写入或流已断开，等确认写完再结束
+			std::lock_guard<std::mutex> lock(_mutex);
+			_read_done = true;
+			tryFinish();
+			return;
+		}
+
+		auto start = std::chrono::steady_clock::now();
+		TextChatMsgRsp reply;
+		_service->DeliverTextChatMsg(_request, &reply);
+		RpcMetrics::GetInstance()->Record("TextChatMsgStream", start);
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_writes.push_back(std::move(reply));
+			if (!_writing) {
+				_writing = true;
+				StartWrite(&_writes.front());
+			}
+		}
+		StartRead(&_request);
+	}
+
+	void OnWriteDone(bool ok) override {
+		std::lock_guard<std::mutex> lock(_mutex);
+		_writes.pop_front();
+		if (!ok) {
+			// 写失败说明流已断开，剩余的确认不再发送
+			_writes.clear();
+		}
+
+		if (!_writes.empty()) {
+			StartWrite(&_writes.front());
+			return;
+		}
+		_writing = false;
+		tryFinish();
+	}
+
+	void OnDone() override {
+		delete this;
+	}
+
+private:
+	// 调用前需持有 _mutex
+	void tryFinish() {
+		if (_read_done && !_writing && !_finished) {
+			_finished = true;
+			Finish(Status::OK);
+		}
+	}
+
+	ChatServiceImpl* _service;
+	TextChatMsgReq _request;
+	std::mutex _mutex;
+	std::deque<TextChatMsgRsp> _writes;
+	bool _writing;
+	bool _read_done;
+	bool _finished;
+};
 
 ChatServiceImpl::ChatServiceImpl()
 {
+	auto cfg = ConfigMgr::Inst().Snapshot();
+	_workers = std::make_unique<boost::asio::thread_pool>(std::max(1, cfg->rpc_worker_threads));
+}
+
+ChatServiceImpl::~ChatServiceImpl()
+{
+	Shutdown();
+}
 
+void ChatServiceImpl::Shutdown()
+{
+	if (_workers) {
+		_workers->join();
+	}
 }
 
-Status ChatServiceImpl::NotifyAddFriend(ServerContext* context, const AddFriendReq* request, AddFriendRsp* reply)
+grpc::ServerUnaryReactor* ChatServiceImpl::NotifyAddFriend(grpc::CallbackServerContext* context,
+	const AddFriendReq* request, AddFriendRsp* reply)
 {
+	auto start = std::chrono::steady_clock::now();
+	auto* reactor = context->DefaultReactor();
 	// 检查用户是否在线
 	auto touid = request->touid();
 	auto session = UserMgr::GetInstance()->GetSession(touid);
 
-	Defer defer([request, reply]() {
+	Defer defer([request, reply, reactor, start]() {
 		reply->set_error(ErrorCodes::Success);
 		reply->set_applyuid(request->applyuid());
 		reply->set_touid(request->touid());
+		reactor->Finish(Status::OK);
+		RpcMetrics::GetInstance()->Record("NotifyAddFriend", start);
 		});
 
 	// 用户不在线直接返回
 	if (session == nullptr) {
-		return Status::OK;
+		return reactor;
 	}
 	
 	// 在线则直接通知对方
@@ -42,73 +137,96 @@ Status ChatServiceImpl::NotifyAddFriend(ServerContext* context, const AddFriendR
 	std::string return_str = rtvalue.toStyledString();
 
 	session->Send(return_str, ID_NOTIFY_ADD_FRIEND_REQ);
-	return Status::OK;
+	return reactor;
 }
 
-Status ChatServiceImpl::NotifyAuthFriend(ServerContext* context, const AuthFriendReq* request,
-	AuthFriendRsp* reply) {
-	// 检查用户是否在线
-	auto touid = request->touid();
-	auto fromuid = request->fromuid();
-	auto session = UserMgr::GetInstance()->GetSession(touid);
+grpc::ServerUnaryReactor* ChatServiceImpl::NotifyAuthFriend(grpc::CallbackServerContext* context,
+	const AuthFriendReq* request, AuthFriendRsp* reply) {
+	auto start = std::chrono::steady_clock::now();
+	auto* reactor = context->DefaultReactor();
+	// 查询申请人信息可能要访问redis/mysql，放到工作线程里做
+	boost::asio::post(*_workers, [this, request, reply, reactor, start]() {
+		// 检查用户是否在线
+		auto touid = request->touid();
+		auto fromuid = request->fromuid();
+		auto session = UserMgr::GetInstance()->GetSession(touid);
 
-	Defer defer([request, reply]() {
-		reply->set_error(ErrorCodes::Success);
-		reply->set_fromuid(request->fromuid());
-		reply->set_touid(request->touid());
-		});
+		Defer defer([request, reply, reactor, start]() {
+			reply->set_error(ErrorCodes::Success);
+			reply->set_fromuid(request->fromuid());
+			reply->set_touid(request->touid());
+			reactor->Finish(Status::OK);
+			RpcMetrics::GetInstance()->Record("NotifyAuthFriend", start);
+			});
 
-	// 用户不在线直接返回
-	if (session == nullptr) {
-		return Status::OK;
-	}
+		// 用户不在线直接返回
+		if (session == nullptr) {
+			return;
+		}
 
-	// 在线则直接通知对方
-	Json::Value  rtvalue;
-	rtvalue["error"] = ErrorCodes::Success;
-	rtvalue["fromuid"] = request->fromuid();
-	rtvalue["touid"] = request->touid();
-
-	std::string base_key = USER_BASE_INFO + std::to_string(fromuid);
-	auto user_info = std::make_shared<UserInfo>();
-	bool b_info = GetBaseInfo(base_key, fromuid, user_info);
-	if (b_info) {
-		rtvalue["name"] = user_info->name;
-		rtvalue["nick"] = user_info->nick;
-		rtvalue["icon"] = user_info->icon;
-		rtvalue["sex"] = user_info->sex;
-	}
-	else {
-		rtvalue["error"] = ErrorCodes::UidInvalid;
-	}
+		// 在线则直接通知对方
+		Json::Value  rtvalue;
+		rtvalue["error"] = ErrorCodes::Success;
+		rtvalue["fromuid"] = request->fromuid();
+		rtvalue["touid"] = request->touid();
 
-	std::string return_str = rtvalue.toStyledString();
+		std::string base_key = USER_HASH_PREFIX + std::to_string(fromuid);
+		auto user_info = std::make_shared<UserInfo>();
+		bool b_info = GetBaseInfo(base_key, fromuid, user_info);
+		if (b_info) {
+			rtvalue["name"] = user_info->name;
+			rtvalue["nick"] = user_info->nick;
+			rtvalue["icon"] = user_info->icon;
+			rtvalue["sex"] = user_info->sex;
+		}
+		else {
+			rtvalue["error"] = ErrorCodes::UidInvalid;
+		}
+
+		std::string return_str = rtvalue.toStyledString();
 
-	session->Send(return_str, ID_NOTIFY_AUTH_FRIEND_REQ);
-	return Status::OK;
+		session->Send(return_str, ID_NOTIFY_AUTH_FRIEND_REQ);
+		});
+	return reactor;
 }
 
-Status ChatServiceImpl::NotifyTextChatMsg(::grpc::ServerContext* context,
+grpc::ServerUnaryReactor* ChatServiceImpl::NotifyTextChatMsg(grpc::CallbackServerContext* context,
 	const TextChatMsgReq* request, TextChatMsgRsp* reply) {
+	auto start = std::chrono::steady_clock::now();
+	auto* reactor = context->DefaultReactor();
+	DeliverTextChatMsg(*request, reply);
+	reactor->Finish(Status::OK);
+	RpcMetrics::GetInstance()->Record("NotifyTextChatMsg", start);
+	return reactor;
+}
+
+grpc::ServerBidiReactor<TextChatMsgReq, TextChatMsgRsp>* ChatServiceImpl::TextChatMsgStream(
+	grpc::CallbackServerContext* context) {
+	return new TextChatStreamReactor(this);
+}
+
+void ChatServiceImpl::DeliverTextChatMsg(const TextChatMsgReq& request, TextChatMsgRsp* reply) {
 	// 检查用户是否在线
-	auto touid = request->touid();
+	auto touid = request.touid();
 	auto session = UserMgr::GetInstance()->GetSession(touid);
 	reply->set_error(ErrorCodes::Success);
+	reply->set_fromuid(request.fromuid());
+	reply->set_touid(touid);
 
 	// 用户不在线直接返回
 	if (session == nullptr) {
-		return Status::OK;
+		return;
 	}
 
 	// 在线则直接通知对方
 	Json::Value  rtvalue;
 	rtvalue["error"] = ErrorCodes::Success;
-	rtvalue["fromuid"] = request->fromuid();
-	rtvalue["touid"] = request->touid();
+	rtvalue["fromuid"] = request.fromuid();
+	rtvalue["touid"] = request.touid();
 
 	// 将消息数组组织为json
 	Json::Value text_array;
-	for (auto& msg : request->textmsgs()) {
+	for (auto& msg : request.textmsgs()) {
 		Json::Value element;
 		element["content"] = msg.msgcontent();
 		element["msgid"] = msg.msgid();
@@ -119,72 +237,34 @@ Status ChatServiceImpl::NotifyTextChatMsg(::grpc::ServerContext* context,
 	std::string return_str = rtvalue.toStyledString();
 
 	session->Send(return_str, ID_NOTIFY_TEXT_CHAT_MSG_REQ);
-	return Status::OK;
 }
 
 
 bool ChatServiceImpl::GetBaseInfo(std::string base_key, int uid, std::shared_ptr<UserInfo>& userinfo)
 {
-	// 优先从redis中查询用户信息
-	std::string info_str = "";
-	bool b_base = RedisMgr::GetInstance()->Get(base_key, info_str);
-	if (b_base) {
-		Json::Reader reader;
-		Json::Value root;
-		reader.parse(info_str, root);
-		userinfo->uid = root["uid"].asInt();
-		userinfo->name = root["name"].asString();
-		userinfo->pwd = root["pwd"].asString();
-		userinfo->email = root["email"].asString();
-		userinfo->nick = root["nick"].asString();
-		userinfo->desc = root["desc"].asString();
-		userinfo->sex = root["sex"].asInt();
-		userinfo->icon = root["icon"].asString();
-		spdlog::info("从Redis中查询到用户信息 uid: {} name: {} pwd: {} email: {} nick: {} desc: {} sex: {} icon: {}",
-			userinfo->uid, userinfo->name, userinfo->pwd, userinfo->email, userinfo->nick, userinfo->desc, userinfo->sex, userinfo->icon);
-	}
-	else {
-		// redis没有则查询mysql
-		// 查询数据库
-		std::shared_ptr<UserInfo> user_info = nullptr;
-		user_info = MysqlMgr::GetInstance()->GetUser(uid);
-		if (user_info == nullptr) {
-			return false;
-		}
-
-		userinfo = user_info;
-
-		// 将数据库结果写入redis缓存
-		Json::Value redis_root;
-		redis_root["uid"] = uid;
-		redis_root["pwd"] = userinfo->pwd;
-		redis_root["name"] = userinfo->name;
-		redis_root["email"] = userinfo->email;
-		redis_root["nick"] = userinfo->nick;
-		redis_root["desc"] = userinfo->desc;
-		redis_root["sex"] = userinfo->sex;
-		redis_root["icon"] = userinfo->icon;
-		RedisMgr::GetInstance()->Set(base_key, redis_root.toStyledString());
-	}
-	
-	return true;
+	// 与LogicSystem共用同一份本地缓存，未命中再查redis和mysql
+	return UserInfoCache::GetInstance()->GetBaseInfo(uid, userinfo);
 }
 
-Status ChatServiceImpl::NotifyKickUser(::grpc::ServerContext* context, 
+grpc::ServerUnaryReactor* ChatServiceImpl::NotifyKickUser(grpc::CallbackServerContext* context,
 	const KickUserReq* request, KickUserRsp* reply)
 {
+	auto start = std::chrono::steady_clock::now();
+	auto* reactor = context->DefaultReactor();
 	// 检查用户是否在线
 	auto uid = request->uid();
 	auto session = UserMgr::GetInstance()->GetSession(uid);
 
-	Defer defer([request, reply]() {
+	Defer defer([request, reply, reactor, start]() {
 		reply->set_error(ErrorCodes::Success);
 		reply->set_uid(request->uid());
+		reactor->Finish(Status::OK);
+		RpcMetrics::GetInstance()->Record("NotifyKickUser", start);
 		});
 
 	// 用户不在线直接返回
 	if (session == nullptr) {
-		return Status::OK;
+		return reactor;
 	}
 
 	// 在线则直接通知对方
@@ -192,7 +272,7 @@ Status ChatServiceImpl::NotifyKickUser(::grpc::ServerContext* context,
 	// 清理已断开的会话
 	_p_server->ClearSession(session->GetSessionId());
 
-	return Status::OK;
+	return reactor;
 }
 
 void ChatServiceImpl::RegisterServer(std::shared_ptr<CServer> pServer)
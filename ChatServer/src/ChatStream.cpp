@@ -0,0 +1,203 @@
+#include "ChatStream.h"
+#include "ConfigMgr.h"
+#include <vector>
+
+using message::TextChatMsgReq;
+using message::TextChatMsgRsp;
+
+ChatStream::ChatStream(const std::string& name, const std::string& host, const std::string& port, Fallback fallback)
+	: _name(name), _fallback(std::move(fallback)), _ready(false), _broken(false), _b_stop(false)
+{
+	_channel = grpc::CreateChannel(host + ":" + port, grpc::InsecureChannelCredentials());
+	_thread = std::thread([this]() {
+		run();
+		});
+}
+
+ChatStream::~ChatStream()
+{
+	Close();
+}
+
+void ChatStream::Close()
+{
+	{
+		// 持锁置位并通知，写线程检查完条件、尚未进入等待时不会错过这次通知
+		std::lock_guard<std::mutex> lock(_mutex);
+		if (_b_stop.exchange(true)) {
+			return;
+		}
+		_cond.notify_all();
+	}
+	if (_thread.joinable()) {
+		_thread.join();
+	}
+}
+
+bool ChatStream::Send(const TextChatMsgReq& req)
+{
+	auto cfg = ConfigMgr::Inst().Snapshot();
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		if (!_ready || _broken) {
+			return false;
+		}
+		// 对端处理不过来时不再堆积，交给调用方走一元rpc
+		if (_pending.size() + _inflight.size() >= (size_t)cfg->chat_stream_window) {
+			return false;
+		}
+		_pending.push_back(req);
+	}
+	_cond.notify_all();
+	return true;
+}
+
+void ChatStream::run()
+{
+	auto stub = message::ChatService::NewStub(_channel);
+	int backoff_ms = 100;
+	while (!_b_stop) {
+		auto start = std::chrono::steady_clock::now();
+		// 连接就绪后再建流，对端未启动时不会反复创建注定失败的流
+		if (_channel->WaitForConnected(std::chrono::system_clock::now() + std::chrono::seconds(1))) {
+			serve(stub);
+			drainToFallback();
+		}
+
+		if (_b_stop) {
+			break;
+		}
+
+		// 稳定运行过一段时间的流断开后立即重连，否则指数退避
+		if (std::chrono::steady_clock::now() - start > std::chrono::seconds(5)) {
+			backoff_ms = 100;
+		}
+		std::unique_lock<std::mutex> lock(_mutex);
+		_cond.wait_for(lock, std::chrono::milliseconds(backoff_ms), [this]() {
+			return _b_stop.load();
+			});
+		backoff_ms = std::min(backoff_ms * 2, 5000);
+	}
+}
+
+void ChatStream::serve(std::unique_ptr<message::ChatService::Stub>& stub)
+{
+	grpc::ClientContext context;
+	auto stream = stub->TextChatMsgStream(&context);
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_ready = true;
+		_broken = false;
+	}
+	spdlog::info("到 {} 的消息流已建立", _name);
+
+	std::thread reader([this, &stream]() {
+		readLoop(stream.get());
+		});
+
+	bool write_failed = false;
+	while (true) {
+		auto cfg = ConfigMgr::Inst().Snapshot();
+		size_t batch_size = std::max(1, cfg->chat_stream_batch_size);
+		std::vector<TextChatMsgReq> batch;
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			_cond.wait(lock, [this]() {
+				return _b_stop || _broken || !_pending.empty();
+				});
+			// 停止时先把已排队的消息发完
+			if (_broken || (_b_stop && _pending.empty())) {
+				break;
+			}
+
+			// 不满一批时在窗口内继续攒，减少小包和系统调用
+			if (!_b_stop && _pending.size() < batch_size && cfg->chat_stream_flush_ms > 0) {
+				_cond.wait_for(lock, std::chrono::milliseconds(cfg->chat_stream_flush_ms), [this, batch_size]() {
+					return _b_stop || _broken || _pending.size() >= batch_size;
+					});
+			}
+
+			while (!_pending.empty() && batch.size() < batch_size) {
+				_inflight.push_back(_pending.front());
+				batch.push_back(std::move(_pending.front()));
+				_pending.pop_front();
+			}
+		}
+
+		// 除最后一条外都带 buffer_hint，整批合并成尽量少的帧发出
+		for (size_t i = 0; i < batch.size(); ++i) {
+			grpc::WriteOptions options;
+			if (i + 1 < batch.size()) {
+				options.set_buffer_hint();
+			}
+			if (!stream->Write(batch[i], options)) {
+				write_failed = true;
+				break;
+			}
+		}
+
+		if (write_failed) {
+			break;
+		}
+	}
+
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		_ready = false;
+		if (!write_failed && !_broken) {
+			lock.unlock();
+			stream->WritesDone();
+			lock.lock();
+			// 等对端确认完剩余消息后自然结束，超时则直接取消
+			_cond.wait_for(lock, std::chrono::seconds(1), [this]() {
+				return _broken;
+				});
+		}
+	}
+
+	context.TryCancel();
+	reader.join();
+	auto status = stream->Finish();
+	spdlog::warn("到 {} 的消息流已断开, code: {}, msg: {}", _name, (int)status.error_code(), status.error_message());
+}
+
+void ChatStream::readLoop(grpc::ClientReaderWriter<TextChatMsgReq, TextChatMsgRsp>* stream)
+{
+	TextChatMsgRsp rsp;
+	while (stream->Read(&rsp)) {
+		std::lock_guard<std::mutex> lock(_mutex);
+		// 对端按写入顺序逐条确认
+		if (!_inflight.empty()) {
+			_inflight.pop_front();
+		}
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_broken = true;
+	}
+	_cond.notify_all();
+}
+
+void ChatStream::drainToFallback()
+{
+	std::deque<TextChatMsgReq> msgs;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_ready = false;
+		msgs.swap(_inflight);
+		for (auto& msg : _pending) {
+			msgs.push_back(std::move(msg));
+		}
+		_pending.clear();
+	}
+
+	if (msgs.empty()) {
+		return;
+	}
+
+	spdlog::warn("到 {} 的消息流上有 {} 条消息未确认, 改走一元rpc补发", _name, msgs.size());
+	for (auto& msg : msgs) {
+		_fallback(msg);
+	}
+}
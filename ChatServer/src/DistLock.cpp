@@ -1,14 +1,17 @@
 #include "DistLock.h"
+#include "RedisMgr.h"
+#include "RedisSubscriber.h"
+#include "const.h"
 #include <thread>
 #include <iostream>
 #include <string>
 #include <chrono>
 #include <thread>
 #include <cstdlib>
+#include <algorithm>
 #include <boost/uuid/uuid.hpp>
 #include <boost/uuid/uuid_generators.hpp>
 #include <boost/uuid/uuid_io.hpp>
-#include <hiredis/hiredis.h>
 
 
 // 单例模式
@@ -23,51 +26,116 @@ static std::string generateUUID() {
 	return to_string(uuid);
 }
 
+// 加锁脚本: 成功返回 {1, 0}，失败返回 {0, 锁的剩余存活毫秒数}
+static const RedisScript ACQUIRE_SCRIPT(
+	"if redis.call('SET', KEYS[1], ARGV[1], 'NX', 'EX', ARGV[2]) then return {1, 0} end "
+	"return {0, redis.call('PTTL', KEYS[1])}");
+
+// 释放脚本: 标识匹配才删除，删除后发布释放通知唤醒等待者
+static const RedisScript RELEASE_SCRIPT(
+	"if redis.call('GET', KEYS[1]) == ARGV[1] then "
+	"redis.call('DEL', KEYS[1]) "
+	"redis.call('PUBLISH', ARGV[2], KEYS[1]) "
+	"return 1 end "
+	"return 0");
+
+bool DistLock::tryAcquire(const std::string& lockKey,
+    const std::string& identifier, int lockTimeout, long long& pttl) {
+    auto reply = RedisMgr::GetInstance()->EvalAsync(ACQUIRE_SCRIPT, { lockKey },
+        { identifier, std::to_string(lockTimeout) }).get();
+    pttl = 0;
+    if (!reply.IsArray() || reply.elements.size() != 2) {
+        // 连接不可用时命令会立即失败，隔一小段时间再试，避免空转
+        pttl = 100;
+        return false;
+    }
+
+    pttl = reply.elements[1].integer;
+    return reply.elements[0].integer == 1;
+}
+
+void DistLock::onRelease(const std::string& lockKey) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto iter = _waiters.find(lockKey);
+    // 没有等待者的锁无需记录
+    if (iter == _waiters.end()) {
+        return;
+    }
+    iter->second.seq++;
+    _cond.notify_all();
+}
+
 // 尝试获取分布式锁，返回唯一标识UUID，获取失败则返回空字符串
-std::string DistLock::acquireLock(redisContext* context, const std::string& lockName,
+// 加锁失败后不再 1ms 轮询，而是等待释放通知；通知可能因订阅连接断开而丢失，
+// 因此等待时间以锁的剩余存活时间为上限，持有者崩溃时锁到期后也能继续尝试
+std::string DistLock::acquireLock(const std::string& lockName,
     int lockTimeout, int acquireTimeout) {
+    return acquireLock(lockName, lockTimeout, std::chrono::milliseconds(acquireTimeout * 1000LL));
+}
+
+// 等待时间按毫秒计，只想短暂等待、不愿阻塞到锁过期的调用方使用
+std::string DistLock::acquireLock(const std::string& lockName,
+    int lockTimeout, std::chrono::milliseconds acquireTimeout) {
+    std::call_once(_sub_flag, [this]() {
+        RedisSubscriber::GetInstance()->Subscribe(LOCK_RELEASE_CHANNEL,
+            [this](const std::string&, const std::string& lockKey) {
+                onRelease(lockKey);
+            });
+    });
+
     std::string identifier = generateUUID();
     std::string lockKey = "lock:" + lockName;
-    auto endTime = std::chrono::steady_clock::now() + std::chrono::seconds(acquireTimeout);
-
-    while (std::chrono::steady_clock::now() < endTime) {
-        // 使用 SET 命令尝试加锁 SET lockKey identifier NX EX lockTimeout
-        redisReply* reply = (redisReply*)redisCommand(context, "SET %s %s NX EX %d",
-            lockKey.c_str(), identifier.c_str(), lockTimeout);
-        if (reply != nullptr) {
-            // 判断返回结果是否为 OK
-            if (reply->type == REDIS_REPLY_STATUS && std::string(reply->str) == "OK") {
-                freeReplyObject(reply);
-                return identifier;
-            }
-            freeReplyObject(reply);
+    auto endTime = std::chrono::steady_clock::now() + acquireTimeout;
+
+    // 先登记为等待者再尝试加锁，避免加锁失败与开始等待之间的释放通知被漏掉
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _waiters[lockKey].count++;
+    }
+    Defer defer([this, &lockKey]() {
+        std::lock_guard<std::mutex> lock(_mutex);
+        auto iter = _waiters.find(lockKey);
+        if (iter != _waiters.end() && --iter->second.count == 0) {
+            _waiters.erase(iter);
+        }
+    });
+
+    while (true) {
+        uint64_t seq = 0;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            seq = _waiters[lockKey].seq;
+        }
+
+        long long pttl = 0;
+        if (tryAcquire(lockKey, identifier, lockTimeout, pttl)) {
+            return identifier;
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        if (now >= endTime) {
+            return "";
         }
-        // 休眠 1 毫秒后重试，防止忙等
-        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+        auto until = endTime;
+        if (pttl >= 0) {
+            until = std::min(endTime, now + std::chrono::milliseconds(pttl + 1));
+        }
+
+        std::unique_lock<std::mutex> lock(_mutex);
+        _cond.wait_until(lock, until, [this, &lockKey, seq]() {
+            return _waiters[lockKey].seq != seq;
+        });
     }
-    return "";
 }
 
 // 释放锁，只能持有该锁的客户端才能释放，返回是否成功
-bool DistLock::releaseLock(redisContext* context, const std::string& lockName,
+bool DistLock::releaseLock(const std::string& lockName,
     const std::string& identifier) {
     std::string lockKey = "lock:" + lockName;
-    // Lua 脚本判断锁标识是否匹配，匹配则删除
-    const char* luaScript = "if redis.call('get', KEYS[1]) == ARGV[1] then \
-                                return redis.call('del', KEYS[1]) \
-                             else \
-                                return 0 \
-                             end";
-    // 使用 EVAL 命令执行 Lua 脚本，第一个参数为脚本，第二个为key，第三个为参数
-    redisReply* reply = (redisReply*)redisCommand(context, "EVAL %s 1 %s %s",
-        luaScript, lockKey.c_str(), identifier.c_str());
-    bool success = false;
-    if (reply != nullptr) {
-        // 返回整数值为 1 时表示成功删除锁
-        if (reply->type == REDIS_REPLY_INTEGER && reply->integer == 1) {
-            success = true;
-        }
-        freeReplyObject(reply);
-    }
-    return success;
-}
\ No newline at end of file
+    // 使用 EVALSHA 执行 Lua 脚本，释放成功后在脚本内发布通知
+    auto reply = RedisMgr::GetInstance()->EvalAsync(RELEASE_SCRIPT, { lockKey },
+        { identifier, LOCK_RELEASE_CHANNEL }).get();
+    // 返回整数值为 1 时表示成功删除锁
+    return reply.IsInteger() && reply.integer == 1;
+}
@@ -5,12 +5,125 @@
 #include "RedisMgr.h"
 #include "UserMgr.h"
 #include "ChatGrpcClient.h"
+#include "UserInfoCache.h"
+#include "FriendListCache.h"
+#include "UserExistFilter.h"
+#include "UserProfileCodec.h"
+#include "RouteCache.h"
 #include "DistLock.h"
+#include "TokenVerifier.h"
 #include <string>
+#include <future>
+#include <limits>
+#include <set>
+#include <algorithm>
 #include "CServer.h"
 using namespace std;
 
+static Json::Value applyToJson(const ApplyInfo& apply) {
+	Json::Value obj;
+	obj["name"] = apply._name;
+	obj["uid"] = apply._uid;
+	obj["icon"] = apply._icon;
+	obj["nick"] = apply._nick;
+	obj["sex"] = apply._sex;
+	obj["desc"] = apply._desc;
+	obj["status"] = apply._status;
+	return obj;
+}
+
+static Json::Value friendToJson(const UserInfo& friend_ele) {
+	Json::Value obj;
+	obj["name"] = friend_ele.name;
+	obj["uid"] = friend_ele.uid;
+	obj["icon"] = friend_ele.icon;
+	obj["nick"] = friend_ele.nick;
+	obj["sex"] = friend_ele.sex;
+	obj["desc"] = friend_ele.desc;
+	obj["back"] = friend_ele.back;
+	return obj;
+}
+
+//把查到的一页逐条放进 rtvalue[list_key]，最多 page 条，且整个回包不超过一帧 MAX_LENGTH；
+//items 比 page 多查一条用来判断后面是否还有。next_key 写入最后一条的uid，客户端带上它拉取下一页；
+//回包中已有的内容(如登录时先放入的申请列表)已经占满一帧时一条也不放，next_key 不前进，more 为true
+static void appendPage(Json::Value& rtvalue, const char* list_key, const char* next_key, const char* more_key,
+	const std::vector<std::pair<int, Json::Value>>& items, size_t page, int after) {
+	//toStyledString 每级缩进的宽度，随 jsoncpp 的版本不同是一个制表符或三个空格
+	static const size_t indent = []() {
+		Json::Value probe;
+		probe["a"] = 1;
+		auto text = probe.toStyledString();
+		return text.find('"') - text.find('\n') - 1;
+	}();
+	//先按最长的取值占位，量一次不含条目的回包大小，之后每条只序列化一次累加
+	rtvalue[list_key] = Json::Value(Json::arrayValue);
+	rtvalue[next_key] = std::numeric_limits<int>::min();
+	rtvalue[more_key] = false;
+	size_t size = rtvalue.toStyledString().size();
+	size_t count = 0;
+	for (; count < items.size() && count < page; ++count) {
+		//条目在回包中位于第二层，每行多两级缩进，另加分隔用的逗号；第一条还要把 [] 展开成多行
+		auto text = items[count].second.toStyledString();
+		size_t item_size = text.size() + std::count(text.begin(), text.end(), '\n') * 2 * indent + 1;
+		if (count == 0) {
+			item_size += 2 * (indent + 1);
+		}
+		if (size + item_size > MAX_LENGTH) {
+			break;
+		}
+		size += item_size;
+		rtvalue[list_key].append(items[count].second);
+		after = items[count].first;
+	}
+	rtvalue[next_key] = after;
+	rtvalue[more_key] = count < items.size();
+}
+
+//联系人变更记录中的条目：a<uid> 为来自uid的好友申请，f<uid> 为好友uid
+static std::string applyChange(int uid) {
+	return "a" + std::to_string(uid);
+}
+
+static std::string friendChange(int uid) {
+	return "f" + std::to_string(uid);
+}
+
+static void splitChanges(const std::vector<std::string>& changes, std::vector<int>& apply_uids, std::vector<int>& friend_uids) {
+	for (auto& change : changes) {
+		if (change.size() < 2) {
+			continue;
+		}
+		int uid = atoi(change.c_str() + 1);
+		if (change[0] == 'a') {
+			apply_uids.push_back(uid);
+		}
+		else if (change[0] == 'f') {
+			friend_uids.push_back(uid);
+		}
+	}
+}
+
+//增量同步：有变化且仍然存在的条目放进 list_key，数据库中已经没有的uid放进 removed_key
+static void appendChanges(Json::Value& rtvalue, const char* list_key, const char* removed_key,
+	const std::vector<int>& uids, const std::vector<std::pair<int, Json::Value>>& items) {
+	rtvalue[list_key] = Json::Value(Json::arrayValue);
+	rtvalue[removed_key] = Json::Value(Json::arrayValue);
+	std::set<int> found;
+	for (auto& item : items) {
+		rtvalue[list_key].append(item.second);
+		found.insert(item.first);
+	}
+	for (auto uid : uids) {
+		if (found.count(uid) == 0) {
+			rtvalue[removed_key].append(uid);
+		}
+	}
+}
+
 LogicSystem::LogicSystem():_b_stop(false), _p_server(nullptr){
+	auto cfg = ConfigMgr::Inst().Snapshot();
+	_loaders = std::make_unique<boost::asio::thread_pool>(std::max(1, cfg->login_loader_threads));
 	RegisterCallBacks();
 	_worker_thread = std::thread (&LogicSystem::DealMsg, this);
 }
@@ -19,6 +132,16 @@ LogicSystem::~LogicSystem(){
 	_b_stop = true;
 	_consume.notify_one();
 	_worker_thread.join();
+	_loaders->join();
+}
+
+std::future<bool> LogicSystem::postLoad(std::function<bool()> job) {
+	auto task = std::make_shared<std::packaged_task<bool()>>(std::move(job));
+	auto future = task->get_future();
+	boost::asio::post(*_loaders, [task]() {
+		(*task)();
+		});
+	return future;
 }
 
 void LogicSystem::PostMsgToQue(shared_ptr < LogicNode> msg) {
@@ -95,6 +218,12 @@ void LogicSystem::RegisterCallBacks() {
 
 	_fun_callbacks[ID_HEART_BEAT_REQ] = std::bind(&LogicSystem::HeartBeatHandler, this,
 		placeholders::_1, placeholders::_2, placeholders::_3);
+
+	_fun_callbacks[ID_GET_APPLY_LIST_REQ] = std::bind(&LogicSystem::GetApplyListHandler, this,
+		placeholders::_1, placeholders::_2, placeholders::_3);
+
+	_fun_callbacks[ID_GET_FRIEND_LIST_REQ] = std::bind(&LogicSystem::GetFriendListHandler, this,
+		placeholders::_1, placeholders::_2, placeholders::_3);
 	
 }
 
@@ -104,7 +233,9 @@ void LogicSystem::LoginHandler(shared_ptr<CSession> session, const short &msg_id
 	reader.parse(msg_data, root);
 	auto uid = root["uid"].asInt();
 	auto token = root["token"].asString();
-	spdlog::info("用户登录, uid: {}, token: {}", uid, token);
+	//客户端上次同步到的联系人版本号，首次登录或本地没有缓存时为0
+	auto contact_ver = root["contact_ver"].asInt64();
+	spdlog::info("用户登录, uid: {}, token: {}, contact_ver: {}", uid, token, contact_ver);
 
 	Json::Value  rtvalue;
 	Defer defer([this, &rtvalue, session]() {
@@ -112,28 +243,97 @@ void LogicSystem::LoginHandler(shared_ptr<CSession> session, const short &msg_id
 		session->Send(return_str, MSG_CHAT_LOGIN_RSP);
 		});
 
+	//token在本地验签，不再访问redis
+	LoginTokenClaims claims;
+	auto verify_res = TokenVerifier::GetInstance()->Verify(token, uid, claims);
+	if (verify_res != ErrorCodes::Success) {
+		rtvalue["error"] = verify_res;
+		return ;
+	}
 
-	//从redis中获取用户token是否正确
-	std::string uid_str = std::to_string(uid);
-	std::string token_key = USERTOKENPREFIX + uid_str;
-	std::string token_value = "";
-	bool success = RedisMgr::GetInstance()->Get(token_key, token_value);
+	//一次Lua脚本完成 u_<uid> 中的所有权切换以及基础信息读取
+	auto cfg = ConfigMgr::Inst().Snapshot();
+	auto& server_name = cfg->self_name;
+	LoginSwapResult swap_res;
+	bool success = RedisMgr::GetInstance()->LoginSwap(uid, server_name,
+		session->GetSessionId(), contact_ver, swap_res);
 	if (!success) {
 		rtvalue["error"] = ErrorCodes::UidInvalid;
 		return ;
 	}
 
-	if (token_value != token) {
-		rtvalue["error"] = ErrorCodes::TokenInvalid;
-		return ;
+	//token只能用一次，登录成功后立即吊销，截获的token无法重放
+	TokenVerifier::GetInstance()->Revoke(claims);
+
+	//联系人没有变化时不访问数据库；增量时只查有变化的条目，全量时只取第一页，其余由客户端分页拉取。
+	//好友申请列表和好友列表互不依赖，在加载线程池中并发读取
+	int page = cfg->friend_page_size;
+	int sync = swap_res.contact_sync;
+	std::vector<int> apply_uids, friend_uids;
+	splitChanges(swap_res.contact_changes, apply_uids, friend_uids);
+	std::vector<std::shared_ptr<ApplyInfo>> apply_list;
+	std::vector<std::shared_ptr<UserInfo>> friend_list;
+	std::future<bool> apply_future, friend_future;
+	//读取任务引用了上面的局部变量，提前返回时也要等它们结束
+	Defer wait_loads([&apply_future, &friend_future]() {
+		if (apply_future.valid()) {
+			apply_future.wait();
+		}
+		if (friend_future.valid()) {
+			friend_future.wait();
+		}
+		});
+	if (sync != CONTACT_SYNC_NOT_MODIFIED) {
+		apply_future = postLoad([this, uid, page, sync, &apply_uids, &apply_list]() {
+			return sync == CONTACT_SYNC_DELTA ? GetFriendApplyInfo(uid, apply_uids, apply_list)
+				: GetFriendApplyInfo(uid, 0, page + 1, apply_list);
+			});
+		friend_future = postLoad([this, uid, page, sync, &friend_uids, &friend_list]() {
+			return sync == CONTACT_SYNC_DELTA ? GetFriendList(uid, friend_uids, friend_list)
+				: GetFriendList(uid, 0, page + 1, friend_list);
+			});
 	}
 
-	rtvalue["error"] = ErrorCodes::Success;
+	//session设置用户uid，uid与session进行绑定，方便后续的消息推送
+	session->SetUserId(uid);
+	session->SetFence(swap_res.fence);
+	UserMgr::GetInstance()->SetUserSession(uid, session);
+
+	//说明用户已经登录过，则需要踢掉旧的连接
+	if (!swap_res.old_server.empty() && swap_res.old_session != session->GetSessionId()) {
+		//如果之前登录的服务器和当前服务器一致，则直接通知本机旧的session下线
+		if (swap_res.old_server == server_name) {
+			auto old_session = _p_server->GetSession(swap_res.old_session);
+			if (old_session) {
+				old_session->NotifyOffline(uid);
+				//清除旧的session
+				_p_server->ClearSession(old_session->GetSessionId());
+			}
+		}
+		else {
+			//否则通过grpc通知旧机器踢掉用户
+			KickUserReq kick_req;
+			kick_req.set_uid(uid);
+			ChatGrpcClient::GetInstance()->NotifyKickUser(swap_res.old_server, kick_req);
+		}
+	}
 
+	rtvalue["error"] = ErrorCodes::Success;
 
-	std::string base_key = USER_BASE_INFO + uid_str;
+	std::string base_key = USER_HASH_PREFIX + std::to_string(uid);
 	auto user_info = std::make_shared<UserInfo>();
-	bool b_base = GetBaseInfo(base_key, uid, user_info);
+	bool b_base = false;
+	if (!swap_res.profile.empty()) {
+		//登录脚本已经带回了最新的基础信息，顺便刷新本地缓存
+		b_base = UserProfileCodec::Parse(swap_res.profile, *user_info);
+		if (b_base) {
+			UserInfoCache::GetInstance()->Put(user_info);
+		}
+	}
+	if (!b_base) {
+		b_base = GetBaseInfo(base_key, uid, user_info);
+	}
+
 	if (!b_base) {
 		rtvalue["error"] = ErrorCodes::UidInvalid;
 		return;
@@ -146,93 +346,66 @@ void LogicSystem::LoginHandler(shared_ptr<CSession> session, const short &msg_id
 	rtvalue["desc"] = user_info->desc;
 	rtvalue["sex"] = user_info->sex;
 	rtvalue["icon"] = user_info->icon;
+	rtvalue["contact_ver"] = (Json::Int64)swap_res.contact_ver;
+	rtvalue["contact_sync"] = sync;
+	if (sync == CONTACT_SYNC_NOT_MODIFIED) {
+		return;
+	}
 
-	//从数据库中获取好友申请列表
-	std::vector<std::shared_ptr<ApplyInfo>> apply_list;
-	auto b_apply = GetFriendApplyInfo(uid, apply_list);
-	if (b_apply) {
+	bool b_apply = apply_future.get();
+	bool b_friend = friend_future.get();
+	if (sync == CONTACT_SYNC_DELTA && b_apply && b_friend) {
+		std::vector<std::pair<int, Json::Value>> apply_items;
 		for (auto& apply : apply_list) {
-			Json::Value obj;
-			obj["name"] = apply->_name;
-			obj["uid"] = apply->_uid;
-			obj["icon"] = apply->_icon;
-			obj["nick"] = apply->_nick;
-			obj["sex"] = apply->_sex;
-			obj["desc"] = apply->_desc;
-			obj["status"] = apply->_status;
-			rtvalue["apply_list"].append(obj);
+			apply_items.emplace_back(apply->_uid, applyToJson(*apply));
+		}
+		appendChanges(rtvalue, "apply_list", "apply_removed", apply_uids, apply_items);
+		std::vector<std::pair<int, Json::Value>> friend_items;
+		for (auto& friend_ele : friend_list) {
+			friend_items.emplace_back(friend_ele->uid, friendToJson(*friend_ele));
+		}
+		appendChanges(rtvalue, "friend_list", "friend_removed", friend_uids, friend_items);
+		if (rtvalue.toStyledString().size() <= MAX_LENGTH) {
+			return;
 		}
 	}
 
-	//获取好友列表
-	std::vector<std::shared_ptr<UserInfo>> friend_list;
-	bool b_friend_list = GetFriendList(uid, friend_list);
-	for (auto& friend_ele : friend_list) {
-		Json::Value obj;
-		obj["name"] = friend_ele->name;
-		obj["uid"] = friend_ele->uid;
-		obj["icon"] = friend_ele->icon;
-		obj["nick"] = friend_ele->nick;
-		obj["sex"] = friend_ele->sex;
-		obj["desc"] = friend_ele->desc;
-		obj["back"] = friend_ele->back;
-		rtvalue["friend_list"].append(obj);
-	}
-
-	auto server_name = ConfigMgr::Inst().GetValue("SelfServer", "Name");
-	{
-		//对用户进行分组，便于后续的路由和负载均衡
-		//拼接用户ip对应的key
-		auto lock_key = LOCK_PREFIX + uid_str;
-		auto identifier = RedisMgr::GetInstance()->acquireLock(lock_key, LOCK_TIME_OUT, ACQUIRE_TIME_OUT);
-		//添加defer释放锁
-		Defer defer2([this, identifier, lock_key]() {
-			RedisMgr::GetInstance()->releaseLock(lock_key, identifier);
+	if (sync == CONTACT_SYNC_DELTA) {
+		//增量查询失败或者变化的条目放不进一帧，改为全量同步第一页
+		rtvalue.removeMember("apply_removed");
+		rtvalue.removeMember("friend_removed");
+		sync = CONTACT_SYNC_FULL;
+		rtvalue["contact_sync"] = sync;
+		apply_list.clear();
+		friend_list.clear();
+		//与增量读取一样在加载线程池中并发读取，不占用逻辑线程
+		apply_future = postLoad([this, uid, page, &apply_list]() {
+			return GetFriendApplyInfo(uid, 0, page + 1, apply_list);
 			});
-		//判断用户是否已经在其他机器上登录过
-
-		std::string uid_ip_value = "";
-		auto uid_ip_key = USERIPPREFIX + uid_str;
-		bool b_ip = RedisMgr::GetInstance()->Get(uid_ip_key, uid_ip_value);
-		//说明用户已经登录过，则需要通知grpc进行踢掉处理
-		if (b_ip) {
-			//获取当前机器的ip信息
-			auto& cfg = ConfigMgr::Inst();
-			auto self_name = cfg["SelfServer"]["Name"];
-			//如果之前登录的ip和当前ip一致，则说明是同一机器的重启，忽略处理
-			if (uid_ip_value == self_name) {
-				//获取之前的session
-				auto old_session = UserMgr::GetInstance()->GetSession(uid);
-
-				//通知旧的session下线
-				if (old_session) {
-					old_session->NotifyOffline(uid);
-					//清除旧的session
-					_p_server->ClearSession(old_session->GetSessionId());
-				}
-
-			}
-			else {
-				//否则需要通知grpc进行踢掉处理
-				//组装踢掉请求
-				KickUserReq kick_req;
-				kick_req.set_uid(uid);
-				//通过grpc通知旧机器踢掉用户
-				ChatGrpcClient::GetInstance()->NotifyKickUser(uid_ip_value, kick_req);
-			}
-		}
+		friend_future = postLoad([this, uid, page, &friend_list]() {
+			return GetFriendList(uid, 0, page + 1, friend_list);
+			});
+		b_apply = apply_future.get();
+		b_friend = friend_future.get();
+	}
+	if (!b_apply || !b_friend) {
+		//列表可能不完整，不下发版本号，客户端下次登录时重新全量同步
+		rtvalue["contact_ver"] = 0;
+	}
 
-		//session设置用户uid
-		session->SetUserId(uid);
-		//为用户绑定ip server信息
-		std::string  ipkey = USERIPPREFIX + uid_str;
-		RedisMgr::GetInstance()->Set(ipkey, server_name);
-		//uid与session进行绑定，方便后续的消息推送
-		UserMgr::GetInstance()->SetUserSession(uid, session);
-		std::string  uid_session_key = USER_SESSION_PREFIX + uid_str;
-		RedisMgr::GetInstance()->Set(uid_session_key, session->GetSessionId());
+	//好友申请列表
+	std::vector<std::pair<int, Json::Value>> apply_items;
+	for (auto& apply : apply_list) {
+		apply_items.emplace_back(apply->_uid, applyToJson(*apply));
+	}
+	appendPage(rtvalue, "apply_list", "apply_next", "apply_more", apply_items, page, 0);
 
+	//好友列表，与申请列表共用一帧的长度
+	std::vector<std::pair<int, Json::Value>> friend_items;
+	for (auto& friend_ele : friend_list) {
+		friend_items.emplace_back(friend_ele->uid, friendToJson(*friend_ele));
 	}
+	appendPage(rtvalue, "friend_list", "friend_next", "friend_more", friend_items, page, 0);
 
 	return;
 }
@@ -280,24 +453,22 @@ void LogicSystem::AddFriendApply(std::shared_ptr<CSession> session, const short&
 		session->Send(return_str, ID_ADD_FRIEND_RSP);
 		});
 
-	//写入申请信息到数据库
-	MysqlMgr::GetInstance()->AddFriendApply(uid, touid);
+	//写入申请信息到数据库，目标用户的申请列表有变化，联系人版本号加一
+	if (MysqlMgr::GetInstance()->AddFriendApply(uid, touid)) {
+		RedisMgr::GetInstance()->BumpContactAsync(touid, { applyChange(uid) });
+	}
 
-	//查询redis 获取touid对应的server ip
-	auto to_str = std::to_string(touid);
-	auto to_ip_key = USERIPPREFIX + to_str;
+	//先查本地路由表，未命中再查redis 获取touid对应的server
 	std::string to_ip_value = "";
-	bool b_ip = RedisMgr::GetInstance()->Get(to_ip_key, to_ip_value);
+	bool b_ip = RouteCache::GetInstance()->GetRoute(touid, to_ip_value);
 	if (!b_ip) {
 		return;
 	}
 
+	auto& self_name = RouteCache::GetInstance()->SelfName();
 
-	auto& cfg = ConfigMgr::Inst();
-	auto self_name = cfg["SelfServer"]["Name"];
 
-
-	std::string base_key = USER_BASE_INFO + std::to_string(uid);
+	std::string base_key = USER_HASH_PREFIX + std::to_string(uid);
 	auto apply_info = std::make_shared<UserInfo>();
 	bool b_info = GetBaseInfo(base_key, uid, apply_info);
 
@@ -320,6 +491,10 @@ void LogicSystem::AddFriendApply(std::shared_ptr<CSession> session, const short&
 			//发送通知
 			session->Send(return_str, ID_NOTIFY_ADD_FRIEND_REQ);
 		}
+		else {
+			//缓存的路由已经过期，用户不在本服务器
+			RouteCache::GetInstance()->MarkStale(touid);
+		}
 
 		return ;
 	}
@@ -356,7 +531,7 @@ void LogicSystem::AuthFriendApply(std::shared_ptr<CSession> session, const short
 	rtvalue["error"] = ErrorCodes::Success;
 	auto user_info = std::make_shared<UserInfo>();
 
-	std::string base_key = USER_BASE_INFO + std::to_string(touid);
+	std::string base_key = USER_HASH_PREFIX + std::to_string(touid);
 	bool b_info = GetBaseInfo(base_key, touid, user_info);
 	if (b_info) {
 		rtvalue["name"] = user_info->name;
@@ -376,22 +551,25 @@ void LogicSystem::AuthFriendApply(std::shared_ptr<CSession> session, const short
 		});
 
 	//写入数据库
-	MysqlMgr::GetInstance()->AuthFriendApply(uid, touid);
+	bool b_auth = MysqlMgr::GetInstance()->AuthFriendApply(uid, touid);
 
 	//在数据库中添加好友关系
-	MysqlMgr::GetInstance()->AddFriend(uid, touid,back_name);
+	bool b_friend = MysqlMgr::GetInstance()->AddFriend(uid, touid,back_name);
 
-	//查询redis 获取touid对应的server ip
-	auto to_str = std::to_string(touid);
-	auto to_ip_key = USERIPPREFIX + to_str;
+	//双方的申请和好友条目都可能变化，具体状态以增量同步时数据库中的为准
+	if (b_auth || b_friend) {
+		RedisMgr::GetInstance()->BumpContactAsync(uid, { applyChange(touid), friendChange(touid) });
+		RedisMgr::GetInstance()->BumpContactAsync(touid, { applyChange(uid), friendChange(uid) });
+	}
+
+	//先查本地路由表，未命中再查redis 获取touid对应的server
 	std::string to_ip_value = "";
-	bool b_ip = RedisMgr::GetInstance()->Get(to_ip_key, to_ip_value);
+	bool b_ip = RouteCache::GetInstance()->GetRoute(touid, to_ip_value);
 	if (!b_ip) {
 		return;
 	}
 
-	auto& cfg = ConfigMgr::Inst();
-	auto self_name = cfg["SelfServer"]["Name"];
+	auto& self_name = RouteCache::GetInstance()->SelfName();
 	//直接通知目标用户
 	if (to_ip_value == self_name) {
 		auto session = UserMgr::GetInstance()->GetSession(touid);
@@ -401,7 +579,7 @@ void LogicSystem::AuthFriendApply(std::shared_ptr<CSession> session, const short
 			notify["error"] = ErrorCodes::Success;
 			notify["fromuid"] = uid;
 			notify["touid"] = touid;
-			std::string base_key = USER_BASE_INFO + std::to_string(uid);
+			std::string base_key = USER_HASH_PREFIX + std::to_string(uid);
 			auto user_info = std::make_shared<UserInfo>();
 			bool b_info = GetBaseInfo(base_key, uid, user_info);
 			if (b_info) {
@@ -419,6 +597,10 @@ void LogicSystem::AuthFriendApply(std::shared_ptr<CSession> session, const short
 			//发送通知
 			session->Send(return_str, ID_NOTIFY_AUTH_FRIEND_REQ);
 		}
+		else {
+			//缓存的路由已经过期，用户不在本服务器
+			RouteCache::GetInstance()->MarkStale(touid);
+		}
 
 		return ;
 	}
@@ -454,17 +636,14 @@ void LogicSystem::DealChatTextMsg(std::shared_ptr<CSession> session, const short
 		});
 
 
-	//查询redis 获取touid对应的server ip
-	auto to_str = std::to_string(touid);
-	auto to_ip_key = USERIPPREFIX + to_str;
+	//先查本地路由表，未命中再查redis 获取touid对应的server
 	std::string to_ip_value = "";
-	bool b_ip = RedisMgr::GetInstance()->Get(to_ip_key, to_ip_value);
+	bool b_ip = RouteCache::GetInstance()->GetRoute(touid, to_ip_value);
 	if (!b_ip) {
 		return;
 	}
 
-	auto& cfg = ConfigMgr::Inst();
-	auto self_name = cfg["SelfServer"]["Name"];
+	auto& self_name = RouteCache::GetInstance()->SelfName();
 	//直接通知目标用户
 	if (to_ip_value == self_name) {
 		auto session = UserMgr::GetInstance()->GetSession(touid);
@@ -473,6 +652,10 @@ void LogicSystem::DealChatTextMsg(std::shared_ptr<CSession> session, const short
 			std::string return_str = rtvalue.toStyledString();
 			session->Send(return_str, ID_NOTIFY_TEXT_CHAT_MSG_REQ);
 		}
+		else {
+			//缓存的路由已经过期，用户不在本服务器
+			RouteCache::GetInstance()->MarkStale(touid);
+		}
 
 		return ;
 	}
@@ -506,6 +689,94 @@ void LogicSystem::HeartBeatHandler(std::shared_ptr<CSession> session, const shor
 	session->Send(rtvalue.toStyledString(), ID_HEARTBEAT_RSP);
 }
 
+void LogicSystem::GetApplyListHandler(std::shared_ptr<CSession> session, const short& msg_id, const string& msg_data) {
+	Json::Reader reader;
+	Json::Value root;
+	reader.parse(msg_data, root);
+	//只能拉取自己的申请列表，uid以session绑定的为准
+	auto uid = session->GetUserId();
+	auto after = root["after"].asInt();
+	spdlog::info("分页拉取好友申请列表, uid: {}, after: {}", uid, after);
+
+	Json::Value  rtvalue;
+	Defer defer([this, &rtvalue, session]() {
+		std::string return_str = rtvalue.toStyledString();
+		session->Send(return_str, ID_GET_APPLY_LIST_RSP);
+		});
+
+	if (uid == 0) {
+		rtvalue["error"] = ErrorCodes::UidInvalid;
+		return;
+	}
+
+	auto cfg = ConfigMgr::Inst().Snapshot();
+	int limit = root["limit"].asInt();
+	int page = limit > 0 ? std::min(limit, cfg->friend_page_size) : cfg->friend_page_size;
+	std::vector<std::shared_ptr<ApplyInfo>> apply_list;
+	if (!GetFriendApplyInfo(uid, after, page + 1, apply_list)) {
+		rtvalue["error"] = ErrorCodes::DbBusy;
+		return;
+	}
+
+	rtvalue["error"] = ErrorCodes::Success;
+	std::vector<std::pair<int, Json::Value>> items;
+	for (auto& apply : apply_list) {
+		items.emplace_back(apply->_uid, applyToJson(*apply));
+	}
+	appendPage(rtvalue, "apply_list", "next", "more", items, page, after);
+}
+
+void LogicSystem::GetFriendListHandler(std::shared_ptr<CSession> session, const short& msg_id, const string& msg_data) {
+	Json::Reader reader;
+	Json::Value root;
+	reader.parse(msg_data, root);
+	//只能拉取自己的好友列表，uid以session绑定的为准
+	auto uid = session->GetUserId();
+	auto after = root["after"].asInt();
+	spdlog::info("分页拉取好友列表, uid: {}, after: {}", uid, after);
+
+	Json::Value  rtvalue;
+	Defer defer([this, &rtvalue, session]() {
+		std::string return_str = rtvalue.toStyledString();
+		session->Send(return_str, ID_GET_FRIEND_LIST_RSP);
+		});
+
+	if (uid == 0) {
+		rtvalue["error"] = ErrorCodes::UidInvalid;
+		return;
+	}
+
+	auto cfg = ConfigMgr::Inst().Snapshot();
+	int limit = root["limit"].asInt();
+	int page = limit > 0 ? std::min(limit, cfg->friend_page_size) : cfg->friend_page_size;
+	std::vector<std::shared_ptr<UserInfo>> friend_list;
+	if (!GetFriendList(uid, after, page + 1, friend_list)) {
+		rtvalue["error"] = ErrorCodes::DbBusy;
+		return;
+	}
+
+	rtvalue["error"] = ErrorCodes::Success;
+	std::vector<std::pair<int, Json::Value>> items;
+	for (auto& friend_ele : friend_list) {
+		items.emplace_back(friend_ele->uid, friendToJson(*friend_ele));
+	}
+	appendPage(rtvalue, "friend_list", "next", "more", items, page, after);
+}
+
+void LogicSystem::OnProfileChanged(int uid) {
+	UserInfoCache::GetInstance()->Invalidate(uid);
+
+	//好友列表中带着对方的资料，逐个让把 uid 加为好友的用户的联系人版本号加一
+	std::vector<int> owners;
+	if (!MysqlMgr::GetInstance()->GetFriendOwners(uid, owners)) {
+		spdlog::error("查询好友关系失败, uid: {}, 联系人版本号未更新", uid);
+		return;
+	}
+	for (auto owner : owners) {
+		RedisMgr::GetInstance()->BumpContactAsync(owner, { friendChange(uid) });
+	}
+}
+
 bool LogicSystem::isPureDigit(const std::string& str)
 {
 	for (char c : str) {
@@ -520,57 +791,39 @@ void LogicSystem::GetUserByUid(std::string uid_str, Json::Value& rtvalue)
 {
 	rtvalue["error"] = ErrorCodes::Success;
 
-	std::string base_key = USER_BASE_INFO + uid_str;
-
-	//通过redis查询用户基本信息
-	std::string info_str = "";
-	bool b_base = RedisMgr::GetInstance()->Get(base_key, info_str);
-	if (b_base) {
-		Json::Reader reader;
-		Json::Value root;
-		reader.parse(info_str, root);
-		auto uid = root["uid"].asInt();
-		auto name = root["name"].asString();
-		auto pwd = root["pwd"].asString();
-		auto email = root["email"].asString();
-		auto nick = root["nick"].asString();
-		auto desc = root["desc"].asString();
-		auto sex = root["sex"].asInt();
-		auto icon = root["icon"].asString();
-		spdlog::info("用户查询信息, uid: {}, name: {}, pwd: {}, email: {}, nick: {}, desc: {}, sex: {}, icon: {}", uid, name, pwd, email, nick, desc, sex, icon);
-
-		rtvalue["uid"] = uid;
-		rtvalue["pwd"] = pwd;
-		rtvalue["name"] = name;
-		rtvalue["email"] = email;
-		rtvalue["nick"] = nick;
-		rtvalue["desc"] = desc;
-		rtvalue["sex"] = sex;
-		rtvalue["icon"] = icon;
+	//超出int范围的数字一定不是uid
+	int uid = 0;
+	try {
+		uid = std::stoi(uid_str);
+	}
+	catch (std::exception&) {
+		rtvalue["error"] = ErrorCodes::UidInvalid;
+		return;
+	}
+
+	//存在性过滤器判定不存在的uid直接返回，不再回源数据库
+	auto filter = UserExistFilter::GetInstance();
+	if (!filter->MayExist(uid)) {
+		rtvalue["error"] = ErrorCodes::UidInvalid;
 		return;
 	}
+	//先记下注册纪元，查询期间该用户刚好注册的话不写入负缓存
+	auto epoch = filter->Epoch();
 
-	auto uid = std::stoi(uid_str);
-	//redis中没有则从数据库中查询
+	//依次查询本地缓存、redis 和数据库
 	std::shared_ptr<UserInfo> user_info = nullptr;
-	user_info = MysqlMgr::GetInstance()->GetUser(uid);
-	if (user_info == nullptr) {
+	auto result = UserInfoCache::GetInstance()->LookupBaseInfo(uid, user_info);
+	if (result == LOOKUP_ERROR) {
+		//查询失败不代表用户不存在，不能写入负缓存
+		rtvalue["error"] = ErrorCodes::DbBusy;
+		return;
+	}
+	if (result == LOOKUP_NOT_FOUND) {
+		filter->MarkMissing(uid, epoch);
 		rtvalue["error"] = ErrorCodes::UidInvalid;
 		return;
 	}
-
-	//将数据库中查询到的用户信息写入redis
-	Json::Value redis_root;
-	redis_root["uid"] = user_info->uid;
-	redis_root["pwd"] = user_info->pwd;
-	redis_root["name"] = user_info->name;
-	redis_root["email"] = user_info->email;
-	redis_root["nick"] = user_info->nick;
-	redis_root["desc"] = user_info->desc;
-	redis_root["sex"] = user_info->sex;
-	redis_root["icon"] = user_info->icon;
-
-	RedisMgr::GetInstance()->Set(base_key, redis_root.toStyledString());
+	spdlog::info("用户查询信息, uid: {}, name: {}, email: {}, nick: {}, desc: {}, sex: {}, icon: {}", user_info->uid, user_info->name, user_info->email, user_info->nick, user_info->desc, user_info->sex, user_info->icon);
 
 	//返回用户信息
 	rtvalue["uid"] = user_info->uid;
@@ -587,54 +840,30 @@ void LogicSystem::GetUserByName(std::string name, Json::Value& rtvalue)
 {
 	rtvalue["error"] = ErrorCodes::Success;
 
-	std::string base_key = NAME_INFO + name;
-
-	//通过redis查询用户基本信息
-	std::string info_str = "";
-	bool b_base = RedisMgr::GetInstance()->Get(base_key, info_str);
-	if (b_base) {
-		Json::Reader reader;
-		Json::Value root;
-		reader.parse(info_str, root);
-		auto uid = root["uid"].asInt();
-		auto name = root["name"].asString();
-		auto pwd = root["pwd"].asString();
-		auto email = root["email"].asString();
-		auto nick = root["nick"].asString();
-		auto desc = root["desc"].asString();
-		auto sex = root["sex"].asInt();
-		spdlog::info("用户查询信息, uid: {}, name: {}, pwd: {}, email: {}, nick: {}, desc: {}, sex: {}", uid, name, pwd, email, nick, desc, sex);
-
-		rtvalue["uid"] = uid;
-		rtvalue["pwd"] = pwd;
-		rtvalue["name"] = name;
-		rtvalue["email"] = email;
-		rtvalue["nick"] = nick;
-		rtvalue["desc"] = desc;
-		rtvalue["sex"] = sex;
+	//存在性过滤器判定不存在的用户名直接返回，不再回源数据库
+	auto filter = UserExistFilter::GetInstance();
+	if (!filter->MayExist(name)) {
+		rtvalue["error"] = ErrorCodes::UidInvalid;
 		return;
 	}
+	//先记下注册纪元，查询期间该用户刚好注册的话不写入负缓存
+	auto epoch = filter->Epoch();
 
-	//redis中没有则从数据库中查询
+	//先经用户名索引换成uid，基础信息与按uid查询共用同一份缓存
 	std::shared_ptr<UserInfo> user_info = nullptr;
-	user_info = MysqlMgr::GetInstance()->GetUser(name);
-	if (user_info == nullptr) {
+	auto result = UserInfoCache::GetInstance()->LookupBaseInfoByName(name, user_info);
+	if (result == LOOKUP_ERROR) {
+		//查询失败不代表用户不存在，不能写入负缓存
+		rtvalue["error"] = ErrorCodes::DbBusy;
+		return;
+	}
+	if (result == LOOKUP_NOT_FOUND) {
+		filter->MarkMissing(name, epoch);
 		rtvalue["error"] = ErrorCodes::UidInvalid;
 		return;
 	}
+	spdlog::info("用户查询信息, uid: {}, name: {}, email: {}, nick: {}, desc: {}, sex: {}", user_info->uid, user_info->name, user_info->email, user_info->nick, user_info->desc, user_info->sex);
 
-	//将数据库中查询到的用户信息写入redis
-	Json::Value redis_root;
-	redis_root["uid"] = user_info->uid;
-	redis_root["pwd"] = user_info->pwd;
-	redis_root["name"] = user_info->name;
-	redis_root["email"] = user_info->email;
-	redis_root["nick"] = user_info->nick;
-	redis_root["desc"] = user_info->desc;
-	redis_root["sex"] = user_info->sex;
-
-	RedisMgr::GetInstance()->Set(base_key, redis_root.toStyledString());
-	
 	//返回用户信息
 	rtvalue["uid"] = user_info->uid;
 	rtvalue["pwd"] = user_info->pwd;
@@ -647,55 +876,67 @@ void LogicSystem::GetUserByName(std::string name, Json::Value& rtvalue)
 
 bool LogicSystem::GetBaseInfo(std::string base_key, int uid, std::shared_ptr<UserInfo>& userinfo)
 {
-	//通过redis查询用户基本信息
-	std::string info_str = "";
-	bool b_base = RedisMgr::GetInstance()->Get(base_key, info_str);
-	if (b_base) {
-		Json::Reader reader;
-		Json::Value root;
-		reader.parse(info_str, root);
-		userinfo->uid = root["uid"].asInt();
-		userinfo->name = root["name"].asString();
-		userinfo->pwd = root["pwd"].asString();
-		userinfo->email = root["email"].asString();
-		userinfo->nick = root["nick"].asString();
-		userinfo->desc = root["desc"].asString();
-		userinfo->sex = root["sex"].asInt();
-		userinfo->icon = root["icon"].asString();
-		spdlog::info("从Redis查到用户信息  {} 用户名：{} 昵称：{} 描述：{} 性别：{} 头像：{}", userinfo->uid, userinfo->name, userinfo->nick, userinfo->desc, userinfo->sex, userinfo->icon);
-	}
-	else {
-		//redis中没有则从数据库中查询
-		std::shared_ptr<UserInfo> user_info = nullptr;
-		user_info = MysqlMgr::GetInstance()->GetUser(uid);
-		if (user_info == nullptr) {
-			return false;
-		}
+	//先查本地缓存，未命中再查redis和数据库
+	return UserInfoCache::GetInstance()->GetBaseInfo(uid, userinfo);
+}
 
-		userinfo = user_info;
+bool LogicSystem::GetFriendApplyInfo(int to_uid, int after_uid, int limit, std::vector<std::shared_ptr<ApplyInfo>> &list) {
+	//从mysql获取指定用户 after_uid 之后的一页好友申请
+	return MysqlMgr::GetInstance()->GetApplyList(to_uid, after_uid, limit, list);
+}
 
-		//将数据库中查询到的用户信息写入redis
-		Json::Value redis_root;
-		redis_root["uid"] = uid;
-		redis_root["pwd"] = userinfo->pwd;
-		redis_root["name"] = userinfo->name;
-		redis_root["email"] = userinfo->email;
-		redis_root["nick"] = userinfo->nick;
-		redis_root["desc"] = userinfo->desc;
-		redis_root["sex"] = userinfo->sex;
-		redis_root["icon"] = userinfo->icon;
-		RedisMgr::GetInstance()->Set(base_key, redis_root.toStyledString());
+// 按好友关系补全资料，资料批量查询，备注取自好友关系；查不到资料的好友跳过
+static bool fillFriends(std::vector<FriendEntry>::const_iterator begin, std::vector<FriendEntry>::const_iterator end,
+	std::vector<std::shared_ptr<UserInfo>>& user_list) {
+	std::vector<int> uids;
+	for (auto iter = begin; iter != end; ++iter) {
+		uids.push_back(iter->uid);
+	}
+	std::unordered_map<int, std::shared_ptr<UserInfo>> infos;
+	if (!UserInfoCache::GetInstance()->GetBaseInfos(uids, infos)) {
+		return false;
+	}
+	for (auto iter = begin; iter != end; ++iter) {
+		auto info = infos.find(iter->uid);
+		if (info == infos.end()) {
+			continue;
+		}
+		info->second->back = iter->back;
+		user_list.push_back(info->second);
 	}
-
 	return true;
 }
 
-bool LogicSystem::GetFriendApplyInfo(int to_uid, std::vector<std::shared_ptr<ApplyInfo>> &list) {
-	//从mysql获取指定用户的好友申请列表
-	return MysqlMgr::GetInstance()->GetApplyList(to_uid, list, 0, 10);
+bool LogicSystem::GetFriendList(int self_id, int after_uid, int limit, std::vector<std::shared_ptr<UserInfo>>& user_list) {
+	//从好友列表缓存中取 after_uid 之后的一页好友
+	std::shared_ptr<const std::vector<FriendEntry>> friends;
+	if (!FriendListCache::GetInstance()->GetFriends(self_id, friends)) {
+		return false;
+	}
+	auto begin = std::upper_bound(friends->begin(), friends->end(), after_uid,
+		[](int uid, const FriendEntry& entry) { return uid < entry.uid; });
+	auto end = friends->end() - begin > limit ? begin + limit : friends->end();
+	return fillFriends(begin, end, user_list);
+}
+
+bool LogicSystem::GetFriendApplyInfo(int to_uid, const std::vector<int>& from_uids, std::vector<std::shared_ptr<ApplyInfo>>& list) {
+	//从mysql获取指定的几条好友申请
+	return MysqlMgr::GetInstance()->GetApplyList(to_uid, from_uids, list);
 }
 
-bool LogicSystem::GetFriendList(int self_id, std::vector<std::shared_ptr<UserInfo>>& user_list) {
-	//从mysql获取好友列表
-	return MysqlMgr::GetInstance()->GetFriendList(self_id, user_list);
+bool LogicSystem::GetFriendList(int self_id, const std::vector<int>& friend_ids, std::vector<std::shared_ptr<UserInfo>>& user_list) {
+	//从好友列表缓存中取指定的几个好友，已经不是好友的跳过
+	std::shared_ptr<const std::vector<FriendEntry>> friends;
+	if (!FriendListCache::GetInstance()->GetFriends(self_id, friends)) {
+		return false;
+	}
+	std::vector<FriendEntry> selected;
+	for (auto uid : std::set<int>(friend_ids.begin(), friend_ids.end())) {
+		auto iter = std::lower_bound(friends->begin(), friends->end(), uid,
+			[](const FriendEntry& entry, int target) { return entry.uid < target; });
+		if (iter != friends->end() && iter->uid == uid) {
+			selected.push_back(*iter);
+		}
+	}
+	return fillFriends(selected.cbegin(), selected.cend(), user_list);
 }
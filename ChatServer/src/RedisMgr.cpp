@@ -2,466 +2,1224 @@
 #include "ConfigMgr.h"
 #include "const.h"
 #include "DistLock.h"
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <random>
 RedisMgr::RedisMgr() {
-	auto & gCfgMgr = ConfigMgr::Inst();
-	auto host = gCfgMgr["Redis"]["Host"];
-	auto port = gCfgMgr["Redis"]["Port"];
-	auto pwd = gCfgMgr["Redis"]["Passwd"];
-	_con_pool.reset(new RedisConPool(10, host.c_str(), atoi(port.c_str()), pwd.c_str()));
+	auto cfg = ConfigMgr::Inst().Snapshot();
+	// 环上以地址标识分片，调整配置中的分片顺序不会改变key的归属
+	std::vector<std::string> nodes;
+	for (auto& shard : cfg->redis_shards) {
+		_shards.emplace_back(new AsyncRedis(shard.host, shard.port, shard.pwd, cfg->redis_async_conns));
+		nodes.push_back(shard.host + ":" + std::to_string(shard.port));
+	}
+	_ring.reset(new HashRing(nodes, cfg->redis_virtual_nodes));
+	spdlog::info("Redis 分片数: {}", _shards.size());
 }
 
 RedisMgr::~RedisMgr() {
 	
 }
 
+// 按uid归类的key前缀，后缀的uid作为哈希标签；u_<uid> 与 uc_<uid> 在同一分片，可以在一个脚本中同时读写；
+// 旧布局的 uip_/usession_/ubaseinfo_/utoken_ 也按uid归类，迁移时新旧key在同一分片
+static const char* UID_KEY_PREFIXES[] = { USER_HASH_PREFIX, CONTACT_LOG_PREFIX, USERIPPREFIX, USER_SESSION_PREFIX, USER_BASE_INFO, USERTOKENPREFIX };
+// StatusServer 只连接 [Redis]，它要读写的全局key固定在第一个分片
+static const char* HOME_SHARD_KEYS[] = { LOGIN_COUNT, CHAT_REGISTRY, CHAT_REGISTRY_INFO, TOKEN_DENY_LIST };
 
-
-bool RedisMgr::Get(const std::string& key, std::string& value)
+std::string RedisMgr::keyTag(const std::string& key)
 {
-	auto connect = _con_pool->getConnection();
-	if (connect == nullptr) {
-		return false;
+	auto open = key.find('{');
+	if (open != std::string::npos) {
+		auto close = key.find('}', open + 1);
+		if (close != std::string::npos && close > open + 1) {
+			return key.substr(open + 1, close - open - 1);
+		}
 	}
-	 auto reply = (redisReply*)redisCommand(connect, "GET %s", key.c_str());
-	if (reply == NULL) {
-	 spdlog::error("[ GET {} ] failed: reply is null, connection error: {}", key, connect->errstr);
-	 _con_pool->returnConnection(connect);
-	 return false;
+	for (auto* prefix : UID_KEY_PREFIXES) {
+		size_t len = strlen(prefix);
+		if (key.size() > len && key.compare(0, len, prefix) == 0) {
+			return "uid:" + key.substr(len);
+		}
 	}
+	return key;
+}
 
-	if (reply->type == REDIS_REPLY_NIL) {
-	 spdlog::error("[ GET {} ] 键不存在", key);
-	 freeReplyObject(reply);
-	 _con_pool->returnConnection(connect);
-	 return false;
+AsyncRedis* RedisMgr::shardFor(const std::string& key)
+{
+	if (_shards.size() == 1) {
+		return _shards[0].get();
 	}
-
-	if (reply->type != REDIS_REPLY_STRING) {
-	 spdlog::error("[ GET {} ] 错误的类型: {}", key, reply->type);
-	 freeReplyObject(reply);
-	 _con_pool->returnConnection(connect);
-	 return false;
+	for (auto* home_key : HOME_SHARD_KEYS) {
+		if (key == home_key) {
+			return _shards[0].get();
+		}
 	}
+	return _shards[_ring->Locate(keyTag(key))].get();
+}
 
-	 value = reply->str;
-	 freeReplyObject(reply);
-
-	 spdlog::info("成功执行命令 [ GET {} ]", key);
-	 _con_pool->returnConnection(connect);
-	 return true;
+AsyncRedis* RedisMgr::route(const std::vector<std::string>& args)
+{
+	if (args.size() < 2) {
+		return _shards[0].get();
+	}
+	std::string cmd = args[0];
+	std::transform(cmd.begin(), cmd.end(), cmd.begin(), ::toupper);
+	if (cmd == "EVAL" || cmd == "EVALSHA") {
+		// EVAL script numkeys key1 ... 脚本的所有key需落在同一分片
+		if (args.size() > 3 && atoi(args[2].c_str()) > 0) {
+			return shardFor(args[3]);
+		}
+		return _shards[0].get();
+	}
+	if (cmd == "PUBLISH") {
+		return _shards[0].get();
+	}
+	return shardFor(args[1]);
 }
 
-bool RedisMgr::Set(const std::string &key, const std::string &value){
-	//ִ��redis������
-	auto connect = _con_pool->getConnection();
-	if (connect == nullptr) {
-		return false;
+void RedisMgr::execSharded(std::vector<std::vector<std::string>> commands, AsyncRedis::BatchCallback callback)
+{
+	// { 分片, { 命令在原批次中的下标, 命令 } }
+	std::map<AsyncRedis*, std::pair<std::vector<size_t>, std::vector<std::vector<std::string>>>> groups;
+	for (size_t i = 0; i < commands.size(); ++i) {
+		auto& group = groups[route(commands[i])];
+		group.first.push_back(i);
+		group.second.push_back(std::move(commands[i]));
 	}
-	auto reply = (redisReply*)redisCommand(connect, "SET %s %s", key.c_str(), value.c_str());
 
-	// 执行命令失败
-	if (NULL == reply)
-	{
-		spdlog::error("执行命令 [ SET {} {} ] 失败", key, value);
-		//freeReplyObject(reply);
-		_con_pool->returnConnection(connect);
-		return false;
+	if (groups.size() <= 1) {
+		auto* shard = groups.empty() ? _shards[0].get() : groups.begin()->first;
+		auto batch = groups.empty() ? std::vector<std::vector<std::string>>() : std::move(groups.begin()->second.second);
+		shard->Batch(std::move(batch), std::move(callback));
+		return;
 	}
 
-	// 执行命令失败
-	if (!(reply->type == REDIS_REPLY_STATUS && (strcmp(reply->str, "OK") == 0 || strcmp(reply->str, "ok") == 0)))
-	{
-		spdlog::error("执行命令 [ SET {} {} ] 失败", key, value);
-		freeReplyObject(reply);
-		_con_pool->returnConnection(connect);
-		return false;
+	// 各分片的回复在各自的连接线程中到达，合并时需要加锁
+	struct MergeState {
+		std::mutex mutex;
+		std::vector<RedisValue> replies;
+		size_t remaining = 0;
+		AsyncRedis::BatchCallback callback;
+	};
+	auto state = std::make_shared<MergeState>();
+	state->replies.resize(commands.size());
+	state->remaining = groups.size();
+	state->callback = std::move(callback);
+	for (auto& group : groups) {
+		auto indexes = std::move(group.second.first);
+		group.first->Batch(std::move(group.second.second), [state, indexes](std::vector<RedisValue>& replies) {
+			bool done = false;
+			{
+				std::lock_guard<std::mutex> lock(state->mutex);
+				for (size_t j = 0; j < indexes.size(); ++j) {
+					state->replies[indexes[j]] = std::move(replies[j]);
+				}
+				done = --state->remaining == 0;
+			}
+			if (done) {
+				state->callback(state->replies);
+			}
+			});
 	}
+}
 
-	// 执行命令成功
-	freeReplyObject(reply);
-	spdlog::info("成功执行命令 [ SET {} {} ]", key, value);
-	_con_pool->returnConnection(connect);
-	return true;
+std::future<RedisValue> RedisMgr::CommandAsync(std::vector<std::string> args)
+{
+	auto* shard = route(args);
+	return shard->Command(std::move(args));
 }
 
-bool RedisMgr::LPush(const std::string &key, const std::string &value)
+void RedisMgr::eval(const RedisScript& script, std::vector<std::string> keys, std::vector<std::string> args,
+	AsyncRedis::Callback callback)
 {
-	auto connect = _con_pool->getConnection();
-	if (connect == nullptr) {
-		return false;
-	}
-	auto reply = (redisReply*)redisCommand(connect, "LPUSH %s %s", key.c_str(), value.c_str());
-	if (NULL == reply)
-	{
-		spdlog::error("[ LPUSH {} {} ] failed", key, value);
-		freeReplyObject(reply);
-		_con_pool->returnConnection(connect);
-		return false;
-	}
+	auto* shard = keys.empty() ? _shards[0].get() : shardFor(keys[0]);
+	// { EVALSHA, sha, numkeys, keys..., args... }，重发时只需替换前两项
+	std::vector<std::string> command;
+	command.reserve(3 + keys.size() + args.size());
+	command.push_back("EVALSHA");
+	command.push_back(script.Sha());
+	command.push_back(std::to_string(keys.size()));
+	std::move(keys.begin(), keys.end(), std::back_inserter(command));
+	std::move(args.begin(), args.end(), std::back_inserter(command));
 
-	if (reply->type != REDIS_REPLY_INTEGER || reply->integer <= 0) {
-		spdlog::error("[ LPUSH {} {} ] failed", key, value);
-		freeReplyObject(reply);
-		_con_pool->returnConnection(connect);
-		return false;
-	}
+	// 脚本对象都是静态的，回调里可以直接持有指针
+	auto* source = &script;
+	auto retry = command;
+	shard->Command(std::move(command), [shard, source, retry, callback](const RedisValue& reply) mutable {
+		if (!reply.IsError() || reply.str.compare(0, 8, "NOSCRIPT") != 0) {
+			callback(reply);
+			return;
+		}
+		spdlog::info("redis 未缓存脚本 {}，改用 EVAL 加载", source->Sha());
+		retry[0] = "EVAL";
+		retry[1] = source->Source();
+		shard->Command(std::move(retry), std::move(callback));
+		});
+}
 
-	spdlog::info("成功执行命令 [ LPUSH {} {} ]", key, value);
-	freeReplyObject(reply);
-	_con_pool->returnConnection(connect);
-	return true;
+std::future<RedisValue> RedisMgr::EvalAsync(const RedisScript& script, std::vector<std::string> keys,
+	std::vector<std::string> args)
+{
+	return evalAsync<RedisValue>(script, std::move(keys), std::move(args), [](const RedisValue& reply) {
+		return reply;
+		});
 }
 
-bool RedisMgr::LPop(const std::string &key, std::string& value){
-	auto connect = _con_pool->getConnection();
-	if (connect == nullptr) {
-		return false;
-	}
-	auto reply = (redisReply*)redisCommand(connect, "LPOP %s ", key.c_str());
-	if (reply == nullptr ) {
-		spdlog::error("[ LPOP {} ] failed", key);
-		_con_pool->returnConnection(connect);
+std::future<std::optional<std::string>> RedisMgr::GetAsync(const std::string& key)
+{
+	return commandAsync<std::optional<std::string>>({ "GET", key }, [key](const RedisValue& reply) -> std::optional<std::string> {
+		if (reply.IsNil()) {
+			spdlog::error("[ GET {} ] 键不存在", key);
+			return std::nullopt;
+		}
+		if (!reply.IsString()) {
+			spdlog::error("[ GET {} ] 错误的类型: {} {}", key, reply.type, reply.str);
+			return std::nullopt;
+		}
+		spdlog::info("成功执行命令 [ GET {} ]", key);
+		return reply.str;
+		});
+}
+
+std::future<bool> RedisMgr::SetAsync(const std::string& key, const std::string& value)
+{
+	return commandAsync<bool>({ "SET", key, value }, [key, value](const RedisValue& reply) {
+		if (!(reply.IsStatus() && (reply.str == "OK" || reply.str == "ok"))) {
+			spdlog::error("执行命令 [ SET {} {} ] 失败: {}", key, value, reply.str);
+			return false;
+		}
+		spdlog::info("成功执行命令 [ SET {} {} ]", key, value);
+		return true;
+		});
+}
+
+// LPUSH/RPUSH 返回插入后的列表长度
+static bool pushSucceeded(const RedisValue& reply) {
+	return reply.IsInteger() && reply.integer > 0;
+}
+
+std::future<bool> RedisMgr::LPushAsync(const std::string& key, const std::string& value)
+{
+	return commandAsync<bool>({ "LPUSH", key, value }, [key, value](const RedisValue& reply) {
+		if (!pushSucceeded(reply)) {
+			spdlog::error("[ LPUSH {} {} ] failed", key, value);
+			return false;
+		}
+		spdlog::info("成功执行命令 [ LPUSH {} {} ]", key, value);
+		return true;
+		});
+}
+
+std::future<std::optional<std::string>> RedisMgr::LPopAsync(const std::string& key)
+{
+	return commandAsync<std::optional<std::string>>({ "LPOP", key }, [key](const RedisValue& reply) -> std::optional<std::string> {
+		if (!reply.IsString()) {
+			spdlog::error("[ LPOP {} ] failed", key);
+			return std::nullopt;
+		}
+		spdlog::info("成功执行命令 [ LPOP {} ]", key);
+		return reply.str;
+		});
+}
+
+std::future<bool> RedisMgr::RPushAsync(const std::string& key, const std::string& value)
+{
+	return commandAsync<bool>({ "RPUSH", key, value }, [key, value](const RedisValue& reply) {
+		if (!pushSucceeded(reply)) {
+			spdlog::error("[ RPUSH {} {} ] failed", key, value);
+			return false;
+		}
+		spdlog::info("成功执行命令 [ RPUSH {} {} ]", key, value);
+		return true;
+		});
+}
+
+std::future<std::optional<std::string>> RedisMgr::RPopAsync(const std::string& key)
+{
+	return commandAsync<std::optional<std::string>>({ "RPOP", key }, [key](const RedisValue& reply) -> std::optional<std::string> {
+		if (!reply.IsString()) {
+			spdlog::error("[ RPOP {} ] failed", key);
+			return std::nullopt;
+		}
+		spdlog::info("成功执行命令 [ RPOP {} ]", key);
+		return reply.str;
+		});
+}
+
+std::future<bool> RedisMgr::HSetAsync(const std::string& key, const std::string& hkey, const std::string& value)
+{
+	return commandAsync<bool>({ "HSET", key, hkey, value }, [key, hkey](const RedisValue& reply) {
+		if (!reply.IsInteger()) {
+			spdlog::error("[ HSET {} {} ] failed: {}", key, hkey, reply.str);
+			return false;
+		}
+		spdlog::info("成功执行命令 [ HSET {} {} ]", key, hkey);
+		return true;
+		});
+}
+
+std::future<std::string> RedisMgr::HGetAsync(const std::string& key, const std::string& hkey)
+{
+	return commandAsync<std::string>({ "HGET", key, hkey }, [key, hkey](const RedisValue& reply) {
+		if (!reply.IsString()) {
+			spdlog::error("[ HGET {} {} ] failed", key, hkey);
+			return std::string();
+		}
+		spdlog::info("成功执行命令 [ HGET {} {} ]", key, hkey);
+		return reply.str;
+		});
+}
+
+std::future<bool> RedisMgr::HDelAsync(const std::string& key, const std::string& field)
+{
+	return commandAsync<bool>({ "HDEL", key, field }, [key, field](const RedisValue& reply) {
+		if (reply.IsError()) {
+			spdlog::error("[ HDEL {} {} ] failed: {}", key, field, reply.str);
+		}
+		return reply.IsInteger() && reply.integer > 0;
+		});
+}
+
+std::future<bool> RedisMgr::DelAsync(const std::string& key)
+{
+	return commandAsync<bool>({ "DEL", key }, [key](const RedisValue& reply) {
+		if (!reply.IsInteger()) {
+			spdlog::error("[ DEL {} ] failed", key);
+			return false;
+		}
+		spdlog::info("成功执行命令 [ DEL {} ]", key);
+		return true;
+		});
+}
+
+std::future<bool> RedisMgr::ExistsKeyAsync(const std::string& key)
+{
+	return commandAsync<bool>({ "EXISTS", key }, [key](const RedisValue& reply) {
+		if (reply.IsError()) {
+			spdlog::error("[ EXISTS {} ] failed: {}", key, reply.str);
+			return false;
+		}
+		if (!reply.IsInteger() || reply.integer == 0) {
+			spdlog::info("键 [ {} ] 不存在", key);
+			return false;
+		}
+		spdlog::info("键 [ {} ] 存在", key);
+		return true;
+		});
+}
+
+std::future<bool> RedisMgr::PublishAsync(const std::string& channel, const std::string& message)
+{
+	return commandAsync<bool>({ "PUBLISH", channel, message }, [channel, message](const RedisValue& reply) {
+		if (!reply.IsInteger()) {
+			spdlog::error("执行命令 [ PUBLISH {} {} ] 失败: {}", channel, message, reply.str);
+			return false;
+		}
+		return true;
+		});
+}
+
+bool RedisMgr::Get(const std::string& key, std::string& value)
+{
+	auto result = GetAsync(key).get();
+	if (!result) {
 		return false;
 	}
+	value = std::move(*result);
+	return true;
+}
+
+bool RedisMgr::Set(const std::string &key, const std::string &value){
+	return SetAsync(key, value).get();
+}
+
+bool RedisMgr::LPush(const std::string &key, const std::string &value)
+{
+	return LPushAsync(key, value).get();
+}
 
-	if (reply->type == REDIS_REPLY_NIL) {
-		spdlog::error("[ LPOP {} ] failed", key);
-		freeReplyObject(reply);
-		_con_pool->returnConnection(connect);
+bool RedisMgr::LPop(const std::string &key, std::string& value){
+	auto result = LPopAsync(key).get();
+	if (!result) {
 		return false;
 	}
-
-	value = reply->str;
-	spdlog::info("成功执行命令 [ LPOP {} ]", key);
-	freeReplyObject(reply);
-	_con_pool->returnConnection(connect);
+	value = std::move(*result);
 	return true;
 }
 
 bool RedisMgr::RPush(const std::string& key, const std::string& value) {
-	auto connect = _con_pool->getConnection();
-	if (connect == nullptr) {
-		return false;
-	}
-	auto reply = (redisReply*)redisCommand(connect, "RPUSH %s %s", key.c_str(), value.c_str());
-	if (NULL == reply)
-	{
-		spdlog::error("[ RPUSH {} {} ] failed", key, value);
-		freeReplyObject(reply);
-		_con_pool->returnConnection(connect);
-		return false;
-	}
+	return RPushAsync(key, value).get();
+}
 
-	if (reply->type != REDIS_REPLY_INTEGER || reply->integer <= 0) {
-		spdlog::error("[ RPUSH {} {} ] failed", key, value);
-		freeReplyObject(reply);
-		_con_pool->returnConnection(connect);
+bool RedisMgr::RPop(const std::string& key, std::string& value) {
+	auto result = RPopAsync(key).get();
+	if (!result) {
 		return false;
 	}
-
-	spdlog::info("成功执行命令 [ RPUSH {} {} ]", key, value);
-	freeReplyObject(reply);
-	_con_pool->returnConnection(connect);
+	value = std::move(*result);
 	return true;
 }
-bool RedisMgr::RPop(const std::string& key, std::string& value) {
-	auto connect = _con_pool->getConnection();
-	if (connect == nullptr) {
-		return false;
+
+bool RedisMgr::HSet(const std::string &key, const std::string &hkey, const std::string &value) {
+	return HSetAsync(key, hkey, value).get();
+}
+
+bool RedisMgr::HSet(const char* key, const char* hkey, const char* hvalue, size_t hvaluelen)
+{
+	return HSetAsync(key, hkey, std::string(hvalue, hvaluelen)).get();
+}
+
+std::string RedisMgr::HGet(const std::string &key, const std::string &hkey)
+{
+	return HGetAsync(key, hkey).get();
+}
+
+bool RedisMgr::HDel(const std::string& key, const std::string& field)
+{
+	return HDelAsync(key, field).get();
+}
+
+bool RedisMgr::Del(const std::string &key)
+{
+	return DelAsync(key).get();
+}
+
+bool RedisMgr::ExistsKey(const std::string &key)
+{
+	return ExistsKeyAsync(key).get();
+}
+
+bool RedisMgr::Publish(const std::string& channel, const std::string& message)
+{
+	return PublishAsync(channel, message).get();
+}
+
+std::string RedisMgr::acquireLock(const std::string& lockName,
+	int lockTimeout, int acquireTimeout) {
+	return DistLock::Inst().acquireLock(lockName, lockTimeout, acquireTimeout);
+}
+
+bool RedisMgr::releaseLock(const std::string& lockName,
+	const std::string& identifier) {
+	if (identifier.empty()) {
+		return true;
 	}
-	auto reply = (redisReply*)redisCommand(connect, "RPOP %s ", key.c_str());
-	if (reply == nullptr ) {
-		spdlog::error("[ RPOP {} ] failed", key);
-		_con_pool->returnConnection(connect);
-		return false;
+	return DistLock::Inst().releaseLock(lockName, identifier);
+}
+
+// 联系人版本号 cver 缺失或变更记录已过期时，从Redis服务器的毫秒时钟重新起步，并以此作为新记录的 floor；
+// 与 fence 一样，重新起步的版本号大于之前发出的所有版本号，持有旧版本号的客户端只会全量同步
+#define CONTACT_VERSION_INIT \
+	"local cver = tonumber(redis.call('HGET', KEYS[1], 'cver')) " \
+	"local floor = redis.call('ZSCORE', KEYS[2], 'floor') " \
+	"if not cver or not floor then " \
+	"local now = redis.call('TIME') " \
+	"cver = tonumber(now[1]) * 1000 + math.floor(tonumber(now[2]) / 1000) " \
+	"floor = cver " \
+	"redis.call('HSET', KEYS[1], 'cver', cver) " \
+	"redis.call('DEL', KEYS[2]) " \
+	"redis.call('ZADD', KEYS[2], cver, 'floor') end "
+
+// 登录脚本: KEYS = u_<uid>, uc_<uid>  ARGV = server_name, session_id, uid, 结构版本, 客户端联系人版本号, 增量条数上限
+// token 已在本地验签，这里只做所有权切换；server/sid/fence 和 profile 同在一个hash中，
+// 每次切换所有权 fence 自增，旧持有者只能凭自己的 fence 释放，整个比较与交换在Redis端原子执行，不需要分布式锁。
+// hash 过期后 fence 从Redis服务器的毫秒时钟重新起步，仍大于过期前发出的所有版本号；
+// 在线期间 hash 不过期，结构版本不一致的 profile 直接丢弃。
+// 客户端版本号等于 cver 时联系人没有变化；不低于 floor 且之后的变更不超过上限时返回变更的条目，否则全量同步，
+// 返回的 sync 取值与 ContactSync 一致
+static const RedisScript LOGIN_SWAP_SCRIPT(
+	"redis.replicate_commands() "
+	"if redis.call('TYPE', KEYS[1]).ok ~= 'hash' then redis.call('DEL', KEYS[1]) end "
+	"local old = redis.call('HMGET', KEYS[1], 'server', 'sid', 'v', 'profile') "
+	"local profile = old[4] or '' "
+	"if old[3] ~= ARGV[4] then profile = '' redis.call('HDEL', KEYS[1], 'profile') end "
+	"local fence "
+	"if redis.call('HEXISTS', KEYS[1], 'fence') == 1 then "
+	"fence = redis.call('HINCRBY', KEYS[1], 'fence', 1) "
+	"else "
+	"local t = redis.call('TIME') "
+	"fence = tonumber(t[1]) * 1000 + math.floor(tonumber(t[2]) / 1000) "
+	"redis.call('HSET', KEYS[1], 'fence', fence) end "
+	"redis.call('HSET', KEYS[1], 'v', ARGV[4], 'server', ARGV[1], 'sid', ARGV[2]) "
+	"redis.call('PERSIST', KEYS[1]) "
+	CONTACT_VERSION_INIT
+	"redis.call('PERSIST', KEYS[2]) "
+	"local since = tonumber(ARGV[5]) "
+	"local sync, changes = 0, {} "
+	"if since == cver then sync = 2 "
+	"elseif since >= tonumber(floor) and since < cver "
+	"and redis.call('ZCOUNT', KEYS[2], '(' .. ARGV[5], '+inf') <= tonumber(ARGV[6]) then "
+	"sync = 1 "
+	"changes = redis.call('ZRANGEBYSCORE', KEYS[2], '(' .. ARGV[5], '+inf') end "
+	"redis.call('PUBLISH', '" ROUTE_CHANNEL "', ARGV[3] .. ',' .. ARGV[1]) "
+	"return {old[1] or '', old[2] or '', profile, fence, cver, sync, changes}");
+
+// 退出脚本: KEYS = u_<uid>, uc_<uid>  ARGV = fence, uid, ttl
+// 只有 fence 仍是自己时才释放，避免误删其他地方新登录的会话；
+// fence 和 profile 保留，整个 hash 转为带TTL的缓存，到期前再次登录 fence 继续单调递增；
+// 联系人变更记录与 hash 同时过期
+static const RedisScript RELEASE_SESSION_SCRIPT(
+	"if redis.call('TYPE', KEYS[1]).ok ~= 'hash' then return 0 end "
+	"if redis.call('HGET', KEYS[1], 'fence') == ARGV[1] then "
+	"redis.call('HDEL', KEYS[1], 'server', 'sid') "
+	"redis.call('EXPIRE', KEYS[1], ARGV[3]) "
+	"redis.call('EXPIRE', KEYS[2], ARGV[3]) "
+	"redis.call('PUBLISH', '" ROUTE_CHANNEL "', ARGV[2] .. ',') "
+	"return 1 end "
+	"return 0");
+
+// 写入基础信息: KEYS = u_<uid>, uc_<uid>  ARGV = profile, 结构版本, ttl
+// 用户在线时 hash 由退出脚本负责设置TTL，这里只给离线用户的 hash 及其联系人变更记录续期
+static const RedisScript SET_PROFILE_SCRIPT(
+	"redis.call('HSET', KEYS[1], 'v', ARGV[2], 'profile', ARGV[1]) "
+	"if redis.call('HEXISTS', KEYS[1], 'server') == 0 then "
+	"redis.call('EXPIRE', KEYS[1], ARGV[3]) redis.call('EXPIRE', KEYS[2], ARGV[3]) end "
+	"return 1");
+
+// 写入好友列表缓存: KEYS = u_<uid>, uc_<uid>  ARGV = friends, 读取时的 cver, ttl
+// 读取之后联系人又有变化时放弃写入，离线用户的两个key与 SET_PROFILE 一样续期
+static const RedisScript SET_FRIENDS_SCRIPT(
+	"if redis.call('HGET', KEYS[1], 'cver') ~= ARGV[2] then return 0 end "
+	"redis.call('HSET', KEYS[1], 'fver', ARGV[2], 'friends', ARGV[1]) "
+	"if redis.call('HEXISTS', KEYS[1], 'server') == 0 then "
+	"redis.call('EXPIRE', KEYS[1], ARGV[3]) redis.call('EXPIRE', KEYS[2], ARGV[3]) end "
+	"return 1");
+
+// 联系人变更脚本: KEYS = u_<uid>, uc_<uid>  ARGV = ttl, 保留条数, 变化的条目...
+// 同一条目再次变化时只更新分数；超出保留条数时裁掉最早的记录，floor 移到被裁掉的最大版本号，
+// 持有更早版本号的客户端随之改为全量同步。离线用户的两个key与 SET_PROFILE 一样续期
+static const RedisScript BUMP_CONTACT_SCRIPT(
+	"redis.replicate_commands() "
+	"if redis.call('TYPE', KEYS[1]).ok ~= 'hash' then redis.call('DEL', KEYS[1]) end "
+	CONTACT_VERSION_INIT
+	"cver = redis.call('HINCRBY', KEYS[1], 'cver', 1) "
+	"for i = 3, #ARGV do redis.call('ZADD', KEYS[2], cver, ARGV[i]) end "
+	"local over = redis.call('ZCARD', KEYS[2]) - 1 - tonumber(ARGV[2]) "
+	"if over > 0 then "
+	"local trimmed = redis.call('ZRANGE', KEYS[2], 0, over, 'WITHSCORES') "
+	"redis.call('ZREMRANGEBYRANK', KEYS[2], 0, over) "
+	"redis.call('ZADD', KEYS[2], trimmed[#trimmed], 'floor') end "
+	"if redis.call('HEXISTS', KEYS[1], 'server') == 0 then "
+	"redis.call('EXPIRE', KEYS[1], ARGV[1]) redis.call('EXPIRE', KEYS[2], ARGV[1]) end "
+	"return cver");
+
+// 在配置的TTL上随机浮动 ±jitter%，同一时刻写入的缓存不会在同一时刻集中过期
+static int jitteredTtl()
+{
+	auto cfg = ConfigMgr::Inst().Snapshot();
+	long long ttl = cfg->user_redis_ttl;
+	long long spread = ttl * cfg->user_redis_ttl_jitter / 100;
+	if (spread <= 0) {
+		return (int)ttl;
 	}
+	thread_local std::mt19937_64 engine(std::random_device{}());
+	std::uniform_int_distribution<long long> dist(-spread, spread);
+	return (int)std::max(1LL, ttl + dist(engine));
+}
+
+std::future<std::optional<LoginSwapResult>> RedisMgr::LoginSwapAsync(int uid, const std::string& server_name,
+	const std::string& session_id, long long contact_ver)
+{
+	auto uid_str = std::to_string(uid);
+	// 增量不超过一页，放得进登录回包
+	auto cfg = ConfigMgr::Inst().Snapshot();
+	return evalAsync<std::optional<LoginSwapResult>>(LOGIN_SWAP_SCRIPT,
+		{ USER_HASH_PREFIX + uid_str, CONTACT_LOG_PREFIX + uid_str },
+		{ server_name, session_id, uid_str, USER_LAYOUT_VERSION, std::to_string(contact_ver),
+			std::to_string(cfg->friend_page_size) },
+		[uid](const RedisValue& reply) -> std::optional<LoginSwapResult> {
+			if (!reply.IsArray() || reply.elements.size() != 7) {
+				spdlog::error("[ LOGIN SWAP {} ] 错误的类型: {} {}", uid, reply.type, reply.str);
+				return std::nullopt;
+			}
+
+			LoginSwapResult result;
+			result.old_server = reply.elements[0].str;
+			result.old_session = reply.elements[1].str;
+			result.profile = reply.elements[2].str;
+			result.fence = reply.elements[3].integer;
+			result.contact_ver = reply.elements[4].integer;
+			result.contact_sync = (int)reply.elements[5].integer;
+			for (auto& change : reply.elements[6].elements) {
+				result.contact_changes.push_back(change.str);
+			}
+			spdlog::info("成功执行命令 [ LOGIN SWAP {} ] fence: {} contact_ver: {} sync: {} changes: {}", uid,
+				result.fence, result.contact_ver, result.contact_sync, result.contact_changes.size());
+			return result;
+		});
+}
+
+std::future<bool> RedisMgr::ReleaseSessionAsync(int uid, long long fence)
+{
+	auto uid_str = std::to_string(uid);
+	return evalAsync<bool>(RELEASE_SESSION_SCRIPT,
+		{ USER_HASH_PREFIX + uid_str, CONTACT_LOG_PREFIX + uid_str }, { std::to_string(fence), uid_str, std::to_string(jitteredTtl()) },
+		[uid, fence](const RedisValue& reply) {
+			if (reply.IsError()) {
+				spdlog::error("[ RELEASE SESSION {} ] failed: {}", uid, reply.str);
+				return false;
+			}
+			bool released = reply.IsInteger() && reply.integer == 1;
+			spdlog::info("成功执行命令 [ RELEASE SESSION {} {} ] 结果: {}", uid, fence, released);
+			return released;
+		});
+}
+
+std::future<std::optional<std::string>> RedisMgr::GetRouteAsync(int uid)
+{
+	auto key = USER_HASH_PREFIX + std::to_string(uid);
+	return commandAsync<std::optional<std::string>>({ "HGET", key, "server" },
+		[key](const RedisValue& reply) -> std::optional<std::string> {
+			if (!reply.IsString()) {
+				if (reply.IsError()) {
+					spdlog::error("[ HGET {} server ] failed: {}", key, reply.str);
+				}
+				return std::nullopt;
+			}
+			return reply.str;
+		});
+}
+
+std::future<std::optional<std::string>> RedisMgr::GetProfileAsync(int uid)
+{
+	auto key = USER_HASH_PREFIX + std::to_string(uid);
+	return commandAsync<std::optional<std::string>>({ "HMGET", key, "v", "profile" },
+		[key](const RedisValue& reply) -> std::optional<std::string> {
+			if (!reply.IsArray() || reply.elements.size() != 2) {
+				spdlog::error("[ HMGET {} v profile ] 错误的类型: {} {}", key, reply.type, reply.str);
+				return std::nullopt;
+			}
+			// 其他结构版本写入的 profile 按未命中处理，由调用方回源后覆盖
+			if (reply.elements[0].str != USER_LAYOUT_VERSION || !reply.elements[1].IsString()) {
+				return std::nullopt;
+			}
+			spdlog::info("成功执行命令 [ HMGET {} v profile ]", key);
+			return reply.elements[1].str;
+		});
+}
+
+std::future<bool> RedisMgr::SetProfileAsync(int uid, const std::string& profile)
+{
+	auto uid_str = std::to_string(uid);
+	return evalAsync<bool>(SET_PROFILE_SCRIPT, { USER_HASH_PREFIX + uid_str, CONTACT_LOG_PREFIX + uid_str },
+		{ profile, USER_LAYOUT_VERSION, std::to_string(jitteredTtl()) },
+		[uid](const RedisValue& reply) {
+			if (reply.IsError()) {
+				spdlog::error("[ SET PROFILE {} ] failed: {}", uid, reply.str);
+				return false;
+			}
+			return true;
+		});
+}
 
-	if (reply->type == REDIS_REPLY_NIL) {
-		spdlog::error("[ RPOP {} ] failed", key);
-		freeReplyObject(reply);
-		_con_pool->returnConnection(connect);
+std::future<std::optional<FriendsCache>> RedisMgr::GetFriendsAsync(int uid)
+{
+	auto key = USER_HASH_PREFIX + std::to_string(uid);
+	return commandAsync<std::optional<FriendsCache>>({ "HMGET", key, "cver", "fver", "friends" },
+		[key](const RedisValue& reply) -> std::optional<FriendsCache> {
+			if (!reply.IsArray() || reply.elements.size() != 3) {
+				spdlog::error("[ HMGET {} cver fver friends ] 错误的类型: {} {}", key, reply.type, reply.str);
+				return std::nullopt;
+			}
+			FriendsCache cache;
+			cache.cver = atoll(reply.elements[0].str.c_str());
+			cache.hit = cache.cver != 0 && reply.elements[1].str == reply.elements[0].str
+				&& reply.elements[2].IsString();
+			if (cache.hit) {
+				cache.friends = reply.elements[2].str;
+			}
+			return cache;
+		});
+}
+
+std::future<bool> RedisMgr::SetFriendsAsync(int uid, long long cver, const std::string& friends)
+{
+	auto uid_str = std::to_string(uid);
+	return evalAsync<bool>(SET_FRIENDS_SCRIPT, { USER_HASH_PREFIX + uid_str, CONTACT_LOG_PREFIX + uid_str },
+		{ friends, std::to_string(cver), std::to_string(jitteredTtl()) },
+		[uid](const RedisValue& reply) {
+			if (reply.IsError()) {
+				spdlog::error("[ SET FRIENDS {} ] failed: {}", uid, reply.str);
+				return false;
+			}
+			return reply.IsInteger() && reply.integer == 1;
+		});
+}
+
+std::future<std::optional<long long>> RedisMgr::BumpContactAsync(int uid, std::vector<std::string> changes)
+{
+	auto uid_str = std::to_string(uid);
+	auto cfg = ConfigMgr::Inst().Snapshot();
+	std::vector<std::string> args = { std::to_string(jitteredTtl()), std::to_string(cfg->contact_log_size) };
+	std::move(changes.begin(), changes.end(), std::back_inserter(args));
+	return evalAsync<std::optional<long long>>(BUMP_CONTACT_SCRIPT,
+		{ USER_HASH_PREFIX + uid_str, CONTACT_LOG_PREFIX + uid_str }, std::move(args),
+		[uid](const RedisValue& reply) -> std::optional<long long> {
+			if (!reply.IsInteger()) {
+				spdlog::error("[ BUMP CONTACT {} ] 错误的类型: {} {}", uid, reply.type, reply.str);
+				return std::nullopt;
+			}
+			spdlog::info("成功执行命令 [ BUMP CONTACT {} ] contact_ver: {}", uid, reply.integer);
+			return reply.integer;
+		});
+}
+
+std::future<std::optional<int>> RedisMgr::GetNameIndexAsync(const std::string& name)
+{
+	auto key = USER_NAME_INDEX + name;
+	return commandAsync<std::optional<int>>({ "GET", key }, [key](const RedisValue& reply) -> std::optional<int> {
+		if (!reply.IsString()) {
+			if (reply.IsError()) {
+				spdlog::error("[ GET {} ] failed: {}", key, reply.str);
+			}
+			return std::nullopt;
+		}
+		int uid = atoi(reply.str.c_str());
+		if (uid <= 0) {
+			return std::nullopt;
+		}
+		return uid;
+		});
+}
+
+std::future<bool> RedisMgr::SetNameIndexAsync(const std::string& name, int uid)
+{
+	auto key = USER_NAME_INDEX + name;
+	return commandAsync<bool>({ "SET", key, std::to_string(uid), "EX", std::to_string(jitteredTtl()) },
+		[key](const RedisValue& reply) {
+			if (!reply.IsStatus()) {
+				spdlog::error("执行命令 [ SET {} ] 失败: {}", key, reply.str);
+				return false;
+			}
+			return true;
+		});
+}
+
+bool RedisMgr::LoginSwap(int uid, const std::string& server_name,
+	const std::string& session_id, long long contact_ver, LoginSwapResult& result)
+{
+	auto swapped = LoginSwapAsync(uid, server_name, session_id, contact_ver).get();
+	if (!swapped) {
 		return false;
 	}
-	value = reply->str;
-	spdlog::info("成功执行命令 [ RPOP {} ]", key);
-	freeReplyObject(reply);
-	_con_pool->returnConnection(connect);
+	result = std::move(*swapped);
 	return true;
 }
 
-bool RedisMgr::HSet(const std::string &key, const std::string &hkey, const std::string &value) {
-	auto connect = _con_pool->getConnection();
-	if (connect == nullptr) {
-		return false;
-	}
-	auto reply = (redisReply*)redisCommand(connect, "HSET %s %s %s", key.c_str(), hkey.c_str(), value.c_str());
-	if (reply == nullptr ) {
-		spdlog::error("[ HSET {} {} {} ] failed", key, hkey, value);
-		_con_pool->returnConnection(connect);
-		return false;
-	}
+bool RedisMgr::ReleaseSession(int uid, long long fence)
+{
+	return ReleaseSessionAsync(uid, fence).get();
+}
 
-	if (reply->type != REDIS_REPLY_INTEGER) {
-		spdlog::error("[ HSET {} {} {} ] failed", key, hkey, value);
-		freeReplyObject(reply);
-		_con_pool->returnConnection(connect);
+bool RedisMgr::GetRoute(int uid, std::string& server)
+{
+	auto route = GetRouteAsync(uid).get();
+	if (!route) {
 		return false;
 	}
-
-	spdlog::info("成功执行命令 [ HSET {} {} {} ]", key, hkey, value);
-	freeReplyObject(reply);
-	_con_pool->returnConnection(connect);
+	server = std::move(*route);
 	return true;
 }
 
-bool RedisMgr::HSet(const char* key, const char* hkey, const char* hvalue, size_t hvaluelen)
+bool RedisMgr::GetProfile(int uid, std::string& profile)
 {
-	auto connect = _con_pool->getConnection();
-	if (connect == nullptr) {
+	auto value = GetProfileAsync(uid).get();
+	if (!value) {
 		return false;
 	}
-	 const char* argv[4];
-	 size_t argvlen[4];
-	 argv[0] = "HSET";
-	argvlen[0] = 4;
-	argv[1] = key;
-	argvlen[1] = strlen(key);
-	argv[2] = hkey;
-	argvlen[2] = strlen(hkey);
-	argv[3] = hvalue;
-	argvlen[3] = hvaluelen;
-
-	auto reply = (redisReply*)redisCommandArgv(connect, 4, argv, argvlen);
-	if (reply == nullptr ) {
-		spdlog::error("[ HSET {} {} {} ] failed", key, hkey, hvalue);
-		_con_pool->returnConnection(connect);
+	profile = std::move(*value);
+	return true;
+}
+
+bool RedisMgr::SetProfile(int uid, const std::string& profile)
+{
+	return SetProfileAsync(uid, profile).get();
+}
+
+std::vector<std::optional<std::string>> RedisMgr::GetProfiles(const std::vector<int>& uids)
+{
+	return GetProfilesAsync(uids).get();
+}
+
+bool RedisMgr::GetFriends(int uid, FriendsCache& cache)
+{
+	auto value = GetFriendsAsync(uid).get();
+	if (!value) {
 		return false;
 	}
+	cache = std::move(*value);
+	return true;
+}
+
+bool RedisMgr::SetFriends(int uid, long long cver, const std::string& friends)
+{
+	return SetFriendsAsync(uid, cver, friends).get();
+}
+
+bool RedisMgr::BumpContact(int uid, const std::vector<std::string>& changes)
+{
+	return BumpContactAsync(uid, changes).get().has_value();
+}
 
-	if (reply->type != REDIS_REPLY_INTEGER) {
-		spdlog::error("[ HSET {} {} {} ] failed", key, hkey, hvalue);
-		freeReplyObject(reply);
-		_con_pool->returnConnection(connect);
+bool RedisMgr::GetNameIndex(const std::string& name, int& uid)
+{
+	auto value = GetNameIndexAsync(name).get();
+	if (!value) {
 		return false;
 	}
-	spdlog::info("成功执行命令 [ HSET {} {} {} ]", key, hkey, hvalue);
-	freeReplyObject(reply);
-	_con_pool->returnConnection(connect);
+	uid = *value;
 	return true;
 }
 
-std::string RedisMgr::HGet(const std::string &key, const std::string &hkey)
+bool RedisMgr::SetNameIndex(const std::string& name, int uid)
 {
-	auto connect = _con_pool->getConnection();
-	if (connect == nullptr) {
-		return "";
-	}
-	const char* argv[3];
-	size_t argvlen[3];
-	argv[0] = "HGET";
-	argvlen[0] = 4;
-	argv[1] = key.c_str();
-	argvlen[1] = key.length();
-	argv[2] = hkey.c_str();
-	argvlen[2] = hkey.length();
-	
-	auto reply = (redisReply*)redisCommandArgv(connect, 3, argv, argvlen);
-	if (reply == nullptr ) {
-		spdlog::error("[ HGET {} {} ] failed", key, hkey);
-		_con_pool->returnConnection(connect);
-		return "";
-	}
+	return SetNameIndexAsync(name, uid).get();
+}
 
-	if ( reply->type == REDIS_REPLY_NIL) {
-		freeReplyObject(reply);
-		spdlog::error("[ HGET {} {} ] failed", key, hkey);
-		_con_pool->returnConnection(connect);
-		return "";
-	}
+// 注册中心脚本统一用Redis服务器的时钟计算过期时刻，各节点之间不需要对时
+#define REGISTRY_NOW_MS \
+	"redis.replicate_commands() " \
+	"local t = redis.call('TIME') " \
+	"local now = tonumber(t[1]) * 1000 + math.floor(tonumber(t[2]) / 1000) "
+
+// 心跳脚本: KEYS = chatserver_nodes, chatserver_info  ARGV = name, info, ttl_ms
+static const RedisScript REGISTRY_HEARTBEAT_SCRIPT(
+	REGISTRY_NOW_MS
+	"local added = redis.call('ZADD', KEYS[1], now + tonumber(ARGV[3]), ARGV[1]) "
+	"redis.call('HSET', KEYS[2], ARGV[1], ARGV[2]) "
+	"if added == 1 then redis.call('PUBLISH', '" MEMBERSHIP_CHANNEL "', 'join,' .. ARGV[1]) end "
+	"return added");
+
+// 注销脚本: KEYS = chatserver_nodes, chatserver_info  ARGV = name
+static const RedisScript REGISTRY_LEAVE_SCRIPT(
+	"local removed = redis.call('ZREM', KEYS[1], ARGV[1]) "
+	"redis.call('HDEL', KEYS[2], ARGV[1]) "
+	"if removed == 1 then redis.call('PUBLISH', '" MEMBERSHIP_CHANNEL "', 'leave,' .. ARGV[1]) end "
+	"return removed");
 
-	std::string value = reply->str;
-	freeReplyObject(reply);
-	_con_pool->returnConnection(connect);
-	spdlog::info("成功执行命令 [ HGET {} {} ]", key, hkey);
-	return value;
+// 成员脚本: KEYS = chatserver_nodes, chatserver_info
+// 先清掉心跳过期的节点并广播 leave，再返回存活节点 { name1, info1, name2, info2, ... }
+static const RedisScript REGISTRY_MEMBERS_SCRIPT(
+	REGISTRY_NOW_MS
+	"local dead = redis.call('ZRANGEBYSCORE', KEYS[1], '-inf', now) "
+	"for _, name in ipairs(dead) do "
+	"redis.call('ZREM', KEYS[1], name) "
+	"redis.call('HDEL', KEYS[2], name) "
+	"redis.call('PUBLISH', '" MEMBERSHIP_CHANNEL "', 'leave,' .. name) end "
+	"local result = {} "
+	"for _, name in ipairs(redis.call('ZRANGEBYSCORE', KEYS[1], '(' .. now, '+inf')) do "
+	"local info = redis.call('HGET', KEYS[2], name) "
+	"if info then table.insert(result, name) table.insert(result, info) end end "
+	"return result");
+
+std::future<bool> RedisMgr::RegistryHeartbeatAsync(const std::string& name, const std::string& info, int ttl_ms)
+{
+	return evalAsync<bool>(REGISTRY_HEARTBEAT_SCRIPT, { CHAT_REGISTRY, CHAT_REGISTRY_INFO },
+		{ name, info, std::to_string(ttl_ms) },
+		[name, info](const RedisValue& reply) {
+			if (!reply.IsInteger()) {
+				spdlog::error("[ REGISTRY HEARTBEAT {} ] 错误的类型: {} {}", name, reply.type, reply.str);
+				return false;
+			}
+			if (reply.integer == 1) {
+				spdlog::info("成功执行命令 [ REGISTRY HEARTBEAT {} ] 节点加入注册中心: {}", name, info);
+			}
+			return true;
+		});
 }
 
-bool RedisMgr::HDel(const std::string& key, const std::string& field)
+std::future<bool> RedisMgr::RegistryLeaveAsync(const std::string& name)
 {
-	auto connect = _con_pool->getConnection();
-	if (connect == nullptr) {
-		return false;
-	}
+	return evalAsync<bool>(REGISTRY_LEAVE_SCRIPT, { CHAT_REGISTRY, CHAT_REGISTRY_INFO }, { name },
+		[name](const RedisValue& reply) {
+			if (reply.IsError()) {
+				spdlog::error("[ REGISTRY LEAVE {} ] failed: {}", name, reply.str);
+				return false;
+			}
+			spdlog::info("成功执行命令 [ REGISTRY LEAVE {} ]", name);
+			return true;
+		});
+}
 
-	Defer defer([&connect, this]() {
-		_con_pool->returnConnection(connect);
+std::future<std::optional<std::map<std::string, std::string>>> RedisMgr::RegistryMembersAsync()
+{
+	using Members = std::map<std::string, std::string>;
+	return evalAsync<std::optional<Members>>(REGISTRY_MEMBERS_SCRIPT, { CHAT_REGISTRY, CHAT_REGISTRY_INFO }, {},
+		[](const RedisValue& reply) -> std::optional<Members> {
+			if (!reply.IsArray()) {
+				spdlog::error("[ REGISTRY MEMBERS ] 错误的类型: {} {}", reply.type, reply.str);
+				return std::nullopt;
+			}
+			Members members;
+			for (size_t i = 0; i + 1 < reply.elements.size(); i += 2) {
+				members[reply.elements[i].str] = reply.elements[i + 1].str;
+			}
+			return members;
 		});
+}
 
-	redisReply* reply = (redisReply*)redisCommand(connect, "HDEL %s %s", key.c_str(), field.c_str());
-	if (reply == nullptr) {
-		spdlog::error("[ HDEL {} {} ] failed", key, field);
+bool RedisMgr::RegistryHeartbeat(const std::string& name, const std::string& info, int ttl_ms)
+{
+	return RegistryHeartbeatAsync(name, info, ttl_ms).get();
+}
+
+bool RedisMgr::RegistryLeave(const std::string& name)
+{
+	return RegistryLeaveAsync(name).get();
+}
+
+bool RedisMgr::RegistryMembers(std::map<std::string, std::string>& members)
+{
+	auto result = RegistryMembersAsync().get();
+	if (!result) {
 		return false;
 	}
+	members.swap(*result);
+	return true;
+}
 
-	bool success = false;
-	if (reply->type == REDIS_REPLY_INTEGER) {
-		success = reply->integer > 0;
-	}
+// 吊销脚本: KEYS = token_deny  ARGV = id, expire
+static const RedisScript REVOKE_TOKEN_SCRIPT(
+	"redis.call('ZADD', KEYS[1], ARGV[2], ARGV[1]) "
+	"redis.call('PUBLISH', '" TOKEN_DENY_CHANNEL "', ARGV[1] .. ',' .. ARGV[2]) "
+	"return 1");
 
-	freeReplyObject(reply);
-	return success;
+std::future<bool> RedisMgr::RevokeTokenAsync(const std::string& id, long long expire)
+{
+	return evalAsync<bool>(REVOKE_TOKEN_SCRIPT, { TOKEN_DENY_LIST }, { id, std::to_string(expire) },
+		[id, expire](const RedisValue& reply) {
+			if (reply.IsError()) {
+				spdlog::error("[ REVOKE TOKEN {} ] failed: {}", id, reply.str);
+				return false;
+			}
+			spdlog::info("成功执行命令 [ REVOKE TOKEN {} {} ]", id, expire);
+			return true;
+		});
 }
 
-bool RedisMgr::Del(const std::string &key)
+std::future<std::optional<std::unordered_map<std::string, long long>>> RedisMgr::GetTokenDenyListAsync(long long now)
 {
-	auto connect = _con_pool->getConnection();
-	if (connect == nullptr) {
-		return false;
-	}
-	auto reply = (redisReply*)redisCommand(connect, "DEL %s", key.c_str());
-	if (reply == nullptr ) {
-		spdlog::error("[ DEL {} ] failed", key);
-		_con_pool->returnConnection(connect);
-		return false;
-	}
+	using DenyList = std::unordered_map<std::string, long long>;
+	auto now_str = std::to_string(now);
+	// 清理和加载可能落在不同连接上，加载只取未过期的部分，两者先后顺序无关
+	shardFor(TOKEN_DENY_LIST)->Command({ "ZREMRANGEBYSCORE", TOKEN_DENY_LIST, "-inf", now_str }, [](const RedisValue& reply) {
+		if (reply.IsError()) {
+			spdlog::error("[ ZREMRANGEBYSCORE {} ] failed: {}", TOKEN_DENY_LIST, reply.str);
+		}
+		});
 
-	if ( reply->type != REDIS_REPLY_INTEGER) {
-		spdlog::error("[ DEL {} ] failed", key);
-		freeReplyObject(reply);
-		_con_pool->returnConnection(connect);
-		return false;
-	}
+	return commandAsync<std::optional<DenyList>>({ "ZRANGEBYSCORE", TOKEN_DENY_LIST, "(" + now_str, "+inf", "WITHSCORES" },
+		[](const RedisValue& reply) -> std::optional<DenyList> {
+			if (!reply.IsArray()) {
+				spdlog::error("[ ZRANGEBYSCORE {} ] 错误的类型: {} {}", TOKEN_DENY_LIST, reply.type, reply.str);
+				return std::nullopt;
+			}
+			DenyList denied;
+			for (size_t i = 0; i + 1 < reply.elements.size(); i += 2) {
+				denied[reply.elements[i].str] = atoll(reply.elements[i + 1].str.c_str());
+			}
+			return denied;
+		});
+}
 
-	spdlog::info("成功执行命令 [ DEL {} ]", key);
-	 freeReplyObject(reply);
-	 _con_pool->returnConnection(connect);
-	 return true;
+std::future<std::optional<long long>> RedisMgr::HIncrByAsync(const std::string& key, const std::string& hkey, long long delta)
+{
+	return commandAsync<std::optional<long long>>({ "HINCRBY", key, hkey, std::to_string(delta) },
+		[key, hkey, delta](const RedisValue& reply) -> std::optional<long long> {
+			if (!reply.IsInteger()) {
+				spdlog::error("[ HINCRBY {} {} {} ] 错误的类型: {} {}", key, hkey, delta, reply.type, reply.str);
+				return std::nullopt;
+			}
+			return reply.integer;
+		});
 }
 
-bool RedisMgr::ExistsKey(const std::string &key)
+// 连接数只靠 HINCRBY 原子增减，不再需要 LOCK_COUNT 分布式锁
+std::future<bool> RedisMgr::IncrCountAsync(const std::string& server_name, long long delta)
 {
-	auto connect = _con_pool->getConnection();
-	if (connect == nullptr) {
-		return false;
-	}
+	return commandAsync<bool>({ "HINCRBY", LOGIN_COUNT, server_name, std::to_string(delta) },
+		[server_name, delta](const RedisValue& reply) {
+			if (!reply.IsInteger()) {
+				spdlog::error("[ HINCRBY {} {} {} ] 错误的类型: {} {}", LOGIN_COUNT, server_name, delta, reply.type, reply.str);
+				return false;
+			}
+			return true;
+		});
+}
 
-	auto reply = (redisReply*)redisCommand(connect, "exists %s", key.c_str());
-	if (reply == nullptr ) {
-		spdlog::error("[ EXISTS {} ] failed", key);
-		_con_pool->returnConnection(connect);
+bool RedisMgr::RevokeToken(const std::string& id, long long expire)
+{
+	return RevokeTokenAsync(id, expire).get();
+}
+
+bool RedisMgr::GetTokenDenyList(long long now, std::unordered_map<std::string, long long>& denied)
+{
+	auto result = GetTokenDenyListAsync(now).get();
+	if (!result) {
 		return false;
 	}
+	denied.swap(*result);
+	return true;
+}
 
-	if (reply->type != REDIS_REPLY_INTEGER || reply->integer == 0) {
-		spdlog::info("键 [ {} ] 不存在", key);
-		_con_pool->returnConnection(connect);
-		freeReplyObject(reply);
+bool RedisMgr::HIncrBy(const std::string& key, const std::string& hkey, long long delta, long long& value)
+{
+	auto result = HIncrByAsync(key, hkey, delta).get();
+	if (!result) {
 		return false;
 	}
-	spdlog::info("键 [ {} ] 存在", key);
-	freeReplyObject(reply);
-	_con_pool->returnConnection(connect);
+	value = *result;
 	return true;
 }
 
+bool RedisMgr::IncrCount(const std::string& server_name, long long delta)
+{
+	return IncrCountAsync(server_name, delta).get();
+}
 
-std::string RedisMgr::acquireLock(const std::string& lockName,
-	int lockTimeout, int acquireTimeout) {
+void RedisMgr::InitCount(std::string server_name) {
+	HSet(LOGIN_COUNT, server_name, "0");
+}
 
-	auto connect = _con_pool->getConnection();
-	if (connect == nullptr) {
-		return "";
+void RedisMgr::DelCount(std::string server_name) {
+	HDel(LOGIN_COUNT, server_name);
+}
+
+// MGET/HMGET 的回复转成与请求一一对应的结果，出错时全部置空
+static std::vector<std::optional<std::string>> toValues(const RedisValue& reply, size_t count) {
+	std::vector<std::optional<std::string>> values(count);
+	if (!reply.IsArray() || reply.elements.size() != count) {
+		return values;
 	}
+	for (size_t i = 0; i < count; ++i) {
+		if (reply.elements[i].IsString()) {
+			values[i] = reply.elements[i].str;
+		}
+	}
+	return values;
+}
 
-	Defer defer([&connect, this]() {
-		_con_pool->returnConnection(connect);
-	});
+template <typename T>
+static std::future<T> readyFuture(T value) {
+	std::promise<T> promise;
+	promise.set_value(std::move(value));
+	return promise.get_future();
+}
 
-	return DistLock::Inst().acquireLock(connect, lockName, lockTimeout, acquireTimeout);
+std::future<std::vector<RedisValue>> RedisMgr::ExecAsync(RedisBatch batch)
+{
+	recordBatch("batch", batch.Size());
+	auto promise = std::make_shared<std::promise<std::vector<RedisValue>>>();
+	auto future = promise->get_future();
+	execSharded(std::move(batch._commands), [promise](std::vector<RedisValue>& replies) {
+		promise->set_value(std::move(replies));
+		});
+	return future;
 }
 
-bool RedisMgr::releaseLock(const std::string& lockName,
-	const std::string& identifier) {
-	if (identifier.empty()) {
-		return true;
+// 多key命令按分片拆开，每个分片一条命令；positions 记录每条命令中各个key在原请求中的位置
+static void splitByShard(const std::string& cmd, size_t step, const std::vector<std::string>& args,
+	const std::function<AsyncRedis*(const std::string&)>& shard_for,
+	std::vector<std::vector<std::string>>& commands, std::vector<std::vector<size_t>>& positions)
+{
+	std::map<AsyncRedis*, size_t> command_of;
+	for (size_t i = 0; i * step < args.size(); ++i) {
+		auto* shard = shard_for(args[i * step]);
+		auto iter = command_of.find(shard);
+		if (iter == command_of.end()) {
+			iter = command_of.emplace(shard, commands.size()).first;
+			commands.push_back({ cmd });
+			positions.emplace_back();
+		}
+		for (size_t j = 0; j < step; ++j) {
+			commands[iter->second].push_back(args[i * step + j]);
+		}
+		positions[iter->second].push_back(i);
 	}
-	auto connect = _con_pool->getConnection();
-	if (connect == nullptr) {
-		return false;
+}
+
+std::future<std::vector<std::optional<std::string>>> RedisMgr::MGetAsync(const std::vector<std::string>& keys)
+{
+	using Values = std::vector<std::optional<std::string>>;
+	if (keys.empty()) {
+		return readyFuture(Values());
 	}
+	recordBatch("mget", keys.size());
 
+	std::vector<std::vector<std::string>> commands;
+	std::vector<std::vector<size_t>> positions;
+	splitByShard("MGET", 1, keys, [this](const std::string& key) { return shardFor(key); }, commands, positions);
 
-	Defer defer([&connect, this]() {
-		_con_pool->returnConnection(connect);
+	auto promise = std::make_shared<std::promise<Values>>();
+	auto future = promise->get_future();
+	auto count = keys.size();
+	execSharded(std::move(commands), [promise, positions, count](std::vector<RedisValue>& replies) {
+		Values values(count);
+		for (size_t c = 0; c < replies.size(); ++c) {
+			if (replies[c].IsError()) {
+				spdlog::error("[ MGET {} 个键 ] failed: {}", positions[c].size(), replies[c].str);
+			}
+			auto part = toValues(replies[c], positions[c].size());
+			for (size_t j = 0; j < part.size(); ++j) {
+				values[positions[c][j]] = std::move(part[j]);
+			}
+		}
+		promise->set_value(std::move(values));
 		});
-
-	return DistLock::Inst().releaseLock(connect, lockName, identifier);
+	return future;
 }
 
-void RedisMgr::IncreaseCount(std::string server_name)
+std::future<bool> RedisMgr::MSetAsync(const std::vector<std::pair<std::string, std::string>>& values)
 {
-	auto lock_key = LOCK_COUNT;
-	auto identifier = RedisMgr::GetInstance()->acquireLock(lock_key, LOCK_TIME_OUT, ACQUIRE_TIME_OUT);
-	//����defer����
-	Defer defer2([this, identifier, lock_key]() {
-		RedisMgr::GetInstance()->releaseLock(lock_key, identifier);
-		});
+	if (values.empty()) {
+		return readyFuture(true);
+	}
+	recordBatch("mset", values.size());
 
-	//����¼��������
-	auto rd_res = RedisMgr::GetInstance()->HGet(LOGIN_COUNT, server_name);
-	int count = 0;
-	if (!rd_res.empty()) {
-		count = std::stoi(rd_res);
+	std::vector<std::string> args;
+	args.reserve(values.size() * 2);
+	for (auto& item : values) {
+		args.push_back(item.first);
+		args.push_back(item.second);
 	}
+	std::vector<std::vector<std::string>> commands;
+	std::vector<std::vector<size_t>> positions;
+	splitByShard("MSET", 2, args, [this](const std::string& key) { return shardFor(key); }, commands, positions);
 
-	count++;
-	auto count_str = std::to_string(count);
-	RedisMgr::GetInstance()->HSet(LOGIN_COUNT, server_name, count_str);
+	// 跨分片时各分片分别写入，不保证整体原子
+	auto promise = std::make_shared<std::promise<bool>>();
+	auto future = promise->get_future();
+	execSharded(std::move(commands), [promise, positions](std::vector<RedisValue>& replies) {
+		bool success = true;
+		for (size_t c = 0; c < replies.size(); ++c) {
+			if (!replies[c].IsStatus()) {
+				spdlog::error("[ MSET {} 个键 ] failed: {}", positions[c].size(), replies[c].str);
+				success = false;
+			}
+		}
+		promise->set_value(success);
+		});
+	return future;
 }
 
-void RedisMgr::DecreaseCount(std::string server_name)
+std::future<std::vector<std::optional<std::string>>> RedisMgr::HMGetAsync(const std::string& key,
+	const std::vector<std::string>& fields)
 {
-	auto lock_key = LOCK_COUNT;
-	auto identifier = RedisMgr::GetInstance()->acquireLock(lock_key, LOCK_TIME_OUT, ACQUIRE_TIME_OUT);
-	//����defer����
-	Defer defer2([this, identifier, lock_key]() {
-		RedisMgr::GetInstance()->releaseLock(lock_key, identifier);
-		});
+	using Values = std::vector<std::optional<std::string>>;
+	if (fields.empty()) {
+		return readyFuture(Values());
+	}
+	recordBatch("hmget", fields.size());
 
-	//����¼��������
-	auto rd_res = RedisMgr::GetInstance()->HGet(LOGIN_COUNT, server_name);
-	int count = 0;
-	if (!rd_res.empty()) {
-		count = std::stoi(rd_res);
-		if (count > 0) {
-			count--;
+	std::vector<std::string> args;
+	args.reserve(fields.size() + 2);
+	args.push_back("HMGET");
+	args.push_back(key);
+	args.insert(args.end(), fields.begin(), fields.end());
+	auto count = fields.size();
+	return commandAsync<Values>(std::move(args), [key, count](const RedisValue& reply) {
+		if (reply.IsError()) {
+			spdlog::error("[ HMGET {} {} 个字段 ] failed: {}", key, count, reply.str);
 		}
-		
+		return toValues(reply, count);
+		});
+}
+
+std::future<std::vector<std::optional<std::string>>> RedisMgr::GetProfilesAsync(const std::vector<int>& uids)
+{
+	using Values = std::vector<std::optional<std::string>>;
+	if (uids.empty()) {
+		return readyFuture(Values());
+	}
+	recordBatch("profiles", uids.size());
+
+	// 每个uid一条 HMGET，按分片分组后一次往返
+	std::vector<std::vector<std::string>> commands;
+	commands.reserve(uids.size());
+	for (auto uid : uids) {
+		commands.push_back({ "HMGET", USER_HASH_PREFIX + std::to_string(uid), "v", "profile" });
 	}
+	auto promise = std::make_shared<std::promise<Values>>();
+	auto future = promise->get_future();
+	execSharded(std::move(commands), [promise](std::vector<RedisValue>& replies) {
+		Values values;
+		values.reserve(replies.size());
+		for (auto& reply : replies) {
+			// 与 GetProfileAsync 一样，其他结构版本写入的 profile 按未命中处理
+			if (reply.IsArray() && reply.elements.size() == 2
+				&& reply.elements[0].str == USER_LAYOUT_VERSION && reply.elements[1].IsString()) {
+				values.push_back(std::move(reply.elements[1].str));
+				continue;
+			}
+			if (reply.IsError()) {
+				spdlog::error("[ HMGET v profile ] failed: {}", reply.str);
+			}
+			values.push_back(std::nullopt);
+		}
+		promise->set_value(std::move(values));
+		});
+	return future;
+}
 
-	auto count_str = std::to_string(count);
-	RedisMgr::GetInstance()->HSet(LOGIN_COUNT, server_name, count_str);
+std::vector<RedisValue> RedisMgr::Exec(RedisBatch batch)
+{
+	return ExecAsync(std::move(batch)).get();
 }
 
+std::vector<std::optional<std::string>> RedisMgr::MGet(const std::vector<std::string>& keys)
+{
+	return MGetAsync(keys).get();
+}
 
-void RedisMgr::InitCount(std::string server_name) {
-	auto lock_key = LOCK_COUNT;
-	auto identifier = RedisMgr::GetInstance()->acquireLock(lock_key, LOCK_TIME_OUT, ACQUIRE_TIME_OUT);
-	//����defer����
-	Defer defer2([this, identifier, lock_key]() {
-		RedisMgr::GetInstance()->releaseLock(lock_key, identifier);
-		});
+bool RedisMgr::MSet(const std::vector<std::pair<std::string, std::string>>& values)
+{
+	return MSetAsync(values).get();
+}
 
-	RedisMgr::GetInstance()->HSet(LOGIN_COUNT, server_name, "0");
+std::vector<std::optional<std::string>> RedisMgr::HMGet(const std::string& key, const std::vector<std::string>& fields)
+{
+	return HMGetAsync(key, fields).get();
 }
 
-void RedisMgr::DelCount(std::string server_name) {
-	auto lock_key = LOCK_COUNT;
-	auto identifier = RedisMgr::GetInstance()->acquireLock(lock_key, LOCK_TIME_OUT, ACQUIRE_TIME_OUT);
-	//����defer����
-	Defer defer2([this, identifier, lock_key]() {
-		RedisMgr::GetInstance()->releaseLock(lock_key, identifier);
-		});
+void RedisMgr::recordBatch(const std::string& kind, size_t size)
+{
+	std::lock_guard<std::mutex> lock(_batch_mutex);
+	auto& stats = _batch_stats[kind];
+	stats.count++;
+	stats.total += size;
+	stats.max = std::max(stats.max, size);
+	for (size_t i = 0; i < BATCH_BOUNDS.size(); ++i) {
+		if (size <= BATCH_BOUNDS[i]) {
+			stats.buckets[i]++;
+			break;
+		}
+	}
+}
 
-	RedisMgr::GetInstance()->HDel(LOGIN_COUNT, server_name);
+void RedisMgr::LogBatchStats()
+{
+	std::map<std::string, BatchStats> stats;
+	{
+		std::lock_guard<std::mutex> lock(_batch_mutex);
+		stats.swap(_batch_stats);
+	}
+
+	for (auto& item : stats) {
+		auto& s = item.second;
+		std::string buckets;
+		for (size_t i = 0; i < BATCH_BOUNDS.size(); ++i) {
+			if (s.buckets[i] == 0) {
+				continue;
+			}
+			if (!buckets.empty()) {
+				buckets += ", ";
+			}
+			buckets += (BATCH_BOUNDS[i] == SIZE_MAX ? std::string(">") + std::to_string(BATCH_BOUNDS[i - 1])
+				: "<=" + std::to_string(BATCH_BOUNDS[i])) + ": " + std::to_string(s.buckets[i]);
+		}
+		spdlog::info("redis {} 共 {} 次, 平均 {} 条, 最大 {} 条, 分布 [{}]",
+			item.first, s.count, s.count ? s.total / s.count : 0, s.max, buckets);
+	}
 }
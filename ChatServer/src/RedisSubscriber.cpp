@@ -0,0 +1,200 @@
+#include "RedisSubscriber.h"
+#include "ConfigMgr.h"
+#include <poll.h>
+#include <cerrno>
+
+RedisSubscriber::RedisSubscriber() : _b_stop(false) {
+	auto cfg = ConfigMgr::Inst().Snapshot();
+	for (auto& shard : cfg->redis_shards) {
+		Link link;
+		link.host = shard.host;
+		link.port = shard.port;
+		link.pwd = shard.pwd;
+		_links.push_back(link);
+	}
+	_thread = std::thread([this]() {
+		run();
+		});
+}
+
+RedisSubscriber::~RedisSubscriber() {
+	Close();
+}
+
+void RedisSubscriber::Subscribe(const std::string& channel, Handler handler) {
+	std::lock_guard<std::mutex> lock(_mutex);
+	auto& handlers = _handlers[channel];
+	// 同一个频道只需要订阅一次
+	if (handlers.empty()) {
+		for (auto& link : _links) {
+			link.pending.push_back(channel);
+		}
+	}
+	handlers.push_back(std::move(handler));
+}
+
+void RedisSubscriber::Close() {
+	if (_b_stop.exchange(true)) {
+		return;
+	}
+	if (_thread.joinable()) {
+		_thread.join();
+	}
+}
+
+bool RedisSubscriber::connect(Link& link) {
+	auto* context = redisConnect(link.host.c_str(), link.port);
+	if (context == nullptr || context->err != 0) {
+		spdlog::error("Redis 订阅连接 {}:{} 失败: {}", link.host, link.port, context ? context->errstr : "null");
+		if (context != nullptr) {
+			redisFree(context);
+		}
+		return false;
+	}
+
+	auto reply = (redisReply*)redisCommand(context, "AUTH %s", link.pwd.c_str());
+	if (reply == nullptr || reply->type == REDIS_REPLY_ERROR) {
+		spdlog::error("Redis 订阅连接 {}:{} 认证失败", link.host, link.port);
+		if (reply != nullptr) {
+			freeReplyObject(reply);
+		}
+		redisFree(context);
+		return false;
+	}
+	freeReplyObject(reply);
+	redisEnableKeepAlive(context);
+	link.context = context;
+
+	// 新连接上没有任何订阅，已登记的频道全部重新订阅
+	std::lock_guard<std::mutex> lock(_mutex);
+	link.pending.clear();
+	for (auto& iter : _handlers) {
+		link.pending.push_back(iter.first);
+	}
+	spdlog::info("Redis 订阅连接 {}:{} 成功", link.host, link.port);
+	return true;
+}
+
+void RedisSubscriber::disconnect(Link& link) {
+	if (link.context == nullptr) {
+		return;
+	}
+	redisFree(link.context);
+	link.context = nullptr;
+}
+
+bool RedisSubscriber::flushPending(Link& link) {
+	std::vector<std::string> channels;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		channels.swap(link.pending);
+	}
+
+	if (channels.empty()) {
+		return true;
+	}
+
+	for (auto& channel : channels) {
+		redisAppendCommand(link.context, "SUBSCRIBE %b", channel.data(), channel.size());
+	}
+
+	int done = 0;
+	while (!done) {
+		if (redisBufferWrite(link.context, &done) == REDIS_ERR) {
+			return false;
+		}
+	}
+	return true;
+}
+
+bool RedisSubscriber::readMessages(Link& link) {
+	if (redisBufferRead(link.context) != REDIS_OK) {
+		return false;
+	}
+
+	void* reply = nullptr;
+	while (redisGetReplyFromReader(link.context, &reply) == REDIS_OK && reply != nullptr) {
+		dispatch((redisReply*)reply);
+		freeReplyObject(reply);
+		reply = nullptr;
+	}
+	return link.context->err == 0;
+}
+
+void RedisSubscriber::dispatch(redisReply* reply) {
+	// 推送消息格式: ["message", channel, payload]，订阅确认等其他回复直接忽略
+	if (reply->type != REDIS_REPLY_ARRAY || reply->elements != 3) {
+		return;
+	}
+	auto* kind = reply->element[0];
+	if (kind->type != REDIS_REPLY_STRING || std::string(kind->str, kind->len) != "message") {
+		return;
+	}
+
+	std::string channel(reply->element[1]->str, reply->element[1]->len);
+	std::string message(reply->element[2]->str, reply->element[2]->len);
+
+	std::vector<Handler> handlers;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		auto iter = _handlers.find(channel);
+		if (iter == _handlers.end()) {
+			return;
+		}
+		handlers = iter->second;
+	}
+
+	for (auto& handler : handlers) {
+		handler(channel, message);
+	}
+}
+
+void RedisSubscriber::run() {
+	std::vector<pollfd> pfds;
+	std::vector<Link*> polled;
+	while (!_b_stop) {
+		auto now = std::chrono::steady_clock::now();
+		pfds.clear();
+		polled.clear();
+		for (auto& link : _links) {
+			if (link.context == nullptr) {
+				// 连接失败的分片稍后重试，不影响其他分片的消息接收
+				if (now < link.retry_at || !connect(link)) {
+					if (now >= link.retry_at) {
+						link.retry_at = now + std::chrono::seconds(1);
+					}
+					continue;
+				}
+			}
+
+			if (!flushPending(link)) {
+				spdlog::error("Redis 订阅连接 {}:{} 断开: {}", link.host, link.port, link.context->errstr);
+				disconnect(link);
+				continue;
+			}
+			pfds.push_back(pollfd{ link.context->fd, POLLIN, 0 });
+			polled.push_back(&link);
+		}
+
+		// 超时返回是为了及时发送新登记的订阅、重连失败的分片和响应退出
+		int rc = ::poll(pfds.data(), pfds.size(), 100);
+		if (rc <= 0) {
+			continue;
+		}
+
+		for (size_t i = 0; i < pfds.size(); ++i) {
+			if (pfds[i].revents == 0) {
+				continue;
+			}
+			auto& link = *polled[i];
+			if (!readMessages(link)) {
+				spdlog::error("Redis 订阅连接 {}:{} 断开: {}", link.host, link.port, link.context->errstr);
+				disconnect(link);
+			}
+		}
+	}
+
+	for (auto& link : _links) {
+		disconnect(link);
+	}
+}
@@ -0,0 +1,83 @@
+#include "TokenVerifier.h"
+#include "ConfigMgr.h"
+#include "RedisMgr.h"
+#include "RedisSubscriber.h"
+#include <ctime>
+
+void TokenVerifier::Init() {
+	// 先订阅再加载，加载期间发生的吊销不会丢
+	RedisSubscriber::GetInstance()->Subscribe(TOKEN_DENY_CHANNEL, [this](const std::string&, const std::string& message) {
+		auto pos = message.find(',');
+		if (pos == std::string::npos) {
+			return;
+		}
+		std::lock_guard<std::mutex> lock(_mutex);
+		_denied[message.substr(0, pos)] = atoll(message.c_str() + pos + 1);
+		});
+
+	_loaded = load();
+}
+
+bool TokenVerifier::load() {
+	std::unordered_map<std::string, long long> denied;
+	if (!RedisMgr::GetInstance()->GetTokenDenyList(std::time(nullptr), denied)) {
+		spdlog::error("加载token黑名单失败，定时器会重试");
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lock(_mutex);
+	_denied.insert(denied.begin(), denied.end());
+	spdlog::info("加载token黑名单 {} 条", _denied.size());
+	return true;
+}
+
+int TokenVerifier::Verify(const std::string& token, int uid, LoginTokenClaims& claims) {
+	auto cfg = ConfigMgr::Inst().Snapshot();
+	if (!LoginToken::Parse(token, cfg->token_keys, claims)) {
+		return ErrorCodes::TokenInvalid;
+	}
+
+	if (claims.uid != uid) {
+		return ErrorCodes::UidInvalid;
+	}
+
+	// 只接受分配给本服务器的token
+	if (claims.server != cfg->self_name || claims.expire < (long long)std::time(nullptr)) {
+		return ErrorCodes::TokenInvalid;
+	}
+
+	if (isDenied(claims.id)) {
+		return ErrorCodes::TokenInvalid;
+	}
+	return ErrorCodes::Success;
+}
+
+void TokenVerifier::Revoke(const LoginTokenClaims& claims) {
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_denied[claims.id] = claims.expire;
+	}
+	RedisMgr::GetInstance()->RevokeTokenAsync(claims.id, claims.expire);
+}
+
+bool TokenVerifier::isDenied(const std::string& id) {
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _denied.find(id) != _denied.end();
+}
+
+void TokenVerifier::Purge() {
+	if (!_loaded) {
+		_loaded = load();
+	}
+
+	long long now = std::time(nullptr);
+	std::lock_guard<std::mutex> lock(_mutex);
+	for (auto iter = _denied.begin(); iter != _denied.end();) {
+		if (iter->second < now) {
+			iter = _denied.erase(iter);
+		}
+		else {
+			++iter;
+		}
+	}
+}
@@ -192,6 +192,7 @@ static const char* ChatService_method_names[] = {
   "/message.ChatService/NotifyAuthFriend",
   "/message.ChatService/NotifyTextChatMsg",
   "/message.ChatService/NotifyKickUser",
+  "/message.ChatService/TextChatMsgStream",
 };
 
 std::unique_ptr< ChatService::Stub> ChatService::NewStub(const std::shared_ptr< ::grpc::ChannelInterface>& channel, const ::grpc::StubOptions& options) {
@@ -207,6 +208,7 @@ ChatService::Stub::Stub(const std::shared_ptr< ::grpc::ChannelInterface>& channe
   , rpcmethod_NotifyAuthFriend_(ChatService_method_names[3], options.suffix_for_stats(),::grpc::internal::RpcMethod::NORMAL_RPC, channel)
   , rpcmethod_NotifyTextChatMsg_(ChatService_method_names[4], options.suffix_for_stats(),::grpc::internal::RpcMethod::NORMAL_RPC, channel)
   , rpcmethod_NotifyKickUser_(ChatService_method_names[5], options.suffix_for_stats(),::grpc::internal::RpcMethod::NORMAL_RPC, channel)
+  , rpcmethod_TextChatMsgStream_(ChatService_method_names[6], options.suffix_for_stats(),::grpc::internal::RpcMethod::BIDI_STREAMING, channel)
   {}
 
 ::grpc::Status ChatService::Stub::NotifyAddFriend(::grpc::ClientContext* context, const ::message::AddFriendReq& request, ::message::AddFriendRsp* response) {
@@ -347,6 +349,22 @@ void ChatService::Stub::async::NotifyKickUser(::grpc::ClientContext* context, co
   return result;
 }
 
+::grpc::ClientReaderWriter< ::message::TextChatMsgReq, ::message::TextChatMsgRsp>* ChatService::Stub::TextChatMsgStreamRaw(::grpc::ClientContext* context) {
+  return ::grpc::internal::ClientReaderWriterFactory< ::message::TextChatMsgReq, ::message::TextChatMsgRsp>::Create(channel_.get(), rpcmethod_TextChatMsgStream_, context);
+}
+
+void ChatService::Stub::async::TextChatMsgStream(::grpc::ClientContext* context, ::grpc::ClientBidiReactor< ::message::TextChatMsgReq,::message::TextChatMsgRsp>* reactor) {
+  ::grpc::internal::ClientCallbackReaderWriterFactory< ::message::TextChatMsgReq, ::message::TextChatMsgRsp>::Create(stub_->channel_.get(), stub_->rpcmethod_TextChatMsgStream_, context, reactor);
+}
+
+::grpc::ClientAsyncReaderWriter< ::message::TextChatMsgReq, ::message::TextChatMsgRsp>* ChatService::Stub::AsyncTextChatMsgStreamRaw(::grpc::ClientContext* context, ::grpc::CompletionQueue* cq, void* tag) {
+  return ::grpc::internal::ClientAsyncReaderWriterFactory< ::message::TextChatMsgReq, ::message::TextChatMsgRsp>::Create(channel_.get(), cq, rpcmethod_TextChatMsgStream_, context, true, tag);
+}
+
+::grpc::ClientAsyncReaderWriter< ::message::TextChatMsgReq, ::message::TextChatMsgRsp>* ChatService::Stub::PrepareAsyncTextChatMsgStreamRaw(::grpc::ClientContext* context, ::grpc::CompletionQueue* cq) {
+  return ::grpc::internal::ClientAsyncReaderWriterFactory< ::message::TextChatMsgReq, ::message::TextChatMsgRsp>::Create(channel_.get(), cq, rpcmethod_TextChatMsgStream_, context, false, nullptr);
+}
+
 ChatService::Service::Service() {
   AddMethod(new ::grpc::internal::RpcServiceMethod(
       ChatService_method_names[0],
@@ -408,6 +426,16 @@ ChatService::Service::Service() {
              ::message::KickUserRsp* resp) {
                return service->NotifyKickUser(ctx, req, resp);
              }, this)));
+  AddMethod(new ::grpc::internal::RpcServiceMethod(
+      ChatService_method_names[6],
+      ::grpc::internal::RpcMethod::BIDI_STREAMING,
+      new ::grpc::internal::BidiStreamingHandler< ChatService::Service, ::message::TextChatMsgReq, ::message::TextChatMsgRsp>(
+          [](ChatService::Service* service,
+             ::grpc::ServerContext* ctx,
+             ::grpc::ServerReaderWriter<::message::TextChatMsgRsp,
+             ::message::TextChatMsgReq>* stream) {
+               return service->TextChatMsgStream(ctx, stream);
+             }, this)));
 }
 
 ChatService::Service::~Service() {
@@ -455,6 +483,12 @@ ChatService::Service::~Service() {
   return ::grpc::Status(::grpc::StatusCode::UNIMPLEMENTED, "");
 }
 
+::grpc::Status ChatService::Service::TextChatMsgStream(::grpc::ServerContext* context, ::grpc::ServerReaderWriter< ::message::TextChatMsgRsp, ::message::TextChatMsgReq>* stream) {
+  (void) context;
+  (void) stream;
+  return ::grpc::Status(::grpc::StatusCode::UNIMPLEMENTED, "");
+}
+
 
 }  // namespace message
 
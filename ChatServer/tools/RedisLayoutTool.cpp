@@ -0,0 +1,516 @@
+// Redis 用户数据布局的迁移与内存对比工具
+//
+// 旧布局每个用户有 uip_/usession_/ubaseinfo_/nameinfo_(以及早期的 utoken_) 多个key，
+// 基础信息以带缩进的JSON在 ubaseinfo_ 和 nameinfo_ 中各存一份且永不过期；
+// 新布局只有 u_<uid> 一个hash(v/server/sid/fence/profile) 和带TTL的 un_<name> 索引。
+//
+// 用法:
+//   redis_layout_tool migrate <host> <port> <pwd> [--delete] [--ttl 秒] [--batch 条数]
+//     把旧key转换为 u_<uid>，已存在的 u_<uid> 不覆盖(说明该用户已经在新版本上登录过)；
+//     --delete 同时删除旧key和 nameinfo_，un_<name> 不迁移，查询时按需回填。
+//     分片部署时对每个分片各执行一次，同一uid的新旧key在同一分片上。
+//   redis_layout_tool bench <host> <port> <pwd> [--users 数量] [--online 百分比] [--db 库号]
+//     在一个空的库中分别按新旧布局写入同样的模拟用户，对比 used_memory 的增量，结束后清空该库。
+#include "const.h"
+#include "data.h"
+#include "UserProfileCodec.h"
+#include <hiredis/hiredis.h>
+#include <json/json.h>
+#include <json/reader.h>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <cstdlib>
+
+using Command = std::vector<std::string>;
+
+struct Options {
+	std::string mode;
+	std::string host;
+	int port = 0;
+	std::string pwd;
+	bool remove_old = false;
+	int ttl = 604800;
+	int jitter = 10;
+	size_t batch = 500;
+	int users = 100000;
+	int online_pct = 10;
+	int db = 15;
+};
+
+// 迁移脚本: KEYS = u_<uid>  ARGV = 结构版本, server, sid, fence, profile, ttl
+// u_<uid> 已存在时不动它；空字段不写，离线用户的 hash 带TTL
+static const char* MIGRATE_SCRIPT =
+	"if redis.call('EXISTS', KEYS[1]) == 1 then return 0 end "
+	"local names = { 'server', 'sid', 'fence', 'profile' } "
+	"redis.call('HSET', KEYS[1], 'v', ARGV[1]) "
+	"for i, name in ipairs(names) do "
+	"if ARGV[i + 1] ~= '' then redis.call('HSET', KEYS[1], name, ARGV[i + 1]) end end "
+	"if ARGV[2] == '' then redis.call('EXPIRE', KEYS[1], ARGV[6]) end "
+	"return 1";
+
+static void usage() {
+	std::cerr << "usage:\n"
+		<< "  redis_layout_tool migrate <host> <port> <pwd> [--delete] [--ttl seconds] [--batch n]\n"
+		<< "  redis_layout_tool bench <host> <port> <pwd> [--users n] [--online percent] [--db index]\n";
+}
+
+static bool parseOptions(int argc, char* argv[], Options& opts) {
+	if (argc < 5) {
+		return false;
+	}
+	opts.mode = argv[1];
+	opts.host = argv[2];
+	opts.port = atoi(argv[3]);
+	opts.pwd = argv[4];
+	for (int i = 5; i < argc; ++i) {
+		std::string arg = argv[i];
+		bool has_value = i + 1 < argc;
+		if (arg == "--delete") {
+			opts.remove_old = true;
+		}
+		else if (arg == "--ttl" && has_value) {
+			opts.ttl = std::max(1, atoi(argv[++i]));
+		}
+		else if (arg == "--batch" && has_value) {
+			opts.batch = std::max(1, atoi(argv[++i]));
+		}
+		else if (arg == "--users" && has_value) {
+			opts.users = std::max(1, atoi(argv[++i]));
+		}
+		else if (arg == "--online" && has_value) {
+			opts.online_pct = std::min(100, std::max(0, atoi(argv[++i])));
+		}
+		else if (arg == "--db" && has_value) {
+			opts.db = atoi(argv[++i]);
+		}
+		else {
+			return false;
+		}
+	}
+	return opts.mode == "migrate" || opts.mode == "bench";
+}
+
+static int jitteredTtl(const Options& opts, std::mt19937_64& engine) {
+	long long spread = (long long)opts.ttl * opts.jitter / 100;
+	if (spread <= 0) {
+		return opts.ttl;
+	}
+	std::uniform_int_distribution<long long> dist(-spread, spread);
+	return (int)std::max(1LL, opts.ttl + dist(engine));
+}
+
+static redisReply* command(redisContext* context, const Command& args) {
+	std::vector<const char*> argv;
+	std::vector<size_t> argvlen;
+	for (auto& arg : args) {
+		argv.push_back(arg.data());
+		argvlen.push_back(arg.size());
+	}
+	return (redisReply*)redisCommandArgv(context, (int)args.size(), argv.data(), argvlen.data());
+}
+
+// 流水线发送一批命令，回复按顺序返回，调用方负责释放
+static bool pipeline(redisContext* context, const std::vector<Command>& commands, std::vector<redisReply*>& replies) {
+	for (auto& args : commands) {
+		std::vector<const char*> argv;
+		std::vector<size_t> argvlen;
+		for (auto& arg : args) {
+			argv.push_back(arg.data());
+			argvlen.push_back(arg.size());
+		}
+		redisAppendCommandArgv(context, (int)args.size(), argv.data(), argvlen.data());
+	}
+
+	replies.clear();
+	for (size_t i = 0; i < commands.size(); ++i) {
+		void* reply = nullptr;
+		if (redisGetReply(context, &reply) != REDIS_OK) {
+			std::cerr << "redis error: " << context->errstr << std::endl;
+			for (auto* r : replies) {
+				freeReplyObject(r);
+			}
+			replies.clear();
+			return false;
+		}
+		replies.push_back((redisReply*)reply);
+	}
+	return true;
+}
+
+static void freeReplies(std::vector<redisReply*>& replies) {
+	for (auto* reply : replies) {
+		freeReplyObject(reply);
+	}
+	replies.clear();
+}
+
+static std::string replyString(const redisReply* reply) {
+	if (reply == nullptr || (reply->type != REDIS_REPLY_STRING && reply->type != REDIS_REPLY_STATUS)) {
+		return "";
+	}
+	return std::string(reply->str, reply->len);
+}
+
+static redisContext* connect(const Options& opts) {
+	auto* context = redisConnect(opts.host.c_str(), opts.port);
+	if (context == nullptr || context->err != 0) {
+		std::cerr << "connect " << opts.host << ":" << opts.port << " failed: "
+			<< (context ? context->errstr : "null") << std::endl;
+		if (context != nullptr) {
+			redisFree(context);
+		}
+		return nullptr;
+	}
+	if (!opts.pwd.empty()) {
+		auto* reply = command(context, { "AUTH", opts.pwd });
+		bool ok = reply != nullptr && reply->type != REDIS_REPLY_ERROR;
+		if (reply != nullptr) {
+			freeReplyObject(reply);
+		}
+		if (!ok) {
+			std::cerr << "auth failed" << std::endl;
+			redisFree(context);
+			return nullptr;
+		}
+	}
+	return context;
+}
+
+// 旧布局中带缩进的JSON基础信息
+static bool parseJsonProfile(const std::string& info_str, UserInfo& userinfo) {
+	Json::Reader reader;
+	Json::Value root;
+	if (!reader.parse(info_str, root)) {
+		return false;
+	}
+	userinfo.uid = root["uid"].asInt();
+	userinfo.name = root["name"].asString();
+	userinfo.pwd = root["pwd"].asString();
+	userinfo.email = root["email"].asString();
+	userinfo.nick = root["nick"].asString();
+	userinfo.desc = root["desc"].asString();
+	userinfo.sex = root["sex"].asInt();
+	userinfo.icon = root["icon"].asString();
+	return true;
+}
+
+// 用 SCAN 遍历匹配的key，每批交给 handler，handler 返回 false 时中止
+template <typename Handler>
+static bool scanKeys(redisContext* context, const std::string& pattern, size_t batch, Handler handler) {
+	std::string cursor = "0";
+	do {
+		auto* reply = command(context, { "SCAN", cursor, "MATCH", pattern, "COUNT", std::to_string(batch) });
+		if (reply == nullptr || reply->type != REDIS_REPLY_ARRAY || reply->elements != 2) {
+			std::cerr << "SCAN " << pattern << " failed" << std::endl;
+			if (reply != nullptr) {
+				freeReplyObject(reply);
+			}
+			return false;
+		}
+		cursor = replyString(reply->element[0]);
+		std::vector<std::string> keys;
+		auto* list = reply->element[1];
+		for (size_t i = 0; i < list->elements; ++i) {
+			keys.push_back(replyString(list->element[i]));
+		}
+		freeReplyObject(reply);
+		if (!keys.empty() && !handler(keys)) {
+			return false;
+		}
+	} while (cursor != "0");
+	return true;
+}
+
+struct MigrateStats {
+	size_t migrated = 0;
+	size_t skipped = 0;
+	size_t broken = 0;
+	size_t deleted = 0;
+};
+
+static bool migrateUids(redisContext* context, const Options& opts, const std::string& sha,
+	const std::vector<std::string>& uids, std::mt19937_64& engine, MigrateStats& stats) {
+	std::vector<Command> reads;
+	for (auto& uid : uids) {
+		reads.push_back({ "HMGET", USER_SESSION_PREFIX + uid, "server", "sid", "fence" });
+		reads.push_back({ "GET", USER_BASE_INFO + uid });
+	}
+	std::vector<redisReply*> replies;
+	if (!pipeline(context, reads, replies)) {
+		return false;
+	}
+
+	std::vector<Command> writes;
+	for (size_t i = 0; i < uids.size(); ++i) {
+		auto* session = replies[i * 2];
+		std::string server, sid, fence;
+		// 类型不对的 usession_ 按不存在处理
+		if (session->type == REDIS_REPLY_ARRAY && session->elements == 3) {
+			server = replyString(session->element[0]);
+			sid = replyString(session->element[1]);
+			fence = replyString(session->element[2]);
+		}
+
+		std::string profile;
+		auto info_str = replyString(replies[i * 2 + 1]);
+		if (!info_str.empty()) {
+			UserInfo userinfo;
+			if (parseJsonProfile(info_str, userinfo)) {
+				profile = UserProfileCodec::Serialize(userinfo);
+			}
+			else {
+				stats.broken++;
+			}
+		}
+
+		writes.push_back({ "EVALSHA", sha, "1", USER_HASH_PREFIX + uids[i], USER_LAYOUT_VERSION,
+			server, sid, fence, profile, std::to_string(jitteredTtl(opts, engine)) });
+		if (opts.remove_old) {
+			writes.push_back({ "DEL", USERIPPREFIX + uids[i], USER_SESSION_PREFIX + uids[i],
+				USER_BASE_INFO + uids[i], USERTOKENPREFIX + uids[i] });
+		}
+	}
+	freeReplies(replies);
+
+	if (!pipeline(context, writes, replies)) {
+		return false;
+	}
+	for (auto* reply : replies) {
+		if (reply->type == REDIS_REPLY_ERROR) {
+			std::cerr << "write failed: " << replyString(reply) << std::endl;
+			freeReplies(replies);
+			return false;
+		}
+	}
+	size_t step = opts.remove_old ? 2 : 1;
+	for (size_t i = 0; i < replies.size(); i += step) {
+		if (replies[i]->integer == 1) {
+			stats.migrated++;
+		}
+		else {
+			stats.skipped++;
+		}
+		if (opts.remove_old) {
+			stats.deleted += replies[i + 1]->integer;
+		}
+	}
+	freeReplies(replies);
+	return true;
+}
+
+static int migrate(const Options& opts) {
+	auto* context = connect(opts);
+	if (context == nullptr) {
+		return 1;
+	}
+
+	auto* reply = command(context, { "SCRIPT", "LOAD", MIGRATE_SCRIPT });
+	std::string sha = replyString(reply);
+	bool ok = reply != nullptr && reply->type == REDIS_REPLY_STRING;
+	if (reply != nullptr) {
+		freeReplyObject(reply);
+	}
+	if (!ok) {
+		std::cerr << "SCRIPT LOAD failed: " << sha << std::endl;
+		redisFree(context);
+		return 1;
+	}
+
+	std::mt19937_64 engine(std::random_device{}());
+	MigrateStats stats;
+	// 基础信息和会话记录都可能单独存在，两种key各遍历一次，已迁移过的uid由脚本跳过
+	for (auto prefix : { std::string(USER_BASE_INFO), std::string(USER_SESSION_PREFIX) }) {
+		ok = ok && scanKeys(context, prefix + "*", opts.batch, [&](const std::vector<std::string>& keys) {
+			std::vector<std::string> uids;
+			for (auto& key : keys) {
+				auto uid = key.substr(prefix.size());
+				if (!uid.empty() && uid.find_first_not_of("0123456789") == std::string::npos) {
+					uids.push_back(uid);
+				}
+			}
+			return uids.empty() || migrateUids(context, opts, sha, uids, engine, stats);
+			});
+	}
+
+	if (ok && opts.remove_old) {
+		ok = scanKeys(context, std::string(NAME_INFO) + "*", opts.batch, [&](const std::vector<std::string>& keys) {
+			Command del = { "UNLINK" };
+			del.insert(del.end(), keys.begin(), keys.end());
+			auto* reply = command(context, del);
+			if (reply == nullptr || reply->type != REDIS_REPLY_INTEGER) {
+				if (reply != nullptr) {
+					freeReplyObject(reply);
+				}
+				return false;
+			}
+			stats.deleted += reply->integer;
+			freeReplyObject(reply);
+			return true;
+			});
+	}
+	redisFree(context);
+
+	std::cout << "migrated: " << stats.migrated << " skipped: " << stats.skipped
+		<< " broken profiles: " << stats.broken << " deleted keys: " << stats.deleted << std::endl;
+	return ok ? 0 : 1;
+}
+
+static long long usedMemory(redisContext* context) {
+	auto* reply = command(context, { "INFO", "memory" });
+	std::string info = replyString(reply);
+	if (reply != nullptr) {
+		freeReplyObject(reply);
+	}
+	std::stringstream ss(info);
+	std::string line;
+	while (std::getline(ss, line)) {
+		if (line.compare(0, 12, "used_memory:") == 0) {
+			return atoll(line.c_str() + 12);
+		}
+	}
+	return -1;
+}
+
+static UserInfo fakeUser(int uid) {
+	UserInfo userinfo;
+	userinfo.uid = uid;
+	userinfo.name = "user" + std::to_string(uid);
+	userinfo.pwd = "a1b2c3d4e5f6" + std::to_string(uid);
+	userinfo.email = userinfo.name + "@example.com";
+	userinfo.nick = "nick" + std::to_string(uid);
+	userinfo.desc = "hello";
+	userinfo.sex = uid % 2;
+	userinfo.icon = ":/res/head_" + std::to_string(uid % 5 + 1) + ".jpg";
+	return userinfo;
+}
+
+// 旧布局: 与改造前 ChatServer 写入的key一致
+static void oldLayout(int uid, bool online, std::vector<Command>& commands) {
+	auto userinfo = fakeUser(uid);
+	auto uid_str = std::to_string(uid);
+	Json::Value root;
+	root["uid"] = userinfo.uid;
+	root["pwd"] = userinfo.pwd;
+	root["name"] = userinfo.name;
+	root["email"] = userinfo.email;
+	root["nick"] = userinfo.nick;
+	root["desc"] = userinfo.desc;
+	root["sex"] = userinfo.sex;
+	root["icon"] = userinfo.icon;
+	commands.push_back({ "SET", USER_BASE_INFO + uid_str, root.toStyledString() });
+	root.removeMember("icon");
+	commands.push_back({ "SET", NAME_INFO + userinfo.name, root.toStyledString() });
+	// 退出时只删除 uip_ 和 server/sid，fence 一直保留
+	commands.push_back({ "HSET", USER_SESSION_PREFIX + uid_str, "fence", "3" });
+	if (online) {
+		commands.push_back({ "SET", USERIPPREFIX + uid_str, "chatserver1" });
+		commands.push_back({ "HSET", USER_SESSION_PREFIX + uid_str, "server", "chatserver1", "sid", "5f0c6d1e-8a3b-4c2d-9e7f-1a2b3c4d5e6f" });
+	}
+}
+
+static void newLayout(int uid, bool online, int ttl, std::vector<Command>& commands) {
+	auto userinfo = fakeUser(uid);
+	auto key = USER_HASH_PREFIX + std::to_string(uid);
+	commands.push_back({ "HSET", key, "v", USER_LAYOUT_VERSION, "fence", "1729000000003",
+		"profile", UserProfileCodec::Serialize(userinfo) });
+	if (online) {
+		commands.push_back({ "HSET", key, "server", "chatserver1", "sid", "5f0c6d1e-8a3b-4c2d-9e7f-1a2b3c4d5e6f" });
+	}
+	else {
+		commands.push_back({ "EXPIRE", key, std::to_string(ttl) });
+	}
+	commands.push_back({ "SET", USER_NAME_INDEX + userinfo.name, std::to_string(uid), "EX", std::to_string(ttl) });
+}
+
+// 写入一种布局的全部模拟用户，返回 used_memory 的增量，失败返回 -1
+template <typename Layout>
+static long long measure(redisContext* context, const Options& opts, Layout layout) {
+	long long before = usedMemory(context);
+	std::vector<Command> commands;
+	std::vector<redisReply*> replies;
+	for (int i = 0; i < opts.users; ++i) {
+		// uid 从较大的值开始，长度与真实uid相近
+		layout(1000000 + i, i % 100 < opts.online_pct, commands);
+		if (commands.size() >= opts.batch || i + 1 == opts.users) {
+			if (!pipeline(context, commands, replies)) {
+				return -1;
+			}
+			freeReplies(replies);
+			commands.clear();
+		}
+	}
+	long long after = usedMemory(context);
+	if (before < 0 || after < 0) {
+		return -1;
+	}
+	return after - before;
+}
+
+static bool flushDb(redisContext* context) {
+	auto* reply = command(context, { "FLUSHDB" });
+	bool ok = reply != nullptr && reply->type == REDIS_REPLY_STATUS;
+	if (reply != nullptr) {
+		freeReplyObject(reply);
+	}
+	return ok;
+}
+
+static int bench(const Options& opts) {
+	auto* context = connect(opts);
+	if (context == nullptr) {
+		return 1;
+	}
+
+	// 只在空库上测试，结束后用 FLUSHDB 清理
+	auto* reply = command(context, { "SELECT", std::to_string(opts.db) });
+	bool selected = reply != nullptr && reply->type == REDIS_REPLY_STATUS;
+	if (reply != nullptr) {
+		freeReplyObject(reply);
+	}
+	reply = selected ? command(context, { "DBSIZE" }) : nullptr;
+	bool empty = reply != nullptr && reply->type == REDIS_REPLY_INTEGER && reply->integer == 0;
+	if (reply != nullptr) {
+		freeReplyObject(reply);
+	}
+	if (!empty) {
+		std::cerr << "db " << opts.db << " is not empty or cannot be selected, choose another with --db" << std::endl;
+		redisFree(context);
+		return 1;
+	}
+
+	std::mt19937_64 engine(std::random_device{}());
+	long long old_bytes = measure(context, opts, [](int uid, bool online, std::vector<Command>& commands) {
+		oldLayout(uid, online, commands);
+		});
+	bool ok = flushDb(context);
+	long long new_bytes = ok ? measure(context, opts, [&](int uid, bool online, std::vector<Command>& commands) {
+		newLayout(uid, online, jitteredTtl(opts, engine), commands);
+		}) : -1;
+	ok = flushDb(context) && ok;
+	redisFree(context);
+
+	if (!ok || old_bytes < 0 || new_bytes < 0) {
+		std::cerr << "bench failed" << std::endl;
+		return 1;
+	}
+	std::cout << "users: " << opts.users << " online: " << opts.online_pct << "%" << std::endl;
+	std::cout << "old layout: " << old_bytes << " bytes, " << old_bytes / opts.users << " bytes/user" << std::endl;
+	std::cout << "new layout: " << new_bytes << " bytes, " << new_bytes / opts.users << " bytes/user" << std::endl;
+	if (new_bytes > 0) {
+		std::cout << "ratio: " << (double)old_bytes / new_bytes << "x" << std::endl;
+	}
+	return 0;
+}
+
+int main(int argc, char* argv[]) {
+	Options opts;
+	if (!parseOptions(argc, argv, opts)) {
+		usage();
+		return 2;
+	}
+	return opts.mode == "migrate" ? migrate(opts) : bench(opts);
+}
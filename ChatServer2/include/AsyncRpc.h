@@ -0,0 +1,110 @@
+#pragma once
+#include "const.h"
+#include <grpcpp/grpcpp.h>
+#include <functional>
+#include <future>
+#include <thread>
+#include <mutex>
+#include <chrono>
+
+// 投递到 CompletionQueue 的tag，轮询线程取出后回调并释放
+class AsyncCallBase {
+public:
+	virtual ~AsyncCallBase() {}
+	virtual void OnComplete() = 0;
+};
+
+// 一次一元异步调用的全部状态，生命周期从发起到轮询线程取回结果
+template <typename Rsp>
+class AsyncCall : public AsyncCallBase {
+public:
+	// 在轮询线程中执行，用于补全回包字段、记录错误，不要做阻塞操作
+	using Callback = std::function<void(const grpc::Status& status, Rsp& reply)>;
+
+	void OnComplete() override {
+		if (callback) {
+			callback(status, reply);
+		}
+		promise.set_value(std::move(reply));
+	}
+
+	grpc::ClientContext context;
+	grpc::Status status;
+	Rsp reply;
+	std::unique_ptr<grpc::ClientAsyncResponseReader<Rsp>> reader;
+	std::promise<Rsp> promise;
+	Callback callback;
+};
+
+// 不需要发rpc时直接返回已就绪的结果
+template <typename T>
+std::future<T> MakeReadyFuture(T value) {
+	std::promise<T> promise;
+	promise.set_value(std::move(value));
+	return promise.get_future();
+}
+
+// 一个 CompletionQueue 配一个轮询线程，调用方发起请求后立即拿到 future，不会阻塞
+class AsyncRpcQueue {
+public:
+	AsyncRpcQueue() : _b_stop(false) {
+		_thread = std::thread([this]() {
+			void* tag = nullptr;
+			bool ok = false;
+			while (_cq.Next(&tag, &ok)) {
+				auto* call = static_cast<AsyncCallBase*>(tag);
+				call->OnComplete();
+				delete call;
+			}
+			});
+	}
+
+	~AsyncRpcQueue() {
+		Close();
+	}
+
+	// prepare 形如 stub->PrepareAsyncXxx(context, request, cq)，超时由 timeout_ms 控制
+	template <typename Rsp, typename Req, typename Prepare>
+	std::future<Rsp> Call(const Req& request, int timeout_ms, Prepare prepare,
+		typename AsyncCall<Rsp>::Callback callback) {
+		auto* call = new AsyncCall<Rsp>();
+		call->callback = std::move(callback);
+		auto future = call->promise.get_future();
+		call->context.set_deadline(std::chrono::system_clock::now() + std::chrono::milliseconds(timeout_ms));
+
+		std::lock_guard<std::mutex> lock(_mutex);
+		// 队列已关闭时不能再投递，直接按调用失败处理
+		if (_b_stop) {
+			call->status = grpc::Status(grpc::StatusCode::UNAVAILABLE, "completion queue closed");
+			call->OnComplete();
+			delete call;
+			return future;
+		}
+
+		call->reader = prepare(&call->context, request, &_cq);
+		call->reader->StartCall();
+		call->reader->Finish(&call->reply, &call->status, call);
+		return future;
+	}
+
+	// 已发出的请求会在超时前全部回调完毕后再退出
+	void Close() {
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			if (_b_stop) {
+				return;
+			}
+			_b_stop = true;
+			_cq.Shutdown();
+		}
+		if (_thread.joinable()) {
+			_thread.join();
+		}
+	}
+
+private:
+	grpc::CompletionQueue _cq;
+	std::mutex _mutex;
+	bool _b_stop;
+	std::thread _thread;
+};
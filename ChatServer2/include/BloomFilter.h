@@ -0,0 +1,34 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+// 只增不删的布隆过滤器，位数组和哈希函数个数按预计元素数和误判率计算
+// 判断为不存在时一定不存在，判断为存在时有 fp_rate 左右的概率误判；
+// 位数组按64位原子整数存放，加入和查询可以在多个线程中并发进行，不需要加锁
+class BloomFilter
+{
+public:
+	BloomFilter(size_t expected, double fp_rate);
+
+	// 返回是否新置了位，已经加入过的元素不会重复计数
+	bool Add(const std::string& key);
+	bool MayContain(const std::string& key) const;
+
+	size_t BitCount() const { return _bits; }
+	int HashCount() const { return _hashes; }
+	// 已加入的不同元素数(与已有元素完全冲突的不计入)，超过预计元素数后误判率会上升
+	size_t Added() const { return _added; }
+	size_t Expected() const { return _expected; }
+
+private:
+	// 由一个64位哈希派生出 k 个位置(双重哈希)
+	static void hash(const std::string& key, uint64_t& h1, uint64_t& h2);
+
+	size_t _expected;
+	size_t _bits;
+	int _hashes;
+	std::unique_ptr<std::atomic<uint64_t>[]> _words;
+	std::atomic<size_t> _added;
+};
@@ -16,6 +16,10 @@ public:
 	shared_ptr<CSession> GetSession(std::string);
 	bool CheckValid(std::string);
 	void on_timer(const boost::system::error_code& ec);
+	//  LOAD_CHANNEL ͵ǰ on_timer ̵ö
+	void on_load_timer(const boost::system::error_code& ec);
+	// ѱۼƵ HINCRBY ˢredis
+	void on_count_timer(const boost::system::error_code& ec);
 	void StartTimer();
     void StopTimer();
     
@@ -28,5 +32,9 @@ private:
 	std::map<std::string, shared_ptr<CSession>> _sessions;
 	std::mutex _mutex;
 	boost::asio::steady_timer _timer;
+	boost::asio::steady_timer _load_timer;
+	boost::asio::steady_timer _count_timer;
+	// ϴˢľ _sessions һ _mutex 
+	int _count_delta;
 };
 
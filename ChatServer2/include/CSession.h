@@ -28,6 +28,9 @@ class CSession : public std::enable_shared_from_this<CSession>
     std::string &GetSessionId();
     void SetUserId(int uid);
     int GetUserId();
+    // 登录时拿到的 u_<uid> 所有权版本号
+    void SetFence(long long fence);
+    long long GetFence();
     void Start();
     void Send(char *msg, short max_length, short msgid);
     void Send(std::string msg, short msgid);
@@ -62,6 +65,7 @@ class CSession : public std::enable_shared_from_this<CSession>
     // 接收头部结构
     std::shared_ptr<MsgNode> _recv_head_node;
     int _user_uid;
+    std::atomic<long long> _fence;
     // 记录上次收到数据的时间
     std::atomic<time_t> _last_heartbeat;
     // session 锁
@@ -0,0 +1,46 @@
+#pragma once
+#include "const.h"
+#include <grpcpp/grpcpp.h>
+#include "message.grpc.pb.h"
+#include "message.pb.h"
+#include <deque>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+// 到一个对端ChatServer的长连接双向流，专门转发文本消息
+// 写线程在 flush 窗口内攒批，同一批只在最后一条触发真正的发送；
+// 对端每处理完一条就按顺序回一条确认，读线程据此弹出未确认队列。
+// 流不可用或未确认数达到窗口上限时 Send 返回false，由调用方改走一元rpc；
+// 流断开时尚未确认的消息交给 fallback 补发，对端可能重复收到(至少一次)
+class ChatStream {
+public:
+	using Fallback = std::function<void(const message::TextChatMsgReq&)>;
+	ChatStream(const std::string& name, const std::string& host, const std::string& port, Fallback fallback);
+	~ChatStream();
+	bool Send(const message::TextChatMsgReq& req);
+	void Close();
+private:
+	void run();
+	// 建立一次流并持续写入，直到流断开或停止
+	void serve(std::unique_ptr<message::ChatService::Stub>& stub);
+	void readLoop(grpc::ClientReaderWriter<message::TextChatMsgReq, message::TextChatMsgRsp>* stream);
+	// 断流后把未确认和未发送的消息交给 fallback
+	void drainToFallback();
+
+	std::string _name;
+	std::shared_ptr<grpc::Channel> _channel;
+	Fallback _fallback;
+	std::mutex _mutex;
+	std::condition_variable _cond;
+	// 等待写入的消息
+	std::deque<message::TextChatMsgReq> _pending;
+	// 已写入等待确认的消息，确认按写入顺序返回
+	std::deque<message::TextChatMsgReq> _inflight;
+	bool _ready;
+	bool _broken;
+	std::atomic<bool> _b_stop;
+	std::thread _thread;
+};
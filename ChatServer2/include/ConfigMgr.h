@@ -4,7 +4,10 @@
 #include <boost/property_tree/ini_parser.hpp>  
 #include <boost/filesystem.hpp>    
 #include <map>
+#include <vector>
+#include <memory>
 #include <iostream>
+#include "LoginToken.h"
 
 struct SectionInfo {
 	SectionInfo(){}
@@ -34,26 +37,140 @@ struct SectionInfo {
 		return _section_datas[key];
 	}
 
-	std::string GetValue(const std::string & key) {
-		if (_section_datas.find(key) == _section_datas.end()) {
+	std::string GetValue(const std::string & key) const {
+		auto iter = _section_datas.find(key);
+		if (iter == _section_datas.end()) {
 			return "";
 		}
-		// һЩ߽  
-		return _section_datas[key];
+		return iter->second;
 	}
 };
 
+// һredisƬĵַ
+struct RedisShardConfig {
+	std::string host;
+	int port = 0;
+	std::string pwd;
+};
+
+// MySQLֻĵַ˺źͿͬ
+struct MysqlReplicaConfig {
+	std::string host;
+	int port = 0;
+};
+
+// ԶChatServerĵַ
+struct PeerServerConfig {
+	std::string name;
+	std::string host;
+	std::string port;
+};
+
+// ǿãɺֻͨ shared_ptr ̼߳乲
+// ȸʱ滻գѾõɿյĵ߲Ӱ
+struct ServerConfig {
+	std::string self_name;
+	std::string self_host;
+	// дעĹڵӵĵַδʱ˻ self_host
+	std::string advertise_host;
+	int self_port = 0;
+	int rpc_port = 0;
+	// ڵɳصStatusServer ԸڵȨ
+	int capacity = 10000;
+	//  StatusServer ͸صļ()
+	int load_report_sec = 2;
+	// ڱۼƣ HINCRBY ˢredis()
+	int count_flush_ms = 1000;
+	// rpcĹ߳
+	int rpc_worker_threads = 4;
+	// ¼ʱȡϵб߳
+	int login_loader_threads = 4;
+
+	std::string redis_host;
+	int redis_port = 0;
+	std::string redis_pwd;
+	// 첽redisͻ˵Щˮ߷
+	int redis_async_conns = 2;
+	// ȫredisƬһΪ [Redis] ȫkeyͷ
+	std::vector<RedisShardConfig> redis_shards;
+	// һԹϣÿƬڵ
+	int redis_virtual_nodes = 160;
+
+	std::string mysql_host;
+	int mysql_port = 0;
+	std::string mysql_user;
+	std::string mysql_pwd;
+	std::string mysql_schema;
+	// ӳسפޣӵȴ()ӵĿлʱ()
+	int mysql_pool_min = 2;
+	int mysql_pool_max = 16;
+	int mysql_acquire_timeout_ms = 3000;
+	int mysql_idle_timeout_sec = 300;
+	// ֻΪʱд
+	std::vector<MysqlReplicaConfig> mysql_replicas;
+	// ûдʱ()Ķ⣬֤Լд
+	int mysql_sticky_ms = 2000;
+
+	std::string status_host;
+	std::string status_port;
+
+	std::vector<PeerServerConfig> peers;
+
+	size_t user_cache_capacity = 10000;
+	int user_cache_ttl = 300;
+	// ûhashûredisеĹʱ()İٷֱȣ
+	// ͬһʱдĿĹʱ̴⼯йںͬʱԴMySQL
+	int user_redis_ttl = 604800;
+	int user_redis_ttl_jitter = 10;
+	// ûϢԴݿ Redis Լʱ()0 ʾԼ
+	int user_load_lease = 2;
+	// ȴͷԼ()ԶСԼʱȲֱӲ⣬ʱռס߼߳
+	int user_load_wait_ms = 50;
+	// ûԹԤƵûʣĹʱ()Ŀ
+	size_t user_filter_expected = 1000000;
+	double user_filter_fp_rate = 0.01;
+	int user_negative_ttl = 30;
+	size_t user_negative_capacity = 100000;
+	int route_cache_ttl = 60;
+	// бͺбÿҳ¼ذֻһҳ
+	int friend_page_size = 20;
+	// ÿûϵ˱¼ͻ˰汾ڱõļ¼ʱȫͬ
+	int contact_log_size = 256;
+	// ںбĿ޺͹ʱ()
+	size_t friend_cache_capacity = 10000;
+	int friend_cache_ttl = 300;
+
+	// Զ֮ıϢ˫()δȷ
+	int chat_stream_flush_ms = 2;
+	int chat_stream_batch_size = 64;
+	int chat_stream_window = 1024;
+
+	// ԶһԪrpcĳʱʱ()
+	int rpc_timeout_ms = 3000;
+
+	// ¼tokenǩԿͬʱöԱֻ
+	LoginToken::Keys token_keys;
+
+	// ע͹ʱ()ʱӦΪ
+	int registry_heartbeat_sec = 5;
+	int registry_ttl_sec = 15;
+
+	// ԭʼsectionݣֲѯ
+	std::map<std::string, SectionInfo> sections;
+};
+
 class ConfigMgr
 {
 public:
 	~ConfigMgr() {
-		_config_map.clear();
 	}
 	SectionInfo operator[](const std::string& section) {
-		if (_config_map.find(section) == _config_map.end()) {
+		auto cfg = Snapshot();
+		auto iter = cfg->sections.find(section);
+		if (iter == cfg->sections.end()) {
 			return SectionInfo();
 		}
-		return _config_map[section];
+		return iter->second;
 	}
 
 
@@ -62,11 +179,12 @@ public:
 			return *this;
 		}
 
-		this->_config_map = src._config_map;
+		std::atomic_store(&_snapshot, src.Snapshot());
+		return *this;
 	};
 
 	ConfigMgr(const ConfigMgr& src) {
-		this->_config_map = src._config_map;
+		_snapshot = src.Snapshot();
 	}
 
 	static ConfigMgr& Inst() {
@@ -74,10 +192,18 @@ public:
 		return cfg_mgr;
 	}
 
+	// ȡǰÿգֻһԭӵüҲ
+	std::shared_ptr<const ServerConfig> Snapshot() const {
+		return std::atomic_load(&_snapshot);
+	}
+
+	// ¶ȡconfig.iniԭ滻գʧʱ
+	// ַӳصʱԴҪŻЧ
+	bool Reload();
+
 	std::string GetValue(const std::string& section, const std::string & key);
 private:
 	ConfigMgr();
-	// 洢sectionkey-valueԵmap  
-	std::map<std::string, SectionInfo> _config_map;
+	static std::shared_ptr<ServerConfig> load();
+	std::shared_ptr<const ServerConfig> _snapshot;
 };
-
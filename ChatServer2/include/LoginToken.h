@@ -0,0 +1,29 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <utility>
+
+// 登录token中携带的信息
+struct LoginTokenClaims {
+	int uid = 0;
+	std::string server;     // StatusServer 分配的ChatServer
+	long long expire = 0;   // 过期时刻，unix秒
+	std::string id;         // token的唯一id，吊销时按它拉黑
+};
+
+// 无状态的登录token: kid.uid.server.expire.id.sig
+// sig 为 HMAC-SHA256(密钥, 前面五段) 的十六进制，签发和校验都不需要访问redis；
+// kid 指明签名所用的密钥，轮换时校验方先加上新密钥，签发方再切换过去
+class LoginToken {
+public:
+	// 密钥列表 { kid, secret }
+	using Keys = std::vector<std::pair<std::string, std::string>>;
+
+	static std::string Sign(const std::string& kid, const std::string& secret, const LoginTokenClaims& claims);
+	// 只校验格式和签名，过期、uid、服务器和黑名单由调用方检查
+	static bool Parse(const std::string& token, const Keys& keys, LoginTokenClaims& claims);
+	// 解析配置 "kid1:secret1,kid2:secret2"，第一个为签发用的密钥
+	static Keys ParseKeys(const std::string& value);
+private:
+	static std::string hmac(const std::string& secret, const std::string& data);
+};
@@ -1,225 +1,14 @@
 #pragma once
 #include "const.h"
-#include <thread>
-#include <mysqlx/xdevapi.h>
-#include <condition_variable>
-#include <iostream>
+#include "MySqlPool.h"
 #include <atomic>
-#include "data.h"
+#include <chrono>
 #include <memory>
-#include <queue>
 #include <mutex>
-
-class SqlConnection {
-public:
-	SqlConnection(std::shared_ptr<mysqlx::Session> session, int64_t lasttime)
-		: _session(session), _last_oper_time(lasttime) {}
-	std::shared_ptr<mysqlx::Session> _session;
-	int64_t _last_oper_time;
-};
-
-class MySqlPool {
-public:
-	MySqlPool(const std::string& host, const std::string& port, const std::string& user, 
-			 const std::string& pass, const std::string& schema, int poolSize)
-		: host_(host), port_(port), user_(user), pass_(pass), schema_(schema), 
-		  poolSize_(poolSize), b_stop_(false), _fail_count(0) {
-		try {
-			for (int i = 0; i < poolSize_; ++i) {
-				auto session = mysqlx::Session(host_, std::stoi(port_), user_, pass_);
-				session.sql("USE " + schema_).execute();
-				
-				// 获取当前时间戳
-				auto currentTime = std::chrono::system_clock::now().time_since_epoch();
-				long long timestamp = std::chrono::duration_cast<std::chrono::seconds>(currentTime).count();
-
-                pool_.push(std::make_unique<SqlConnection>(
-                    std::make_shared<mysqlx::Session>(std::move(session)),
-                    timestamp));
-                spdlog::info("Mysql 连接建立成功: {}", i);
-			}
-
-			_check_thread = std::thread([this]() {
-				int count = 0;
-				while (!b_stop_) {
-					if (count >= 60) {
-						checkConnectionPro();
-						count = 0;            
-					}
-		
-					std::this_thread::sleep_for(std::chrono::seconds(1));
-					count++;
-				}
-			});
-
-			_check_thread.detach();
-		}
-		catch (const mysqlx::Error& e) {
-			spdlog::error("Mysql 连接池初始化失败, 错误: {}", e.what());
-		}
-	}
-
-	void checkConnection() {
-		std::lock_guard<std::mutex> guard(mutex_);
-		int poolsize = pool_.size();
-		auto currentTime = std::chrono::system_clock::now().time_since_epoch();
-		long long timestamp = std::chrono::duration_cast<std::chrono::seconds>(currentTime).count();
-		
-		for (int i = 0; i < poolsize; i++) {
-			auto con = std::move(pool_.front());
-			pool_.pop();
-			Defer defer([this, &con]() {
-				pool_.push(std::move(con));
-			});
-
-			if (timestamp - con->_last_oper_time < 5) {
-				continue;
-			}
-			
-			try {
-				con->_session->sql("SELECT 1").execute();
-				con->_last_oper_time = timestamp;
-			}
-			catch (const mysqlx::Error& e) {
-				spdlog::error("Mysql 连接检查失败, 错误: {}", e.what());
-				auto session = mysqlx::Session(host_, std::stoi(port_), user_, pass_);
-				session.sql("USE " + schema_).execute();
-				con->_session = std::make_shared<mysqlx::Session>(std::move(session));
-				con->_last_oper_time = timestamp;
-			}
-		}
-	}
-
-	void checkConnectionPro() {
-		size_t targetCount;
-		{
-			std::lock_guard<std::mutex> guard(mutex_);
-			targetCount = pool_.size();
-		}
-
-		size_t processed = 0;
-		auto now = std::chrono::system_clock::now().time_since_epoch();
-		long long timestamp = std::chrono::duration_cast<std::chrono::seconds>(now).count();
-
-		while (processed < targetCount) {
-			std::unique_ptr<SqlConnection> con;
-			{
-				std::lock_guard<std::mutex> guard(mutex_);
-				if (pool_.empty()) {
-					break;
-				}
-				con = std::move(pool_.front());
-				pool_.pop();
-			}
-
-			bool healthy = true;
-			if (timestamp - con->_last_oper_time >= 5) {
-				try {
-					con->_session->sql("SELECT 1").execute();
-					con->_last_oper_time = timestamp;
-				}
-				catch (const mysqlx::Error& e) {
-					spdlog::error("Mysql 连接检查失败, 错误: {}", e.what());
-					healthy = false;
-					_fail_count++;
-				}
-			}
-
-			if(healthy) {
-				std::lock_guard<std::mutex> guard(mutex_);
-				pool_.push(std::move(con));
-				cond_.notify_one();
-			}
-
-			++processed;
-		}
-
-		while (_fail_count > 0) {
-			auto b_res = reconnect(timestamp);
-			if (b_res) {
-				_fail_count--;
-			}
-			else {
-				break;
-			}
-		}
-	}
-
-	bool reconnect(long long timestamp) {
-		try {
-			auto session = mysqlx::Session(host_, std::stoi(port_), user_, pass_);
-			session.sql("USE " + schema_).execute();
-			auto newCon = std::make_unique<SqlConnection>(
-				std::make_shared<mysqlx::Session>(std::move(session)), 
-				timestamp
-			);
-			{
-				std::lock_guard<std::mutex> guard(mutex_);
-				pool_.push(std::move(newCon));
-			}
-
-			spdlog::info("Mysql 连接重建成功");
-			return true;
-		}
-		catch (const mysqlx::Error& e) {
-			spdlog::error("Mysql 连接重建失败, 错误: {}", e.what());
-			return false;
-		}
-	}
-
-	std::unique_ptr<SqlConnection> getConnection() {
-		std::unique_lock<std::mutex> lock(mutex_);
-		cond_.wait(lock, [this] { 
-			if (b_stop_) {
-				return true;
-			}        
-			return !pool_.empty(); 
-		});
-		
-		if (b_stop_) {
-			return nullptr;
-		}
-		
-		std::unique_ptr<SqlConnection> con(std::move(pool_.front()));
-		pool_.pop();
-		return con;
-	}
-
-	void returnConnection(std::unique_ptr<SqlConnection> con) {
-		std::unique_lock<std::mutex> lock(mutex_);
-		if (b_stop_) {
-			return;
-		}
-		pool_.push(std::move(con));
-		cond_.notify_one();
-	}
-
-	void Close() {
-		b_stop_ = true;
-		cond_.notify_all();
-	}
-
-	~MySqlPool() {
-		std::unique_lock<std::mutex> lock(mutex_);
-		while (!pool_.empty()) {
-			pool_.pop();
-		}
-	}
-
-private:
-	std::string host_;
-	std::string port_;
-	std::string user_;
-	std::string pass_;
-	std::string schema_;
-	int poolSize_;
-	std::queue<std::unique_ptr<SqlConnection>> pool_;
-	std::mutex mutex_;
-	std::condition_variable cond_;
-	std::atomic<bool> b_stop_;
-	std::thread _check_thread;
-	std::atomic<int> _fail_count;
-};
+#include <unordered_map>
+#include <vector>
+#include <iostream>
+#include "data.h"
 
 class MysqlDao
 {
@@ -233,12 +22,40 @@ public:
 	bool AddFriendApply(const int& from, const int& to);
 	bool AuthFriendApply(const int& from, const int& to);
 	bool AddFriend(const int& from, const int& to, std::string back_name);
-	std::shared_ptr<UserInfo> GetUser(int uid);
-	std::shared_ptr<UserInfo> GetUser(std::string name);
-	bool GetApplyList(int touid, std::vector<std::shared_ptr<ApplyInfo>>& applyList, int offset, int limit);
-	bool GetFriendList(int self_id, std::vector<std::shared_ptr<UserInfo>>& user_info);
+	// 查到时写入 user；连接池超时或出错返回 LOOKUP_ERROR，调用方不能当作不存在；用于回填缓存，走主库
+	LookupResult GetUser(int uid, std::shared_ptr<UserInfo>& user);
+	LookupResult GetUser(std::string name, std::shared_ptr<UserInfo>& user);
+	// 按 from_uid 升序取 after_uid 之后的最多 limit 条待处理的好友申请
+	bool GetApplyList(int touid, int after_uid, int limit, std::vector<std::shared_ptr<ApplyInfo>>& applyList);
+	// 增量同步用：按uid取指定的几条好友申请(不论是否已处理)，已不存在的不在结果中
+	bool GetApplyList(int touid, const std::vector<int>& from_uids, std::vector<std::shared_ptr<ApplyInfo>>& applyList);
+	// 按好友uid升序取全部好友的uid和备注，不带资料，用于回填缓存，走主库
+	bool GetFriendIds(int self_id, std::vector<FriendEntry>& friends);
+	// 一条语句批量查询基础信息，不存在的uid不在结果中；用于回填缓存，走主库
+	bool GetUsers(const std::vector<int>& uids, std::vector<std::shared_ptr<UserInfo>>& users);
+	// 把 friend_id 加为好友的所有用户
+	bool GetFriendOwners(int friend_id, std::vector<int>& owners);
+	bool ScanUsers(int after_uid, int limit, std::vector<std::pair<int, std::string>>& users);
 private:
+	// 读请求用的连接池：key 在粘滞窗口内写过时走主库，否则在可用的副本间轮询
+	MySqlPool& readPool(const std::string& key);
+	// 回填 Redis 缓存的读请求一律走主库：结果会按当前的联系人版本号或长 TTL 缓存，
+	// 别的服务器刚写入、本机不在粘滞窗口内时，副本的延迟会被固化到缓存里
+	MySqlPool& fillPool() { return *pool_; }
+	// 写之前调用，此后 sticky_ms_ 内涉及 key 的读请求都走主库
+	void markWrite(const std::string& key);
+	static std::string uidKey(int uid);
+	static std::string nameKey(const std::string& name);
+
+	// 主库，所有写请求都在这里执行
 	std::unique_ptr<MySqlPool> pool_;
+	std::vector<std::unique_ptr<MySqlPool>> replicas_;
+	std::atomic<size_t> next_replica_;
+	int sticky_ms_;
+	std::mutex sticky_mutex_;
+	std::unordered_map<std::string, std::chrono::steady_clock::time_point> sticky_;
+	// sticky_ 达到这个大小时清理一次过期的条目
+	size_t sticky_sweep_at_;
 };
 
 
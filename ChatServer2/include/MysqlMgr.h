@@ -15,11 +15,17 @@ public:
 	bool CheckPwd(const std::string& name, const std::string& pwd, UserInfo& userInfo);
 	bool AddFriendApply(const int& from, const int& to);
 	bool AuthFriendApply(const int& from, const int& to);
+	// 写入成功后同步更新好友列表缓存
 	bool AddFriend(const int& from, const int& to, std::string back_name);
-	std::shared_ptr<UserInfo> GetUser(int uid);
-	std::shared_ptr<UserInfo> GetUser(std::string name);
-	bool GetApplyList(int touid, std::vector<std::shared_ptr<ApplyInfo>>& applyList, int begin, int limit=10);
-	bool GetFriendList(int self_id, std::vector<std::shared_ptr<UserInfo> >& user_info);
+	LookupResult GetUser(int uid, std::shared_ptr<UserInfo>& user);
+	LookupResult GetUser(std::string name, std::shared_ptr<UserInfo>& user);
+	bool GetApplyList(int touid, int after_uid, int limit, std::vector<std::shared_ptr<ApplyInfo>>& applyList);
+	bool GetApplyList(int touid, const std::vector<int>& from_uids, std::vector<std::shared_ptr<ApplyInfo>>& applyList);
+	bool GetFriendIds(int self_id, std::vector<FriendEntry>& friends);
+	bool GetUsers(const std::vector<int>& uids, std::vector<std::shared_ptr<UserInfo>>& users);
+	bool GetFriendOwners(int friend_id, std::vector<int>& owners);
+	// 按uid升序取 after_uid 之后最多 limit 个用户的uid和用户名，用于加载用户存在性过滤器
+	bool ScanUsers(int after_uid, int limit, std::vector<std::pair<int, std::string>>& users);
 private:
 	MysqlMgr();
 	MysqlDao  _dao;
@@ -1,274 +1,110 @@
 #pragma once
 #include "const.h"
-#include <hiredis/hiredis.h>
-#include <condition_variable>
-#include <iostream>
-#include <thread>
-#include <chrono>
-#include <queue>
-#include <atomic>
+#include "AsyncRedis.h"
+#include "HashRing.h"
+#include "RedisScript.h"
+#include <future>
+#include <optional>
+#include <array>
 #include <mutex>
+#include <map>
+#include <unordered_map>
 #include "Singleton.h"
-class RedisConPool {
-public:
-	RedisConPool(size_t poolSize, const char* host, int port, const char* pwd)
-		: poolSize_(poolSize), host_(host), port_(port), b_stop_(false), pwd_(pwd), counter_(0), fail_count_(0){
-		for (size_t i = 0; i < poolSize_; ++i) {
-			auto* context = redisConnect(host, port);
-			if (context == nullptr || context->err != 0) {
-				if (context != nullptr) {
-					redisFree(context);
-				}
-				continue;
-			}
-
-			auto reply = (redisReply*)redisCommand(context, "AUTH %s", pwd);
-			if (reply->type == REDIS_REPLY_ERROR) {
-				spdlog::error("认证失败, 错误: {}", reply->str);
-				//执行成功后释放redisCommand执行后返回的redisReply所占用的内存
-				freeReplyObject(reply);
-				continue;
-			}
-
-			//执行成功后释放redisCommand执行后返回的redisReply所占用的内存
-			freeReplyObject(reply);
-			spdlog::info("Redis 认证成功");
-			connections_.push(context);
-		}
-
-		check_thread_ = std::thread([this]() {
-			while (!b_stop_) {
-				counter_++;
-				if (counter_ >= 60) {
-					checkThreadPro();
-					counter_ = 0;
-				}
-
-				std::this_thread::sleep_for(std::chrono::seconds(1)); // 每隔1秒检查一次
-			}	
-		});
-
-	}
-
-	~RedisConPool() {
-
-	}
-
-	void ClearConnections() {
-		std::lock_guard<std::mutex> lock(mutex_);
-		while (!connections_.empty()) {
-			auto* context = connections_.front();
-			redisFree(context);
-			connections_.pop();
-		}
-	}
-
-	redisContext* getConnection() {
-		std::unique_lock<std::mutex> lock(mutex_);
-		cond_.wait(lock, [this] { 
-			if (b_stop_) {
-				return true;
-			}
-			return !connections_.empty(); 
-			});
-		//如果停止了，直接返回空指针
-		if (b_stop_) {
-			return  nullptr;
-		}
-		auto* context = connections_.front();
-		connections_.pop();
-		return context;
-	}
-
-	redisContext* getConNonBlock() {
-		std::lock_guard<std::mutex> lock(mutex_);
-		if (b_stop_) {
-			return nullptr;
-		}
-
-		if (connections_.empty()) {
-			return nullptr;
-		}
-
-		auto* context = connections_.front();
-		connections_.pop();
-		return context;
-	}
+// 登录脚本的执行结果
+struct LoginSwapResult {
+	std::string old_server;   // 之前所在的服务器，为空表示之前未登录
+	std::string old_session;  // 之前的session id
+	std::string profile;      // 基础信息缓存(UserProfileCodec 编码)，为空表示缓存未命中
+	long long fence = 0;      // 本次登录拿到的所有权版本号，释放时凭此校验
+	long long contact_ver = 0;          // 当前的联系人版本号
+	int contact_sync = CONTACT_SYNC_FULL;  // 与客户端版本比较后的同步方式
+	std::vector<std::string> contact_changes;  // 增量同步时有变化的 a<uid>/f<uid>
+};
 
-	void returnConnection(redisContext* context) {
-		std::lock_guard<std::mutex> lock(mutex_);
-		if (b_stop_) {
-			return;
-		}
-		connections_.push(context);
-		cond_.notify_one();
-	}
+// 好友列表缓存的读取结果
+struct FriendsCache {
+	long long cver = 0;       // 读取时的联系人版本号，回填时凭此校验
+	bool hit = false;         // friends 是否为当前版本号下的好友列表
+	std::string friends;      // FriendListCache 的编码
+};
 
-	void Close() {
-		b_stop_ = true;
-		cond_.notify_all();
-		check_thread_.join();
+// 批量命令的构造器，Add 返回该命令的回复在结果中的下标
+class RedisBatch {
+public:
+	size_t Add(std::vector<std::string> args) {
+		_commands.push_back(std::move(args));
+		return _commands.size() - 1;
 	}
-
+	size_t Size() const { return _commands.size(); }
+	bool Empty() const { return _commands.empty(); }
 private:
-
-	void checkThreadPro() {
-		size_t pool_size;
-		{
-			//获取当前连接数
-			std::lock_guard<std::mutex> lock(mutex_);
-			pool_size = connections_.size();
-		}
-
-		for (int i = 0; i < pool_size && !b_stop_; i++) {
-			redisContext* context = nullptr;
-			//1.取出一个连接(非阻塞)
-			context = getConNonBlock();
-			if (context == nullptr) {
-				break;
-			}
-
-			redisReply* reply = nullptr;
-			try {
-				reply = (redisReply*)redisCommand(context, "PING");
-				//2.检查底层I/O协议层是否有错
-				if (context->err) {
-					spdlog::error("Redis 连接失败: {}", context->err);
-					if (reply) {
-						freeReplyObject(reply);
-					}
-
-					redisFree(context);
-					fail_count_++;
-					continue;
-				}
-
-				//3.检查Redis服务器返回的是否是ERROR
-				if (!reply || reply->type == REDIS_REPLY_ERROR) {
-					spdlog::error("Redis 连接失败: {}", reply->str);
-					if (reply) {
-						freeReplyObject(reply);
-					}
-
-					redisFree(context);
-					fail_count_++;
-					continue;
-				}
-
-				freeReplyObject(reply);
-				returnConnection(context);
-			}catch(std::exception& exp){
-				if (reply) {
-					freeReplyObject(reply);
-				}
-
-				redisFree(context);
-				fail_count_++;
-			}
-		}
-
-		//执行重连操作
-		while (fail_count_ > 0) {
-			auto res = reconnect();
-			if (res) {
-					fail_count_--;
-			}
-			else {
-				//等待下次检查
-				break;
-			}
-		}
-	}
-
-	bool reconnect() {
-		auto* context = redisConnect(host_, port_);
-		if (context == nullptr || context->err != 0) {
-			if (context != nullptr) {
-				redisFree(context);
-			}
-			return false;
-		}
-
-		auto reply = (redisReply*)redisCommand(context, "AUTH %s", pwd_);
-		if (reply->type == REDIS_REPLY_ERROR) {
-			spdlog::error("Redis 认证失败, 错误: {}", reply->str);
-			//执行释放操作
-			freeReplyObject(reply);
-			redisFree(context);
-			return false;
-		}
-
-		//执行成功后释放redisCommand执行后返回的redisReply所占用的内存
-		freeReplyObject(reply);
-		spdlog::info("Redis 认证成功");
-		returnConnection(context);
-		return true;
-	}
-
-	void checkThread() {
-		std::lock_guard<std::mutex> lock(mutex_);
-		if (b_stop_) {
-			return;
-		}
-		auto pool_size = connections_.size();
-		for (int i = 0; i < pool_size && !b_stop_; i++) {
-			auto* context = connections_.front();
-			connections_.pop();
-			try {
-				auto reply = (redisReply*)redisCommand(context, "PING");
-				if (!reply) {
-					spdlog::error("Redis 回复为空，连接失败");
-					connections_.push(context);
-					continue;
-				}
-				freeReplyObject(reply);
-				connections_.push(context);
-			}
-			catch(std::exception& exp){
-				spdlog::error("Redis 连接失败, 错误: {}", exp.what());
-				redisFree(context);
-				context = redisConnect(host_, port_);
-				if (context == nullptr || context->err != 0) {
-					if (context != nullptr) {
-						redisFree(context);
-					}
-					continue;
-				}
-
-				auto reply = (redisReply*)redisCommand(context, "AUTH %s", pwd_);
-				if (reply->type == REDIS_REPLY_ERROR) {
-					spdlog::error("Redis 认证失败, 错误: {}", reply->str);
-					//执行成功后释放redisCommand执行后返回的redisReply所占用的内存
-					freeReplyObject(reply);
-					continue;
-				}
-
-				//执行成功后释放redisCommand执行后返回的redisReply所占用的内存
-				freeReplyObject(reply);
-				spdlog::info("Redis 认证成功");
-				connections_.push(context);
-			}
-		}
-	}
-	std::atomic<bool> b_stop_;
-	size_t poolSize_;
-	const char* host_;
-	const char* pwd_;
-	int port_;
-	std::queue<redisContext*> connections_;
-	std::mutex mutex_;
-	std::condition_variable cond_;
-	std::thread  check_thread_;
-	int counter_;
-	std::atomic<int> fail_count_;
+	friend class RedisMgr;
+	std::vector<std::vector<std::string>> _commands;
 };
 
-class RedisMgr: public Singleton<RedisMgr>, 
+// 所有命令都经由 AsyncRedis 在少量长连接上流水线发送
+// 配置了多个分片时按key的哈希标签在一致性哈希环上选择分片，每个分片各自持有连接；
+// 一个uid的会话所有权和基础信息都在 u_<uid> 一个hash中，登录、退出只需单key脚本；
+// StatusServer 也要读写的全局key，以及不带key的 PUBLISH 固定发往第一个分片
+// XxxAsync 返回的 future 在redis回复后就绪，同名的同步接口等价于 XxxAsync(...).get()；
+// future 在连接线程中完成，不要在 AsyncRedis 的回调里调用同步接口
+class RedisMgr: public Singleton<RedisMgr>,
 	public std::enable_shared_from_this<RedisMgr>
 {
 	friend class Singleton<RedisMgr>;
 public:
 	~RedisMgr();
+	// 执行任意命令，返回原始回复
+	std::future<RedisValue> CommandAsync(std::vector<std::string> args);
+	// 以 EVALSHA 执行脚本，返回原始回复；脚本按第一个key选择分片
+	std::future<RedisValue> EvalAsync(const RedisScript& script, std::vector<std::string> keys,
+		std::vector<std::string> args);
+
+	std::future<std::optional<std::string>> GetAsync(const std::string& key);
+	std::future<bool> SetAsync(const std::string& key, const std::string& value);
+	std::future<bool> LPushAsync(const std::string& key, const std::string& value);
+	std::future<std::optional<std::string>> LPopAsync(const std::string& key);
+	std::future<bool> RPushAsync(const std::string& key, const std::string& value);
+	std::future<std::optional<std::string>> RPopAsync(const std::string& key);
+	std::future<bool> HSetAsync(const std::string& key, const std::string& hkey, const std::string& value);
+	// 不存在时返回空字符串
+	std::future<std::string> HGetAsync(const std::string& key, const std::string& hkey);
+	std::future<bool> HDelAsync(const std::string& key, const std::string& field);
+	std::future<bool> DelAsync(const std::string& key);
+	std::future<bool> ExistsKeyAsync(const std::string& key);
+	std::future<bool> PublishAsync(const std::string& channel, const std::string& message);
+	std::future<std::optional<LoginSwapResult>> LoginSwapAsync(int uid, const std::string& server_name,
+		const std::string& session_id, long long contact_ver);
+	std::future<bool> ReleaseSessionAsync(int uid, long long fence);
+	// 用户所在的服务器，不在线或出错时为空
+	std::future<std::optional<std::string>> GetRouteAsync(int uid);
+	// 当前结构版本的 profile，未命中或出错时为空
+	std::future<std::optional<std::string>> GetProfileAsync(int uid);
+	std::future<bool> SetProfileAsync(int uid, const std::string& profile);
+	// 按uid批量读取 profile，结果与 uids 一一对应
+	std::future<std::vector<std::optional<std::string>>> GetProfilesAsync(const std::vector<int>& uids);
+	std::future<std::optional<FriendsCache>> GetFriendsAsync(int uid);
+	std::future<bool> SetFriendsAsync(int uid, long long cver, const std::string& friends);
+	// 返回自增后的联系人版本号，出错时为空
+	std::future<std::optional<long long>> BumpContactAsync(int uid, std::vector<std::string> changes);
+	std::future<std::optional<int>> GetNameIndexAsync(const std::string& name);
+	std::future<bool> SetNameIndexAsync(const std::string& name, int uid);
+	std::future<bool> RegistryHeartbeatAsync(const std::string& name, const std::string& info, int ttl_ms);
+	std::future<bool> RegistryLeaveAsync(const std::string& name);
+	std::future<std::optional<std::map<std::string, std::string>>> RegistryMembersAsync();
+	std::future<bool> RevokeTokenAsync(const std::string& id, long long expire);
+	std::future<std::optional<std::unordered_map<std::string, long long>>> GetTokenDenyListAsync(long long now);
+	std::future<std::optional<long long>> HIncrByAsync(const std::string& key, const std::string& hkey, long long delta);
+	std::future<bool> IncrCountAsync(const std::string& server_name, long long delta);
+
+	// 一次往返执行整批命令，回复按加入顺序返回，单条命令失败时对应位置为 ERROR
+	std::future<std::vector<RedisValue>> ExecAsync(RedisBatch batch);
+	// 结果与 keys/fields 一一对应，不存在或出错的位置为空
+	std::future<std::vector<std::optional<std::string>>> MGetAsync(const std::vector<std::string>& keys);
+	std::future<bool> MSetAsync(const std::vector<std::pair<std::string, std::string>>& values);
+	std::future<std::vector<std::optional<std::string>>> HMGetAsync(const std::string& key,
+		const std::vector<std::string>& fields);
+
 	bool Get(const std::string &key, std::string& value);
 	bool Set(const std::string &key, const std::string &value);
 	bool LPush(const std::string &key, const std::string &value);
@@ -281,22 +117,120 @@ public:
 	bool HDel(const std::string& key, const std::string& field);
 	bool Del(const std::string &key);
 	bool ExistsKey(const std::string &key);
+	bool Publish(const std::string& channel, const std::string& message);
+	std::vector<RedisValue> Exec(RedisBatch batch);
+	std::vector<std::optional<std::string>> MGet(const std::vector<std::string>& keys);
+	bool MSet(const std::vector<std::pair<std::string, std::string>>& values);
+	std::vector<std::optional<std::string>> HMGet(const std::string& key, const std::vector<std::string>& fields);
+	// 输出本周期各类批量操作的大小分布并清零，由定时器周期性调用
+	void LogBatchStats();
 	void Close() {
-		_con_pool->Close();
-		_con_pool->ClearConnections();
+		for (auto& shard : _shards) {
+			shard->Close();
+		}
 	}
 
+	// 加锁需要等待释放通知，只提供同步接口
 	std::string acquireLock(const std::string& lockName,
 		int lockTimeout, int acquireTimeout);
 
 	bool releaseLock(const std::string& lockName,
 		const std::string& identifier);
 
-	void IncreaseCount(std::string server_name);
-	void DecreaseCount(std::string server_name);
+	// 一次往返完成登录：原子切换 u_<uid> 中的会话所有权，并取回基础信息，token 由调用方先在本地验签；
+	// contact_ver 是客户端上次同步到的联系人版本号，同时比较出联系人的同步方式和有变化的条目
+	bool LoginSwap(int uid, const std::string& server_name,
+		const std::string& session_id, long long contact_ver, LoginSwapResult& result);
+	// 仅当 fence 仍是本次登录的版本号时释放会话，u_<uid> 随后按抖动后的TTL过期，返回是否释放
+	bool ReleaseSession(int uid, long long fence);
+	bool GetRoute(int uid, std::string& server);
+
+	// 基础信息存放在 u_<uid> 的 profile 字段，离线用户的 hash 写入时续期
+	bool GetProfile(int uid, std::string& profile);
+	bool SetProfile(int uid, const std::string& profile);
+	std::vector<std::optional<std::string>> GetProfiles(const std::vector<int>& uids);
+	// 好友列表缓存在 u_<uid> 的 friends 字段，写入时的联系人版本号记在 fver，
+	// 联系人有任何变化 cver 随之自增，fver 不等于 cver 的 friends 按未命中处理
+	bool GetFriends(int uid, FriendsCache& cache);
+	// 仅当 cver 仍是读取时的版本号才写入，避免用变化之前从数据库读到的列表覆盖
+	bool SetFriends(int uid, long long cver, const std::string& friends);
+	// 记录 uid 的联系人变化并自增版本号，changes 为 a<uid>(好友申请)/f<uid>(好友)
+	bool BumpContact(int uid, const std::vector<std::string>& changes);
+	// 用户名 -> uid 索引 un_<name>，带抖动后的TTL
+	bool GetNameIndex(const std::string& name, int& uid);
+	bool SetNameIndex(const std::string& name, int uid);
+
+	// 续约注册中心中本节点的心跳，首次加入时广播 join
+	bool RegistryHeartbeat(const std::string& name, const std::string& info, int ttl_ms);
+	// 从注册中心注销本节点并广播 leave
+	bool RegistryLeave(const std::string& name);
+	// 清理心跳过期的节点，返回存活节点 name -> info
+	bool RegistryMembers(std::map<std::string, std::string>& members);
+
+	// 把token加入黑名单并广播，expire 之后条目自动失效
+	bool RevokeToken(const std::string& id, long long expire);
+	// 清理过期条目并加载未过期的黑名单 id -> expire
+	bool GetTokenDenyList(long long now, std::unordered_map<std::string, long long>& denied);
+
+	// HINCRBY，value 返回增减之后的值
+	bool HIncrBy(const std::string& key, const std::string& hkey, long long delta, long long& value);
+	// 按差值增减本服务器的连接数
+	bool IncrCount(const std::string& server_name, long long delta);
 	void InitCount(std::string server_name);
 	void DelCount(std::string server_name);
 private:
 	RedisMgr();
-	unique_ptr<RedisConPool>  _con_pool;
-};
\ No newline at end of file
+	// key 所在的分片
+	AsyncRedis* shardFor(const std::string& key);
+	// 命令所在的分片，按命令的第一个key选择，没有key的命令发往第一个分片
+	AsyncRedis* route(const std::vector<std::string>& args);
+	// 计算哈希用的标签: {} 中的内容，或按uid归类的key中的uid，否则为整个key
+	static std::string keyTag(const std::string& key);
+	// 命令按分片分组成批发送，全部回复到齐后按原顺序回调
+	void execSharded(std::vector<std::vector<std::string>> commands, AsyncRedis::BatchCallback callback);
+
+	// 先发 EVALSHA，回复 NOSCRIPT 时在同一分片上改用 EVAL 重发
+	void eval(const RedisScript& script, std::vector<std::string> keys, std::vector<std::string> args,
+		AsyncRedis::Callback callback);
+
+	// 执行脚本并在连接线程中把回复转换成 T
+	template <typename T, typename Transform>
+	std::future<T> evalAsync(const RedisScript& script, std::vector<std::string> keys,
+		std::vector<std::string> args, Transform transform) {
+		auto promise = std::make_shared<std::promise<T>>();
+		auto future = promise->get_future();
+		eval(script, std::move(keys), std::move(args), [promise, transform](const RedisValue& reply) {
+			promise->set_value(transform(reply));
+			});
+		return future;
+	}
+
+	// 发送命令并在连接线程中把回复转换成 T
+	template <typename T, typename Transform>
+	std::future<T> commandAsync(std::vector<std::string> args, Transform transform) {
+		auto promise = std::make_shared<std::promise<T>>();
+		auto future = promise->get_future();
+		auto* shard = route(args);
+		shard->Command(std::move(args), [promise, transform](const RedisValue& reply) {
+			promise->set_value(transform(reply));
+			});
+		return future;
+	}
+	// 按批量操作的类型记录一次批量的大小
+	void recordBatch(const std::string& kind, size_t size);
+
+	// 批量大小分布各个桶的上界，最后一个桶收纳所有更大的批量
+	static constexpr std::array<size_t, 8> BATCH_BOUNDS = { 1, 2, 4, 8, 16, 64, 256, SIZE_MAX };
+	struct BatchStats {
+		uint64_t count = 0;
+		uint64_t total = 0;
+		size_t max = 0;
+		std::array<uint64_t, BATCH_BOUNDS.size()> buckets{};
+	};
+
+	// 下标与配置中的 redis_shards 一一对应
+	std::vector<std::unique_ptr<AsyncRedis>> _shards;
+	std::unique_ptr<HashRing> _ring;
+	std::mutex _batch_mutex;
+	std::map<std::string, BatchStats> _batch_stats;
+};
@@ -0,0 +1,55 @@
+#pragma once
+#include "const.h"
+#include "Singleton.h"
+#include <hiredis/hiredis.h>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+#include <string>
+#include <thread>
+#include <chrono>
+#include <atomic>
+#include <mutex>
+
+// Redis 发布订阅的接收端
+// 每个分片使用一条独立的连接，由一个后台线程统一 poll，所有读写都在该线程内完成；
+// 分片之间的发布互不可见，脚本会在key所在的分片上发布，所以每个分片都要订阅同样的频道；
+// 其他线程只登记回调，由后台线程负责发送 SUBSCRIBE 并在断线后重新订阅
+class RedisSubscriber : public Singleton<RedisSubscriber>
+{
+	friend class Singleton<RedisSubscriber>;
+public:
+	using Handler = std::function<void(const std::string& channel, const std::string& message)>;
+	~RedisSubscriber();
+	// 订阅频道，回调在订阅线程中执行，不要在回调里做阻塞操作
+	void Subscribe(const std::string& channel, Handler handler);
+	void Close();
+private:
+	// 一个分片上的订阅连接
+	struct Link {
+		std::string host;
+		int port = 0;
+		std::string pwd;
+		redisContext* context = nullptr;
+		// 已登记但还未在这条连接上发送 SUBSCRIBE 的频道
+		std::vector<std::string> pending;
+		// 连接失败后下次重试的时刻
+		std::chrono::steady_clock::time_point retry_at;
+	};
+
+	RedisSubscriber();
+	void run();
+	bool connect(Link& link);
+	// 发送待订阅的频道，写失败返回false
+	bool flushPending(Link& link);
+	// 读取并分发已到达的消息，连接出错返回false
+	bool readMessages(Link& link);
+	void disconnect(Link& link);
+	void dispatch(redisReply* reply);
+
+	std::vector<Link> _links;
+	std::mutex _mutex;
+	std::unordered_map<std::string, std::vector<Handler>> _handlers;
+	std::atomic<bool> _b_stop;
+	std::thread _thread;
+};
@@ -0,0 +1,46 @@
+#pragma once
+#include "const.h"
+#include "Singleton.h"
+#include <unordered_map>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <string>
+
+// uid -> 所在ChatServer 的本地路由表，位于 Redis u_<uid> 的 server 字段之前
+// 登录/退出脚本会在 ROUTE_CHANNEL 上发布 "uid,server"，收到后直接更新已缓存的条目，
+// 热点用户的消息投递不再需要访问 Redis；条目带过期时间，防止订阅断开期间漏掉通知
+class RouteCache : public Singleton<RouteCache>
+{
+	friend class Singleton<RouteCache>;
+public:
+	~RouteCache();
+	// 查询uid所在的服务器，不在线返回false
+	bool GetRoute(int uid, std::string& server);
+	// 本服务器名称，启动时从配置读取一次
+	const std::string& SelfName() const {
+		return _self_name;
+	}
+	// 按缓存路由投递时发现用户已不在，删除条目并记录一次过期路由
+	void MarkStale(int uid);
+	// 输出命中率并清理过期条目，由定时器周期性调用
+	void LogStats();
+private:
+	RouteCache();
+	void onRoute(const std::string& message);
+	std::chrono::steady_clock::time_point expireTime();
+
+	struct Entry {
+		std::string server;   // 为空表示不在线
+		std::chrono::steady_clock::time_point expire;
+	};
+	std::string _self_name;
+	std::mutex _mutex;
+	std::unordered_map<int, Entry> _routes;
+	// 每收到一次路由通知加一，用于丢弃查询 Redis 期间已经过期的结果
+	std::atomic<uint64_t> _version;
+
+	std::atomic<uint64_t> _hits;
+	std::atomic<uint64_t> _misses;
+	std::atomic<uint64_t> _stale;
+};
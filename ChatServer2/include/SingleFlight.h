@@ -0,0 +1,65 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <unordered_map>
+
+// 合并对同一个键的并发加载
+// 第一个调用者在自己的线程里执行加载，加载期间到达的调用者等待并共享它的结果；
+// 加载结束即删除条目，之后的调用重新加载，结果的缓存由调用方负责；
+// loader 中不能再以同一个键调用 Do，否则会等待自己
+template <typename Key, typename Value>
+class SingleFlight
+{
+public:
+	SingleFlight() : _loads(0), _shared(0) {}
+
+	// loader 抛出的异常同样传给所有等待者
+	Value Do(const Key& key, const std::function<Value()>& loader) {
+		std::promise<Value> promise;
+		std::shared_future<Value> future;
+		bool leader = false;
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			auto iter = _flights.find(key);
+			if (iter != _flights.end()) {
+				future = iter->second;
+				_shared++;
+			}
+			else {
+				future = promise.get_future().share();
+				_flights.emplace(key, future);
+				leader = true;
+				_loads++;
+			}
+		}
+		if (!leader) {
+			return future.get();
+		}
+
+		try {
+			promise.set_value(loader());
+		}
+		catch (...) {
+			promise.set_exception(std::current_exception());
+		}
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_flights.erase(key);
+		}
+		return future.get();
+	}
+
+	// 实际执行的加载次数和搭便车的调用次数
+	uint64_t Loads() const { return _loads; }
+	uint64_t Shared() const { return _shared; }
+
+private:
+	std::mutex _mutex;
+	std::unordered_map<Key, std::shared_future<Value>> _flights;
+	std::atomic<uint64_t> _loads;
+	std::atomic<uint64_t> _shared;
+};
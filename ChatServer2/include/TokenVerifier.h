@@ -0,0 +1,35 @@
+#pragma once
+#include "const.h"
+#include "Singleton.h"
+#include "LoginToken.h"
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+// 在本地校验 StatusServer 签发的登录token，登录路径上不再读写redis
+// 黑名单启动时从redis加载，之后通过 TOKEN_DENY_CHANNEL 增量同步，条目在token过期后清理
+class TokenVerifier : public Singleton<TokenVerifier>
+{
+	friend class Singleton<TokenVerifier>;
+public:
+	// 订阅吊销通知并加载黑名单，加载失败时由 Purge 重试
+	void Init();
+	// 校验签名、uid、目标服务器、有效期和黑名单，成功返回 ErrorCodes::Success
+	int Verify(const std::string& token, int uid, LoginTokenClaims& claims);
+	// 吊销token，本地立即生效，写入redis不等待结果，所有ChatServer都会收到通知；
+	// 登录成功后吊销所用的token，同一个token不能再次登录
+	void Revoke(const LoginTokenClaims& claims);
+	// 清理已过期的黑名单条目，启动时加载失败的话重新加载，由定时器调用
+	void Purge();
+private:
+	TokenVerifier() : _loaded(false) {}
+	bool isDenied(const std::string& id);
+	// 从redis加载未过期的黑名单，与本地已有的条目合并
+	bool load();
+
+	std::mutex _mutex;
+	// token id -> 过期时刻
+	std::unordered_map<std::string, long long> _denied;
+	std::atomic<bool> _loaded;
+};
@@ -0,0 +1,118 @@
+#pragma once
+#include "const.h"
+#include "Singleton.h"
+#include "BloomFilter.h"
+#include <atomic>
+#include <chrono>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <boost/asio/thread_pool.hpp>
+
+// 按 uid 和用户名搜索用户时的存在性过滤，拦截查不到的请求，不让它们回源 MySQL
+// 布隆过滤器记录所有已注册的 uid 和用户名：启动时从 MySQL 分页加载，之后由 GateServer 的注册通知增量加入，
+// 定时器再补扫一次新注册的用户，防止订阅断开期间漏掉通知；加载完成前不做拦截；
+// 布隆过滤器放过但最终没有查到的 uid 和用户名进入短期的负缓存，收到注册通知时从负缓存中删除
+class UserExistFilter : public Singleton<UserExistFilter>
+{
+	friend class Singleton<UserExistFilter>;
+public:
+	~UserExistFilter();
+	// 订阅注册通知并加载全部用户
+	void Init();
+	// 补扫上次加载之后注册的用户，由定时器周期性调用；启动加载失败时在这里重新加载
+	// 补扫是分页的 MySQL 查询，投递到过滤器自己的线程执行，立即返回；上一次还没结束时跳过
+	void Refresh();
+	// 返回false时该用户一定不存在(或者刚刚确认过不存在)，无需再查询；
+	// 含非 ASCII 字节的用户名总是放行，见 normalizeName
+	bool MayExist(int uid);
+	bool MayExist(const std::string& name);
+	// 查询前取得当前的注册纪元，查询后连同结果一起交给 MarkMissing
+	uint64_t Epoch() { return _epoch; }
+	// 完整查询后仍未找到时调用，含非 ASCII 字节的用户名不记录；
+	// 查询期间收到过注册通知(纪元变了)时不记录，否则刚注册的用户可能在通知之后又被写回负缓存
+	void MarkMissing(int uid, uint64_t epoch);
+	void MarkMissing(const std::string& name, uint64_t epoch);
+	// 输出拦截次数等统计信息，由定时器周期性调用
+	void LogStats();
+private:
+	UserExistFilter();
+	void onRegistered(int uid, const std::string& name);
+	void refresh();
+	// 从 after_uid 之后分页加载直到读完，返回是否全部加载成功
+	bool load(int after_uid);
+	// MySQL 默认的排序规则比较用户名时不区分大小写且忽略尾部空格，过滤器按同样的规则归一化，避免误拦；
+	// 只折叠 ASCII 大小写，非 ASCII 字符在排序规则下还有重音、全半角等等价关系，无法在这里复现，
+	// 含非 ASCII 字节的用户名不经过滤器和负缓存，直接查询
+	static std::string normalizeName(const std::string& name);
+	static bool isAscii(const std::string& name);
+	static std::string uidKey(int uid);
+
+	// 固定 TTL 的负缓存，先写入的先过期，按写入顺序淘汰
+	template <typename Key>
+	class MissingSet {
+	public:
+		bool Contains(const Key& key, std::chrono::steady_clock::time_point now) {
+			auto iter = _index.find(key);
+			if (iter == _index.end()) {
+				return false;
+			}
+			if (iter->second->second <= now) {
+				_order.erase(iter->second);
+				_index.erase(iter);
+				return false;
+			}
+			return true;
+		}
+		void Insert(const Key& key, std::chrono::steady_clock::time_point expire, size_t capacity) {
+			Erase(key);
+			_order.emplace_back(key, expire);
+			_index[key] = std::prev(_order.end());
+			auto now = std::chrono::steady_clock::now();
+			while (!_order.empty() && (_index.size() > capacity || _order.front().second <= now)) {
+				_index.erase(_order.front().first);
+				_order.pop_front();
+			}
+		}
+		void Erase(const Key& key) {
+			auto iter = _index.find(key);
+			if (iter == _index.end()) {
+				return;
+			}
+			_order.erase(iter->second);
+			_index.erase(iter);
+		}
+		size_t Size() const { return _index.size(); }
+	private:
+		using Order = std::list<std::pair<Key, std::chrono::steady_clock::time_point>>;
+		Order _order;
+		std::unordered_map<Key, typename Order::iterator> _index;
+	};
+
+	// 每次分页加载的用户数
+	static const int LOAD_PAGE = 10000;
+	// 补扫时回退的 uid 数，覆盖提交顺序与 uid 顺序不一致的少量注册
+	static const int REFRESH_OVERLAP = 100;
+
+	// uid 和用户名共用一个过滤器，uid 加前缀 "#" 区分
+	std::unique_ptr<BloomFilter> _bloom;
+	std::atomic<bool> _ready;
+	// 已加载的最大 uid，补扫从这里开始
+	std::atomic<int> _max_uid;
+	std::mutex _load_mutex;
+	// 执行补扫的单线程池，_refreshing 为true时已有补扫在排队或执行
+	boost::asio::thread_pool _refresher;
+	std::atomic<bool> _refreshing;
+
+	std::mutex _mutex;
+	// 每收到一次注册通知加一，在 _mutex 下修改
+	std::atomic<uint64_t> _epoch;
+	MissingSet<int> _missing_uids;
+	MissingSet<std::string> _missing_names;
+
+	std::atomic<uint64_t> _bloom_rejects;
+	std::atomic<uint64_t> _negative_hits;
+	std::atomic<uint64_t> _passed;
+};
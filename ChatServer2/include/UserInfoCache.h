@@ -0,0 +1,92 @@
+#pragma once
+#include "const.h"
+#include "Singleton.h"
+#include "data.h"
+#include "SingleFlight.h"
+#include <list>
+#include <unordered_map>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <functional>
+
+// 进程内的用户基础信息缓存(L1)，位于 Redis u_<uid> 的 profile 字段之前
+// 按 uid 分片的 LRU，每个条目带过期时间；
+// 其他进程修改 profile 后通过 USER_INFO_INVALIDATE 频道广播 uid，收到后删除本地条目；
+// 本地未命中时同一个 uid/用户名 只有一个调用者回源，Redis 也未命中时再以 Redis 租约在服务器之间合并查库
+class UserInfoCache : public Singleton<UserInfoCache>
+{
+	friend class Singleton<UserInfoCache>;
+public:
+	~UserInfoCache();
+	// 依次查询本地缓存、Redis、MySQL，返回的是一份拷贝，调用者可以随意修改
+	bool GetBaseInfo(int uid, std::shared_ptr<UserInfo>& userinfo);
+	// 批量查询，每一层只访问一次：本地未命中的一次往返读 Redis，Redis 也未命中的一条语句查 MySQL；
+	// 不存在的uid不在结果中，只有查询 MySQL 失败时返回false
+	bool GetBaseInfos(const std::vector<int>& uids, std::unordered_map<int, std::shared_ptr<UserInfo>>& infos);
+	// 先经 un_<name> 索引换成 uid 再按 uid 查询，索引未命中时按用户名查 MySQL 并回填索引
+	bool GetBaseInfoByName(const std::string& name, std::shared_ptr<UserInfo>& userinfo);
+	// 同上，但区分确认不存在与查询失败，只有 MySQL 确认没有这条记录时才返回 LOOKUP_NOT_FOUND；
+	// Redis 出错按未命中继续查库，由 MySQL 给出结论
+	LookupResult LookupBaseInfo(int uid, std::shared_ptr<UserInfo>& userinfo);
+	LookupResult LookupBaseInfoByName(const std::string& name, std::shared_ptr<UserInfo>& userinfo);
+	// 将已经拿到的最新用户信息放入本地缓存，调用方自己保证数据不早于最近一次失效
+	void Put(const std::shared_ptr<const UserInfo>& userinfo);
+	// 删除本地条目并通知其他服务器删除，修改 profile 后调用
+	void Invalidate(int uid);
+	// 输出命中率等统计信息，由定时器周期性调用
+	void LogStats();
+private:
+	UserInfoCache();
+	bool getLocal(int uid, std::shared_ptr<UserInfo>& userinfo);
+	uint64_t versionOf(int uid);
+	// 分片的版本号仍是 version 时才写入，回源期间收到过失效通知则放弃，避免旧资料在本地留满 TTL
+	void put(const std::shared_ptr<const UserInfo>& userinfo, uint64_t version);
+	void erase(int uid);
+	// 回源的结果，info 只在 result 为 LOOKUP_FOUND 时有效
+	struct Loaded {
+		LookupResult result;
+		std::shared_ptr<const UserInfo> info;
+	};
+	// 本地未命中后的回源，由 SingleFlight 保证同一个键同时只有一个调用者执行
+	Loaded loadByUid(int uid);
+	Loaded loadByName(const std::string& name);
+	// 持有租约时查数据库：拿到租约后先用 reread 重读 Redis，别的服务器刚回填过就不再查库；
+	// 等不到租约时不再等待，直接查库，租约只用来削峰
+	Loaded loadLeased(const std::string& lease_name,
+		const std::function<std::shared_ptr<UserInfo>()>& reread,
+		const std::function<Loaded()>& load);
+
+	struct Entry {
+		std::shared_ptr<const UserInfo> info;
+		std::chrono::steady_clock::time_point expire;
+	};
+	using LruList = std::list<std::pair<int, Entry>>;
+	struct Shard {
+		std::mutex mutex;
+		LruList lru;       // 头部是最近使用的条目
+		std::unordered_map<int, LruList::iterator> index;
+		// 分片内任一条目失效时加一
+		uint64_t version = 0;
+	};
+	static const int SHARD_COUNT = 16;
+
+	Shard& shardOf(int uid) {
+		return _shards[static_cast<unsigned int>(uid) % SHARD_COUNT];
+	}
+
+	Shard _shards[SHARD_COUNT];
+	size_t _shard_capacity;
+	SingleFlight<int, Loaded> _uid_flight;
+	SingleFlight<std::string, Loaded> _name_flight;
+
+	std::atomic<uint64_t> _hits;
+	std::atomic<uint64_t> _misses;
+	std::atomic<uint64_t> _evictions;
+	std::atomic<uint64_t> _invalidations;
+	// 等租约超时后直接查库的次数
+	std::atomic<uint64_t> _lease_timeouts;
+};
@@ -13,6 +13,12 @@ struct UserInfo {
 	std::string back;
 };
 
+// 好友关系中的一条：好友的uid和给好友的备注
+struct FriendEntry {
+	int uid;
+	std::string back;
+};
+
 struct ApplyInfo {
 	ApplyInfo(int uid, std::string name, std::string desc,
 		std::string icon, std::string nick, int sex, int status)
@@ -3,13 +3,22 @@
 #include "ConfigMgr.h"
 #include "RedisMgr.h"
 #include "UserMgr.h"
+#include "UserInfoCache.h"
+#include "FriendListCache.h"
 #include <iostream>
 
+#include "RouteCache.h"
+#include "RpcMetrics.h"
+#include "TokenVerifier.h"
+#include "UserExistFilter.h"
 CServer::CServer(boost::asio::io_context &io_context, short port)
     : _io_context(io_context),
       _port(port),
       _acceptor(io_context, tcp::endpoint(tcp::v4(), port)),
-      _timer(_io_context, std::chrono::seconds(60))
+      _timer(_io_context, std::chrono::seconds(60)),
+      _load_timer(_io_context),
+      _count_timer(_io_context),
+      _count_delta(0)
 {
     // 打印服务器启动信息
     spdlog::info("ChatServer2 启动成功, 正在监听端口 : {}", _port);
@@ -29,6 +38,7 @@ void CServer::HandleAccept(shared_ptr<CSession> new_session, const boost::system
         new_session->Start();
         lock_guard<mutex> lock(_mutex);
         _sessions.insert(make_pair(new_session->GetSessionId(), new_session));
+        _count_delta++;
     } else {
         // 打印连接建立失败信息
         spdlog::error("Tcp长连接建立失败:accept fail {}", error.what());
@@ -59,7 +69,9 @@ void CServer::ClearSession(std::string session_id)
         UserMgr::GetInstance()->RmvUserSession(uid, session_id);
     }
 
-    _sessions.erase(session_id);
+    if (_sessions.erase(session_id) > 0) {
+        _count_delta--;
+    }
 }
 
 // 根据用户id获取session
@@ -92,12 +104,13 @@ void CServer::on_timer(const boost::system::error_code &ec)
     }
 
     std::vector<std::shared_ptr<CSession>> _expired_sessions;
-    int session_count = 0;
 
     std::map<std::string, shared_ptr<CSession>> sessions_copy;
     {
         lock_guard<mutex> lock(_mutex);
         sessions_copy = _sessions;
+        // 下面用快照整体校准，快照之前的增减不能再刷一次
+        _count_delta = 0;
     }
 
     time_t now = std::time(nullptr);
@@ -108,19 +121,32 @@ void CServer::on_timer(const boost::system::error_code &ec)
             iter->second->Close();
             // 记录过期session信息
             _expired_sessions.push_back(iter->second);
-            continue;
         }
-        session_count++;
     }
 
-    // 上报session数量
-    auto &cfg = ConfigMgr::Inst();
-    auto self_name = cfg["SelfServer"]["Name"];
-    auto count_str = std::to_string(session_count);
+    // 校准session数量，平时的增减由 on_count_timer 刷新
+    // 过期的session稍后清理时会再计一次减少，所以这里按快照总数校准
+    auto cfg = ConfigMgr::Inst().Snapshot();
+    auto &self_name = cfg->self_name;
+    auto count_str = std::to_string(sessions_copy.size());
     // 打印定时器上报信息
     spdlog::info("定时器上报ChatServer2 的连接数到redis中，当前连接数: {}", count_str);
     RedisMgr::GetInstance()->HSet(LOGIN_COUNT, self_name, count_str);
 
+    // 输出本地用户信息缓存、好友列表缓存和路由缓存的命中率
+    UserInfoCache::GetInstance()->LogStats();
+    FriendListCache::GetInstance()->LogStats();
+    RouteCache::GetInstance()->LogStats();
+    // 输出各rpc接口的调用次数和耗时
+    RpcMetrics::GetInstance()->LogStats();
+    // 输出redis批量操作的大小分布
+    RedisMgr::GetInstance()->LogBatchStats();
+    // 清理已过期的token黑名单条目，启动时没有加载成功的话重新加载
+    TokenVerifier::GetInstance()->Purge();
+    // 补扫新注册的用户(投递到过滤器自己的线程，不占用io线程)并输出存在性过滤的拦截次数
+    UserExistFilter::GetInstance()->Refresh();
+    UserExistFilter::GetInstance()->LogStats();
+
     // 处理异常session，防止资源泄漏
     for (auto &session : _expired_sessions) {
         session->DealExceptionSession();
@@ -133,6 +159,56 @@ void CServer::on_timer(const boost::system::error_code &ec)
     });
 }
 
+void CServer::on_load_timer(const boost::system::error_code &ec)
+{
+    if (ec) {
+        return;
+    }
+
+    size_t session_count = 0;
+    {
+        lock_guard<mutex> lock(_mutex);
+        session_count = _sessions.size();
+    }
+
+    // 消息内容为 "name,连接数,容量"，StatusServer 据此维护内存中的负载表
+    auto cfg = ConfigMgr::Inst().Snapshot();
+    RedisMgr::GetInstance()->Publish(LOAD_CHANNEL, cfg->self_name + "," + std::to_string(session_count)
+        + "," + std::to_string(cfg->capacity));
+
+    _load_timer.expires_after(std::chrono::seconds(cfg->load_report_sec));
+    auto self(shared_from_this());
+    _load_timer.async_wait([self](boost::system::error_code ec) {
+        self->on_load_timer(ec);
+    });
+}
+
+void CServer::on_count_timer(const boost::system::error_code &ec)
+{
+    if (ec) {
+        return;
+    }
+
+    int delta = 0;
+    {
+        lock_guard<mutex> lock(_mutex);
+        std::swap(delta, _count_delta);
+    }
+
+    auto cfg = ConfigMgr::Inst().Snapshot();
+    if (delta != 0 && !RedisMgr::GetInstance()->IncrCount(cfg->self_name, delta)) {
+        // 刷新失败时把差值放回去，下次一起刷
+        lock_guard<mutex> lock(_mutex);
+        _count_delta += delta;
+    }
+
+    _count_timer.expires_after(std::chrono::milliseconds(cfg->count_flush_ms));
+    auto self(shared_from_this());
+    _count_timer.async_wait([self](boost::system::error_code ec) {
+        self->on_count_timer(ec);
+    });
+}
+
 void CServer::StartTimer()
 {
     // 启动定时器
@@ -140,9 +216,20 @@ void CServer::StartTimer()
     _timer.async_wait([self](boost::system::error_code ec) {
         self->on_timer(ec);
     });
+    // 负载上报立即开始，StatusServer 不必等第一个周期
+    _load_timer.expires_after(std::chrono::seconds(0));
+    _load_timer.async_wait([self](boost::system::error_code ec) {
+        self->on_load_timer(ec);
+    });
+    _count_timer.expires_after(std::chrono::milliseconds(ConfigMgr::Inst().Snapshot()->count_flush_ms));
+    _count_timer.async_wait([self](boost::system::error_code ec) {
+        self->on_count_timer(ec);
+    });
 }
 
 void CServer::StopTimer()
 {
     _timer.cancel();
+    _load_timer.cancel();
+    _count_timer.cancel();
 }
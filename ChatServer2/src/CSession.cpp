@@ -9,7 +9,7 @@
 #include <json/value.h>
 #include <sstream>
 
-CSession::CSession(boost::asio::io_context &io_context, CServer *server) : _socket(io_context), _server(server), _b_close(false), _b_head_parse(false), _user_uid(0)
+CSession::CSession(boost::asio::io_context &io_context, CServer *server) : _socket(io_context), _server(server), _b_close(false), _b_head_parse(false), _user_uid(0), _fence(0)
 {
     boost::uuids::uuid a_uuid = boost::uuids::random_generator()();
     _session_id = boost::uuids::to_string(a_uuid);
@@ -41,6 +41,16 @@ int CSession::GetUserId()
     return _user_uid;
 }
 
+void CSession::SetFence(long long fence)
+{
+    _fence = fence;
+}
+
+long long CSession::GetFence()
+{
+    return _fence;
+}
+
 void CSession::Start()
 {
     AsyncReadHead(HEAD_TOTAL_LEN);
@@ -289,30 +299,16 @@ void CSession::UpdateHeartbeat()
 void CSession::DealExceptionSession()
 {
     auto self = shared_from_this();
-    // 处理异常session
-    auto uid_str = std::to_string(_user_uid);
-    auto lock_key = LOCK_PREFIX + uid_str;
-    auto identifier = RedisMgr::GetInstance()->acquireLock(lock_key, LOCK_TIME_OUT, ACQUIRE_TIME_OUT);
-    Defer defer([identifier, lock_key, self, this]() {
-        _server->ClearSession(_session_id);
-        RedisMgr::GetInstance()->releaseLock(lock_key, identifier);
-    });
-
-    if (identifier.empty()) {
-        return;
-    }
-    std::string redis_session_id = "";
-    auto bsuccess = RedisMgr::GetInstance()->Get(USER_SESSION_PREFIX + uid_str, redis_session_id);
-    if (!bsuccess) {
-        return;
-    }
+    Defer defer([self, this]()
+                { _server->ClearSession(_session_id); });
 
-    if (redis_session_id != _session_id) {
-        // 说明有其他客户端连接，当前连接应该断开
+    if (_user_uid == 0)
+    {
         return;
     }
 
-    RedisMgr::GetInstance()->Del(USER_SESSION_PREFIX + uid_str);
-    // 清理用户登录信息
-    RedisMgr::GetInstance()->Del(USERIPPREFIX + uid_str);
+    // 处理异常session: 只有 u_<uid> 的 fence 仍是本session登录时拿到的版本号才释放
+    // 比较与删除在同一个Lua脚本中完成，若其他地方已重新登录则 fence 已变化，不会误删
+    // 这里运行在会话的io线程上，redis 连接也由这些线程驱动，只投递不等待结果
+    RedisMgr::GetInstance()->ReleaseSessionAsync(_user_uid, _fence);
 }
@@ -6,11 +6,17 @@
 #include <ostream>
 #include <thread>
 #include <mutex>
+#include <functional>
 #include "AsioIOServicePool.h"
 #include "CServer.h"
 #include "ConfigMgr.h"
 #include "RedisMgr.h"
+#include "RedisSubscriber.h"
 #include "ChatServiceImpl.h"
+#include "ChatGrpcClient.h"
+#include "ServiceRegistry.h"
+#include "TokenVerifier.h"
+#include "UserExistFilter.h"
 #include "const.h"
 
 using namespace std;
@@ -28,32 +34,41 @@ std::mutex mutex_quit;
 */
 int main()
 {	
-	auto& cfg = ConfigMgr::Inst();
-	auto server_name = cfg["SelfServer"]["Name"];
+	auto cfg = ConfigMgr::Inst().Snapshot();
+	auto server_name = cfg->self_name;
 	try {
 		auto pool = AsioIOServicePool::GetInstance();
         // 将登录数设置为0
         spdlog::info("ChatServer2 初始化设置登陆数为 0");
 		RedisMgr::GetInstance()->HSet(LOGIN_COUNT, server_name, "0");
+        // 加载token黑名单，之后登录时在本地验签
+        TokenVerifier::GetInstance()->Init();
+        // 加载已注册用户的存在性过滤器，之后搜索不存在的用户时不再查询数据库
+        UserExistFilter::GetInstance()->Init();
 
-        Defer derfer([server_name]()
+        Defer derfer([server_name, pool]()
             {
 				RedisMgr::GetInstance()->HDel(LOGIN_COUNT, server_name);
+				// 先注销，其他节点不再往这里转发消息
+				ServiceRegistry::GetInstance()->Close();
+				ChatGrpcClient::GetInstance()->Close();
+				RedisSubscriber::GetInstance()->Close();
 				RedisMgr::GetInstance()->Close();
+				// redis 连接由 io 线程池驱动，关闭 redis 之后才能停止线程池
+				pool->Stop();
 			}
 		);
 
-        spdlog::info("ChatServer2 : cfg SelfServer Port {}", cfg["SelfServer"]["Port"]);
-        auto port_str = cfg["SelfServer"]["Port"];
+        spdlog::info("ChatServer2 : cfg SelfServer Port {}", cfg->self_port);
 
         boost::asio::io_context io_context;
 		//创建Cserver智能指针------>这里开启了监听客户端主动的tcp连接请求
-		auto pointer_server = std::make_shared<CServer>(io_context, atoi(port_str.c_str()));
+		auto pointer_server = std::make_shared<CServer>(io_context, cfg->self_port);
 		//启动定时器
 		pointer_server->StartTimer();
 
 		//定义一个GrpcServer
-		std::string server_address(cfg["SelfServer"]["Host"] + ":" + cfg["SelfServer"]["RPCPort"]);
+		std::string server_address(cfg->self_host + ":" + std::to_string(cfg->rpc_port));
 		ChatServiceImpl service;
 		grpc::ServerBuilder builder;
 		// 监听端口和添加服务
@@ -65,6 +80,17 @@ int main()
 		// 打印服务器地址
 		spdlog::info("ChatServer2 RPC 正在监听端口：{}", server_address);
 
+		// rpc服务已就绪，注册到注册中心，并随成员变化增减对端
+		ServiceRegistry::GetInstance()->Watch([](const ChatNode& node, bool joined) {
+			if (joined) {
+				ChatGrpcClient::GetInstance()->AddPeer(node.name, node.host, node.rpc_port);
+			}
+			else {
+				ChatGrpcClient::GetInstance()->RemovePeer(node.name);
+			}
+			});
+		ServiceRegistry::GetInstance()->Start();
+
 		//单独启动一个线程处理grpc服务
 		std::thread  grpc_server_thread([&server]() {
 				server->Wait();
@@ -72,11 +98,22 @@ int main()
 
 	
 		boost::asio::signal_set signals(io_context, SIGINT, SIGTERM);
-		signals.async_wait([&io_context, pool, &server](auto, auto) {
+		signals.async_wait([&io_context, &server](auto, auto) {
 			io_context.stop();
-			pool->Stop();
 			server->Shutdown();
 			});
+
+		// SIGHUP 触发配置热更新，处理完后继续等待下一次信号
+		boost::asio::signal_set reload_signals(io_context, SIGHUP);
+		std::function<void(const boost::system::error_code&, int)> on_reload;
+		on_reload = [&reload_signals, &on_reload](const boost::system::error_code& ec, int) {
+			if (ec) {
+				return;
+			}
+			ConfigMgr::Inst().Reload();
+			reload_signals.async_wait(on_reload);
+			};
+		reload_signals.async_wait(on_reload);
 		
 	
 		//将Cserver注册给逻辑类方便以后清除连接
@@ -84,6 +121,8 @@ int main()
 		io_context.run();
 
 		grpc_server_thread.join();
+		// gRPC服务器已关闭，不会再有新的请求投递到工作线程
+		service.Shutdown();
 		pointer_server->StopTimer();
 		return 0;
 	}
@@ -1,23 +1,32 @@
 #include "ConfigMgr.h"
 #include "const.h"
+#include <sstream>
+#include <algorithm>
+
 ConfigMgr::ConfigMgr(){
+    _snapshot = load();
+}
+
+std::shared_ptr<ServerConfig> ConfigMgr::load() {
     // 获取当前工作目录  
     boost::filesystem::path current_path = boost::filesystem::current_path();
     // 构造config.ini文件的完整路径  
     boost::filesystem::path config_path = current_path / "config.ini";
-	// 打印配置文件路径
     spdlog::info("配置文件路径: {}", config_path.string());
 
     // 使用Boost.PropertyTree读取INI文件  
     boost::property_tree::ptree pt;
     boost::property_tree::read_ini(config_path.string(), pt);
 
+    auto cfg = std::make_shared<ServerConfig>();
+    auto& config_map = cfg->sections;
+
     // 遍历INI文件中的所有section  
     for (const auto& section_pair : pt) {
         const std::string& section_name = section_pair.first;
         const boost::property_tree::ptree& section_tree = section_pair.second;
 
-        // 遍历每个section下所有的key-value对  
+        // 遍历每个section下的所有key-value对  
         std::map<std::string, std::string> section_config;
         for (const auto& key_value_pair : section_tree) {
             const std::string& key = key_value_pair.first;
@@ -27,11 +36,11 @@ ConfigMgr::ConfigMgr(){
         SectionInfo sectionInfo;
         sectionInfo._section_datas = section_config;
         // 将section的key-value对存入config_map中  
-        _config_map[section_name] = sectionInfo;
+        config_map[section_name] = sectionInfo;
     }
 
-    // 打印所有section的key-value对  
-    for (const auto& section_entry : _config_map) {
+    // 打印所有section的key-value
+    for (const auto& section_entry : config_map) {
         const std::string& section_name = section_entry.first;
         SectionInfo section_config = section_entry.second;
         spdlog::info("section: {}", section_name);
@@ -40,12 +49,147 @@ ConfigMgr::ConfigMgr(){
         }
     }
 
+    // 解析成强类型字段，之后的读取不再需要查表
+    auto value = [&config_map](const std::string& section, const std::string& key) {
+        auto iter = config_map.find(section);
+        if (iter == config_map.end()) {
+            return std::string();
+        }
+        return iter->second.GetValue(key);
+    };
+    auto int_value = [&value](const std::string& section, const std::string& key, int def) {
+        auto str = value(section, key);
+        return str.empty() ? def : atoi(str.c_str());
+    };
+
+    cfg->self_name = value("SelfServer", "Name");
+    cfg->self_host = value("SelfServer", "Host");
+    cfg->advertise_host = value("SelfServer", "AdvertiseHost");
+    if (cfg->advertise_host.empty()) {
+        // 监听全部网卡时没法直接作为对端地址，退回本机回环地址
+        cfg->advertise_host = cfg->self_host == "0.0.0.0" ? "127.0.0.1" : cfg->self_host;
+    }
+    cfg->self_port = int_value("SelfServer", "Port", 0);
+    cfg->rpc_port = int_value("SelfServer", "RPCPort", 0);
+    cfg->rpc_worker_threads = int_value("SelfServer", "RPCWorkers", 4);
+    cfg->login_loader_threads = int_value("SelfServer", "LoginLoaders", 4);
+    cfg->capacity = std::max(1, int_value("SelfServer", "Capacity", 10000));
+    cfg->load_report_sec = std::max(1, int_value("SelfServer", "LoadReportSec", 2));
+    cfg->count_flush_ms = std::max(10, int_value("SelfServer", "CountFlushMs", 1000));
+
+    cfg->redis_host = value("Redis", "Host");
+    cfg->redis_port = int_value("Redis", "Port", 6379);
+    cfg->redis_pwd = value("Redis", "Passwd");
+    cfg->redis_async_conns = std::max(1, int_value("Redis", "AsyncConns", 2));
+    cfg->redis_virtual_nodes = std::max(1, int_value("Redis", "VirtualNodes", 160));
+    // Shards 中以逗号分隔列出其余分片的section名，未配置时只有 [Redis] 一个分片
+    cfg->redis_shards.push_back(RedisShardConfig{ cfg->redis_host, cfg->redis_port, cfg->redis_pwd });
+    std::stringstream shard_ss(value("Redis", "Shards"));
+    std::string shard_name;
+    while (std::getline(shard_ss, shard_name, ',')) {
+        RedisShardConfig shard;
+        shard.host = value(shard_name, "Host");
+        if (shard.host.empty()) {
+            continue;
+        }
+        shard.port = int_value(shard_name, "Port", 6379);
+        shard.pwd = value(shard_name, "Passwd");
+        cfg->redis_shards.push_back(shard);
+    }
+
+    cfg->mysql_host = value("Mysql", "Host");
+    cfg->mysql_port = int_value("Mysql", "Port", 33060);
+    cfg->mysql_user = value("Mysql", "User");
+    cfg->mysql_pwd = value("Mysql", "Passwd");
+    cfg->mysql_schema = value("Mysql", "Schema");
+    cfg->mysql_pool_min = std::max(0, int_value("Mysql", "MinConns", 2));
+    cfg->mysql_pool_max = std::max(1, int_value("Mysql", "MaxConns", 16));
+    cfg->mysql_acquire_timeout_ms = std::max(1, int_value("Mysql", "AcquireTimeoutMs", 3000));
+    cfg->mysql_idle_timeout_sec = std::max(1, int_value("Mysql", "IdleTimeoutSec", 300));
+    cfg->mysql_sticky_ms = std::max(0, int_value("Mysql", "StickyMs", 2000));
+    // Replicas 中以逗号分隔列出只读副本的section名
+    std::stringstream replica_ss(value("Mysql", "Replicas"));
+    std::string replica_name;
+    while (std::getline(replica_ss, replica_name, ',')) {
+        MysqlReplicaConfig replica;
+        replica.host = value(replica_name, "Host");
+        if (replica.host.empty()) {
+            continue;
+        }
+        replica.port = int_value(replica_name, "Port", 33060);
+        cfg->mysql_replicas.push_back(replica);
+    }
+
+    cfg->status_host = value("StatusServer", "Host");
+    cfg->status_port = value("StatusServer", "Port");
+
+    // PeerServer 中以逗号分隔列出对端的section名
+    std::stringstream ss(value("PeerServer", "Servers"));
+    std::string word;
+    while (std::getline(ss, word, ',')) {
+        PeerServerConfig peer;
+        peer.name = value(word, "Name");
+        if (peer.name.empty()) {
+            continue;
+        }
+        peer.host = value(word, "Host");
+        peer.port = value(word, "Port");
+        cfg->peers.push_back(peer);
+    }
+
+    cfg->user_cache_capacity = int_value("UserCache", "Capacity", 10000);
+    cfg->user_cache_ttl = int_value("UserCache", "TTL", 300);
+    cfg->user_redis_ttl = std::max(1, int_value("UserCache", "RedisTTL", 604800));
+    cfg->user_redis_ttl_jitter = std::min(50, std::max(0, int_value("UserCache", "RedisTTLJitter", 10)));
+    cfg->user_load_lease = std::max(0, int_value("UserCache", "LoadLease", 2));
+    cfg->user_load_wait_ms = std::max(0, int_value("UserCache", "LoadWaitMs", 50));
+    cfg->user_filter_expected = std::max(1, int_value("UserFilter", "ExpectedUsers", 1000000));
+    auto fp_rate = value("UserFilter", "FalsePositive");
+    cfg->user_filter_fp_rate = fp_rate.empty() ? 0.01 : atof(fp_rate.c_str());
+    cfg->user_negative_ttl = int_value("UserFilter", "NegativeTTL", 30);
+    cfg->user_negative_capacity = std::max(1, int_value("UserFilter", "NegativeCapacity", 100000));
+    cfg->route_cache_ttl = int_value("RouteCache", "TTL", 60);
+    cfg->friend_page_size = std::min(100, std::max(1, int_value("FriendList", "PageSize", 20)));
+    cfg->contact_log_size = std::max(1, int_value("FriendList", "ChangeLog", 256));
+    cfg->friend_cache_capacity = int_value("FriendList", "CacheCapacity", 10000);
+    cfg->friend_cache_ttl = int_value("FriendList", "CacheTTL", 300);
+    cfg->chat_stream_flush_ms = int_value("ChatStream", "FlushMs", 2);
+    cfg->chat_stream_batch_size = int_value("ChatStream", "BatchSize", 64);
+    cfg->chat_stream_window = int_value("ChatStream", "Window", 1024);
+    cfg->rpc_timeout_ms = int_value("PeerServer", "TimeoutMs", 3000);
+    cfg->token_keys = LoginToken::ParseKeys(value("Token", "Keys"));
+    if (cfg->token_keys.empty()) {
+        spdlog::error("未配置登录token密钥 [Token] Keys，所有登录都会被拒绝");
+    }
+    cfg->registry_heartbeat_sec = std::max(1, int_value("Registry", "HeartbeatSec", 5));
+    cfg->registry_ttl_sec = std::max(cfg->registry_heartbeat_sec * 2, int_value("Registry", "TTLSec", 15));
+    return cfg;
+}
+
+bool ConfigMgr::Reload() {
+    try {
+        auto cfg = load();
+        auto old_cfg = Snapshot();
+        if (cfg->self_name != old_cfg->self_name) {
+            spdlog::warn("配置热更新不支持修改服务器名称 {} -> {}, 重启后生效", old_cfg->self_name, cfg->self_name);
+            cfg->self_name = old_cfg->self_name;
+        }
+        std::atomic_store(&_snapshot, std::shared_ptr<const ServerConfig>(cfg));
+        spdlog::info("配置热更新完成");
+        return true;
+    }
+    catch (std::exception& exp) {
+        spdlog::error("配置热更新失败，继续使用旧配置: {}", exp.what());
+        return false;
+    }
 }
 
 std::string ConfigMgr::GetValue(const std::string& section, const std::string& key) {
-	if (_config_map.find(section) == _config_map.end()) {
-		return "";
-	}
+    auto cfg = Snapshot();
+    auto iter = cfg->sections.find(section);
+    if (iter == cfg->sections.end()) {
+        return "";
+    }
 
-	return _config_map[section].GetValue(key);
-}
\ No newline at end of file
+    return iter->second.GetValue(key);
+}
@@ -0,0 +1,261 @@
+#include "FriendListCache.h"
+#include "ConfigMgr.h"
+#include "RedisMgr.h"
+#include "RedisSubscriber.h"
+#include "MysqlMgr.h"
+#include <algorithm>
+#include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/io/zero_copy_stream_impl_lite.h>
+#include <google/protobuf/wire_format_lite.h>
+
+using google::protobuf::io::CodedInputStream;
+using google::protobuf::io::CodedOutputStream;
+using google::protobuf::io::StringOutputStream;
+using google::protobuf::internal::WireFormatLite;
+
+enum FriendListField {
+	FIELD_UID_DELTA = 1,
+	FIELD_BACK = 2,
+};
+
+FriendListCache::FriendListCache() : _shard_capacity(0),
+	_hits(0), _misses(0), _evictions(0), _invalidations(0) {
+	auto cfg = ConfigMgr::Inst().Snapshot();
+	_self_name = cfg->self_name;
+	_shard_capacity = cfg->friend_cache_capacity / SHARD_COUNT;
+	if (_shard_capacity == 0) {
+		_shard_capacity = 1;
+	}
+
+	// 订阅失效通知，消息内容是 uid,服务器名
+	RedisSubscriber::GetInstance()->Subscribe(FRIEND_LIST_INVALIDATE,
+		[this](const std::string&, const std::string& message) {
+			auto pos = message.find(',');
+			if (pos != std::string::npos && message.substr(pos + 1) == _self_name) {
+				return;
+			}
+			try {
+				erase(std::stoi(message.substr(0, pos)));
+			}
+			catch (std::exception& exp) {
+				spdlog::error("好友列表失效通知格式错误: {} {}", message, exp.what());
+			}
+		});
+}
+
+FriendListCache::~FriendListCache() {
+
+}
+
+bool FriendListCache::getLocal(int uid, std::shared_ptr<const FriendList>& friends) {
+	auto& shard = shardOf(uid);
+	std::lock_guard<std::mutex> lock(shard.mutex);
+	auto iter = shard.index.find(uid);
+	if (iter == shard.index.end()) {
+		return false;
+	}
+
+	if (iter->second->second.expire <= std::chrono::steady_clock::now()) {
+		shard.lru.erase(iter->second);
+		shard.index.erase(iter);
+		return false;
+	}
+
+	// 移到头部，标记为最近使用；列表本身不可修改，直接共享
+	shard.lru.splice(shard.lru.begin(), shard.lru, iter->second);
+	friends = iter->second->second.friends;
+	return true;
+}
+
+uint64_t FriendListCache::versionOf(int uid) {
+	auto& shard = shardOf(uid);
+	std::lock_guard<std::mutex> lock(shard.mutex);
+	return shard.version;
+}
+
+void FriendListCache::put(int uid, std::shared_ptr<const FriendList> friends, uint64_t version) {
+	auto ttl = std::chrono::seconds(ConfigMgr::Inst().Snapshot()->friend_cache_ttl);
+	Entry entry{ std::move(friends), std::chrono::steady_clock::now() + ttl };
+
+	auto& shard = shardOf(uid);
+	std::lock_guard<std::mutex> lock(shard.mutex);
+	if (shard.version != version) {
+		return;
+	}
+	auto iter = shard.index.find(uid);
+	if (iter != shard.index.end()) {
+		iter->second->second = std::move(entry);
+		shard.lru.splice(shard.lru.begin(), shard.lru, iter->second);
+		return;
+	}
+
+	shard.lru.emplace_front(uid, std::move(entry));
+	shard.index[uid] = shard.lru.begin();
+	// 超出容量淘汰最久未使用的条目
+	while (shard.index.size() > _shard_capacity) {
+		shard.index.erase(shard.lru.back().first);
+		shard.lru.pop_back();
+		_evictions++;
+	}
+}
+
+void FriendListCache::erase(int uid) {
+	auto& shard = shardOf(uid);
+	std::lock_guard<std::mutex> lock(shard.mutex);
+	// 没有条目也要加一，正在回源的查询可能马上写入
+	shard.version++;
+	auto iter = shard.index.find(uid);
+	if (iter == shard.index.end()) {
+		return;
+	}
+	shard.lru.erase(iter->second);
+	shard.index.erase(iter);
+	_invalidations++;
+}
+
+bool FriendListCache::GetFriends(int uid, std::shared_ptr<const FriendList>& friends) {
+	if (getLocal(uid, friends)) {
+		_hits++;
+		return true;
+	}
+	_misses++;
+
+	//先记下分片版本号，查询期间收到失效通知的话结果可能已经过期，只返回不缓存
+	uint64_t version = versionOf(uid);
+	//redis中的列表与联系人版本号一致才可用
+	FriendsCache cache;
+	bool b_cache = RedisMgr::GetInstance()->GetFriends(uid, cache);
+	auto list = std::make_shared<FriendList>();
+	if (b_cache && cache.hit && Parse(cache.friends, *list)) {
+		put(uid, list, version);
+		friends = list;
+		return true;
+	}
+
+	//从数据库只查好友关系，回填时凭读到的版本号校验，期间有人加好友则放弃回填
+	if (!MysqlMgr::GetInstance()->GetFriendIds(uid, *list)) {
+		return false;
+	}
+	if (b_cache && cache.cver != 0) {
+		RedisMgr::GetInstance()->SetFriendsAsync(uid, cache.cver, Serialize(*list));
+	}
+	put(uid, list, version);
+	friends = list;
+	return true;
+}
+
+void FriendListCache::OnFriendAdded(int self_id, int friend_id, const std::string& back) {
+	// 本机有缓存时就地插入新好友，写时复制，已经拿到旧列表的读者不受影响；
+	// 没有缓存时下次读取从数据库加载，已经包含新好友；版本号加一，丢弃加好友之前开始的回源结果
+	auto& shard = shardOf(self_id);
+	{
+		std::lock_guard<std::mutex> lock(shard.mutex);
+		shard.version++;
+		auto iter = shard.index.find(self_id);
+		if (iter != shard.index.end()) {
+			auto& old_list = *iter->second->second.friends;
+			auto pos = std::lower_bound(old_list.begin(), old_list.end(), friend_id,
+				[](const FriendEntry& entry, int uid) { return entry.uid < uid; });
+			if (pos == old_list.end() || pos->uid != friend_id) {
+				auto list = std::make_shared<FriendList>();
+				list->reserve(old_list.size() + 1);
+				list->insert(list->end(), old_list.begin(), pos);
+				list->push_back(FriendEntry{ friend_id, back });
+				list->insert(list->end(), pos, old_list.end());
+				iter->second->second.friends = list;
+			}
+		}
+	}
+
+	RedisMgr::GetInstance()->PublishAsync(FRIEND_LIST_INVALIDATE, std::to_string(self_id) + "," + _self_name);
+}
+
+std::string FriendListCache::Serialize(const FriendList& friends) {
+	std::string data;
+	{
+		// 析构时才把缓冲区中剩余的字节写回 data
+		StringOutputStream stream(&data);
+		CodedOutputStream output(&stream);
+		if (!friends.empty()) {
+			// packed 字段先写总字节数，再连续写各个差值
+			size_t packed_size = 0;
+			uint32_t prev = 0;
+			for (auto& entry : friends) {
+				packed_size += CodedOutputStream::VarintSize32(static_cast<uint32_t>(entry.uid) - prev);
+				prev = static_cast<uint32_t>(entry.uid);
+			}
+			WireFormatLite::WriteTag(FIELD_UID_DELTA, WireFormatLite::WIRETYPE_LENGTH_DELIMITED, &output);
+			output.WriteVarint32(static_cast<uint32_t>(packed_size));
+			prev = 0;
+			for (auto& entry : friends) {
+				output.WriteVarint32(static_cast<uint32_t>(entry.uid) - prev);
+				prev = static_cast<uint32_t>(entry.uid);
+			}
+		}
+		for (auto& entry : friends) {
+			WireFormatLite::WriteString(FIELD_BACK, entry.back, &output);
+		}
+	}
+	return data;
+}
+
+bool FriendListCache::Parse(const std::string& data, FriendList& friends) {
+	CodedInputStream input(reinterpret_cast<const uint8_t*>(data.data()), static_cast<int>(data.size()));
+	std::vector<int> uids;
+	std::vector<std::string> backs;
+	uint32_t tag = 0;
+	while ((tag = input.ReadTag()) != 0) {
+		auto wire_type = WireFormatLite::GetTagWireType(tag);
+		auto field = WireFormatLite::GetTagFieldNumber(tag);
+		bool ok = true;
+		if (field == FIELD_UID_DELTA && wire_type == WireFormatLite::WIRETYPE_LENGTH_DELIMITED) {
+			uint32_t length = 0;
+			ok = input.ReadVarint32(&length);
+			if (ok) {
+				auto limit = input.PushLimit(static_cast<int>(length));
+				uint32_t prev = uids.empty() ? 0 : static_cast<uint32_t>(uids.back());
+				while (ok && input.BytesUntilLimit() > 0) {
+					uint32_t delta = 0;
+					ok = input.ReadVarint32(&delta);
+					prev += delta;
+					uids.push_back(static_cast<int>(prev));
+				}
+				input.PopLimit(limit);
+			}
+		}
+		else if (field == FIELD_BACK && wire_type == WireFormatLite::WIRETYPE_LENGTH_DELIMITED) {
+			backs.emplace_back();
+			ok = WireFormatLite::ReadString(&input, &backs.back());
+		}
+		else {
+			ok = WireFormatLite::SkipField(&input, tag);
+		}
+		if (!ok) {
+			return false;
+		}
+	}
+
+	// ReadTag 在数据结束和数据损坏时都返回0，只有完整读完且uid与备注一一对应才算成功
+	if (input.CurrentPosition() != static_cast<int>(data.size()) || uids.size() != backs.size()) {
+		return false;
+	}
+	friends.clear();
+	friends.reserve(uids.size());
+	for (size_t i = 0; i < uids.size(); ++i) {
+		friends.push_back(FriendEntry{ uids[i], std::move(backs[i]) });
+	}
+	return true;
+}
+
+void FriendListCache::LogStats() {
+	uint64_t hits = _hits;
+	uint64_t misses = _misses;
+	size_t size = 0;
+	for (auto& shard : _shards) {
+		std::lock_guard<std::mutex> lock(shard.mutex);
+		size += shard.index.size();
+	}
+	double hit_rate = hits + misses == 0 ? 0.0 : (double)hits * 100 / (hits + misses);
+	spdlog::info("好友列表缓存 条目: {} 命中: {} 未命中: {} 命中率: {:.2f}% 淘汰: {} 失效: {}",
+		size, hits, misses, hit_rate, _evictions.load(), _invalidations.load());
+}
@@ -0,0 +1,40 @@
+#include "HashRing.h"
+#include <algorithm>
+
+HashRing::HashRing(const std::vector<std::string>& nodes, int virtual_nodes) {
+	_ring.reserve(nodes.size() * virtual_nodes);
+	for (size_t i = 0; i < nodes.size(); ++i) {
+		for (int v = 0; v < virtual_nodes; ++v) {
+			_ring.emplace_back(Hash(nodes[i] + "#" + std::to_string(v)), i);
+		}
+	}
+	std::sort(_ring.begin(), _ring.end());
+}
+
+size_t HashRing::Locate(const std::string& key) const {
+	if (_ring.empty()) {
+		return 0;
+	}
+	auto hash = Hash(key);
+	auto iter = std::lower_bound(_ring.begin(), _ring.end(), std::make_pair(hash, (size_t)0));
+	// 越过最后一个虚拟节点时绕回环的起点
+	if (iter == _ring.end()) {
+		iter = _ring.begin();
+	}
+	return iter->second;
+}
+
+uint64_t HashRing::Hash(const std::string& data) {
+	// FNV-1a，再用 murmur3 的 fmix64 打散，相近的key也能均匀分布在环上
+	uint64_t hash = 14695981039346656037ULL;
+	for (unsigned char c : data) {
+		hash ^= c;
+		hash *= 1099511628211ULL;
+	}
+	hash ^= hash >> 33;
+	hash *= 0xff51afd7ed558ccdULL;
+	hash ^= hash >> 33;
+	hash *= 0xc4ceb9fe1a85ec53ULL;
+	hash ^= hash >> 33;
+	return hash;
+}
@@ -1,29 +1,151 @@
 #include "MysqlDao.h"
 #include "ConfigMgr.h"
 
-MysqlDao::MysqlDao()
+// 按条件查询用户基础信息的语句，列的顺序固定为 uid, name, email, pwd, nick, desc, sex, icon
+static std::function<mysqlx::TableSelect(SqlConnection&)> userSelect(const std::string& condition)
 {
-	auto & cfg = ConfigMgr::Inst();
-	const auto& host = cfg["Mysql"]["Host"];
-	const auto& port = cfg["Mysql"]["Port"];
-	const auto& pwd = cfg["Mysql"]["Passwd"];
-	const auto& schema = cfg["Mysql"]["Schema"];
-	const auto& user = cfg["Mysql"]["User"];
-	pool_.reset(new MySqlPool(host, port, user, pwd, schema, 5));
+	return [condition](SqlConnection& con) {
+		auto stmt = con.Table("user").select("uid", "name", "email", "pwd", "nick", "`desc`", "sex", "icon");
+		stmt.where(condition);
+		return stmt;
+	};
+}
+
+// 批量按uid查询，列的顺序与 userSelect 相同
+static const char* USER_COLUMNS = "uid, name, email, pwd, IFNULL(nick, ''), IFNULL(`desc`, ''), IFNULL(sex, 0), IFNULL(icon, '')";
+
+// 资料列可能为 NULL，按空值处理
+static std::string stringOr(const mysqlx::Value& value)
+{
+	return value.isNull() ? std::string() : value.get<std::string>();
+}
+
+static std::shared_ptr<UserInfo> parseUser(mysqlx::Row& row)
+{
+	auto userInfo = std::make_shared<UserInfo>();
+	userInfo->uid = row[0].get<int>();
+	userInfo->name = row[1].get<std::string>();
+	userInfo->email = row[2].get<std::string>();
+	userInfo->pwd = row[3].get<std::string>();
+	userInfo->nick = stringOr(row[4]);
+	userInfo->desc = stringOr(row[5]);
+	userInfo->sex = row[6].isNull() ? 0 : row[6].get<int>();
+	userInfo->icon = stringOr(row[7]);
+	return userInfo;
+}
+
+// IN 列表的占位符 "?, ?, ..."
+static std::string placeholders(size_t count)
+{
+	std::string marks;
+	for (size_t i = 0; i < count; ++i) {
+		marks += i == 0 ? "?" : ", ?";
+	}
+	return marks;
+}
+
+static const size_t STICKY_SWEEP_MIN = 1024;
+
+MysqlDao::MysqlDao() : next_replica_(0), sticky_sweep_at_(STICKY_SWEEP_MIN)
+{
+	auto cfg = ConfigMgr::Inst().Snapshot();
+	MySqlPoolOptions options;
+	options.host = cfg->mysql_host;
+	options.port = cfg->mysql_port;
+	options.user = cfg->mysql_user;
+	options.pass = cfg->mysql_pwd;
+	options.schema = cfg->mysql_schema;
+	options.min_size = cfg->mysql_pool_min;
+	options.max_size = cfg->mysql_pool_max;
+	options.acquire_timeout_ms = cfg->mysql_acquire_timeout_ms;
+	options.idle_timeout_sec = cfg->mysql_idle_timeout_sec;
+	pool_.reset(new MySqlPool(options));
+
+	// 副本的账号、库名和连接池参数与主库相同，至少常驻一个连接，断开后由检查线程补建
+	options.min_size = std::max(1, options.min_size);
+	for (size_t i = 0; i < cfg->mysql_replicas.size(); ++i) {
+		options.name = "replica" + std::to_string(i);
+		options.host = cfg->mysql_replicas[i].host;
+		options.port = cfg->mysql_replicas[i].port;
+		replicas_.emplace_back(new MySqlPool(options));
+	}
+	sticky_ms_ = cfg->mysql_sticky_ms;
 }
 
 MysqlDao::~MysqlDao(){
 	pool_->Close();
+	for (auto& replica : replicas_) {
+		replica->Close();
+	}
 }
 
-int MysqlDao::RegUser(const std::string& name, const std::string& email, const std::string& pwd)
+std::string MysqlDao::uidKey(int uid)
 {
-	auto con = pool_->getConnection();
-	try {
-		if (con == nullptr) {
-			return -1;
+	return "uid_" + std::to_string(uid);
+}
+
+std::string MysqlDao::nameKey(const std::string& name)
+{
+	return "name_" + name;
+}
+
+MySqlPool& MysqlDao::readPool(const std::string& key)
+{
+	if (replicas_.empty()) {
+		return *pool_;
+	}
+
+	if (sticky_ms_ > 0) {
+		std::lock_guard<std::mutex> lock(sticky_mutex_);
+		auto iter = sticky_.find(key);
+		if (iter != sticky_.end() && iter->second > std::chrono::steady_clock::now()) {
+			return *pool_;
 		}
+	}
 
+	// 轮询可用的副本，全部断开时退回主库
+	for (size_t i = 0; i < replicas_.size(); ++i) {
+		auto& replica = replicas_[next_replica_++ % replicas_.size()];
+		if (replica->Available()) {
+			return *replica;
+		}
+	}
+	return *pool_;
+}
+
+void MysqlDao::markWrite(const std::string& key)
+{
+	if (replicas_.empty() || sticky_ms_ <= 0) {
+		return;
+	}
+
+	auto now = std::chrono::steady_clock::now();
+	std::lock_guard<std::mutex> lock(sticky_mutex_);
+	sticky_[key] = now + std::chrono::milliseconds(sticky_ms_);
+	if (sticky_.size() < sticky_sweep_at_) {
+		return;
+	}
+
+	for (auto iter = sticky_.begin(); iter != sticky_.end();) {
+		if (iter->second <= now) {
+			iter = sticky_.erase(iter);
+			continue;
+		}
+		++iter;
+	}
+	// 按清理后的大小调整下次清理的时机，写入密集时也不会每次都全量扫描
+	sticky_sweep_at_ = std::max(STICKY_SWEEP_MIN, sticky_.size() * 2);
+}
+
+int MysqlDao::RegUser(const std::string& name, const std::string& email, const std::string& pwd)
+{
+	markWrite(nameKey(name));
+	PooledConnection con(*pool_, "reg_user");
+	if (!con) {
+		return -1;
+	}
+
+	try {
 		// 调用存储过程
 		auto result = con->_session->sql("CALL reg_user(?, ?, ?, @result)")
 			.bind(name, email, pwd)
@@ -35,102 +157,100 @@ int MysqlDao::RegUser(const std::string& name, const std::string& email, const s
 		if (row) {
 			int ret = row[0];
 			spdlog::info("Result: {}", ret);
-			pool_->returnConnection(std::move(con));
 			return ret;
 		}
-		pool_->returnConnection(std::move(con));
 		return -1;
 	}
 	catch (const mysqlx::Error& e) {
-		pool_->returnConnection(std::move(con));
+		con.Fail();
 		spdlog::error("Error: {}", e.what());
 		return -1;
 	}
 }
 
 bool MysqlDao::CheckEmail(const std::string& name, const std::string& email) {
-	auto con = pool_->getConnection();
-	try {
-		if (con == nullptr) {
-			return false;
-		}
+	PooledConnection con(readPool(nameKey(name)), "check_email");
+	if (!con) {
+		return false;
+	}
 
-		auto res = con->_session->sql("SELECT email FROM user WHERE name = ?")
-			.bind(name)
-			.execute();
+	try {
+		auto& stmt = con->Statement<mysqlx::TableSelect>("email_by_name", [](SqlConnection& c) {
+			auto stmt = c.Table("user").select("email");
+			stmt.where("name = :name");
+			return stmt;
+			});
+		auto res = stmt.bind("name", name).execute();
 
 		auto row = res.fetchOne();
 		if (row) {
 			std::string db_email = row[0].get<std::string>();
 			spdlog::info("Check Email: {}", db_email);
-			pool_->returnConnection(std::move(con));
 			return email == db_email;
 		}
-		pool_->returnConnection(std::move(con));
 		return false;
 	}
 	catch (const mysqlx::Error& e) {
-		pool_->returnConnection(std::move(con));
+		con.Fail();
 		spdlog::error("Error: {}", e.what());
 		return false;
 	}
 }
 
 bool MysqlDao::UpdatePwd(const std::string& name, const std::string& newpwd) {
-	auto con = pool_->getConnection();
-	try {
-		if (con == nullptr) {
-			return false;
-		}
+	markWrite(nameKey(name));
+	PooledConnection con(*pool_, "update_pwd");
+	if (!con) {
+		return false;
+	}
 
-		auto res = con->_session->sql("UPDATE user SET pwd = ? WHERE name = ?")
-			.bind(newpwd, name)
-			.execute();
+	try {
+		auto& stmt = con->Statement<mysqlx::TableUpdate>("update_pwd", [](SqlConnection& c) {
+			auto stmt = c.Table("user").update();
+			stmt.set("pwd", mysqlx::expr(":pwd")).where("name = :name");
+			return stmt;
+			});
+		auto res = stmt.bind("pwd", newpwd).bind("name", name).execute();
 
 		int affected = res.getAffectedItemsCount();
 		spdlog::info("Updated rows: {}", affected);
-		pool_->returnConnection(std::move(con));
 		return affected > 0;
 	}
 	catch (const mysqlx::Error& e) {
-		pool_->returnConnection(std::move(con));
+		con.Fail();
 		spdlog::error("Error: {}", e.what());
 		return false;
 	}
 }
 
 bool MysqlDao::CheckPwd(const std::string& name, const std::string& pwd, UserInfo& userInfo) {
-	auto con = pool_->getConnection();
-	if (con == nullptr) {
+	PooledConnection con(readPool(nameKey(name)), "check_pwd");
+	if (!con) {
 		return false;
 	}
 
-	Defer defer([this, &con]() {
-		pool_->returnConnection(std::move(con));
-	});
-
 	try {
-		auto res = con->_session->sql("SELECT * FROM user WHERE name = ?")
-			.bind(name)
-			.execute();
+		auto& stmt = con->Statement<mysqlx::TableSelect>("user_by_name", userSelect("name = :name"));
+		auto result = stmt.bind("name", name).execute();
 
-		auto row = res.fetchOne();
+		auto row = result.fetchOne();
 		if (!row) {
 			return false;
 		}
 
-		std::string origin_pwd = row[4].get<std::string>(); // pwd column
-		if (pwd != origin_pwd) {
+		auto user = parseUser(row);
+		if (pwd != user->pwd) {
 			return false;
 		}
 
-		userInfo.name = row[2].get<std::string>(); // name column
-		userInfo.email = row[3].get<std::string>(); // email column
-		userInfo.uid = row[1].get<int>(); // uid column
-		userInfo.pwd = origin_pwd;
+		userInfo.name = user->name;
+		userInfo.pwd = user->pwd;
+		userInfo.uid = user->uid;
+		userInfo.email = user->email;
 		return true;
 	}
 	catch (const mysqlx::Error& e) {
+		con.Fail();
 		spdlog::error("Error: {}", e.what());
 		return false;
 	}
@@ -138,209 +258,311 @@ bool MysqlDao::CheckPwd(const std::string& name, const std::string& pwd, UserInf
 
 bool MysqlDao::AddFriendApply(const int& from, const int& to)
 {
-	auto con = pool_->getConnection();
-	if (con == nullptr) {
+	markWrite(uidKey(from));
+	markWrite(uidKey(to));
+	PooledConnection con(*pool_, "add_friend_apply");
+	if (!con) {
 		return false;
 	}
 
-	Defer defer([this, &con]() {
-		pool_->returnConnection(std::move(con));
-	});
-
 	try {
-		auto res = con->_session->sql("INSERT INTO friend_apply (from_uid, to_uid) VALUES (?, ?) "
+		auto result = con->_session->sql("INSERT INTO friend_apply (from_uid, to_uid) VALUES (?, ?) "
 			"ON DUPLICATE KEY UPDATE from_uid = from_uid, to_uid = to_uid")
 			.bind(from, to)
 			.execute();
 
-		return res.getAffectedItemsCount() > 0;
+		return result.getAffectedItemsCount() > 0;
 	}
 	catch (const mysqlx::Error& e) {
+		con.Fail();
 		spdlog::error("Error: {}", e.what());
 		return false;
 	}
 }
 
-bool MysqlDao::AuthFriendApply(const int& from, const int& to) {
-	auto con = pool_->getConnection();
-	if (con == nullptr) {
+bool MysqlDao::AuthFriendApply(const int& from, const int& to)
+{
+	markWrite(uidKey(from));
+	markWrite(uidKey(to));
+	PooledConnection con(*pool_, "auth_friend_apply");
+	if (!con) {
 		return false;
 	}
 
-	Defer defer([this, &con]() {
-		pool_->returnConnection(std::move(con));
-	});
-
 	try {
-		auto res = con->_session->sql("UPDATE friend_apply SET status = 1 WHERE from_uid = ? AND to_uid = ?")
-			.bind(to, from) // 申请时是from，验证时是to
-			.execute();
-
-		return res.getAffectedItemsCount() > 0;
+		auto& stmt = con->Statement<mysqlx::TableUpdate>("auth_friend_apply", [](SqlConnection& c) {
+			auto stmt = c.Table("friend_apply").update();
+			stmt.set("status", 1).where("from_uid = :from AND to_uid = :to");
+			return stmt;
+			});
+		auto result = stmt.bind("from", to).bind("to", from).execute(); // 申请时是from，验证时是to
+
+		return result.getAffectedItemsCount() > 0;
 	}
 	catch (const mysqlx::Error& e) {
+		con.Fail();
 		spdlog::error("Error: {}", e.what());
 		return false;
 	}
 }
 
-bool MysqlDao::AddFriend(const int& from, const int& to, std::string back_name) {
-	auto con = pool_->getConnection();
-	if (con == nullptr) {
+bool MysqlDao::AddFriend(const int& from, const int& to, std::string back_name)
+{
+	markWrite(uidKey(from));
+	markWrite(uidKey(to));
+	PooledConnection con(*pool_, "add_friend");
+	if (!con) {
 		return false;
 	}
 
-	Defer defer([this, &con]() {
-		pool_->returnConnection(std::move(con));
-	});
-
 	try {
-		auto res = con->_session->sql("INSERT INTO friend_list (self_id, friend_id, back_name) VALUES (?, ?, ?)")
+		auto result = con->_session->sql("INSERT INTO friend_list (self_id, friend_id, back_name) VALUES (?, ?, ?)")
 			.bind(from, to, back_name)
 			.execute();
 
-		return res.getAffectedItemsCount() > 0;
+		return result.getAffectedItemsCount() > 0;
 	}
 	catch (const mysqlx::Error& e) {
+		con.Fail();
 		spdlog::error("Error: {}", e.what());
 		return false;
 	}
 }
 
-std::shared_ptr<UserInfo> MysqlDao::GetUser(int uid)
+LookupResult MysqlDao::GetUser(int uid, std::shared_ptr<UserInfo>& user)
 {
-	auto con = pool_->getConnection();
-	if (con == nullptr) {
-		return nullptr;
+	PooledConnection con(fillPool(), "get_user_by_uid");
+	if (!con) {
+		return LOOKUP_ERROR;
 	}
 
-	Defer defer([this, &con]() {
-		pool_->returnConnection(std::move(con));
-	});
+	try {
+		auto& stmt = con->Statement<mysqlx::TableSelect>("user_by_uid", userSelect("uid = :uid"));
+		auto result = stmt.bind("uid", uid).execute();
+
+		auto row = result.fetchOne();
+		if (!row) {
+			return LOOKUP_NOT_FOUND;
+		}
+		user = parseUser(row);
+		return LOOKUP_FOUND;
+	}
+	catch (const mysqlx::Error& e) {
+		con.Fail();
+		spdlog::error("Error: {}", e.what());
+		return LOOKUP_ERROR;
+	}
+}
+
+LookupResult MysqlDao::GetUser(std::string name, std::shared_ptr<UserInfo>& user)
+{
+	PooledConnection con(fillPool(), "get_user_by_name");
+	if (!con) {
+		return LOOKUP_ERROR;
+	}
 
 	try {
-		auto res = con->_session->sql("SELECT * FROM user WHERE uid = ?")
-			.bind(uid)
-			.execute();
+		auto& stmt = con->Statement<mysqlx::TableSelect>("user_by_name", userSelect("name = :name"));
+		auto result = stmt.bind("name", name).execute();
 
-		auto row = res.fetchOne();
+		auto row = result.fetchOne();
 		if (!row) {
-			return nullptr;
+			return LOOKUP_NOT_FOUND;
 		}
+		user = parseUser(row);
+		return LOOKUP_FOUND;
+	}
+	catch (const mysqlx::Error& e) {
+		con.Fail();
+		spdlog::error("Error: {}", e.what());
+		return LOOKUP_ERROR;
+	}
+}
 
-		auto userInfo = std::make_shared<UserInfo>();
-		userInfo->uid = row[1].get<int>();         // uid is in column 1
-		userInfo->name = row[2].get<std::string>(); // name is in column 2
-		userInfo->pwd = row[4].get<std::string>();  // pwd is in column 4
-		userInfo->email = row[3].get<std::string>();// email is in column 3
-		return userInfo;
+bool MysqlDao::GetApplyList(int touid, int after_uid, int limit, std::vector<std::shared_ptr<ApplyInfo>>& applyList)
+{
+	PooledConnection con(readPool(uidKey(touid)), "get_apply_list");
+	if (!con) {
+		return false;
+	}
+
+	try {
+		// 以 from_uid 为游标翻页，(to_uid, from_uid) 唯一，翻页时不会漏掉或重复
+		auto result = con->_session->sql("SELECT a.from_uid, u.name, IFNULL(u.`desc`, ''), IFNULL(u.icon, ''), "
+			"IFNULL(u.nick, ''), IFNULL(u.sex, 0), a.status FROM friend_apply a "
+			"JOIN user u ON a.from_uid = u.uid "
+			"WHERE a.to_uid = ? AND a.status = 0 AND a.from_uid > ? ORDER BY a.from_uid LIMIT ?")
+			.bind(touid, after_uid, limit)
+			.execute();
+
+		// 逐行读取，不一次性把结果集全部拷贝出来
+		while (auto row = result.fetchOne()) {
+			auto applyInfo = std::make_shared<ApplyInfo>(
+				row[0].get<int>(),          // _uid (from_uid)
+				row[1].get<std::string>(),  // _name
+				row[2].get<std::string>(),  // _desc
+				row[3].get<std::string>(),  // _icon
+				row[4].get<std::string>(),  // _nick
+				row[5].get<int>(),          // _sex
+				row[6].get<int>()           // _status
+			);
+			applyList.push_back(applyInfo);
+		}
+		return true;
 	}
 	catch (const mysqlx::Error& e) {
+		con.Fail();
 		spdlog::error("Error: {}", e.what());
-		return nullptr;
+		return false;
 	}
 }
 
-std::shared_ptr<UserInfo> MysqlDao::GetUser(std::string name)
+bool MysqlDao::GetApplyList(int touid, const std::vector<int>& from_uids, std::vector<std::shared_ptr<ApplyInfo>>& applyList)
 {
-	auto con = pool_->getConnection();
-	if (con == nullptr) {
-		return nullptr;
+	if (from_uids.empty()) {
+		return true;
+	}
+
+	PooledConnection con(readPool(uidKey(touid)), "get_apply_by_uids");
+	if (!con) {
+		return false;
+	}
+
+	try {
+		// 不过滤 status，已处理的申请也要带回去，客户端据此更新本地的申请列表
+		auto stmt = con->_session->sql("SELECT a.from_uid, u.name, IFNULL(u.`desc`, ''), IFNULL(u.icon, ''), "
+			"IFNULL(u.nick, ''), IFNULL(u.sex, 0), a.status FROM friend_apply a "
+			"JOIN user u ON a.from_uid = u.uid "
+			"WHERE a.to_uid = ? AND a.from_uid IN (" + placeholders(from_uids.size()) + ")");
+		stmt.bind(touid);
+		for (auto from_uid : from_uids) {
+			stmt.bind(from_uid);
+		}
+		auto result = stmt.execute();
+
+		while (auto row = result.fetchOne()) {
+			auto applyInfo = std::make_shared<ApplyInfo>(
+				row[0].get<int>(),          // _uid (from_uid)
+				row[1].get<std::string>(),  // _name
+				row[2].get<std::string>(),  // _desc
+				row[3].get<std::string>(),  // _icon
+				row[4].get<std::string>(),  // _nick
+				row[5].get<int>(),          // _sex
+				row[6].get<int>()           // _status
+			);
+			applyList.push_back(applyInfo);
+		}
+		return true;
 	}
+	catch (const mysqlx::Error& e) {
+		con.Fail();
+		spdlog::error("Error: {}", e.what());
+		return false;
+	}
+}
 
-	Defer defer([this, &con]() {
-		pool_->returnConnection(std::move(con));
-	});
+bool MysqlDao::GetFriendIds(int self_id, std::vector<FriendEntry>& friends)
+{
+	PooledConnection con(fillPool(), "get_friend_ids");
+	if (!con) {
+		return false;
+	}
 
 	try {
-		auto res = con->_session->sql("SELECT * FROM user WHERE name = ?")
-			.bind(name)
+		// 只查好友关系表，好友的资料由调用方按uid批量补全
+		auto result = con->_session->sql("SELECT friend_id, IFNULL(back_name, '') FROM friend_list "
+			"WHERE self_id = ? ORDER BY friend_id")
+			.bind(self_id)
 			.execute();
 
-		auto row = res.fetchOne();
-		if (!row) {
-			return nullptr;
+		while (auto row = result.fetchOne()) {
+			friends.push_back(FriendEntry{ row[0].get<int>(), row[1].get<std::string>() });
 		}
-
-		auto userInfo = std::make_shared<UserInfo>();
-		userInfo->uid = row[1].get<int>();         // uid is in column 1
-		userInfo->name = row[2].get<std::string>(); // name is in column 2
-		userInfo->pwd = row[4].get<std::string>();  // pwd is in column 4
-		userInfo->email = row[3].get<std::string>();// email is in column 3
-		return userInfo;
+		return true;
 	}
 	catch (const mysqlx::Error& e) {
+		con.Fail();
 		spdlog::error("Error: {}", e.what());
-		return nullptr;
+		return false;
 	}
 }
 
-bool MysqlDao::GetApplyList(int touid, std::vector<std::shared_ptr<ApplyInfo>>& applyList, int offset, int limit) {
-	auto con = pool_->getConnection();
-	if (con == nullptr) {
+bool MysqlDao::GetUsers(const std::vector<int>& uids, std::vector<std::shared_ptr<UserInfo>>& users)
+{
+	if (uids.empty()) {
+		return true;
+	}
+
+	// 一批uid属于不同的用户，任何一个刚被写过都要读主库，回填缓存又要求读主库，所以整批走主库
+	PooledConnection con(fillPool(), "get_users_by_uids");
+	if (!con) {
 		return false;
 	}
 
-	Defer defer([this, &con]() {
-		pool_->returnConnection(std::move(con));
-	});
+	try {
+		auto stmt = con->_session->sql(std::string("SELECT ") + USER_COLUMNS + " FROM user WHERE uid IN ("
+			+ placeholders(uids.size()) + ")");
+		for (auto uid : uids) {
+			stmt.bind(uid);
+		}
+		auto result = stmt.execute();
+
+		while (auto row = result.fetchOne()) {
+			users.push_back(parseUser(row));
+		}
+		return true;
+	}
+	catch (const mysqlx::Error& e) {
+		con.Fail();
+		spdlog::error("Error: {}", e.what());
+		return false;
+	}
+}
+
+bool MysqlDao::GetFriendOwners(int friend_id, std::vector<int>& owners)
+{
+	PooledConnection con(readPool(uidKey(friend_id)), "get_friend_owners");
+	if (!con) {
+		return false;
+	}
 
 	try {
-		auto res = con->_session->sql("SELECT a.*, u.name as from_name FROM friend_apply a "
-			"LEFT JOIN user u ON a.from_uid = u.uid "
-			"WHERE a.to_uid = ? AND a.status = 0 LIMIT ?, ?")
-			.bind(touid, offset, limit)
+		auto result = con->_session->sql("SELECT self_id FROM friend_list WHERE friend_id = ?")
+			.bind(friend_id)
 			.execute();
 
-		while (auto row = res.fetchOne()) {
-			auto info = std::make_shared<ApplyInfo>(
-				row[1].get<int>(),          // from_uid -> _uid (column 2)
-				row[4].get<std::string>(),  // from_name -> _name (from joined user table)
-				"",                         // _desc
-				"",                         // _icon
-				"",                         // _nick
-				0,                          // _sex
-				row[3].get<int>()           // _status (column 4)
-			);
-			applyList.push_back(info);
+		while (auto row = result.fetchOne()) {
+			owners.push_back(row[0].get<int>());
 		}
 		return true;
 	}
 	catch (const mysqlx::Error& e) {
+		con.Fail();
 		spdlog::error("Error: {}", e.what());
 		return false;
 	}
 }
 
-bool MysqlDao::GetFriendList(int self_id, std::vector<std::shared_ptr<UserInfo>>& user_info_list) {
-	auto con = pool_->getConnection();
-	if (con == nullptr) {
+bool MysqlDao::ScanUsers(int after_uid, int limit, std::vector<std::pair<int, std::string>>& users)
+{
+	// 全表扫描不属于任何用户，不受粘滞影响，优先走副本
+	PooledConnection con(readPool(std::string()), "scan_users");
+	if (!con) {
 		return false;
 	}
 
-	Defer defer([this, &con]() {
-		pool_->returnConnection(std::move(con));
-	});
-
 	try {
-		auto res = con->_session->sql("SELECT u.*, f.back_name FROM friend_list f "
-			"LEFT JOIN user u ON f.friend_id = u.uid "
-			"WHERE f.self_id = ?")
-			.bind(self_id)
+		auto result = con->_session->sql("SELECT uid, name FROM user WHERE uid > ? ORDER BY uid LIMIT ?")
+			.bind(after_uid, limit)
 			.execute();
 
-		while (auto row = res.fetchOne()) {
-			auto info = std::make_shared<UserInfo>();
-			info->uid = row[1].get<int>();              // u.uid (column 2)
-			info->name = row[2].get<std::string>();     // u.name (column 3)
-			info->email = row[3].get<std::string>();    // u.email (column 4)
-			info->pwd = row[4].get<std::string>();      // u.pwd (column 5)
-			info->back = row[10].get<std::string>();    // f.back (last column)
-			user_info_list.push_back(info);
+		while (auto row = result.fetchOne()) {
+			users.emplace_back(row[0].get<int>(), row[1].get<std::string>());
 		}
 		return true;
 	}
 	catch (const mysqlx::Error& e) {
+		con.Fail();
 		spdlog::error("Error: {}", e.what());
 		return false;
 	}
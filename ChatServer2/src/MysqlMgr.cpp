@@ -1,4 +1,5 @@
 #include "MysqlMgr.h"
+#include "FriendListCache.h"
 
 
 MysqlMgr::~MysqlMgr() {
@@ -35,26 +36,46 @@ bool MysqlMgr::AuthFriendApply(const int& from, const int& to) {
 }
 
 bool MysqlMgr::AddFriend(const int& from, const int& to, std::string back_name) {
-	return _dao.AddFriend(from, to, back_name);
+	if (!_dao.AddFriend(from, to, back_name)) {
+		return false;
+	}
+	FriendListCache::GetInstance()->OnFriendAdded(from, to, back_name);
+	return true;
 }
 
-std::shared_ptr<UserInfo> MysqlMgr::GetUser(int uid)
+LookupResult MysqlMgr::GetUser(int uid, std::shared_ptr<UserInfo>& user)
 {
-	return _dao.GetUser(uid);
+	return _dao.GetUser(uid, user);
 }
 
-std::shared_ptr<UserInfo> MysqlMgr::GetUser(std::string name)
+LookupResult MysqlMgr::GetUser(std::string name, std::shared_ptr<UserInfo>& user)
 {
-	return _dao.GetUser(name);
+	return _dao.GetUser(name, user);
 }
 
-bool MysqlMgr::GetApplyList(int touid, 
-	std::vector<std::shared_ptr<ApplyInfo>>& applyList, int begin, int limit) {
+bool MysqlMgr::GetApplyList(int touid, int after_uid, int limit,
+	std::vector<std::shared_ptr<ApplyInfo>>& applyList) {
 
-	return _dao.GetApplyList(touid, applyList, begin, limit);
+	return _dao.GetApplyList(touid, after_uid, limit, applyList);
 }
 
-bool MysqlMgr::GetFriendList(int self_id, std::vector<std::shared_ptr<UserInfo> >& user_info) {
-	return _dao.GetFriendList(self_id, user_info);
+bool MysqlMgr::GetApplyList(int touid, const std::vector<int>& from_uids,
+	std::vector<std::shared_ptr<ApplyInfo>>& applyList) {
+	return _dao.GetApplyList(touid, from_uids, applyList);
 }
 
+bool MysqlMgr::GetFriendIds(int self_id, std::vector<FriendEntry>& friends) {
+	return _dao.GetFriendIds(self_id, friends);
+}
+
+bool MysqlMgr::GetUsers(const std::vector<int>& uids, std::vector<std::shared_ptr<UserInfo>>& users) {
+	return _dao.GetUsers(uids, users);
+}
+
+bool MysqlMgr::GetFriendOwners(int friend_id, std::vector<int>& owners) {
+	return _dao.GetFriendOwners(friend_id, owners);
+}
+
+bool MysqlMgr::ScanUsers(int after_uid, int limit, std::vector<std::pair<int, std::string>>& users) {
+	return _dao.ScanUsers(after_uid, limit, users);
+}
@@ -0,0 +1,16 @@
+#include "RedisScript.h"
+#include <openssl/evp.h>
+
+RedisScript::RedisScript(std::string source) : _source(std::move(source)) {
+	unsigned char digest[EVP_MAX_MD_SIZE];
+	unsigned int digest_len = 0;
+	EVP_Digest(_source.data(), _source.size(), digest, &digest_len, EVP_sha1(), nullptr);
+
+	// redis 使用小写十六进制的sha1
+	static const char* HEX = "0123456789abcdef";
+	_sha.reserve(digest_len * 2);
+	for (unsigned int i = 0; i < digest_len; ++i) {
+		_sha.push_back(HEX[digest[i] >> 4]);
+		_sha.push_back(HEX[digest[i] & 0x0f]);
+	}
+}
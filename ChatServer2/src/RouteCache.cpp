@@ -0,0 +1,98 @@
+#include "RouteCache.h"
+#include "ConfigMgr.h"
+#include "RedisMgr.h"
+#include "RedisSubscriber.h"
+
+RouteCache::RouteCache() : _version(0), _hits(0), _misses(0), _stale(0) {
+	_self_name = ConfigMgr::Inst().Snapshot()->self_name;
+
+	RedisSubscriber::GetInstance()->Subscribe(ROUTE_CHANNEL,
+		[this](const std::string&, const std::string& message) {
+			onRoute(message);
+		});
+}
+
+RouteCache::~RouteCache() {
+
+}
+
+std::chrono::steady_clock::time_point RouteCache::expireTime() {
+	// 每次从快照读取，热更新后新写入的条目立即使用新的TTL
+	auto ttl = std::chrono::seconds(ConfigMgr::Inst().Snapshot()->route_cache_ttl);
+	return std::chrono::steady_clock::now() + ttl;
+}
+
+void RouteCache::onRoute(const std::string& message) {
+	auto pos = message.find(',');
+	if (pos == std::string::npos) {
+		spdlog::error("路由通知格式错误: {}", message);
+		return;
+	}
+
+	int uid = atoi(message.substr(0, pos).c_str());
+	Entry entry{ message.substr(pos + 1), expireTime() };
+	std::lock_guard<std::mutex> lock(_mutex);
+	_version++;
+	// 只更新本服务器查询过的uid，其他uid等到第一次投递时再从 Redis 加载
+	auto iter = _routes.find(uid);
+	if (iter != _routes.end()) {
+		iter->second = std::move(entry);
+	}
+}
+
+bool RouteCache::GetRoute(int uid, std::string& server) {
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		auto iter = _routes.find(uid);
+		if (iter != _routes.end()) {
+			if (iter->second.expire > std::chrono::steady_clock::now()) {
+				_hits++;
+				server = iter->second.server;
+				return !server.empty();
+			}
+			_routes.erase(iter);
+		}
+	}
+	_misses++;
+
+	uint64_t version = _version;
+	std::string value = "";
+	bool b_ip = RedisMgr::GetInstance()->GetRoute(uid, value);
+
+	std::lock_guard<std::mutex> lock(_mutex);
+	// 查询期间收到过路由通知，Redis 的结果可能已经过期，不写入缓存
+	if (version == _version) {
+		_routes[uid] = Entry{ b_ip ? value : "", expireTime() };
+	}
+	server = value;
+	return b_ip;
+}
+
+void RouteCache::MarkStale(int uid) {
+	std::lock_guard<std::mutex> lock(_mutex);
+	if (_routes.erase(uid) > 0) {
+		_stale++;
+	}
+}
+
+void RouteCache::LogStats() {
+	uint64_t hits = _hits;
+	uint64_t misses = _misses;
+	size_t size = 0;
+	{
+		// 顺便清理已经过期的条目
+		std::lock_guard<std::mutex> lock(_mutex);
+		auto now = std::chrono::steady_clock::now();
+		for (auto iter = _routes.begin(); iter != _routes.end();) {
+			if (iter->second.expire <= now) {
+				iter = _routes.erase(iter);
+				continue;
+			}
+			iter++;
+		}
+		size = _routes.size();
+	}
+	double hit_rate = hits + misses == 0 ? 0.0 : (double)hits * 100 / (hits + misses);
+	spdlog::info("路由缓存 条目: {} 命中: {} 未命中: {} 命中率: {:.2f}% 过期路由: {}",
+		size, hits, misses, hit_rate, _stale.load());
+}
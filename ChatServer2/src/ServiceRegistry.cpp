@@ -0,0 +1,129 @@
+#include "ServiceRegistry.h"
+#include "ConfigMgr.h"
+#include "RedisMgr.h"
+#include "RedisSubscriber.h"
+#include <sstream>
+
+ServiceRegistry::ServiceRegistry() : _b_dirty(false), _b_stop(false) {
+	auto cfg = ConfigMgr::Inst().Snapshot();
+	_self_name = cfg->self_name;
+	_self_info = cfg->advertise_host + "," + std::to_string(cfg->self_port) + "," + std::to_string(cfg->rpc_port);
+}
+
+ServiceRegistry::~ServiceRegistry() {
+	Close();
+}
+
+void ServiceRegistry::Watch(Listener listener) {
+	std::lock_guard<std::mutex> lock(_mutex);
+	_listeners.push_back(std::move(listener));
+}
+
+void ServiceRegistry::Start() {
+	// 只做标记并唤醒注册中心线程，拉取成员和回调都不放在订阅线程里
+	RedisSubscriber::GetInstance()->Subscribe(MEMBERSHIP_CHANNEL, [this](const std::string&, const std::string& message) {
+		spdlog::info("收到ChatServer成员变更: {}", message);
+		std::lock_guard<std::mutex> lock(_mutex);
+		_b_dirty = true;
+		_cond.notify_one();
+		});
+
+	_thread = std::thread([this]() {
+		run();
+		});
+}
+
+void ServiceRegistry::Close() {
+	if (_b_stop.exchange(true)) {
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_cond.notify_one();
+	}
+	if (!_thread.joinable()) {
+		return;
+	}
+	_thread.join();
+	RedisMgr::GetInstance()->RegistryLeave(_self_name);
+}
+
+bool ServiceRegistry::parseNode(const std::string& name, const std::string& info, ChatNode& node) {
+	std::stringstream ss(info);
+	node.name = name;
+	if (!std::getline(ss, node.host, ',') || !std::getline(ss, node.port, ',') || !std::getline(ss, node.rpc_port, ',')) {
+		spdlog::error("注册中心节点 {} 地址格式错误: {}", name, info);
+		return false;
+	}
+	return true;
+}
+
+void ServiceRegistry::sync() {
+	std::map<std::string, std::string> infos;
+	if (!RedisMgr::GetInstance()->RegistryMembers(infos)) {
+		// 拉取失败时保留旧视图，避免Redis抖动把所有对端都摘掉
+		return;
+	}
+
+	std::map<std::string, ChatNode> latest;
+	for (auto& item : infos) {
+		ChatNode node;
+		if (item.first == _self_name || !parseNode(item.first, item.second, node)) {
+			continue;
+		}
+		latest[node.name] = node;
+	}
+
+	std::vector<std::pair<ChatNode, bool>> events;
+	for (auto& item : _members) {
+		auto iter = latest.find(item.first);
+		if (iter == latest.end() || iter->second != item.second) {
+			events.emplace_back(item.second, false);
+		}
+	}
+	for (auto& item : latest) {
+		auto iter = _members.find(item.first);
+		if (iter == _members.end() || iter->second != item.second) {
+			events.emplace_back(item.second, true);
+		}
+	}
+	_members.swap(latest);
+
+	if (events.empty()) {
+		return;
+	}
+
+	std::vector<Listener> listeners;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		listeners = _listeners;
+	}
+	for (auto& event : events) {
+		spdlog::info("ChatServer {} {}, 地址 {}:{}", event.first.name, event.second ? "加入" : "离开",
+			event.first.host, event.first.rpc_port);
+		for (auto& listener : listeners) {
+			listener(event.first, event.second);
+		}
+	}
+}
+
+void ServiceRegistry::run() {
+	auto next_beat = std::chrono::steady_clock::now();
+	while (!_b_stop) {
+		auto now = std::chrono::steady_clock::now();
+		if (now >= next_beat) {
+			// 心跳间隔支持热更新，每轮重新读取
+			auto cfg = ConfigMgr::Inst().Snapshot();
+			RedisMgr::GetInstance()->RegistryHeartbeat(_self_name, _self_info, cfg->registry_ttl_sec * 1000);
+			next_beat = now + std::chrono::seconds(cfg->registry_heartbeat_sec);
+		}
+
+		sync();
+
+		std::unique_lock<std::mutex> lock(_mutex);
+		_cond.wait_until(lock, next_beat, [this]() {
+			return _b_stop || _b_dirty;
+			});
+		_b_dirty = false;
+	}
+}
@@ -45,8 +45,6 @@ LoginRsp StatusGrpcClient::Login(int uid, std::string token)
 
 StatusGrpcClient::StatusGrpcClient()
 {
-	auto& gCfgMgr = ConfigMgr::Inst();
-	std::string host = gCfgMgr["StatusServer"]["Host"];
-	std::string port = gCfgMgr["StatusServer"]["Port"];
-	pool_.reset(new StatusConPool(5, host, port));
+	auto cfg = ConfigMgr::Inst().Snapshot();
+	pool_.reset(new StatusConPool(5, cfg->status_host, cfg->status_port));
 }
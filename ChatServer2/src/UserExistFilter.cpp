@@ -0,0 +1,189 @@
+#include "UserExistFilter.h"
+#include "ConfigMgr.h"
+#include "MysqlMgr.h"
+#include "RedisSubscriber.h"
+#include <algorithm>
+#include <boost/asio/post.hpp>
+#include <cctype>
+#include <vector>
+
+UserExistFilter::UserExistFilter() : _ready(false), _max_uid(0), _refresher(1), _refreshing(false), _epoch(0),
+	_bloom_rejects(0), _negative_hits(0), _passed(0) {
+	auto cfg = ConfigMgr::Inst().Snapshot();
+	// uid 和用户名各占一个元素，容量只在启动时确定
+	_bloom = std::make_unique<BloomFilter>(cfg->user_filter_expected * 2, cfg->user_filter_fp_rate);
+	spdlog::info("用户存在性过滤器 位数: {} 哈希函数: {}", _bloom->BitCount(), _bloom->HashCount());
+}
+
+UserExistFilter::~UserExistFilter() {
+	_refresher.join();
+}
+
+void UserExistFilter::Init() {
+	// 先订阅再加载，加载期间注册的用户不会漏掉
+	RedisSubscriber::GetInstance()->Subscribe(USER_REGISTERED_CHANNEL,
+		[this](const std::string&, const std::string& message) {
+			auto pos = message.find(',');
+			if (pos == std::string::npos) {
+				spdlog::error("注册通知格式错误: {}", message);
+				return;
+			}
+			onRegistered(atoi(message.c_str()), message.substr(pos + 1));
+		});
+
+	std::lock_guard<std::mutex> lock(_load_mutex);
+	if (!load(0)) {
+		spdlog::error("加载用户存在性过滤器失败，已加载到uid {}，定时器会继续加载", _max_uid.load());
+		return;
+	}
+	_ready = true;
+	spdlog::info("加载用户存在性过滤器到uid {}，共 {} 个元素", _max_uid.load(), _bloom->Added());
+}
+
+void UserExistFilter::Refresh() {
+	if (_refreshing.exchange(true)) {
+		return;
+	}
+	boost::asio::post(_refresher, [this]() {
+		refresh();
+		_refreshing = false;
+		});
+}
+
+void UserExistFilter::refresh() {
+	std::lock_guard<std::mutex> lock(_load_mutex);
+	if (!_ready) {
+		// 启动加载中途失败，从已加载的位置继续
+		_ready = load(_max_uid);
+		return;
+	}
+	load(std::max(0, _max_uid - REFRESH_OVERLAP));
+}
+
+bool UserExistFilter::load(int after_uid) {
+	while (true) {
+		std::vector<std::pair<int, std::string>> users;
+		if (!MysqlMgr::GetInstance()->ScanUsers(after_uid, LOAD_PAGE, users)) {
+			return false;
+		}
+		for (auto& user : users) {
+			_bloom->Add(uidKey(user.first));
+			_bloom->Add(normalizeName(user.second));
+			after_uid = user.first;
+		}
+		if (after_uid > _max_uid) {
+			_max_uid = after_uid;
+		}
+		if ((int)users.size() < LOAD_PAGE) {
+			return true;
+		}
+	}
+}
+
+void UserExistFilter::onRegistered(int uid, const std::string& name) {
+	if (uid <= 0) {
+		return;
+	}
+	auto key = normalizeName(name);
+	_bloom->Add(uidKey(uid));
+	_bloom->Add(key);
+
+	std::lock_guard<std::mutex> lock(_mutex);
+	_epoch++;
+	_missing_uids.Erase(uid);
+	_missing_names.Erase(key);
+}
+
+bool UserExistFilter::MayExist(int uid) {
+	if (uid <= 0) {
+		_bloom_rejects++;
+		return false;
+	}
+	if (_ready && !_bloom->MayContain(uidKey(uid))) {
+		_bloom_rejects++;
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lock(_mutex);
+	if (_missing_uids.Contains(uid, std::chrono::steady_clock::now())) {
+		_negative_hits++;
+		return false;
+	}
+	_passed++;
+	return true;
+}
+
+bool UserExistFilter::MayExist(const std::string& name) {
+	if (!isAscii(name)) {
+		_passed++;
+		return true;
+	}
+	auto key = normalizeName(name);
+	if (key.empty() || (_ready && !_bloom->MayContain(key))) {
+		_bloom_rejects++;
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lock(_mutex);
+	if (_missing_names.Contains(key, std::chrono::steady_clock::now())) {
+		_negative_hits++;
+		return false;
+	}
+	_passed++;
+	return true;
+}
+
+void UserExistFilter::MarkMissing(int uid, uint64_t epoch) {
+	auto cfg = ConfigMgr::Inst().Snapshot();
+	if (cfg->user_negative_ttl <= 0) {
+		return;
+	}
+	auto expire = std::chrono::steady_clock::now() + std::chrono::seconds(cfg->user_negative_ttl);
+	std::lock_guard<std::mutex> lock(_mutex);
+	if (_epoch != epoch) {
+		return;
+	}
+	_missing_uids.Insert(uid, expire, cfg->user_negative_capacity);
+}
+
+void UserExistFilter::MarkMissing(const std::string& name, uint64_t epoch) {
+	auto cfg = ConfigMgr::Inst().Snapshot();
+	if (cfg->user_negative_ttl <= 0 || !isAscii(name)) {
+		return;
+	}
+	auto expire = std::chrono::steady_clock::now() + std::chrono::seconds(cfg->user_negative_ttl);
+	std::lock_guard<std::mutex> lock(_mutex);
+	if (_epoch != epoch) {
+		return;
+	}
+	_missing_names.Insert(normalizeName(name), expire, cfg->user_negative_capacity);
+}
+
+std::string UserExistFilter::normalizeName(const std::string& name) {
+	auto end = name.find_last_not_of(' ');
+	std::string key = end == std::string::npos ? std::string() : name.substr(0, end + 1);
+	std::transform(key.begin(), key.end(), key.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+	return key;
+}
+
+bool UserExistFilter::isAscii(const std::string& name) {
+	return std::all_of(name.begin(), name.end(), [](unsigned char c) { return c < 0x80; });
+}
+
+std::string UserExistFilter::uidKey(int uid) {
+	return "#" + std::to_string(uid);
+}
+
+void UserExistFilter::LogStats() {
+	size_t missing = 0;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		missing = _missing_uids.Size() + _missing_names.Size();
+	}
+	spdlog::info("用户存在性过滤 就绪: {} 过滤器拦截: {} 负缓存拦截: {} 放行: {} 负缓存条目: {}",
+		_ready.load(), _bloom_rejects.load(), _negative_hits.load(), _passed.load(), missing);
+	// 元素数超过预计值后误判率上升，拦截效果变差，需要调大 ExpectedUsers 后重启
+	if (_bloom->Added() > _bloom->Expected()) {
+		spdlog::warn("用户存在性过滤器元素数 {} 已超过预计值 {}", _bloom->Added(), _bloom->Expected());
+	}
+}
@@ -0,0 +1,299 @@
+#include "UserInfoCache.h"
+#include "ConfigMgr.h"
+#include "RedisMgr.h"
+#include "RedisSubscriber.h"
+#include "MysqlMgr.h"
+#include "UserProfileCodec.h"
+#include "DistLock.h"
+
+UserInfoCache::UserInfoCache() : _shard_capacity(0),
+	_hits(0), _misses(0), _evictions(0), _invalidations(0), _lease_timeouts(0) {
+	auto cfg = ConfigMgr::Inst().Snapshot();
+	_shard_capacity = cfg->user_cache_capacity / SHARD_COUNT;
+	if (_shard_capacity == 0) {
+		_shard_capacity = 1;
+	}
+
+	// 订阅失效通知，消息内容是 uid
+	RedisSubscriber::GetInstance()->Subscribe(USER_INFO_INVALIDATE,
+		[this](const std::string&, const std::string& message) {
+			try {
+				erase(std::stoi(message));
+			}
+			catch (std::exception& exp) {
+				spdlog::error("用户信息失效通知格式错误: {} {}", message, exp.what());
+			}
+		});
+}
+
+UserInfoCache::~UserInfoCache() {
+
+}
+
+bool UserInfoCache::getLocal(int uid, std::shared_ptr<UserInfo>& userinfo) {
+	auto& shard = shardOf(uid);
+	std::lock_guard<std::mutex> lock(shard.mutex);
+	auto iter = shard.index.find(uid);
+	if (iter == shard.index.end()) {
+		return false;
+	}
+
+	if (iter->second->second.expire <= std::chrono::steady_clock::now()) {
+		shard.lru.erase(iter->second);
+		shard.index.erase(iter);
+		return false;
+	}
+
+	// 移到头部，标记为最近使用
+	shard.lru.splice(shard.lru.begin(), shard.lru, iter->second);
+	userinfo = std::make_shared<UserInfo>(*iter->second->second.info);
+	return true;
+}
+
+uint64_t UserInfoCache::versionOf(int uid) {
+	auto& shard = shardOf(uid);
+	std::lock_guard<std::mutex> lock(shard.mutex);
+	return shard.version;
+}
+
+void UserInfoCache::Put(const std::shared_ptr<const UserInfo>& userinfo) {
+	if (userinfo == nullptr) {
+		return;
+	}
+	put(userinfo, versionOf(userinfo->uid));
+}
+
+void UserInfoCache::put(const std::shared_ptr<const UserInfo>& userinfo, uint64_t version) {
+	int uid = userinfo->uid;
+	// TTL 每次从快照读取，热更新后立即生效；容量只在启动时确定
+	auto ttl = std::chrono::seconds(ConfigMgr::Inst().Snapshot()->user_cache_ttl);
+	Entry entry{ std::make_shared<const UserInfo>(*userinfo),
+		std::chrono::steady_clock::now() + ttl };
+
+	auto& shard = shardOf(uid);
+	std::lock_guard<std::mutex> lock(shard.mutex);
+	if (shard.version != version) {
+		return;
+	}
+	auto iter = shard.index.find(uid);
+	if (iter != shard.index.end()) {
+		iter->second->second = std::move(entry);
+		shard.lru.splice(shard.lru.begin(), shard.lru, iter->second);
+		return;
+	}
+
+	shard.lru.emplace_front(uid, std::move(entry));
+	shard.index[uid] = shard.lru.begin();
+	// 超出容量淘汰最久未使用的条目
+	while (shard.index.size() > _shard_capacity) {
+		shard.index.erase(shard.lru.back().first);
+		shard.lru.pop_back();
+		_evictions++;
+	}
+}
+
+void UserInfoCache::erase(int uid) {
+	auto& shard = shardOf(uid);
+	std::lock_guard<std::mutex> lock(shard.mutex);
+	// 没有条目也要加一，正在回源的查询可能马上写入
+	shard.version++;
+	auto iter = shard.index.find(uid);
+	if (iter == shard.index.end()) {
+		return;
+	}
+	shard.lru.erase(iter->second);
+	shard.index.erase(iter);
+	_invalidations++;
+}
+
+void UserInfoCache::Invalidate(int uid) {
+	erase(uid);
+	RedisMgr::GetInstance()->Publish(USER_INFO_INVALIDATE, std::to_string(uid));
+}
+
+bool UserInfoCache::GetBaseInfo(int uid, std::shared_ptr<UserInfo>& userinfo) {
+	return LookupBaseInfo(uid, userinfo) == LOOKUP_FOUND;
+}
+
+LookupResult UserInfoCache::LookupBaseInfo(int uid, std::shared_ptr<UserInfo>& userinfo) {
+	if (getLocal(uid, userinfo)) {
+		_hits++;
+		return LOOKUP_FOUND;
+	}
+	_misses++;
+
+	//同一uid并发未命中时共享一次回源的结果，各自拿一份拷贝
+	auto loaded = _uid_flight.Do(uid, [this, uid]() { return loadByUid(uid); });
+	if (loaded.result != LOOKUP_FOUND) {
+		return loaded.result;
+	}
+	userinfo = std::make_shared<UserInfo>(*loaded.info);
+	return LOOKUP_FOUND;
+}
+
+UserInfoCache::Loaded UserInfoCache::loadLeased(const std::string& lease_name,
+	const std::function<std::shared_ptr<UserInfo>()>& reread,
+	const std::function<Loaded()>& load) {
+	auto cfg = ConfigMgr::Inst().Snapshot();
+	if (cfg->user_load_lease <= 0) {
+		return load();
+	}
+
+	//只短暂等待租约：持有者查库通常在几毫秒内回填 Redis，等满租约时长会阻塞逻辑线程上排队的其他消息
+	auto identifier = DistLock::Inst().acquireLock(lease_name, cfg->user_load_lease,
+		std::chrono::milliseconds(cfg->user_load_wait_ms));
+	if (identifier.empty()) {
+		_lease_timeouts++;
+		return load();
+	}
+	Defer defer([&lease_name, &identifier]() {
+		DistLock::Inst().releaseLock(lease_name, identifier);
+	});
+
+	auto user_info = reread();
+	if (user_info != nullptr) {
+		return Loaded{ LOOKUP_FOUND, user_info };
+	}
+	return load();
+}
+
+UserInfoCache::Loaded UserInfoCache::loadByUid(int uid) {
+	auto read_redis = [uid]() -> std::shared_ptr<UserInfo> {
+		std::string profile = "";
+		auto user_info = std::make_shared<UserInfo>();
+		if (!RedisMgr::GetInstance()->GetProfile(uid, profile) || !UserProfileCodec::Parse(profile, *user_info)) {
+			return nullptr;
+		}
+		return user_info;
+	};
+
+	//先记下分片版本号，回源期间收到失效通知的话结果可能已经过期，只返回不缓存
+	uint64_t version = versionOf(uid);
+	//通过redis查询用户基本信息
+	auto user_info = read_redis();
+	if (user_info != nullptr) {
+		spdlog::info("从Redis查到用户信息  {} 用户名：{} 昵称：{} 描述：{} 性别：{} 头像：{}", user_info->uid, user_info->name, user_info->nick, user_info->desc, user_info->sex, user_info->icon);
+	}
+	else {
+		//redis中没有则从数据库中查询，并将查询到的用户信息写入redis
+		auto loaded = loadLeased("ubase_" + std::to_string(uid), read_redis, [uid]() {
+			std::shared_ptr<UserInfo> db_info;
+			auto result = MysqlMgr::GetInstance()->GetUser(uid, db_info);
+			if (result == LOOKUP_FOUND) {
+				RedisMgr::GetInstance()->SetProfile(uid, UserProfileCodec::Serialize(*db_info));
+			}
+			return Loaded{ result, db_info };
+		});
+		if (loaded.result == LOOKUP_FOUND) {
+			put(loaded.info, version);
+		}
+		return loaded;
+	}
+
+	put(user_info, version);
+	return Loaded{ LOOKUP_FOUND, user_info };
+}
+
+bool UserInfoCache::GetBaseInfos(const std::vector<int>& uids, std::unordered_map<int, std::shared_ptr<UserInfo>>& infos) {
+	std::vector<int> misses;
+	for (auto uid : uids) {
+		std::shared_ptr<UserInfo> user_info;
+		if (getLocal(uid, user_info)) {
+			_hits++;
+			infos[uid] = user_info;
+			continue;
+		}
+		_misses++;
+		misses.push_back(uid);
+	}
+	if (misses.empty()) {
+		return true;
+	}
+
+	//本地未命中的从redis批量读取，先记下各自分片的版本号
+	std::unordered_map<int, uint64_t> versions;
+	for (auto uid : misses) {
+		versions[uid] = versionOf(uid);
+	}
+	auto profiles = RedisMgr::GetInstance()->GetProfiles(misses);
+	std::vector<int> db_uids;
+	for (size_t i = 0; i < misses.size(); ++i) {
+		auto user_info = std::make_shared<UserInfo>();
+		if (profiles[i] && UserProfileCodec::Parse(*profiles[i], *user_info)) {
+			put(user_info, versions[misses[i]]);
+			infos[misses[i]] = user_info;
+			continue;
+		}
+		db_uids.push_back(misses[i]);
+	}
+	if (db_uids.empty()) {
+		return true;
+	}
+
+	//redis中也没有的从数据库批量查询，并回填redis，不等待写入完成
+	std::vector<std::shared_ptr<UserInfo>> users;
+	if (!MysqlMgr::GetInstance()->GetUsers(db_uids, users)) {
+		return false;
+	}
+	for (auto& user_info : users) {
+		RedisMgr::GetInstance()->SetProfileAsync(user_info->uid, UserProfileCodec::Serialize(*user_info));
+		put(user_info, versions[user_info->uid]);
+		infos[user_info->uid] = user_info;
+	}
+	return true;
+}
+
+bool UserInfoCache::GetBaseInfoByName(const std::string& name, std::shared_ptr<UserInfo>& userinfo) {
+	return LookupBaseInfoByName(name, userinfo) == LOOKUP_FOUND;
+}
+
+LookupResult UserInfoCache::LookupBaseInfoByName(const std::string& name, std::shared_ptr<UserInfo>& userinfo) {
+	int uid = 0;
+	if (RedisMgr::GetInstance()->GetNameIndex(name, uid)) {
+		return LookupBaseInfo(uid, userinfo);
+	}
+
+	auto loaded = _name_flight.Do(name, [this, &name]() { return loadByName(name); });
+	if (loaded.result != LOOKUP_FOUND) {
+		return loaded.result;
+	}
+	userinfo = std::make_shared<UserInfo>(*loaded.info);
+	return LOOKUP_FOUND;
+}
+
+UserInfoCache::Loaded UserInfoCache::loadByName(const std::string& name) {
+	//索引中没有则从数据库中按用户名查询，同时回填索引和基础信息
+	auto loaded = loadLeased("uname_" + name, [this, &name]() -> std::shared_ptr<UserInfo> {
+		int uid = 0;
+		std::shared_ptr<UserInfo> cached;
+		if (!RedisMgr::GetInstance()->GetNameIndex(name, uid) || !GetBaseInfo(uid, cached)) {
+			return nullptr;
+		}
+		return cached;
+	}, [&name]() {
+		std::shared_ptr<UserInfo> db_info;
+		auto result = MysqlMgr::GetInstance()->GetUser(name, db_info);
+		if (result == LOOKUP_FOUND) {
+			RedisMgr::GetInstance()->SetNameIndex(name, db_info->uid);
+			RedisMgr::GetInstance()->SetProfile(db_info->uid, UserProfileCodec::Serialize(*db_info));
+		}
+		return Loaded{ result, db_info };
+	});
+	//查库之前不知道uid，拿不到分片版本号，不写入本地缓存；下次按uid查询时从刚回填的 Redis 读取
+	return loaded;
+}
+
+void UserInfoCache::LogStats() {
+	uint64_t hits = _hits;
+	uint64_t misses = _misses;
+	size_t size = 0;
+	for (auto& shard : _shards) {
+		std::lock_guard<std::mutex> lock(shard.mutex);
+		size += shard.index.size();
+	}
+	double hit_rate = hits + misses == 0 ? 0.0 : (double)hits * 100 / (hits + misses);
+	spdlog::info("用户信息缓存 条目: {} 命中: {} 未命中: {} 命中率: {:.2f}% 淘汰: {} 失效: {}",
+		size, hits, misses, hit_rate, _evictions.load(), _invalidations.load());
+	spdlog::info("用户信息回源 执行: {} 合并: {} 租约超时: {}",
+		_uid_flight.Loads() + _name_flight.Loads(), _uid_flight.Shared() + _name_flight.Shared(), _lease_timeouts.load());
+}
@@ -0,0 +1,95 @@
+#include "UserProfileCodec.h"
+#include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/io/zero_copy_stream_impl_lite.h>
+#include <google/protobuf/wire_format_lite.h>
+
+using google::protobuf::io::CodedInputStream;
+using google::protobuf::io::CodedOutputStream;
+using google::protobuf::io::StringOutputStream;
+using google::protobuf::internal::WireFormatLite;
+
+enum ProfileField {
+	FIELD_UID = 1,
+	FIELD_NAME = 2,
+	FIELD_PWD = 3,
+	FIELD_EMAIL = 4,
+	FIELD_NICK = 5,
+	FIELD_DESC = 6,
+	FIELD_SEX = 7,
+	FIELD_ICON = 8,
+};
+
+static void writeString(int field, const std::string& value, CodedOutputStream* output) {
+	if (!value.empty()) {
+		WireFormatLite::WriteString(field, value, output);
+	}
+}
+
+static void writeInt(int field, int value, CodedOutputStream* output) {
+	if (value != 0) {
+		WireFormatLite::WriteInt32(field, value, output);
+	}
+}
+
+std::string UserProfileCodec::Serialize(const UserInfo& userinfo) {
+	std::string data;
+	{
+		// 析构时才把缓冲区中剩余的字节写回 data
+		StringOutputStream stream(&data);
+		CodedOutputStream output(&stream);
+		writeInt(FIELD_UID, userinfo.uid, &output);
+		writeString(FIELD_NAME, userinfo.name, &output);
+		writeString(FIELD_PWD, userinfo.pwd, &output);
+		writeString(FIELD_EMAIL, userinfo.email, &output);
+		writeString(FIELD_NICK, userinfo.nick, &output);
+		writeString(FIELD_DESC, userinfo.desc, &output);
+		writeInt(FIELD_SEX, userinfo.sex, &output);
+		writeString(FIELD_ICON, userinfo.icon, &output);
+	}
+	return data;
+}
+
+bool UserProfileCodec::Parse(const std::string& data, UserInfo& userinfo) {
+	CodedInputStream input(reinterpret_cast<const uint8_t*>(data.data()), static_cast<int>(data.size()));
+	UserInfo parsed;
+	uint32_t tag = 0;
+	while ((tag = input.ReadTag()) != 0) {
+		auto wire_type = WireFormatLite::GetTagWireType(tag);
+		std::string* str = nullptr;
+		int* num = nullptr;
+		switch (WireFormatLite::GetTagFieldNumber(tag)) {
+		case FIELD_UID: num = &parsed.uid; break;
+		case FIELD_NAME: str = &parsed.name; break;
+		case FIELD_PWD: str = &parsed.pwd; break;
+		case FIELD_EMAIL: str = &parsed.email; break;
+		case FIELD_NICK: str = &parsed.nick; break;
+		case FIELD_DESC: str = &parsed.desc; break;
+		case FIELD_SEX: num = &parsed.sex; break;
+		case FIELD_ICON: str = &parsed.icon; break;
+		default: break;
+		}
+
+		bool ok = true;
+		if (str != nullptr && wire_type == WireFormatLite::WIRETYPE_LENGTH_DELIMITED) {
+			ok = WireFormatLite::ReadString(&input, str);
+		}
+		else if (num != nullptr && wire_type == WireFormatLite::WIRETYPE_VARINT) {
+			uint32_t value = 0;
+			ok = input.ReadVarint32(&value);
+			*num = static_cast<int>(value);
+		}
+		else {
+			ok = WireFormatLite::SkipField(&input, tag);
+		}
+		if (!ok) {
+			return false;
+		}
+	}
+
+	// ReadTag 在数据结束和数据损坏时都返回0，只有完整读完才算成功
+	if (input.CurrentPosition() != static_cast<int>(data.size())) {
+		return false;
+	}
+	userinfo = std::move(parsed);
+	return true;
+}
@@ -741,7 +741,7 @@ const char descriptor_table_protodef_message_2eproto[] PROTOBUF_SECTION_VARIABLE
     "\n\rStatusService\022G\n\rGetChatServer\022\031.messa"
     "ge.GetChatServerReq\032\031.message.GetChatSer"
     "verRsp\"\000\022-\n\005Login\022\021.message.LoginReq\032\021.m"
-    "essage.LoginRsp2\245\003\n\013ChatService\022A\n\017Notif"
+    "essage.LoginRsp2\362\003\n\013ChatService\022A\n\017Notif"
     "yAddFriend\022\025.message.AddFriendReq\032\025.mess"
     "age.AddFriendRsp\"\000\022A\n\rRplyAddFriend\022\026.me"
     "ssage.RplyFriendReq\032\026.message.RplyFriend"
@@ -751,14 +751,16 @@ const char descriptor_table_protodef_message_2eproto[] PROTOBUF_SECTION_VARIABLE
     "essage.AuthFriendRsp\"\000\022G\n\021NotifyTextChat"
     "Msg\022\027.message.TextChatMsgReq\032\027.message.T"
     "extChatMsgRsp\"\000\022>\n\016NotifyKickUser\022\024.mess"
-    "age.KickUserReq\032\024.message.KickUserRsp\"\000b"
-    "\006proto3"
+    "age.KickUserReq\032\024.message.KickUserRsp\"\000\022"
+    "K\n\021TextChatMsgStream\022\027.message.TextChatM"
+    "sgReq\032\027.message.TextChatMsgRsp\"\000(\0010\001b\006pr"
+    "oto3"
 };
 static ::absl::once_flag descriptor_table_message_2eproto_once;
 const ::_pbi::DescriptorTable descriptor_table_message_2eproto = {
     false,
     false,
-    1847,
+    1924,
     descriptor_table_protodef_message_2eproto,
     "message.proto",
     &descriptor_table_message_2eproto_once,
@@ -0,0 +1,114 @@
+#pragma once
+#include "const.h"
+#include "grpc_macros.h"
+#include <chrono>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+
+// 投递到 CompletionQueue 的tag，轮询线程取出后回调并释放
+class AsyncCallBase
+{
+public:
+    virtual ~AsyncCallBase() {}
+    virtual void OnComplete() = 0;
+};
+
+// 一次一元异步调用的全部状态，生命周期从发起到轮询线程取回结果
+template <typename Rsp>
+class AsyncCall : public AsyncCallBase
+{
+public:
+    // 在轮询线程中执行，用于补全回包、投递后续处理，不要做阻塞操作
+    using Callback = std::function<void(const grpc::Status &status, Rsp &reply)>;
+
+    void OnComplete() override
+    {
+        if (callback)
+        {
+            callback(status, reply);
+        }
+        promise.set_value(std::move(reply));
+    }
+
+    grpc::ClientContext context;
+    grpc::Status status;
+    Rsp reply;
+    std::unique_ptr<grpc::ClientAsyncResponseReader<Rsp>> reader;
+    std::promise<Rsp> promise;
+    Callback callback;
+};
+
+// 一个 CompletionQueue 配一个轮询线程，调用方发起请求后立即拿到 future，不会阻塞io线程
+class AsyncRpcQueue
+{
+public:
+    AsyncRpcQueue() : b_stop_(false)
+    {
+        thread_ = std::thread([this]()
+                              {
+            void* tag = nullptr;
+            bool ok = false;
+            while (cq_.Next(&tag, &ok)) {
+                auto* call = static_cast<AsyncCallBase*>(tag);
+                call->OnComplete();
+                delete call;
+            } });
+    }
+
+    ~AsyncRpcQueue()
+    {
+        Close();
+    }
+
+    // prepare 形如 stub->PrepareAsyncXxx(context, request, cq)，超时由 timeout_ms 控制
+    template <typename Rsp, typename Req, typename Prepare>
+    std::future<Rsp> Call(const Req &request, int timeout_ms, Prepare prepare,
+                          typename AsyncCall<Rsp>::Callback callback)
+    {
+        auto *call = new AsyncCall<Rsp>();
+        call->callback = std::move(callback);
+        auto future = call->promise.get_future();
+        call->context.set_deadline(std::chrono::system_clock::now() + std::chrono::milliseconds(timeout_ms));
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        // 队列已关闭时不能再投递，直接按调用失败处理
+        if (b_stop_)
+        {
+            call->status = grpc::Status(grpc::StatusCode::UNAVAILABLE, "completion queue closed");
+            call->OnComplete();
+            delete call;
+            return future;
+        }
+
+        call->reader = prepare(&call->context, request, &cq_);
+        call->reader->StartCall();
+        call->reader->Finish(&call->reply, &call->status, call);
+        return future;
+    }
+
+    // 已发出的请求会在超时前全部回调完毕后再退出
+    void Close()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (b_stop_)
+            {
+                return;
+            }
+            b_stop_ = true;
+            cq_.Shutdown();
+        }
+        if (thread_.joinable())
+        {
+            thread_.join();
+        }
+    }
+
+private:
+    grpc::CompletionQueue cq_;
+    std::mutex mutex_;
+    bool b_stop_;
+    std::thread thread_;
+};
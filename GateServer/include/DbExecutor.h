@@ -0,0 +1,67 @@
+#pragma once
+#include "Singleton.h"
+#include "const.h"
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// 数据库专用的执行器，查询在自己的线程池中执行，io线程只负责投递和回包
+// 队列有上限，积压过多时直接拒绝，不让请求在队列里一直排到客户端超时
+class DbExecutor : public Singleton<DbExecutor>
+{
+    friend class Singleton<DbExecutor>;
+
+public:
+    ~DbExecutor();
+
+    // 在数据库线程执行 query，完成后把返回值投递到 executor 上调用 on_done
+    // 队列已满或已关闭时返回false，query 和 on_done 都不会执行
+    template <typename Query, typename Executor, typename Done>
+    bool Post(Query query, const Executor &executor, Done on_done)
+    {
+        return enqueue([query, executor, on_done]()
+                       {
+            auto result = query();
+            boost::asio::post(executor, [on_done, result]()
+                              { on_done(result); }); });
+    }
+
+    // 返回future，供不在io线程上的调用者等待结果
+    // 队列已满或已关闭时future中是 std::runtime_error
+    template <typename Query>
+    std::future<std::invoke_result_t<Query>> Submit(Query query)
+    {
+        using Result = std::invoke_result_t<Query>;
+        auto task = std::make_shared<std::packaged_task<Result()>>(std::move(query));
+        auto future = task->get_future();
+        if (!enqueue([task]()
+                     { (*task)(); }))
+        {
+            std::promise<Result> rejected;
+            rejected.set_exception(std::make_exception_ptr(std::runtime_error("db executor rejected")));
+            return rejected.get_future();
+        }
+        return future;
+    }
+
+    // 不再接收新任务，已入队的任务执行完后线程退出
+    void Close();
+
+private:
+    DbExecutor();
+    bool enqueue(std::function<void()> job);
+    void run();
+
+    std::deque<std::function<void()>> jobs_;
+    size_t max_queue_;
+    std::mutex mutex_;
+    std::condition_variable cond_;
+    bool b_stop_;
+    std::vector<std::thread> threads_;
+};
@@ -13,6 +13,13 @@ public:
     {
         return _socket;
     }
+    // 处理器要等异步结果时先调用 DeferReply，HandleReq 返回后不会立即回包
+    void DeferReply()
+    {
+        _deferred = true;
+    }
+    // 可在任意线程调用，回包会投递回连接所属的io线程执行
+    void Reply(const std::string &body);
 
 private:
     void CheckDeadline();
@@ -32,6 +39,9 @@ private:
     net::steady_timer deadline_{
         _socket.get_executor(), std::chrono::seconds(60)};
 
+    // 是否由处理器稍后调用 Reply 回包
+    bool _deferred = false;
+
     std::string _get_url;
     std::unordered_map<std::string, std::string> _get_params;
 };
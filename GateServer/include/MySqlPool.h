@@ -0,0 +1,183 @@
+#pragma once
+#include "const.h"
+#include <mysqlx/xdevapi.h>
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+struct MySqlPoolOptions {
+	// 日志中区分主库和各个副本的连接池
+	std::string name = "primary";
+	std::string host;
+	int port = 33060;
+	std::string user;
+	std::string pass;
+	std::string schema;
+	// 常驻的最少连接数，空闲超时的连接只回收到这个数量为止
+	int min_size = 2;
+	// 连接数上限，没有空闲连接时在上限内按需新建
+	int max_size = 16;
+	// 借连接的最长等待时间(毫秒)，超时返回空
+	int acquire_timeout_ms = 3000;
+	// 连接空闲超过这个时间(秒)且多于 min_size 时关闭
+	int idle_timeout_sec = 300;
+};
+
+// 使用 X DevAPI 的 Session
+class SqlConnection {
+public:
+	SqlConnection(std::shared_ptr<mysqlx::Session> session, const std::string& schema, int64_t lasttime) :
+		_session(session),
+		_last_oper_time(lasttime),
+		_last_ping_time(lasttime),
+		_schema(schema)
+	{
+	}
+
+	mysqlx::Table Table(const std::string& name) {
+		return _session->getSchema(_schema).getTable(name);
+	}
+
+	// 按名字缓存在本连接上的 CRUD 语句，首次使用时由 factory 构造；
+	// 同一个语句对象只换绑定值再次执行时，连接器会自动在服务端预处理，之后只发送参数
+	template <typename Stmt, typename Factory>
+	Stmt& Statement(const std::string& name, Factory factory) {
+		auto iter = _statements.find(name);
+		if (iter == _statements.end()) {
+			iter = _statements.emplace(name, std::make_shared<Stmt>(factory(*this))).first;
+		}
+		return *static_cast<Stmt*>(iter->second.get());
+	}
+
+	std::shared_ptr<mysqlx::Session> _session;
+	// 最近一次归还的时刻，空闲回收按它计算
+	int64_t _last_oper_time;
+	// 最近一次执行或保活成功的时刻，保活按它计算
+	int64_t _last_ping_time;
+private:
+	std::string _schema;
+	// 语句依附于创建它的 Session，连接重建时随旧对象一起释放
+	std::unordered_map<std::string, std::shared_ptr<void>> _statements;
+};
+
+// 使用 X DevAPI 的弹性连接池
+// 启动时建立 min_size 个连接，借不到空闲连接时在 max_size 以内就地新建，
+// 后台线程定期保活空闲连接、回收空闲过久的连接并补足 min_size；
+// 借连接的等待时间和每类查询的耗时按桶统计，周期性输出，便于发现连接池饥饿
+class MySqlPool {
+public:
+	MySqlPool(const MySqlPoolOptions& options);
+	~MySqlPool();
+
+	// 借出一个连接，超时或连接池已关闭时返回空
+	std::unique_ptr<SqlConnection> getConnection();
+	void returnConnection(std::unique_ptr<SqlConnection> con);
+	// 查询出错的连接不再放回空闲队列，直接关闭并让出名额，由借连接或检查线程重新建立
+	void discardConnection(std::unique_ptr<SqlConnection> con);
+	// 是否还有建立着的连接且最近没有失败，数据库断开、补建失败或刚有查询出错时为false
+	bool Available();
+	// 记录一次查询的耗时，耗时从 start 计到现在
+	void RecordQuery(const std::string& query, std::chrono::steady_clock::time_point start, bool ok);
+	// 输出本周期的统计并清零
+	void LogStats();
+	void Close();
+
+private:
+	std::unique_ptr<SqlConnection> connect();
+	void checkConnection();
+	void recordWait(std::chrono::steady_clock::time_point start, bool ok);
+	// 建连接、保活或查询失败时调用，之后 FAILURE_COOLDOWN_SEC 内 Available 返回false，需持有 _mutex
+	void markFailure();
+	static int64_t now();
+
+	// 检查线程的运行间隔、空闲连接的保活间隔和统计输出间隔(秒)
+	static const int CHECK_INTERVAL_SEC = 10;
+	static const int KEEPALIVE_SEC = 60;
+	static const int STATS_INTERVAL_SEC = 60;
+	// 失败后暂停把读请求路由到这里的时间(秒)，与检查间隔相同，期间检查线程会补建连接
+	static const int FAILURE_COOLDOWN_SEC = 10;
+
+	// 各个桶的上界(微秒)，最后一个桶收纳所有更慢的操作
+	static constexpr std::array<uint64_t, 9> BUCKET_BOUNDS = { 100, 500, 1000, 5000, 10000, 50000, 100000, 500000, UINT64_MAX };
+	struct LatencyStats {
+		uint64_t count = 0;
+		uint64_t failed = 0;
+		uint64_t total_us = 0;
+		uint64_t max_us = 0;
+		std::array<uint64_t, BUCKET_BOUNDS.size()> buckets{};
+
+		void Add(uint64_t cost_us, bool ok);
+		uint64_t Percentile(double ratio) const;
+	};
+
+	MySqlPoolOptions _options;
+	// 空闲连接，尾部是最近归还的；借出时取尾部，头部的连接最先空闲超时
+	std::deque<std::unique_ptr<SqlConnection>> _idle;
+	// 已建立和正在建立的连接总数，包括借出的
+	int _total;
+	// 正在等待连接的调用者数量
+	int _waiting;
+	bool _b_stop;
+	std::mutex _mutex;
+	// 等待连接的调用者在 _cond 上等待，检查线程在 _stop_cond 上休眠，互不抢占通知
+	std::condition_variable _cond;
+	std::condition_variable _stop_cond;
+	std::thread _check_thread;
+	// 本统计周期内连接数和等待者数量的峰值
+	int _peak_total;
+	int _peak_waiting;
+	// 最近一次失败之后恢复可用的时刻
+	std::chrono::steady_clock::time_point _healthy_after;
+
+	std::mutex _stats_mutex;
+	LatencyStats _wait_stats;
+	std::map<std::string, LatencyStats> _query_stats;
+};
+
+// 借出连接并在析构时归还，同时把从借出到归还的耗时记在 query 名下
+class PooledConnection {
+public:
+	PooledConnection(MySqlPool& pool, const char* query) :
+		_pool(pool),
+		_query(query),
+		_con(pool.getConnection()),
+		_start(std::chrono::steady_clock::now()),
+		_ok(true)
+	{
+	}
+
+	~PooledConnection() {
+		if (_con == nullptr) {
+			return;
+		}
+		_pool.RecordQuery(_query, _start, _ok);
+		if (!_ok) {
+			_pool.discardConnection(std::move(_con));
+			return;
+		}
+		_pool.returnConnection(std::move(_con));
+	}
+
+	PooledConnection(const PooledConnection&) = delete;
+	PooledConnection& operator=(const PooledConnection&) = delete;
+
+	explicit operator bool() const { return _con != nullptr; }
+	SqlConnection* operator->() const { return _con.get(); }
+	// 查询抛出异常时调用，计入失败次数；会话的状态不确定，归还时关闭而不是放回连接池
+	void Fail() { _ok = false; }
+
+private:
+	MySqlPool& _pool;
+	const char* _query;
+	std::unique_ptr<SqlConnection> _con;
+	// 拿到连接之后才开始计时，等待连接的耗时单独统计
+	std::chrono::steady_clock::time_point _start;
+	bool _ok;
+};
@@ -1,47 +1,6 @@
 #pragma once
 #include "const.h"
-#include <thread>
-#include <atomic>
-#include <condition_variable>
-#include <queue>
-#include <mutex>
-
-// 使用 X DevAPI 的 Session
-class SqlConnection {
-public:
-	SqlConnection(std::shared_ptr<mysqlx::Session> session, int64_t lasttime) :
-		_session(session),
-		_last_oper_time(lasttime)
-	{
-	}
-
-	std::shared_ptr<mysqlx::Session> _session;
-	int64_t _last_oper_time;
-};
-
-// 使用 X DevAPI 的连接池
-class MySqlPool {
-public:
-	MySqlPool(const std::string& url, const std::string& user, const std::string& pass, const std::string& schema, int poolSize);
-	~MySqlPool();
-
-	void checkConnection();
-	std::unique_ptr<SqlConnection> getConnection();
-	void returnConnection(std::unique_ptr<SqlConnection> con);
-	void Close();
-
-private:
-	std::string url_;
-	std::string user_;
-	std::string pass_;
-	std::string schema_;
-	int poolSize_;
-	std::queue<std::unique_ptr<SqlConnection>> pool_;
-	std::mutex mutex_;
-	std::condition_variable cond_;
-	std::atomic<bool> b_stop_;
-	std::thread _check_thread;
-};
+#include "MySqlPool.h"
 
 struct UserInfo {
 	std::string name;
@@ -280,6 +280,7 @@ public:
 	bool HDel(const std::string& key, const std::string& field);
 	bool Del(const std::string &key);
 	bool ExistsKey(const std::string &key);
+	bool Publish(const std::string& channel, const std::string& message);
 	void Close() {
 		_con_pool->Close();
 		_con_pool->ClearConnections();
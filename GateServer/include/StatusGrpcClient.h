@@ -1,4 +1,5 @@
 #pragma once
+#include "AsyncRpc.h"
 #include "ConfigMgr.h"
 #include "Singleton.h"
 #include "const.h"
@@ -6,6 +7,8 @@
 #include "message.grpc.pb.h"
 #include "message.pb.h"
 #include <condition_variable>
+#include <functional>
+#include <future>
 #include <iostream>
 #include <memory>
 #include <queue>
@@ -116,10 +119,16 @@ public:
     ~StatusGrpcClient()
     {
     }
-    GetChatServerRsp GetChatServer(int uid);
+    // 异步查询分配的ChatServer，立即返回future；on_done 在rpc完成或超时后于轮询线程中执行
+    std::future<GetChatServerRsp> GetChatServer(int uid, std::function<void(const GetChatServerRsp &)> on_done = nullptr);
     LoginRsp Login(int uid, std::string token);
+    void Close();
 
 private:
     StatusGrpcClient();
     std::unique_ptr<StatusConPool> pool_;
+    // 异步调用共用一个stub，在同一条channel上多路复用
+    std::unique_ptr<StatusService::Stub> async_stub_;
+    AsyncRpcQueue rpc_queue_;
+    int timeout_ms_;
 };
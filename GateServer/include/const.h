@@ -39,6 +39,7 @@ enum ErrorCodes {
 	PasswdInvalid = 1009,   //密码格式非法
 	TokenInvalid = 1010,   //Token无效
 	UidInvalid = 1011,  //uid无效
+	DbBusy = 1012,  //数据库繁忙，请求被拒绝
 };
 
 
@@ -58,5 +59,7 @@ private:
 };
 
 #define CODEPREFIX  "code_"
+// 注册成功后发布 "uid,name"，ChatServer 据此更新用户存在性过滤器
+#define USER_REGISTERED_CHANNEL "user_registered"
 
 
@@ -0,0 +1,91 @@
+#include "DbExecutor.h"
+#include "ConfigMgr.h"
+#include <algorithm>
+
+DbExecutor::DbExecutor()
+    : b_stop_(false)
+{
+    auto &cfg = ConfigMgr::Inst();
+    const auto &threads = cfg["Mysql"]["ExecutorThreads"];
+    const auto &queue = cfg["Mysql"]["ExecutorQueue"];
+    // 线程数不要超过连接池上限，否则多出的线程只会在连接池上等待
+    int thread_num = threads.empty() ? 4 : std::max(1, atoi(threads.c_str()));
+    max_queue_ = queue.empty() ? 1024 : std::max(1, atoi(queue.c_str()));
+
+    for (int i = 0; i < thread_num; ++i)
+    {
+        threads_.emplace_back([this]()
+                              { run(); });
+    }
+    spdlog::info("DbExecutor 线程数: {} 队列上限: {}", thread_num, max_queue_);
+}
+
+DbExecutor::~DbExecutor()
+{
+    Close();
+}
+
+bool DbExecutor::enqueue(std::function<void()> job)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (b_stop_)
+        {
+            return false;
+        }
+        if (jobs_.size() >= max_queue_)
+        {
+            spdlog::warn("DbExecutor 队列已满 {}，拒绝新任务", max_queue_);
+            return false;
+        }
+        jobs_.push_back(std::move(job));
+    }
+    cond_.notify_one();
+    return true;
+}
+
+void DbExecutor::run()
+{
+    while (true)
+    {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cond_.wait(lock, [this]
+                       { return b_stop_ || !jobs_.empty(); });
+            // 关闭后先把剩余任务执行完再退出
+            if (jobs_.empty())
+            {
+                return;
+            }
+            job = std::move(jobs_.front());
+            jobs_.pop_front();
+        }
+
+        try
+        {
+            job();
+        }
+        catch (const std::exception &e)
+        {
+            spdlog::error("DbExecutor 任务异常: {}", e.what());
+        }
+    }
+}
+
+void DbExecutor::Close()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (b_stop_)
+        {
+            return;
+        }
+        b_stop_ = true;
+    }
+    cond_.notify_all();
+    for (auto &t : threads_)
+    {
+        t.join();
+    }
+}
@@ -4,8 +4,10 @@
 #include "AsioIOServicePool.h"
 #include "CServer.h"
 #include "ConfigMgr.h"
+#include "DbExecutor.h"
 #include "MysqlMgr.h"
 #include "RedisMgr.h"
+#include "StatusGrpcClient.h"
 #include "const.h"
 #include <hiredis/hiredis.h>
 #include <iostream>
@@ -19,6 +21,7 @@ int main()
     try
     {
         MysqlMgr::GetInstance();
+        DbExecutor::GetInstance();
         RedisMgr::GetInstance();
 
         auto &gCfgMgr = ConfigMgr::Inst();
@@ -44,6 +47,8 @@ int main()
         std::make_shared<CServer>(ioc, gate_port)->Start();
         spdlog::info("GateServer 监听端口: {}", gate_port);
         ioc.run();
+        DbExecutor::GetInstance()->Close();
+        StatusGrpcClient::GetInstance()->Close();
         RedisMgr::GetInstance()->Close();
     }
     catch (std::exception const &e)
@@ -195,11 +195,24 @@ void HttpConnection::HandleReq()
 
         _response.result(http::status::ok);
         _response.set(http::field::server, "GateServer");
+        if (_deferred)
+        {
+            return;
+        }
         WriteResponse();
         return;
     }
 }
 
+void HttpConnection::Reply(const std::string &body)
+{
+    auto self = shared_from_this();
+    boost::asio::post(_socket.get_executor(), [self, body]()
+                      {
+        beast::ostream(self->_response.body()) << body;
+        self->WriteResponse(); });
+}
+
 void HttpConnection::CheckDeadline()
 {
     auto self = shared_from_this();
@@ -4,12 +4,22 @@
 #endif
 
 #include "LogicSystem.h"
+#include "DbExecutor.h"
 #include "HttpConnection.h"
 #include "MysqlMgr.h"
 #include "RedisMgr.h"
 #include "StatusGrpcClient.h"
 #include "VerifyGrpcClient.h"
 
+// 数据库执行器队列已满时直接回复繁忙，调用前需已 DeferReply
+static void ReplyDbBusy(std::shared_ptr<HttpConnection> connection)
+{
+    spdlog::error("数据库繁忙，请求被拒绝");
+    Json::Value root;
+    root["error"] = ErrorCodes::DbBusy;
+    connection->Reply(root.toStyledString());
+}
+
 LogicSystem::LogicSystem()
 {
     RegGet("/get_test", [](std::shared_ptr<HttpConnection> connection)
@@ -51,16 +61,30 @@ LogicSystem::LogicSystem()
                 }
 
                 auto email = src_root["email"].asString();
-                int uid = 0;
-                std::string name = "";
-                MysqlMgr::GetInstance()->TestProcedure(email, uid, name);
-                spdlog::info("邮箱是： {}", email);
-                root["error"] = ErrorCodes::Success;
-                root["email"] = src_root["email"];
-                root["name"] = name;
-                root["uid"] = uid;
-                std::string jsonstr = root.toStyledString();
-                beast::ostream(connection->_response.body()) << jsonstr;
+                connection->DeferReply();
+                bool posted = DbExecutor::GetInstance()->Post(
+                    [email]()
+                    {
+                        int uid = 0;
+                        std::string name = "";
+                        MysqlMgr::GetInstance()->TestProcedure(email, uid, name);
+                        return std::make_pair(uid, name);
+                    },
+                    connection->GetSocket().get_executor(),
+                    [connection, email](const std::pair<int, std::string> &result)
+                    {
+                        spdlog::info("邮箱是： {}", email);
+                        Json::Value root;
+                        root["error"] = ErrorCodes::Success;
+                        root["email"] = email;
+                        root["name"] = result.second;
+                        root["uid"] = result.first;
+                        connection->Reply(root.toStyledString());
+                    });
+                if (!posted)
+                {
+                    ReplyDbBusy(connection);
+                }
                 return true; });
 
     // 获取验证码
@@ -149,25 +173,40 @@ LogicSystem::LogicSystem()
 			return true;
 		}
 
-		// 查询数据库判断用户是否存在
-		int uid = MysqlMgr::GetInstance()->RegUser(name, email, pwd, icon);
-		if (uid == 0 || uid == -1) {
-			spdlog::error("用户或邮箱已存在");
-			root["error"] = ErrorCodes::UserExist;
-			std::string jsonstr = root.toStyledString();
-			beast::ostream(connection->_response.body()) << jsonstr;
-			return true;
+		// 查询数据库判断用户是否存在，在数据库线程中执行，结果回到本连接的io线程再回包
+		auto varifycode = src_root["varifycode"].asString();
+		connection->DeferReply();
+		bool posted = DbExecutor::GetInstance()->Post(
+			[name, email, pwd, icon]() {
+				int uid = MysqlMgr::GetInstance()->RegUser(name, email, pwd, icon);
+				// 通知各ChatServer新用户已存在，避免被存在性过滤器拦截
+				if (uid > 0) {
+					RedisMgr::GetInstance()->Publish(USER_REGISTERED_CHANNEL, std::to_string(uid) + "," + name);
+				}
+				return uid;
+			},
+			connection->GetSocket().get_executor(),
+			[connection, name, email, pwd, confirm, icon, varifycode](int uid) {
+				Json::Value root;
+				if (uid == 0 || uid == -1) {
+					spdlog::error("用户或邮箱已存在");
+					root["error"] = ErrorCodes::UserExist;
+					connection->Reply(root.toStyledString());
+					return;
+				}
+				root["error"] = 0;
+				root["uid"] = uid;
+				root["email"] = email;
+				root ["user"]= name;
+				root["passwd"] = pwd;
+				root["confirm"] = confirm;
+				root["icon"] = icon;
+				root["varifycode"] = varifycode;
+				connection->Reply(root.toStyledString());
+			});
+		if (!posted) {
+			ReplyDbBusy(connection);
 		}
-		root["error"] = 0;
-		root["uid"] = uid;
-		root["email"] = email;
-		root ["user"]= name;
-		root["passwd"] = pwd;
-		root["confirm"] = confirm;
-		root["icon"] = icon;
-		root["varifycode"] = src_root["varifycode"].asString();
-		std::string jsonstr = root.toStyledString();
-		beast::ostream(connection->_response.body()) << jsonstr;
 		return true; });
 
     // 用户找回密码逻辑
@@ -210,34 +249,46 @@ LogicSystem::LogicSystem()
 			beast::ostream(connection->_response.body()) << jsonstr;
 			return true;
 		}
-		// 查询数据库判断用户名和邮箱是否匹配
-		bool email_valid = MysqlMgr::GetInstance()->CheckEmail(name, email);
-		if (!email_valid) {
-			spdlog::error("用户邮箱不匹配");
-			root["error"] = ErrorCodes::EmailNotMatch;
-			std::string jsonstr = root.toStyledString();
-			beast::ostream(connection->_response.body()) << jsonstr;
-			return true;
-		}
-
-		// 密码更新为新密码
-		bool b_up = MysqlMgr::GetInstance()->UpdatePwd(name, pwd);
-		if (!b_up) {
-			spdlog::error("密码更新失败");
-			root["error"] = ErrorCodes::PasswdUpFailed;
-			std::string jsonstr = root.toStyledString();
-			beast::ostream(connection->_response.body()) << jsonstr;
-			return true;
+		// 校验邮箱和更新密码在数据库线程中依次执行，结果回到本连接的io线程再回包
+		auto varifycode = src_root["varifycode"].asString();
+		connection->DeferReply();
+		bool posted = DbExecutor::GetInstance()->Post(
+			[name, email, pwd]() {
+				// 查询数据库判断用户名和邮箱是否匹配
+				bool email_valid = MysqlMgr::GetInstance()->CheckEmail(name, email);
+				if (!email_valid) {
+					spdlog::error("用户邮箱不匹配");
+					return ErrorCodes::EmailNotMatch;
+				}
+
+				// 密码更新为新密码
+				bool b_up = MysqlMgr::GetInstance()->UpdatePwd(name, pwd);
+				if (!b_up) {
+					spdlog::error("密码更新失败");
+					return ErrorCodes::PasswdUpFailed;
+				}
+				return ErrorCodes::Success;
+			},
+			connection->GetSocket().get_executor(),
+			[connection, name, email, pwd, varifycode](ErrorCodes error) {
+				Json::Value root;
+				if (error != ErrorCodes::Success) {
+					root["error"] = error;
+					connection->Reply(root.toStyledString());
+					return;
+				}
+
+				spdlog::info("密码更新成功：{}", pwd);
+				root["error"] = 0;
+				root["email"] = email;
+				root["user"] = name;
+				root["passwd"] = pwd;
+				root["varifycode"] = varifycode;
+				connection->Reply(root.toStyledString());
+			});
+		if (!posted) {
+			ReplyDbBusy(connection);
 		}
-
-		spdlog::info("密码更新成功：{}", pwd);
-		root["error"] = 0;
-		root["email"] = email;
-		root["user"] = name;
-		root["passwd"] = pwd;
-		root["varifycode"] = src_root["varifycode"].asString();
-		std::string jsonstr = root.toStyledString();
-		beast::ostream(connection->_response.body()) << jsonstr;
 		return true; });
 
     // 用户登录逻辑
@@ -263,41 +314,57 @@ LogicSystem::LogicSystem()
 
                 auto email = src_root["email"].asString();
                 auto pwd = src_root["passwd"].asString();
-                UserInfo userInfo;
-
-                // 查询数据库判断用户密码是否匹配，查询过程中会填充userInfo信息
-                bool pwd_valid = MysqlMgr::GetInstance()->CheckPwd(email, pwd, userInfo);
-                if (!pwd_valid)
-                {
-                    spdlog::error("密码错误");
-                    root["error"] = ErrorCodes::PasswdInvalid;
-                    std::string jsonstr = root.toStyledString();
-                    beast::ostream(connection->_response.body()) << jsonstr;
-                    return true;
-                }
-
-                // 查询StatusServer找到合适的服务器
-                auto reply = StatusGrpcClient::GetInstance()->GetChatServer(userInfo.uid);
 
-                if (reply.error())
+                // 查询数据库判断用户密码是否匹配，在数据库线程中执行，查询过程中会填充userInfo信息
+                connection->DeferReply();
+                bool posted = DbExecutor::GetInstance()->Post(
+                    [email, pwd]()
+                    {
+                        UserInfo userInfo;
+                        bool pwd_valid = MysqlMgr::GetInstance()->CheckPwd(email, pwd, userInfo);
+                        return std::make_pair(pwd_valid, userInfo);
+                    },
+                    connection->GetSocket().get_executor(),
+                    [connection, email](const std::pair<bool, UserInfo> &result)
+                    {
+                        if (!result.first)
+                        {
+                            spdlog::error("密码错误");
+                            Json::Value root;
+                            root["error"] = ErrorCodes::PasswdInvalid;
+                            connection->Reply(root.toStyledString());
+                            return;
+                        }
+
+                        // 查询StatusServer找到合适的服务器，结果回来后再回包，不占用io线程等待
+                        auto uid = result.second.uid;
+                        StatusGrpcClient::GetInstance()->GetChatServer(uid,
+                            [connection, email, uid](const GetChatServerRsp &reply)
+                            {
+                                Json::Value root;
+                                if (reply.error())
+                                {
+                                    spdlog::error(" StatusGrpcClient 获取 ChatServer 失败，错误码：{}", reply.error());
+                                    root["error"] = ErrorCodes::RPCFailed;
+                                    connection->Reply(root.toStyledString());
+                                    return;
+                                }
+
+                                spdlog::info("通过GateServer查询到合适的ChatServer成功，对应用户id： {}", uid);
+                                root["error"] = 0;
+                                root["email"] = email;
+                                root["uid"] = uid;
+                                root["token"] = reply.token();
+                                root["host"] = reply.host();
+                                root["port"] = reply.port();
+                                connection->Reply(root.toStyledString());
+                            });
+                    });
+                if (!posted)
                 {
-                    spdlog::error(" StatusGrpcClient 获取 ChatServer 失败，错误码：{}", reply.error());
-                    root["error"] = ErrorCodes::RPCFailed;
-                    std::string jsonstr = root.toStyledString();
-                    beast::ostream(connection->_response.body()) << jsonstr;
-                    return true;
+                    ReplyDbBusy(connection);
                 }
 
-                spdlog::info("通过GateServer查询到合适的ChatServer成功，对应用户id： {}", userInfo.uid);
-                root["error"] = 0;
-                root["email"] = email;
-                root["uid"] = userInfo.uid;
-                root["token"] = reply.token();
-                root["host"] = reply.host();
-                root["port"] = reply.port();
-                std::string jsonstr = root.toStyledString();
-                beast::ostream(connection->_response.body()) << jsonstr;
-
                 return true;
             });
 }
@@ -0,0 +1,341 @@
+#include "MySqlPool.h"
+#include <algorithm>
+#include <vector>
+
+MySqlPool::MySqlPool(const MySqlPoolOptions& options) : _options(options),
+	_total(0), _waiting(0), _b_stop(false), _peak_total(0), _peak_waiting(0) {
+	_options.min_size = std::max(0, _options.min_size);
+	_options.max_size = std::max(std::max(1, _options.min_size), _options.max_size);
+	_options.acquire_timeout_ms = std::max(1, _options.acquire_timeout_ms);
+
+	for (int i = 0; i < _options.min_size; ++i) {
+		try {
+			_idle.push_back(connect());
+			_total++;
+		}
+		catch (const mysqlx::Error& e) {
+			// 数据库暂时不可用时不阻止服务启动，借连接和定期检查时会再补建
+			spdlog::error("Mysql[{}] 连接池初始化失败: {}", _options.name, e.what());
+			markFailure();
+			break;
+		}
+	}
+	_peak_total = _total;
+	spdlog::info("Mysql[{}] 连接池初始连接数: {} 最少: {} 上限: {}", _options.name, _total, _options.min_size, _options.max_size);
+
+	_check_thread = std::thread([this]() {
+		auto last_stats = std::chrono::steady_clock::now();
+		while (true) {
+			{
+				std::unique_lock<std::mutex> lock(_mutex);
+				if (_stop_cond.wait_for(lock, std::chrono::seconds(CHECK_INTERVAL_SEC), [this] { return _b_stop; })) {
+					break;
+				}
+			}
+			checkConnection();
+			if (std::chrono::steady_clock::now() - last_stats >= std::chrono::seconds(STATS_INTERVAL_SEC)) {
+				LogStats();
+				last_stats = std::chrono::steady_clock::now();
+			}
+		}
+		});
+}
+
+MySqlPool::~MySqlPool() {
+	Close();
+	std::lock_guard<std::mutex> lock(_mutex);
+	_idle.clear();
+}
+
+int64_t MySqlPool::now() {
+	auto currentTime = std::chrono::system_clock::now().time_since_epoch();
+	return std::chrono::duration_cast<std::chrono::seconds>(currentTime).count();
+}
+
+std::unique_ptr<SqlConnection> MySqlPool::connect() {
+	mysqlx::SessionSettings settings(
+		_options.host, _options.port,
+		_options.user, _options.pass,
+		_options.schema
+	);
+	auto session = std::make_shared<mysqlx::Session>(settings);
+	return std::make_unique<SqlConnection>(session, _options.schema, now());
+}
+
+std::unique_ptr<SqlConnection> MySqlPool::getConnection() {
+	auto start = std::chrono::steady_clock::now();
+	auto deadline = start + std::chrono::milliseconds(_options.acquire_timeout_ms);
+	// 新建失败说明数据库不可用，本次只等待其他调用者归还，避免反复重连
+	bool create_failed = false;
+
+	std::unique_lock<std::mutex> lock(_mutex);
+	while (!_b_stop) {
+		if (!_idle.empty()) {
+			auto con = std::move(_idle.back());
+			_idle.pop_back();
+			lock.unlock();
+			recordWait(start, true);
+			return con;
+		}
+
+		if (_total < _options.max_size && !create_failed) {
+			// 先占住名额再在锁外建连接，建连接期间其他调用者照常借还
+			_total++;
+			_peak_total = std::max(_peak_total, _total);
+			lock.unlock();
+			std::unique_ptr<SqlConnection> con;
+			try {
+				con = connect();
+			}
+			catch (const mysqlx::Error& e) {
+				spdlog::error("Mysql[{}] 新建连接失败: {}", _options.name, e.what());
+			}
+			if (con != nullptr) {
+				recordWait(start, true);
+				return con;
+			}
+			lock.lock();
+			_total--;
+			markFailure();
+			create_failed = true;
+			continue;
+		}
+
+		if (std::chrono::steady_clock::now() >= deadline) {
+			break;
+		}
+		_waiting++;
+		_peak_waiting = std::max(_peak_waiting, _waiting);
+		_cond.wait_until(lock, deadline);
+		_waiting--;
+	}
+
+	bool stopped = _b_stop;
+	int total = _total;
+	lock.unlock();
+	recordWait(start, false);
+	if (!stopped) {
+		spdlog::warn("Mysql[{}] 借连接超时 {}ms, 当前连接数: {} 上限: {}", _options.name, _options.acquire_timeout_ms, total, _options.max_size);
+	}
+	return nullptr;
+}
+
+void MySqlPool::returnConnection(std::unique_ptr<SqlConnection> con) {
+	if (con == nullptr) {
+		return;
+	}
+	con->_last_oper_time = now();
+	con->_last_ping_time = con->_last_oper_time;
+
+	std::lock_guard<std::mutex> lock(_mutex);
+	if (_b_stop) {
+		_total--;
+		return;
+	}
+	_idle.push_back(std::move(con));
+	_cond.notify_one();
+}
+
+void MySqlPool::discardConnection(std::unique_ptr<SqlConnection> con) {
+	if (con == nullptr) {
+		return;
+	}
+	// 关闭会话可能要等网络超时，在锁外进行
+	con.reset();
+
+	std::lock_guard<std::mutex> lock(_mutex);
+	_total--;
+	markFailure();
+	// 让出的名额可以由等待者新建连接
+	_cond.notify_one();
+}
+
+void MySqlPool::markFailure() {
+	_healthy_after = std::chrono::steady_clock::now() + std::chrono::seconds(FAILURE_COOLDOWN_SEC);
+}
+
+bool MySqlPool::Available() {
+	std::lock_guard<std::mutex> lock(_mutex);
+	return !_b_stop && _total > 0 && std::chrono::steady_clock::now() >= _healthy_after;
+}
+
+void MySqlPool::checkConnection() {
+	auto timestamp = now();
+	std::vector<std::unique_ptr<SqlConnection>> expired;
+	std::vector<std::unique_ptr<SqlConnection>> stale;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		// 头部是空闲最久的连接，多于 min_size 的部分空闲超时后关闭
+		while (!_idle.empty() && _total > _options.min_size
+			&& timestamp - _idle.front()->_last_oper_time >= _options.idle_timeout_sec) {
+			expired.push_back(std::move(_idle.front()));
+			_idle.pop_front();
+			_total--;
+		}
+
+		// 久未使用的连接取出来在锁外保活，期间其他连接照常借还
+		for (auto iter = _idle.begin(); iter != _idle.end();) {
+			if (timestamp - (*iter)->_last_ping_time >= KEEPALIVE_SEC) {
+				stale.push_back(std::move(*iter));
+				iter = _idle.erase(iter);
+				continue;
+			}
+			++iter;
+		}
+	}
+	if (!expired.empty()) {
+		spdlog::info("Mysql[{}] 连接池回收空闲连接 {} 个", _options.name, expired.size());
+		expired.clear();
+	}
+
+	for (auto& con : stale) {
+		try {
+			con->_session->sql("SELECT 1").execute();
+			con->_last_ping_time = timestamp;
+		}
+		catch (const mysqlx::Error& e) {
+			spdlog::error("Mysql[{}] 连接池保持连接失败: {}", _options.name, e.what());
+			con.reset();
+		}
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		// 保活过的连接空闲时间最长，放回头部，不影响空闲回收的顺序
+		for (auto iter = stale.rbegin(); iter != stale.rend(); ++iter) {
+			if (*iter == nullptr || _b_stop) {
+				_total--;
+				if (*iter == nullptr) {
+					markFailure();
+				}
+				continue;
+			}
+			_idle.push_front(std::move(*iter));
+			_cond.notify_one();
+		}
+	}
+
+	// 断开的连接丢弃后补足 min_size
+	while (true) {
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			if (_b_stop || _total >= _options.min_size) {
+				break;
+			}
+			_total++;
+		}
+		try {
+			auto con = connect();
+			std::lock_guard<std::mutex> lock(_mutex);
+			_idle.push_back(std::move(con));
+			_cond.notify_one();
+		}
+		catch (const mysqlx::Error& e) {
+			spdlog::error("Mysql[{}] 连接池补建连接失败: {}", _options.name, e.what());
+			std::lock_guard<std::mutex> lock(_mutex);
+			_total--;
+			markFailure();
+			break;
+		}
+	}
+}
+
+void MySqlPool::LatencyStats::Add(uint64_t cost_us, bool ok) {
+	count++;
+	if (!ok) {
+		failed++;
+	}
+	total_us += cost_us;
+	max_us = std::max(max_us, cost_us);
+	for (size_t i = 0; i < BUCKET_BOUNDS.size(); ++i) {
+		if (cost_us <= BUCKET_BOUNDS[i]) {
+			buckets[i]++;
+			break;
+		}
+	}
+}
+
+uint64_t MySqlPool::LatencyStats::Percentile(double ratio) const {
+	uint64_t target = (uint64_t)(count * ratio);
+	uint64_t seen = 0;
+	for (size_t i = 0; i < BUCKET_BOUNDS.size(); ++i) {
+		seen += buckets[i];
+		if (seen > target) {
+			// 落在最后一个桶时只能给出最大值
+			return BUCKET_BOUNDS[i] == UINT64_MAX ? max_us : BUCKET_BOUNDS[i];
+		}
+	}
+	return max_us;
+}
+
+static uint64_t elapsedUs(std::chrono::steady_clock::time_point start) {
+	auto cost = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+	return cost.count() > 0 ? cost.count() : 0;
+}
+
+void MySqlPool::recordWait(std::chrono::steady_clock::time_point start, bool ok) {
+	auto cost_us = elapsedUs(start);
+	std::lock_guard<std::mutex> lock(_stats_mutex);
+	_wait_stats.Add(cost_us, ok);
+}
+
+void MySqlPool::RecordQuery(const std::string& query, std::chrono::steady_clock::time_point start, bool ok) {
+	auto cost_us = elapsedUs(start);
+	std::lock_guard<std::mutex> lock(_stats_mutex);
+	_query_stats[query].Add(cost_us, ok);
+}
+
+void MySqlPool::LogStats() {
+	int total = 0, idle = 0, waiting = 0, peak_total = 0, peak_waiting = 0;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		total = _total;
+		idle = (int)_idle.size();
+		waiting = _waiting;
+		peak_total = _peak_total;
+		peak_waiting = _peak_waiting;
+		_peak_total = _total;
+		_peak_waiting = _waiting;
+	}
+
+	LatencyStats wait;
+	std::map<std::string, LatencyStats> queries;
+	{
+		std::lock_guard<std::mutex> lock(_stats_mutex);
+		std::swap(wait, _wait_stats);
+		queries.swap(_query_stats);
+	}
+
+	spdlog::info("Mysql[{}] 连接池 连接: {} 空闲: {} 等待: {} 峰值连接: {} 峰值等待: {}",
+		_options.name, total, idle, waiting, peak_total, peak_waiting);
+	if (wait.count > 0) {
+		spdlog::info("Mysql[{}] 借连接 {} 次, 超时 {} 次, 平均 {}us, p50<={}us, p99<={}us, 最大 {}us",
+			_options.name, wait.count, wait.failed, wait.total_us / wait.count,
+			wait.Percentile(0.5), wait.Percentile(0.99), wait.max_us);
+	}
+	// 已经用满上限仍然超时，说明上限不够或者有慢查询长期占用连接
+	if (wait.failed > 0 && peak_total >= _options.max_size) {
+		spdlog::warn("Mysql[{}] 连接池已达上限 {} 仍有 {} 次借连接超时", _options.name, _options.max_size, wait.failed);
+	}
+	for (auto& item : queries) {
+		auto& s = item.second;
+		spdlog::info("Mysql[{}] 查询 {} {} 次, 失败 {} 次, 平均 {}us, p50<={}us, p99<={}us, 最大 {}us",
+			_options.name, item.first, s.count, s.failed, s.total_us / s.count,
+			s.Percentile(0.5), s.Percentile(0.99), s.max_us);
+	}
+}
+
+void MySqlPool::Close() {
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		if (_b_stop) {
+			return;
+		}
+		_b_stop = true;
+	}
+	_cond.notify_all();
+	_stop_cond.notify_all();
+	if (_check_thread.joinable()) {
+		_check_thread.join();
+	}
+}
@@ -335,6 +335,28 @@ bool RedisMgr::Del(const std::string &key)
 	 return true;
 }
 
+bool RedisMgr::Publish(const std::string& channel, const std::string& message)
+{
+	auto connect = _con_pool->getConnection();
+	if (connect == nullptr) {
+		return false;
+	}
+	// 用 %b 传参，消息中的空格不会被拆成多个参数
+	auto reply = (redisReply*)redisCommand(connect, "PUBLISH %s %b", channel.c_str(), message.data(), message.size());
+	if (reply == nullptr || reply->type != REDIS_REPLY_INTEGER) {
+		spdlog::error("执行命令 [ PUBLISH {} {} ] 失败", channel, message);
+		if (reply != nullptr) {
+			freeReplyObject(reply);
+		}
+		_con_pool->returnConnection(connect);
+		return false;
+	}
+
+	freeReplyObject(reply);
+	_con_pool->returnConnection(connect);
+	return true;
+}
+
 bool RedisMgr::ExistsKey(const std::string &key)
 {
 	auto connect = _con_pool->getConnection();
@@ -1,38 +1,32 @@
 #include "StatusGrpcClient.h"
 #include "const.h"
 
-GetChatServerRsp StatusGrpcClient::GetChatServer(int uid)
+std::future<GetChatServerRsp> StatusGrpcClient::GetChatServer(int uid, std::function<void(const GetChatServerRsp &)> on_done)
 {
-	ClientContext context;
-	// 设置5秒超时
-	auto deadline = std::chrono::system_clock::now() + std::chrono::seconds(5);
-	context.set_deadline(deadline);
-	
-	GetChatServerRsp reply;
 	GetChatServerReq request;
-    request.set_uid(uid);
-    
-	auto stub = pool_->getConnection();
-	if (!stub) {
-		reply.set_error(ErrorCodes::RPCFailed);
-		return reply;
-	}
-    Status status = stub->GetChatServer(&context, request, &reply);
+	request.set_uid(uid);
 
-    Defer defer(
-        [&stub, this]()
-        {
-            pool_->returnConnection(std::move(stub));
-        });
-    
-	if (status.ok()) {	
-		return reply;
-	}
-	else {
-		spdlog::error("GRPC请求发出，但是获取ChatServer失败，错误码：{}，错误信息：{}", static_cast<int>(status.error_code()), status.error_message());
-		reply.set_error(ErrorCodes::RPCFailed);
-		return reply;
-	}
+	auto stub = async_stub_.get();
+	return rpc_queue_.Call<GetChatServerRsp>(request, timeout_ms_,
+		[stub](ClientContext* context, const GetChatServerReq& req, grpc::CompletionQueue* cq) {
+			return stub->PrepareAsyncGetChatServer(context, req, cq);
+		},
+		[on_done](const Status& status, GetChatServerRsp& reply) {
+			if (!status.ok()) {
+				spdlog::error("GRPC请求发出，但是获取ChatServer失败，错误码：{}，错误信息：{}", static_cast<int>(status.error_code()), status.error_message());
+				reply.set_error(ErrorCodes::RPCFailed);
+			}
+			if (on_done) {
+				on_done(reply);
+			}
+		});
+}
+
+void StatusGrpcClient::Close()
+{
+	// 等已发出的请求回调完毕
+	rpc_queue_.Close();
+	pool_->Close();
 }
 
 LoginRsp StatusGrpcClient::Login(int uid, std::string token)
@@ -78,5 +72,8 @@ StatusGrpcClient::StatusGrpcClient()
 	
 
 	pool_.reset(new StatusConPool(5, host, port));
+	async_stub_ = StatusService::NewStub(grpc::CreateChannel(host + ":" + port, grpc::InsecureChannelCredentials()));
+	std::string timeout = gCfgMgr["StatusServer"]["TimeoutMs"];
+	timeout_ms_ = timeout.empty() ? 5000 : atoi(timeout.c_str());
 	spdlog::info("StatusGrpcClient连接池创建成功");
 }
@@ -2,6 +2,7 @@
 #include "const.h"
 #include <hiredis/hiredis.h>
 #include <queue>
+#include <map>
 #include <atomic>
 #include <mutex>
 #include <chrono>
@@ -293,6 +294,9 @@ public:
 	bool releaseLock(const std::string& lockName,
 		const std::string& identifier);
 
+	// 清理心跳过期的ChatServer，返回存活节点 name -> info
+	bool RegistryMembers(std::map<std::string, std::string>& members);
+
 
 private:
 	RedisMgr();
@@ -0,0 +1,43 @@
+#pragma once
+#include "const.h"
+#include "Singleton.h"
+#include <hiredis/hiredis.h>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <mutex>
+
+// Redis 发布订阅的接收端
+// 使用一条独立的连接和一个后台线程，所有读写都在该线程内完成；
+// 其他线程只登记回调，由后台线程负责发送 SUBSCRIBE 并在断线后重新订阅
+class RedisSubscriber : public Singleton<RedisSubscriber>
+{
+	friend class Singleton<RedisSubscriber>;
+public:
+	using Handler = std::function<void(const std::string& channel, const std::string& message)>;
+	~RedisSubscriber();
+	// 订阅频道，回调在订阅线程中执行，不要在回调里做阻塞操作
+	void Subscribe(const std::string& channel, Handler handler);
+	void Close();
+private:
+	RedisSubscriber();
+	void run();
+	bool connect();
+	// 发送待订阅的频道，写失败返回false
+	bool flushPending();
+	void dispatch(redisReply* reply);
+
+	std::string _host;
+	int _port;
+	std::string _pwd;
+	redisContext* _context;
+	std::mutex _mutex;
+	std::unordered_map<std::string, std::vector<Handler>> _handlers;
+	// 已登记但还未发送 SUBSCRIBE 的频道
+	std::vector<std::string> _pending;
+	std::atomic<bool> _b_stop;
+	std::thread _thread;
+};
@@ -0,0 +1,37 @@
+#pragma once
+#include "const.h"
+#include "Singleton.h"
+#include <array>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <string>
+
+// 按rpc方法统计调用次数、失败次数和耗时分布
+// 耗时按固定的桶累计，输出时据此估算p50/p99，每个统计周期结束后清零
+class RpcMetrics : public Singleton<RpcMetrics>
+{
+    friend class Singleton<RpcMetrics>;
+public:
+    // 记录一次调用，耗时从 start 计到现在
+    void Record(const std::string& method, std::chrono::steady_clock::time_point start, bool ok = true);
+    // 输出本周期的统计并清零，由定时器周期性调用
+    void LogStats();
+private:
+    RpcMetrics() {}
+    // 各个桶的上界(微秒)，最后一个桶收纳所有更慢的调用
+    static constexpr std::array<uint64_t, 9> BUCKET_BOUNDS = { 100, 500, 1000, 5000, 10000, 50000, 100000, 500000, UINT64_MAX };
+
+    struct MethodStats
+    {
+        uint64_t count = 0;
+        uint64_t failed = 0;
+        uint64_t total_us = 0;
+        uint64_t max_us = 0;
+        std::array<uint64_t, BUCKET_BOUNDS.size()> buckets{};
+    };
+    static uint64_t percentile(const MethodStats& stats, double ratio);
+
+    std::mutex _mutex;
+    std::map<std::string, MethodStats> _stats;
+};
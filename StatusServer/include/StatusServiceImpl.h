@@ -1,7 +1,13 @@
 #pragma once
 #include "grpc_macros.h"
 #include "message.grpc.pb.h"
+#include "LoginToken.h"
+#include <chrono>
+#include <deque>
+#include <memory>
 #include <mutex>
+#include <unordered_map>
+#include <vector>
 
 using grpc::Server;
 using grpc::ServerBuilder;
@@ -17,9 +23,10 @@ class ChatServer
 {
 public:
     ChatServer()
-        : host(""), port(""), name(""), con_count(0) {}
+        : host(""), port(""), name(""), con_count(0), capacity(DEFAULT_CAPACITY) {}
     ChatServer(const ChatServer &cs)
-        : host(cs.host), port(cs.port), name(cs.name), con_count(cs.con_count) {}
+        : host(cs.host), port(cs.port), name(cs.name), con_count(cs.con_count), capacity(cs.capacity),
+          reservations(cs.reservations) {}
     ChatServer &operator=(const ChatServer &cs)
     {
         if (&cs == this)
@@ -31,27 +38,55 @@ public:
         name = cs.name;
         port = cs.port;
         con_count = cs.con_count;
+        capacity = cs.capacity;
+        reservations = cs.reservations;
         return *this;
     }
+    // 未收到负载上报前使用的默认容量
+    static constexpr int DEFAULT_CAPACITY = 10000;
     std::string host;
     std::string port;
     std::string name;
+    // 最近一次上报的连接数
     int con_count;
+    // 可承载的连接数，作为分配权重
+    int capacity;
+    // 已分配但可能还没连上来的登录，按分配时间排序，超出预留窗口后丢弃
+    std::deque<std::chrono::steady_clock::time_point> reservations;
 };
 
-class StatusServiceImpl final : public StatusService::Service
+// 回调式服务，处理函数在gRPC的回调线程中被调用
+// 选服只查内存中的负载表，token在本地签名，整个处理过程不阻塞，不需要额外的工作线程
+class StatusServiceImpl final : public StatusService::CallbackService
 {
 public:
     StatusServiceImpl();
 
     // GateServer StatusServer RPC客户端请求被这个函数接收
-    Status GetChatServer(ServerContext *context, const GetChatServerReq *request, GetChatServerRsp *reply) override;
+    grpc::ServerUnaryReactor *GetChatServer(grpc::CallbackServerContext *context, const GetChatServerReq *request, GetChatServerRsp *reply) override;
 
-    Status Login(ServerContext *context, const LoginReq *request, LoginRsp *reply) override;
+    grpc::ServerUnaryReactor *Login(grpc::CallbackServerContext *context, const LoginReq *request, LoginRsp *reply) override;
+
+    // 从注册中心拉取存活的ChatServer替换本地列表，拉取失败时保留旧列表
+    // 启动时、收到成员变更通知以及定时器到期时调用
+    void SyncServers();
+
+    // 处理ChatServer推送的负载，消息内容为 "name,连接数,容量"，在订阅线程中调用
+    void OnLoadReport(const std::string &message);
 
 private:
-    void insertToken(int uid, std::string token);
     ChatServer getChatServer();
+    // 丢弃超出预留窗口的分配记录，返回当前估计的连接数
+    int currentLoad(ChatServer &server, std::chrono::steady_clock::time_point now);
+    // 负载表只在内存中维护，分配时不访问redis
     std::unordered_map<std::string, ChatServer> _servers;
+    // _servers 的名字列表，用于随机抽取候选
+    std::vector<std::string> _server_names;
     std::mutex _server_mtx;
+    // 分配出去的登录在这段时间内计入目标服务器的负载(毫秒)
+    int _reserve_ms;
+    // 登录token的签名密钥，首个用于签发，其余仅用于校验
+    LoginToken::Keys _token_keys;
+    // 登录token的有效期(秒)
+    int _token_ttl;
 };
@@ -61,6 +61,14 @@ private:
 #define USER_BASE_INFO "ubaseinfo_"
 #define LOGIN_COUNT  "logincount"
 #define LOCK_COUNT "lockcount"
+// ChatServer注册中心，zset 成员为服务器名，分值为心跳过期时刻(毫秒)
+#define CHAT_REGISTRY "chatserver_nodes"
+// 注册中心的节点地址，hash 字段为服务器名，值为 "host,port,rpc_port"
+#define CHAT_REGISTRY_INFO "chatserver_info"
+// ChatServer成员变更通知频道，消息内容为 "join,name" 或 "leave,name"
+#define MEMBERSHIP_CHANNEL "chatserver_membership"
+// ChatServer负载上报频道，消息内容为 "name,连接数,容量"
+#define LOAD_CHANNEL "chatserver_load"
 
 // 分布式锁的超时时间
 #define LOCK_TIME_OUT 10
@@ -0,0 +1,86 @@
+#include "LoginToken.h"
+#include <openssl/crypto.h>
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
+#include <sstream>
+#include <cstdlib>
+
+std::string LoginToken::hmac(const std::string& secret, const std::string& data) {
+	unsigned char digest[EVP_MAX_MD_SIZE];
+	unsigned int digest_len = 0;
+	HMAC(EVP_sha256(), secret.data(), (int)secret.size(),
+		(const unsigned char*)data.data(), data.size(), digest, &digest_len);
+
+	static const char* HEX = "0123456789abcdef";
+	std::string hex;
+	hex.reserve(digest_len * 2);
+	for (unsigned int i = 0; i < digest_len; ++i) {
+		hex.push_back(HEX[digest[i] >> 4]);
+		hex.push_back(HEX[digest[i] & 0x0f]);
+	}
+	return hex;
+}
+
+std::string LoginToken::Sign(const std::string& kid, const std::string& secret, const LoginTokenClaims& claims) {
+	std::string payload = kid + "." + std::to_string(claims.uid) + "." + claims.server + "."
+		+ std::to_string(claims.expire) + "." + claims.id;
+	return payload + "." + hmac(secret, payload);
+}
+
+bool LoginToken::Parse(const std::string& token, const Keys& keys, LoginTokenClaims& claims) {
+	auto sig_pos = token.rfind('.');
+	if (sig_pos == std::string::npos) {
+		return false;
+	}
+	std::string payload = token.substr(0, sig_pos);
+	std::string sig = token.substr(sig_pos + 1);
+
+	std::vector<std::string> parts;
+	std::stringstream ss(payload);
+	std::string part;
+	while (std::getline(ss, part, '.')) {
+		parts.push_back(part);
+	}
+	if (parts.size() != 5) {
+		return false;
+	}
+
+	const std::string* secret = nullptr;
+	for (auto& key : keys) {
+		if (key.first == parts[0]) {
+			secret = &key.second;
+			break;
+		}
+	}
+	if (secret == nullptr) {
+		return false;
+	}
+
+	auto expect = hmac(*secret, payload);
+	// 定长比较，避免按耗时猜出签名
+	if (expect.size() != sig.size() || CRYPTO_memcmp(expect.data(), sig.data(), sig.size()) != 0) {
+		return false;
+	}
+
+	claims.uid = atoi(parts[1].c_str());
+	claims.server = parts[2];
+	claims.expire = atoll(parts[3].c_str());
+	claims.id = parts[4];
+	return true;
+}
+
+LoginToken::Keys LoginToken::ParseKeys(const std::string& value) {
+	Keys keys;
+	std::stringstream ss(value);
+	std::string item;
+	while (std::getline(ss, item, ',')) {
+		auto pos = item.find(':');
+		// kid 是token的第一段，不能含有分隔符
+		if (pos == std::string::npos || pos == 0 || pos + 1 == item.size()
+			|| item.substr(0, pos).find('.') != std::string::npos) {
+			continue;
+		}
+		keys.emplace_back(item.substr(0, pos), item.substr(pos + 1));
+	}
+	return keys;
+}
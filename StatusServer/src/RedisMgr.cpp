@@ -390,5 +390,58 @@ bool RedisMgr::releaseLock(const std::string& lockName,
 	return DistLock::Inst().releaseLock(connect, lockName, identifier);
 }
 
+// 注册中心脚本统一用Redis服务器的时钟计算过期时刻，各节点之间不需要对时
+#define REGISTRY_NOW_MS \
+	"redis.replicate_commands() " \
+	"local t = redis.call('TIME') " \
+	"local now = tonumber(t[1]) * 1000 + math.floor(tonumber(t[2]) / 1000) "
+
+// 成员脚本: KEYS = chatserver_nodes, chatserver_info
+// 先清掉心跳过期的节点并广播 leave，再返回存活节点 { name1, info1, name2, info2, ... }
+static const char* REGISTRY_MEMBERS_SCRIPT =
+	REGISTRY_NOW_MS
+	"local dead = redis.call('ZRANGEBYSCORE', KEYS[1], '-inf', now) "
+	"for _, name in ipairs(dead) do "
+	"redis.call('ZREM', KEYS[1], name) "
+	"redis.call('HDEL', KEYS[2], name) "
+	"redis.call('PUBLISH', '" MEMBERSHIP_CHANNEL "', 'leave,' .. name) end "
+	"local result = {} "
+	"for _, name in ipairs(redis.call('ZRANGEBYSCORE', KEYS[1], '(' .. now, '+inf')) do "
+	"local info = redis.call('HGET', KEYS[2], name) "
+	"if info then table.insert(result, name) table.insert(result, info) end end "
+	"return result";
+
+bool RedisMgr::RegistryMembers(std::map<std::string, std::string>& members)
+{
+	auto connect = _con_pool->getConnection();
+	if (connect == nullptr) {
+		return false;
+	}
 
+	Defer defer([&connect, this]() {
+		_con_pool->returnConnection(connect);
+		});
+
+	const char* argv[5] = { "EVAL", REGISTRY_MEMBERS_SCRIPT, "2", CHAT_REGISTRY, CHAT_REGISTRY_INFO };
+	size_t argvlen[5] = { 4, strlen(REGISTRY_MEMBERS_SCRIPT), 1, strlen(CHAT_REGISTRY), strlen(CHAT_REGISTRY_INFO) };
 
+	auto reply = (redisReply*)redisCommandArgv(connect, 5, argv, argvlen);
+	if (reply == nullptr) {
+		spdlog::error("[ REGISTRY MEMBERS ] failed: reply is null, connection error: {}", connect->errstr);
+		return false;
+	}
+
+	if (reply->type != REDIS_REPLY_ARRAY) {
+		spdlog::error("[ REGISTRY MEMBERS ] 错误的类型: {}", reply->type);
+		freeReplyObject(reply);
+		return false;
+	}
+
+	members.clear();
+	for (size_t i = 0; i + 1 < reply->elements; i += 2) {
+		members[std::string(reply->element[i]->str, reply->element[i]->len)] =
+			std::string(reply->element[i + 1]->str, reply->element[i + 1]->len);
+	}
+	freeReplyObject(reply);
+	return true;
+}
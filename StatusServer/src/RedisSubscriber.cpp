@@ -0,0 +1,162 @@
+#include "RedisSubscriber.h"
+#include "ConfigMgr.h"
+#include <poll.h>
+#include <cerrno>
+
+RedisSubscriber::RedisSubscriber() : _port(0), _context(nullptr), _b_stop(false) {
+	auto& cfg = ConfigMgr::Inst();
+	_host = cfg["Redis"]["Host"];
+	_port = atoi(cfg["Redis"]["Port"].c_str());
+	_pwd = cfg["Redis"]["Passwd"];
+	_thread = std::thread([this]() {
+		run();
+		});
+}
+
+RedisSubscriber::~RedisSubscriber() {
+	Close();
+}
+
+void RedisSubscriber::Subscribe(const std::string& channel, Handler handler) {
+	std::lock_guard<std::mutex> lock(_mutex);
+	auto& handlers = _handlers[channel];
+	// 同一个频道只需要订阅一次
+	if (handlers.empty()) {
+		_pending.push_back(channel);
+	}
+	handlers.push_back(std::move(handler));
+}
+
+void RedisSubscriber::Close() {
+	if (_b_stop.exchange(true)) {
+		return;
+	}
+	if (_thread.joinable()) {
+		_thread.join();
+	}
+}
+
+bool RedisSubscriber::connect() {
+	_context = redisConnect(_host.c_str(), _port);
+	if (_context == nullptr || _context->err != 0) {
+		spdlog::error("Redis 订阅连接失败: {}", _context ? _context->errstr : "null");
+		if (_context != nullptr) {
+			redisFree(_context);
+			_context = nullptr;
+		}
+		return false;
+	}
+
+	auto reply = (redisReply*)redisCommand(_context, "AUTH %s", _pwd.c_str());
+	if (reply == nullptr || reply->type == REDIS_REPLY_ERROR) {
+		spdlog::error("Redis 订阅连接认证失败");
+		if (reply != nullptr) {
+			freeReplyObject(reply);
+		}
+		redisFree(_context);
+		_context = nullptr;
+		return false;
+	}
+	freeReplyObject(reply);
+	redisEnableKeepAlive(_context);
+
+	// 新连接上没有任何订阅，已登记的频道全部重新订阅
+	std::lock_guard<std::mutex> lock(_mutex);
+	_pending.clear();
+	for (auto& iter : _handlers) {
+		_pending.push_back(iter.first);
+	}
+	spdlog::info("Redis 订阅连接成功");
+	return true;
+}
+
+bool RedisSubscriber::flushPending() {
+	std::vector<std::string> channels;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		channels.swap(_pending);
+	}
+
+	if (channels.empty()) {
+		return true;
+	}
+
+	for (auto& channel : channels) {
+		redisAppendCommand(_context, "SUBSCRIBE %b", channel.data(), channel.size());
+	}
+
+	int done = 0;
+	while (!done) {
+		if (redisBufferWrite(_context, &done) == REDIS_ERR) {
+			return false;
+		}
+	}
+	return true;
+}
+
+void RedisSubscriber::dispatch(redisReply* reply) {
+	// 推送消息格式: ["message", channel, payload]，订阅确认等其他回复直接忽略
+	if (reply->type != REDIS_REPLY_ARRAY || reply->elements != 3) {
+		return;
+	}
+	auto* kind = reply->element[0];
+	if (kind->type != REDIS_REPLY_STRING || std::string(kind->str, kind->len) != "message") {
+		return;
+	}
+
+	std::string channel(reply->element[1]->str, reply->element[1]->len);
+	std::string message(reply->element[2]->str, reply->element[2]->len);
+
+	std::vector<Handler> handlers;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		auto iter = _handlers.find(channel);
+		if (iter == _handlers.end()) {
+			return;
+		}
+		handlers = iter->second;
+	}
+
+	for (auto& handler : handlers) {
+		handler(channel, message);
+	}
+}
+
+void RedisSubscriber::run() {
+	while (!_b_stop) {
+		if (_context == nullptr && !connect()) {
+			// 连接失败，稍后重试
+			std::this_thread::sleep_for(std::chrono::seconds(1));
+			continue;
+		}
+
+		bool ok = flushPending();
+		if (ok) {
+			// 超时返回是为了及时发送新登记的订阅和响应退出
+			pollfd pfd{ _context->fd, POLLIN, 0 };
+			int rc = ::poll(&pfd, 1, 100);
+			if (rc == 0 || (rc < 0 && errno == EINTR)) {
+				continue;
+			}
+			ok = rc > 0 && redisBufferRead(_context) == REDIS_OK;
+		}
+
+		void* reply = nullptr;
+		while (ok && redisGetReplyFromReader(_context, &reply) == REDIS_OK && reply != nullptr) {
+			dispatch((redisReply*)reply);
+			freeReplyObject(reply);
+			reply = nullptr;
+		}
+
+		if (!ok || _context->err != 0) {
+			spdlog::error("Redis 订阅连接断开: {}", _context->errstr);
+			redisFree(_context);
+			_context = nullptr;
+		}
+	}
+
+	if (_context != nullptr) {
+		redisFree(_context);
+		_context = nullptr;
+	}
+}
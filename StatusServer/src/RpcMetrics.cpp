@@ -0,0 +1,58 @@
+#include "RpcMetrics.h"
+
+void RpcMetrics::Record(const std::string& method, std::chrono::steady_clock::time_point start, bool ok)
+{
+    auto cost = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+    uint64_t cost_us = cost.count() > 0 ? cost.count() : 0;
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto& stats = _stats[method];
+    stats.count++;
+    if (!ok)
+    {
+        stats.failed++;
+    }
+    stats.total_us += cost_us;
+    stats.max_us = std::max(stats.max_us, cost_us);
+    for (size_t i = 0; i < BUCKET_BOUNDS.size(); ++i)
+    {
+        if (cost_us <= BUCKET_BOUNDS[i])
+        {
+            stats.buckets[i]++;
+            break;
+        }
+    }
+}
+
+uint64_t RpcMetrics::percentile(const MethodStats& stats, double ratio)
+{
+    uint64_t target = (uint64_t)(stats.count * ratio);
+    uint64_t seen = 0;
+    for (size_t i = 0; i < BUCKET_BOUNDS.size(); ++i)
+    {
+        seen += stats.buckets[i];
+        if (seen > target)
+        {
+            // 落在最后一个桶时只能给出最大值
+            return BUCKET_BOUNDS[i] == UINT64_MAX ? stats.max_us : BUCKET_BOUNDS[i];
+        }
+    }
+    return stats.max_us;
+}
+
+void RpcMetrics::LogStats()
+{
+    std::map<std::string, MethodStats> stats;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        stats.swap(_stats);
+    }
+
+    for (auto& item : stats)
+    {
+        auto& s = item.second;
+        spdlog::info("rpc {} 调用 {} 次, 失败 {} 次, 平均 {}us, p50<={}us, p99<={}us, 最大 {}us",
+            item.first, s.count, s.failed, s.count ? s.total_us / s.count : 0,
+            percentile(s, 0.5), percentile(s, 0.99), s.max_us);
+    }
+}
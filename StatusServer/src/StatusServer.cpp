@@ -17,6 +17,8 @@
 #include <thread>
 #include <boost/asio.hpp>
 #include "StatusServiceImpl.h"
+#include "RpcMetrics.h"
+#include "RedisSubscriber.h"
 
 void RunServer() {
 	auto & cfg = ConfigMgr::Inst();
@@ -51,11 +53,56 @@ void RunServer() {
 		}
 	);
 
+	// 定时输出各rpc接口的调用次数和耗时
+	boost::asio::steady_timer metrics_timer(io_context);
+	std::function<void(const boost::system::error_code&)> on_metrics;
+	on_metrics = [&metrics_timer, &on_metrics](const boost::system::error_code& ec) {
+		if (ec) {
+			return;
+		}
+		RpcMetrics::GetInstance()->LogStats();
+		metrics_timer.expires_after(std::chrono::seconds(60));
+		metrics_timer.async_wait(on_metrics);
+		};
+	metrics_timer.expires_after(std::chrono::seconds(60));
+	metrics_timer.async_wait(on_metrics);
+
+	// ChatServer成员变化时立即同步，同步放到io_context线程中执行，不阻塞订阅线程
+	service.SyncServers();
+	RedisSubscriber::GetInstance()->Subscribe(MEMBERSHIP_CHANNEL, [&io_context, &service](const std::string&, const std::string& message) {
+		spdlog::info("收到ChatServer成员变更: {}", message);
+		boost::asio::post(io_context, [&service]() {
+			service.SyncServers();
+			});
+		});
+
+	// ChatServer定期推送负载，直接更新内存中的负载表
+	RedisSubscriber::GetInstance()->Subscribe(LOAD_CHANNEL, [&service](const std::string&, const std::string& message) {
+		service.OnLoadReport(message);
+		});
+
+	// 定时同步一次，兜底丢失的通知并清理心跳过期的节点
+	std::string sync_sec_str = cfg["Registry"]["SyncSec"];
+	auto sync_sec = std::chrono::seconds(sync_sec_str.empty() ? 5 : std::max(1, atoi(sync_sec_str.c_str())));
+	boost::asio::steady_timer registry_timer(io_context);
+	std::function<void(const boost::system::error_code&)> on_registry;
+	on_registry = [&registry_timer, &on_registry, &service, sync_sec](const boost::system::error_code& ec) {
+		if (ec) {
+			return;
+		}
+		service.SyncServers();
+		registry_timer.expires_after(sync_sec);
+		registry_timer.async_wait(on_registry);
+		};
+	registry_timer.expires_after(sync_sec);
+	registry_timer.async_wait(on_registry);
+
 	// 在单独的线程中运行io_context
 	std::thread([&io_context]() { io_context.run(); }).detach();
 
 	// 等待服务器关闭
 	server->Wait();
+	RedisSubscriber::GetInstance()->Close();
 }
 
 int main(int argc, char** argv) {
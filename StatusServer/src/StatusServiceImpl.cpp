@@ -1,12 +1,20 @@
 #include "StatusServiceImpl.h"
 #include "ConfigMgr.h"
 #include "RedisMgr.h"
+#include "RpcMetrics.h"
+#include "LoginToken.h"
 #include "const.h"
 #include <climits>
+#include <random>
+#include <ctime>
+#include <stdexcept>
 #include <iostream>
+#include <map>
+#include <sstream>
 
 StatusServiceImpl::StatusServiceImpl()
 {
+    // 配置中的服务器只在首次同步注册中心之前使用
     auto &cfg = ConfigMgr::Inst();
     auto server_list = cfg["chatservers"]["Name"];
 
@@ -35,7 +43,94 @@ StatusServiceImpl::StatusServiceImpl()
         spdlog::info("StatusServer 维护：{} {} {}", server.name, server.host, server.port);
 
         _servers[server.name] = server;
+        _server_names.push_back(server.name);
     }
+
+    std::string reserve_ms = cfg["LoadBalance"]["ReserveMs"];
+    _reserve_ms = reserve_ms.empty() ? 3000 : std::max(0, atoi(reserve_ms.c_str()));
+
+    // 第一个密钥用于签发，轮换时先在各ChatServer上加入新密钥，再把它放到这里的首位
+    _token_keys = LoginToken::ParseKeys(cfg["Token"]["Keys"]);
+    if (_token_keys.empty())
+    {
+        throw std::runtime_error("未配置登录token密钥 [Token] Keys");
+    }
+    std::string token_ttl = cfg["Token"]["TTLSec"];
+    _token_ttl = token_ttl.empty() ? 300 : std::max(1, atoi(token_ttl.c_str()));
+}
+
+void StatusServiceImpl::SyncServers()
+{
+    std::map<std::string, std::string> members;
+    if (!RedisMgr::GetInstance()->RegistryMembers(members))
+    {
+        return;
+    }
+
+    std::unordered_map<std::string, ChatServer> servers;
+    for (auto &item : members)
+    {
+        // 节点地址格式为 host,port,rpc_port，分配给客户端的是长连接端口
+        ChatServer server;
+        server.name = item.first;
+        std::stringstream ss(item.second);
+        if (!std::getline(ss, server.host, ',') || !std::getline(ss, server.port, ','))
+        {
+            spdlog::error("注册中心节点 {} 地址格式错误: {}", item.first, item.second);
+            continue;
+        }
+        // 新加入的节点还没有推送过负载，先用它定时写入的连接数垫底
+        auto count_str = RedisMgr::GetInstance()->HGet(LOGIN_COUNT, server.name);
+        server.con_count = count_str.empty() ? 0 : atoi(count_str.c_str());
+        servers[server.name] = server;
+    }
+
+    std::vector<std::string> server_names;
+    std::lock_guard<std::mutex> guard(_server_mtx);
+    for (auto &server : servers)
+    {
+        server_names.push_back(server.first);
+        auto iter = _servers.find(server.first);
+        if (iter == _servers.end() || iter->second.host != server.second.host || iter->second.port != server.second.port)
+        {
+            spdlog::info("StatusServer 加入：{} {} {}", server.second.name, server.second.host, server.second.port);
+            continue;
+        }
+        // 已有节点保留推送来的负载和未过期的预留
+        server.second.con_count = iter->second.con_count;
+        server.second.capacity = iter->second.capacity;
+        server.second.reservations.swap(iter->second.reservations);
+    }
+    for (auto &server : _servers)
+    {
+        if (servers.find(server.first) == servers.end())
+        {
+            spdlog::info("StatusServer 移除：{} {} {}", server.second.name, server.second.host, server.second.port);
+        }
+    }
+    _servers.swap(servers);
+    _server_names.swap(server_names);
+}
+
+void StatusServiceImpl::OnLoadReport(const std::string &message)
+{
+    std::stringstream ss(message);
+    std::string name, count_str, capacity_str;
+    if (!std::getline(ss, name, ',') || !std::getline(ss, count_str, ',') || !std::getline(ss, capacity_str, ','))
+    {
+        spdlog::error("ChatServer 负载上报格式错误: {}", message);
+        return;
+    }
+
+    std::lock_guard<std::mutex> guard(_server_mtx);
+    // 尚未同步到的节点忽略，等注册中心同步后再接收它的上报
+    auto iter = _servers.find(name);
+    if (iter == _servers.end())
+    {
+        return;
+    }
+    iter->second.con_count = atoi(count_str.c_str());
+    iter->second.capacity = std::max(1, atoi(capacity_str.c_str()));
 }
 
 std::string generate_unique_string()
@@ -49,99 +144,113 @@ std::string generate_unique_string()
     return unique_string;
 }
 
-Status StatusServiceImpl::GetChatServer(ServerContext *context, const GetChatServerReq *request, GetChatServerRsp *reply)
+grpc::ServerUnaryReactor *StatusServiceImpl::GetChatServer(grpc::CallbackServerContext *context, const GetChatServerReq *request, GetChatServerRsp *reply)
 {
-    std::string prefix("接收到GateServer的RPC请求 :  ");
+    auto start = std::chrono::steady_clock::now();
+    auto *reactor = context->DefaultReactor();
+    // 选服只查内存中的负载表，token在本地签名，不访问redis，直接在回调线程中完成
     const auto &server = getChatServer();
+    // 注册中心里暂时没有 ChatServer(全部下线或尚未同步)，不能给空地址签发token
+    if (server.name.empty())
+    {
+        spdlog::warn("没有可用的 ChatServer，uid {} 本次登录失败", request->uid());
+        reply->set_error(ErrorCodes::RPCFailed);
+        reactor->Finish(Status::OK);
+        RpcMetrics::GetInstance()->Record("GetChatServer", start);
+        return reactor;
+    }
+
+    LoginTokenClaims claims;
+    claims.uid = request->uid();
+    claims.server = server.name;
+    claims.expire = std::time(nullptr) + _token_ttl;
+    claims.id = generate_unique_string();
 
     reply->set_host(server.host);
     reply->set_port(server.port);
     reply->set_error(ErrorCodes::Success);
-    reply->set_token(generate_unique_string());
-    insertToken(request->uid(), reply->token());
-    
-    return Status::OK;
+    reply->set_token(LoginToken::Sign(_token_keys.front().first, _token_keys.front().second, claims));
+
+    reactor->Finish(Status::OK);
+    RpcMetrics::GetInstance()->Record("GetChatServer", start);
+    return reactor;
+}
+
+int StatusServiceImpl::currentLoad(ChatServer &server, std::chrono::steady_clock::time_point now)
+{
+    auto expire = now - std::chrono::milliseconds(_reserve_ms);
+    while (!server.reservations.empty() && server.reservations.front() < expire)
+    {
+        server.reservations.pop_front();
+    }
+    return server.con_count + (int)server.reservations.size();
 }
 
 ChatServer StatusServiceImpl::getChatServer()
 {
+    // 随机抽两台，选按容量加权后负载较低的一台(power of two choices)
+    // 上报有延迟，刚分配出去的登录先记为预留，避免同一时段的登录全部涌向同一台
+    thread_local std::mt19937 rng(std::random_device{}());
+
     std::lock_guard<std::mutex> guard(_server_mtx);
 
     // 如果没有可用服务器，返回默认值
-    if (_servers.empty())
+    if (_server_names.empty())
     {
         return ChatServer();
     }
 
-    auto minServer = _servers.begin()->second;
+    auto now = std::chrono::steady_clock::now();
+    size_t count = _server_names.size();
+    size_t first = std::uniform_int_distribution<size_t>(0, count - 1)(rng);
+    auto *best = &_servers[_server_names[first]];
+    int best_load = currentLoad(*best, now);
 
-    // 获取第一个服务器的连接数
-    auto count_str = RedisMgr::GetInstance()->HGet(LOGIN_COUNT, minServer.name);
-    if (count_str.empty())
-    {
-        // 如果为空，假设连接数为0（新启动的服务器或无连接）
-        minServer.con_count = 0;
-    }
-    else
+    if (count > 1)
     {
-        minServer.con_count = std::stoi(count_str);
-    }
-
-    // 使用范围for循环遍历所有服务器，找到连接数最少的
-    for (auto &server : _servers)
-    {
-        
-        // 获取当前服务器的连接数
-        auto count_str = RedisMgr::GetInstance()->HGet(LOGIN_COUNT, server.second.name);
-        if (count_str.empty())
-        {
-            server.second.con_count = 0;
-        }
-        else
-        {
-            server.second.con_count = std::stoi(count_str);
-        }
-
-        // 如果当前服务器连接数更少，则选择它
-        if (server.second.con_count < minServer.con_count)
+        size_t second = (first + 1 + std::uniform_int_distribution<size_t>(0, count - 2)(rng)) % count;
+        auto *other = &_servers[_server_names[second]];
+        int other_load = currentLoad(*other, now);
+        // 比较 load / capacity，交叉相乘避免浮点运算
+        if ((int64_t)other_load * best->capacity < (int64_t)best_load * other->capacity)
         {
-            minServer = server.second;
+            best = other;
+            best_load = other_load;
         }
     }
 
-    spdlog::info("返回 [{}] 连接信息:{}:{} 连接数: {}", minServer.name, minServer.host, minServer.port, minServer.con_count);
-    return minServer;
+    best->reservations.push_back(now);
+    spdlog::info("返回 [{}] 连接信息:{}:{} 连接数: {} 容量: {}", best->name, best->host, best->port, best_load, best->capacity);
+    return *best;
 }
 
-Status StatusServiceImpl::Login(ServerContext *context, const LoginReq *request, LoginRsp *reply)
+grpc::ServerUnaryReactor *StatusServiceImpl::Login(grpc::CallbackServerContext *context, const LoginReq *request, LoginRsp *reply)
 {
+    auto start = std::chrono::steady_clock::now();
+    auto *reactor = context->DefaultReactor();
+    Defer defer([reactor, start]()
+                {
+        reactor->Finish(Status::OK);
+        RpcMetrics::GetInstance()->Record("Login", start); });
+
     auto uid = request->uid();
     auto token = request->token();
 
-    std::string uid_str = std::to_string(uid);
-    std::string token_key = USERTOKENPREFIX + uid_str;
-    std::string token_value = "";
-    bool success = RedisMgr::GetInstance()->Get(token_key, token_value);
-    if (success)
+    // 与ChatServer相同，只做本地验签
+    LoginTokenClaims claims;
+    if (!LoginToken::Parse(token, _token_keys, claims) || claims.expire < (long long)std::time(nullptr))
     {
-        reply->set_error(ErrorCodes::UidInvalid);
-        return Status::OK;
+        reply->set_error(ErrorCodes::TokenInvalid);
+        return reactor;
     }
 
-    if (token_value != token)
+    if (claims.uid != uid)
     {
-        reply->set_error(ErrorCodes::TokenInvalid);
-        return Status::OK;
+        reply->set_error(ErrorCodes::UidInvalid);
+        return reactor;
     }
     reply->set_error(ErrorCodes::Success);
     reply->set_uid(uid);
     reply->set_token(token);
-    return Status::OK;
-}
-
-void StatusServiceImpl::insertToken(int uid, std::string token)
-{
-    std::string uid_str = std::to_string(uid);
-    std::string token_key = USERTOKENPREFIX + uid_str;
-    RedisMgr::GetInstance()->Set(token_key, token);
+    return reactor;
 }